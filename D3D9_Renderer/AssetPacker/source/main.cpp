@@ -0,0 +1,161 @@
+//>Offline asset packer: every file under the given directories -> one LZ4-compressed, page-aligned pack.
+//>Usage: AssetPacker [--output file] [--verify] [directory ...]   (defaults to data -> data.pack)
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "../../D3D9_Renderer/source/utils/AssetPack.h"
+#include "../../D3D9_Renderer/source/utils/Hash.h"
+#include "../../D3D9_Renderer/source/utils/MappedFile.h"
+#include "../../D3D9_Renderer/source/utils/ThreadPool.h"
+#include "../../D3D9_Renderer/source/utils/Time.h"
+
+namespace filesystem = std::experimental::filesystem;
+
+namespace
+{
+    struct PackJob
+    {
+        std::string sourcePath;
+        bool isCompressible;
+        bool isRead;
+    };
+
+    std::string GetLowerExtension(const filesystem::path& path)
+    {
+        std::string extension = path.extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+        return extension;
+    }
+
+    //>Reads every entry back out of the written pack and compares it with the content hash taken from the source
+    bool VerifyPack(const std::string& packPath, const std::vector<renderer::AssetPackSource>& sources)
+    {
+        auto& assetPack = renderer::AssetPack::GetInstance();
+        if (!assetPack.Mount(packPath))
+        {
+            std::printf("verify: cannot mount %s\n", packPath.c_str());
+            return false;
+        }
+
+        uint32_t mismatches = 0;
+        std::vector<uint8_t> inflated;
+        for (const auto& source : sources)
+        {
+            const auto entry = assetPack.Find(source.name);
+            bool matches = entry != nullptr;
+            if (matches && entry->chunkCount == 0)
+                matches = renderer::HashBytes(assetPack.GetStoredData(*entry), entry->size) == source.contentHash;
+            else if (matches)
+                matches = assetPack.Inflate(*entry, inflated) && renderer::HashBytes(inflated.data(), inflated.size()) == source.contentHash;
+            if (!matches)
+            {
+                ++mismatches;
+                std::printf("verify: %s does not read back\n", source.name.c_str());
+            }
+        }
+        assetPack.Unmount();
+        std::printf("verify: %zu files, %u mismatches\n", sources.size(), mismatches);
+        return mismatches == 0;
+    }
+
+    inline double ToMB(size_t bytes) { return static_cast<double>(bytes) / (1024.0 * 1024.0); }
+}
+
+int main(int argc, char** argv)
+{
+    std::string outputPath = "data.pack";
+    bool verify = false;
+    std::vector<std::string> directories;
+    for (int itr = 1; itr < argc; ++itr)
+    {
+        const std::string arg = argv[itr];
+        if (arg == "--output" && itr + 1 < argc)
+            outputPath = argv[++itr];
+        else if (arg == "--verify")
+            verify = true;
+        else
+            directories.emplace_back(arg);
+    }
+    if (directories.empty())
+        directories = { "data" };
+
+    std::vector<PackJob> jobs;
+    for (const auto& directory : directories)
+    {
+        std::error_code error;
+        for (const auto& entry : filesystem::recursive_directory_iterator(directory, error))
+        {
+            if (!filesystem::is_regular_file(entry.status()))
+                continue;
+            const std::string extension = GetLowerExtension(entry.path());
+            if (extension == ".tmp" || extension == ".pack")
+                continue; //a cache write that never finished, or an earlier pack
+
+            PackJob job = {};
+            job.sourcePath = entry.path().generic_string();
+            //the cooked model stays mapped while its chunks stream in; compressed it would have to be inflated whole
+            job.isCompressible = extension != ".mdlcache";
+            jobs.emplace_back(job);
+        }
+        if (error)
+            std::printf("skipping %s: %s\n", directory.c_str(), error.message().c_str());
+    }
+
+    renderer::Stopwatch stopwatch;
+    std::vector<renderer::AssetPackSource> sources(jobs.size());
+    auto& threadPool = renderer::ThreadPool::GetInstance();
+    threadPool.ParallelFor(static_cast<uint32_t>(jobs.size()), [&jobs, &sources](uint32_t itr)
+        {
+            renderer::MappedFile source;
+            if (!source.Open(jobs[itr].sourcePath))
+                return;
+            sources[itr] = renderer::AssetPack::CompressEntry(jobs[itr].sourcePath, source.GetData(), source.GetSize(), jobs[itr].isCompressible);
+            jobs[itr].isRead = true;
+        });
+    const double compressMs = stopwatch.GetElapsedMs();
+
+    //empty and unreadable files stay loose; the runtime falls back to them
+    std::vector<renderer::AssetPackSource> packed;
+    uint32_t compressed = 0;
+    size_t sourceBytes = 0;
+    size_t storedBytes = 0;
+    for (size_t itr = 0; itr < jobs.size(); ++itr)
+    {
+        if (!jobs[itr].isRead)
+        {
+            std::printf("skipped  %s\n", jobs[itr].sourcePath.c_str());
+            continue;
+        }
+        const auto& source = sources[itr];
+        sourceBytes += source.size;
+        storedBytes += source.storedData.size();
+        if (!source.chunks.empty())
+        {
+            ++compressed;
+            std::printf("lz4      %-56s %8.2f MB -> %6.2f MB\n", source.name.c_str(), ToMB(source.size), ToMB(source.storedData.size()));
+        }
+        packed.emplace_back(std::move(sources[itr]));
+    }
+
+    stopwatch.Restart();
+    if (!renderer::AssetPack::Write(outputPath, packed))
+    {
+        std::printf("cannot write %s\n", outputPath.c_str());
+        return 1;
+    }
+    const double writeMs = stopwatch.GetElapsedMs();
+
+    std::printf("\n%zu files (%u compressed, %zu stored) -> %s in %.2f ms on %u threads, written in %.2f ms\n", packed.size(), compressed,
+        packed.size() - compressed, outputPath.c_str(), compressMs, threadPool.GetThreadCount() + 1, writeMs);
+    if (sourceBytes > 0)
+        std::printf("data: %.2f MB -> %.2f MB (%.2fx smaller) before page alignment\n", ToMB(sourceBytes), ToMB(storedBytes), static_cast<double>(sourceBytes) / storedBytes);
+
+    if (verify && !VerifyPack(outputPath, packed))
+        return 1;
+    return 0;
+}
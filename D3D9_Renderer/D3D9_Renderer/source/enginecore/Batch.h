@@ -1,17 +1,225 @@
 #pragma once
 
+#include <d3dx9.h>
+#include <array>
+#include <algorithm>
+
+#include "../renderer/d3d9/VertexDefs.h"
+#include "../renderer/Mesh.h"
+#include "../renderer/MeshCluster.h"
+
 namespace renderer
 {
+    constexpr float LodPixelError = 1.0f;  //a level is used while its simplification error projects to at most this many pixels
+    constexpr float LodHysteresis = 0.75f; //switching to a coarser level also waits until its error is this far under the limit
+    constexpr uint32_t MaxIndex16Vertices = 0x10000; //vertices a 16-bit index reaches from its base vertex
+    constexpr uint32_t NoInstanceGroup = UINT32_MAX;
+    constexpr uint32_t NoSubBatch = UINT32_MAX;
+
+    //>Index range of one level of detail; every level shares the vertex range of LOD0
+    struct LodRange
+    {
+        LodRange()
+            :indexStart(0),
+            primitiveCount(0),
+            error(0.0f)
+        {}
+
+        uint32_t indexStart;
+        uint32_t primitiveCount;
+        float error; //model units
+    };
+
+    //>Stretch of a sub-batch's indices whose meshes all hang off one scene node. Only kept for sub-batches spanning
+    //>several nodes, which draw once while the nodes are at rest and once per span after one of them has moved.
+    struct NodeSpan
+    {
+        uint32_t indexOffset; //from the sub-batch's indexStart
+        uint32_t primitiveCount;
+        uint32_t transformIndex;
+    };
+
+    //>Run of a batch's meshes drawn with one DrawIndexedPrimitive. Indices are stored relative to baseVertex, so runs whose
+    //>vertices fit MaxIndex16Vertices use the 16-bit index buffer; only a single mesh larger than that keeps 32-bit indices.
+    struct SubBatchDesc
+    {
+        SubBatchDesc()
+            :baseVertex(0),
+            sourceVertex(0),
+            vertexCount(0),
+            indexStart(0),
+            primitiveCount(0),
+            sourceIndexStart(0),
+            clusterStart(0),
+            clusterCount(0),
+            clusterIndexStart(0),
+            transformIndex(0),
+            nodeSpanStart(0),
+            nodeSpanCount(0),
+            repeatOf(NoSubBatch),
+            contentHash(0),
+            isIndex32(false)
+        {}
+
+        uint32_t baseVertex;       //in the device vertex buffer, which leaves out duplicate meshes
+        uint32_t sourceVertex;     //the same vertex in the model-wide vertex image
+        uint32_t vertexCount;
+        uint32_t indexStart;       //in the 16- or 32-bit index buffer
+        uint32_t primitiveCount;
+        uint32_t sourceIndexStart; //in the model-wide index image
+        uint32_t clusterStart;     //LOD0 sub-batches only
+        uint32_t clusterCount;
+        uint32_t clusterIndexStart; //in the cluster culler's copy of its width, when it has clusters
+        uint32_t transformIndex;   //scene node of all its meshes; NoTransform when they hang off several, see nodeSpanStart
+        uint32_t nodeSpanStart;    //in ModelManager::GetNodeSpans; nodeSpanCount is 0 for a single node
+        uint32_t nodeSpanCount;
+        uint32_t repeatOf;         //a run lacking a level draws its coarsest sub-batch again: that one's index, every other field unset
+        uint64_t contentHash;      //of its meshes' Mesh::GetContentHash, in order; 0 without mesh hashing
+        bool isIndex32;
+    };
+
     struct BatchDesc
     {
         BatchDesc()
             :primitiveCount(0),
             vertexCount(0),
-            indexStart(0)
+            vertexStart(0),
+            indexStart(0),
+            isResident(false),
+            lodCount(1),
+            lods(),
+            boundsMin(0.0f, 0.0f, 0.0f),
+            boundsMax(0.0f, 0.0f, 0.0f),
+            center(0.0f, 0.0f, 0.0f),
+            radius(0.0f),
+            clusterStart(0),
+            clusterCount(0),
+            subBatchStart(),
+            subBatchCount()
         {}
 
         uint32_t primitiveCount;
         uint32_t vertexCount;
+        uint32_t vertexStart;
         uint32_t indexStart;
+        bool isResident; //vertex and index ranges are in the device buffers
+        uint32_t lodCount;
+        std::array<LodRange, MaxMeshLods> lods; //[0] mirrors indexStart/primitiveCount
+        D3DXVECTOR3 boundsMin; //box of the meshes the batch draws itself, instanced ones left to their groups
+        D3DXVECTOR3 boundsMax;
+        D3DXVECTOR3 center;    //bounding sphere of the same meshes
+        float radius;
+        uint32_t clusterStart; //LOD0 clusters in ModelManager::GetClusterList
+        uint32_t clusterCount;
+        std::array<uint32_t, MaxMeshLods> subBatchStart; //per level, in ModelManager::GetSubBatchList
+        std::array<uint32_t, MaxMeshLods> subBatchCount;
     };
-}
\ No newline at end of file
+
+    //>One mesh as the unit of geometry streaming: its ranges in the model-wide images and its bounds
+    struct ChunkDesc
+    {
+        ChunkDesc()
+            :materialIndex(0),
+            vertexStart(0),
+            vertexCount(0),
+            vertexStride(sizeof(PositionVertex)),
+            indexStride(sizeof(uint32_t)),
+            indexStart(0),
+            primitiveCount(0),
+            boundsMin(0.0f, 0.0f, 0.0f),
+            boundsMax(0.0f, 0.0f, 0.0f),
+            center(0.0f, 0.0f, 0.0f),
+            radius(0.0f),
+            lodCount(1),
+            lods(),
+            clusterStart(0),
+            clusterCount(0),
+            transformIndex(0),
+            instanceGroup(NoInstanceGroup),
+            contentHash(0)
+        {}
+
+        //>Vertices plus the indices of every level
+        inline uint32_t GetSizeInBytes() const
+        {
+            uint32_t indexCount = 0;
+            for (uint32_t level = 0; level < lodCount; ++level)
+                indexCount += lods[level].primitiveCount * 3;
+            return vertexCount * vertexStride + indexCount * indexStride;
+        }
+
+        uint32_t materialIndex;
+        uint32_t vertexStart;
+        uint32_t vertexCount;
+        uint32_t vertexStride; //bytes per vertex in the device format
+        uint32_t indexStride;  //2 unless the chunk has more than MaxIndex16Vertices vertices
+        uint32_t indexStart;
+        uint32_t primitiveCount;
+        D3DXVECTOR3 boundsMin;
+        D3DXVECTOR3 boundsMax;
+        D3DXVECTOR3 center; //bounding sphere centred on the box, over every copy for a prototype
+        float radius;
+        uint32_t lodCount;
+        std::array<LodRange, MaxMeshLods> lods; //[0] mirrors indexStart/primitiveCount
+        uint32_t clusterStart;
+        uint32_t clusterCount;
+        uint32_t transformIndex;
+        uint32_t instanceGroup; //set on a prototype: its bounds cover every copy and it is drawn instanced
+        uint64_t contentHash;   //the mesh's Mesh::GetContentHash
+    };
+
+    //>A prototype mesh and its duplicates: one copy of the geometry drawn once per instance offset
+    struct InstanceGroupDesc
+    {
+        InstanceGroupDesc()
+            :meshIndex(0),
+            materialIndex(0),
+            chunkIndex(0),
+            vertexCount(0),
+            lodCount(1),
+            lods(),
+            subBatchStart(0),
+            center(0.0f, 0.0f, 0.0f),
+            radius(0.0f),
+            instanceStart(0),
+            instanceCount(0),
+            isResident(false)
+        {}
+
+        uint32_t meshIndex; //the prototype
+        uint32_t materialIndex;
+        uint32_t chunkIndex; //the prototype's chunk when streaming
+        uint32_t vertexCount;
+        uint32_t lodCount;
+        std::array<LodRange, MaxMeshLods> lods; //the prototype's, for selection and statistics
+        uint32_t subBatchStart; //one sub-batch per level in ModelManager::GetSubBatchList, when not streaming
+        D3DXVECTOR3 center; //bounding sphere of the prototype where it was imported
+        float radius;
+        uint32_t instanceStart; //offsets in ModelManager::GetInstanceOffsets (and their nodes in GetInstanceTransforms), the prototype's own zero offset first
+        uint32_t instanceCount;
+        bool isResident;
+    };
+
+    //>Coarsest level whose error, projected from the nearest point of the bounding sphere, stays within LodPixelError.
+    //>Finer levels are taken at once; coarser ones only once they also clear LodPixelError * LodHysteresis, so a level does not flicker at the boundary.
+    inline uint32_t SelectLod(const std::array<LodRange, MaxMeshLods>& lods, uint32_t lodCount, const D3DXVECTOR3& center, float radius,
+        const D3DXVECTOR3& viewPosition, float pixelsPerUnitAtUnitDistance, uint32_t currentLod)
+    {
+        const D3DXVECTOR3 toCenter = center - viewPosition;
+        const float distance = (std::max)(D3DXVec3Length(&toCenter) - radius, 1.0f); //clamped to the near plane
+        auto projectedError = [&](uint32_t level) { return lods[level].error / distance * pixelsPerUnitAtUnitDistance; };
+
+        uint32_t desiredLod = 0;
+        for (uint32_t level = 1; level < lodCount && projectedError(level) <= LodPixelError; ++level)
+            desiredLod = level;
+
+        currentLod = (std::min)(currentLod, lodCount - 1);
+        if (desiredLod <= currentLod)
+            return desiredLod;
+
+        uint32_t coarserLod = currentLod;
+        for (uint32_t level = currentLod + 1; level <= desiredLod && projectedError(level) <= LodPixelError * LodHysteresis; ++level)
+            coarserLod = level;
+        return coarserLod;
+    }
+}
@@ -0,0 +1,220 @@
+#include <cassert>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <initializer_list>
+
+#include "ClusterCuller.h"
+#include "../utils/ComHelpers.h"
+
+namespace renderer
+{
+    namespace
+    {
+        //>Corner of the box furthest along the plane normal; the box is outside when even that corner is behind the plane
+        bool IsBoxInFrustum(const ClusterView& view, const D3DXVECTOR3& boundsMin, const D3DXVECTOR3& boundsMax)
+        {
+            for (const auto& plane : view.frustumPlanes)
+            {
+                const D3DXVECTOR3 corner(plane.a >= 0.0f ? boundsMax.x : boundsMin.x,
+                    plane.b >= 0.0f ? boundsMax.y : boundsMin.y,
+                    plane.c >= 0.0f ? boundsMax.z : boundsMin.z);
+                if (D3DXPlaneDotCoord(&plane, &corner) < 0.0f)
+                    return false;
+            }
+            return true;
+        }
+    }
+
+    ClusterView BuildClusterView(const D3DXMATRIX& worldViewProj, const D3DXVECTOR3& position)
+    {
+        //clip = v * M, so each plane is a sum of the matrix columns; D3D clips z to [0, w]
+        const D3DXMATRIX& m = worldViewProj;
+        ClusterView view;
+        view.position = position;
+        view.frustumPlanes[0] = D3DXPLANE(m(0, 3) + m(0, 0), m(1, 3) + m(1, 0), m(2, 3) + m(2, 0), m(3, 3) + m(3, 0)); //left
+        view.frustumPlanes[1] = D3DXPLANE(m(0, 3) - m(0, 0), m(1, 3) - m(1, 0), m(2, 3) - m(2, 0), m(3, 3) - m(3, 0)); //right
+        view.frustumPlanes[2] = D3DXPLANE(m(0, 3) + m(0, 1), m(1, 3) + m(1, 1), m(2, 3) + m(2, 1), m(3, 3) + m(3, 1)); //bottom
+        view.frustumPlanes[3] = D3DXPLANE(m(0, 3) - m(0, 1), m(1, 3) - m(1, 1), m(2, 3) - m(2, 1), m(3, 3) - m(3, 1)); //top
+        view.frustumPlanes[4] = D3DXPLANE(m(0, 2), m(1, 2), m(2, 2), m(3, 2));                                         //near
+        view.frustumPlanes[5] = D3DXPLANE(m(0, 3) - m(0, 2), m(1, 3) - m(1, 2), m(2, 3) - m(2, 2), m(3, 3) - m(3, 2)); //far
+        for (auto& plane : view.frustumPlanes)
+            D3DXPlaneNormalize(&plane, &plane);
+        return view;
+    }
+
+    bool IsSphereInFrustum(const ClusterView& view, const D3DXVECTOR3& center, float radius)
+    {
+        for (const auto& plane : view.frustumPlanes)
+        {
+            if (D3DXPlaneDotCoord(&plane, &center) < -radius)
+                return false;
+        }
+        return true;
+    }
+
+    void TransformSphere(const D3DXVECTOR3& center, float radius, const D3DXMATRIX& world, D3DXVECTOR3& outCenter, float& outRadius)
+    {
+        D3DXVec3TransformCoord(&outCenter, &center, &world);
+        float maxScaleSq = 0.0f;
+        for (int32_t row = 0; row < 3; ++row)
+            maxScaleSq = (std::max)(maxScaleSq, world(row, 0) * world(row, 0) + world(row, 1) * world(row, 1) + world(row, 2) * world(row, 2));
+        outRadius = radius * sqrtf(maxScaleSq);
+    }
+
+    ClusterCuller::ClusterCuller()
+        :m_index16(),
+        m_index32(),
+        m_frameStats()
+    {
+    }
+
+    ClusterCuller::~ClusterCuller()
+    {
+        ReleaseDeviceResources();
+    }
+
+    bool ClusterCuller::BeginFrame(IDirect3DDevice9* device, uint32_t maxIndices16, uint32_t maxIndices32)
+    {
+        assert(m_index16.mapped == nullptr && m_index32.mapped == nullptr);
+        m_frameStats = ClusterCullStats();
+        if (maxIndices16 == 0 && maxIndices32 == 0)
+            return false;
+
+        if (!MapBuffer(device, m_index16, maxIndices16, D3DFMT_INDEX16) || !MapBuffer(device, m_index32, maxIndices32, D3DFMT_INDEX32))
+        {
+            EndFrame();
+            return false;
+        }
+        return true;
+    }
+
+    bool ClusterCuller::MapBuffer(IDirect3DDevice9* device, FrameIndexBuffer& frameBuffer, uint32_t maxIndices, D3DFORMAT format)
+    {
+        frameBuffer.usedIndices = 0;
+        if (maxIndices == 0)
+            return true;
+
+        const UINT indexSize = format == D3DFMT_INDEX16 ? sizeof(uint16_t) : sizeof(uint32_t);
+        if (frameBuffer.buffer == nullptr || frameBuffer.capacity < maxIndices)
+        {
+            ComSafeRelease(frameBuffer.buffer);
+            frameBuffer.buffer = nullptr;
+            frameBuffer.capacity = 0;
+            if (FAILED(device->CreateIndexBuffer(maxIndices * indexSize, D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY, format, D3DPOOL_DEFAULT, &frameBuffer.buffer, nullptr)))
+            {
+                frameBuffer.buffer = nullptr;
+                return false;
+            }
+            frameBuffer.capacity = maxIndices;
+        }
+
+        //DISCARD hands out fresh memory, so last frame's draws never stall the lock
+        void* bufferData = nullptr;
+        if (FAILED(frameBuffer.buffer->Lock(0, 0, &bufferData, D3DLOCK_DISCARD)))
+            return false;
+        frameBuffer.mapped = bufferData;
+        return true;
+    }
+
+    ClusterDrawRange ClusterCuller::AppendVisible(const ClusterView& view, const MeshCluster* clusters, uint32_t clusterCount,
+        const void* indexSource, uint32_t sourceIndexStart, bool isIndex32)
+    {
+        FrameIndexBuffer& frameBuffer = isIndex32 ? m_index32 : m_index16;
+        assert(frameBuffer.mapped != nullptr);
+        const size_t indexBytes = isIndex32 ? sizeof(uint32_t) : sizeof(uint16_t);
+        ClusterDrawRange range = { frameBuffer.buffer, frameBuffer.usedIndices, 0 };
+        for (uint32_t itr = 0; itr < clusterCount; ++itr)
+        {
+            const auto& cluster = clusters[itr];
+            if (!IsClusterVisible(view, cluster))
+                continue;
+
+            const uint32_t indexCount = cluster.primitiveCount * 3;
+            assert(frameBuffer.usedIndices + indexCount <= frameBuffer.capacity);
+            const uint8_t* srcIndices = static_cast<const uint8_t*>(indexSource) + (cluster.indexStart - sourceIndexStart) * indexBytes;
+            memcpy(static_cast<uint8_t*>(frameBuffer.mapped) + frameBuffer.usedIndices * indexBytes, srcIndices, indexCount * indexBytes);
+            frameBuffer.usedIndices += indexCount;
+            range.primitiveCount += cluster.primitiveCount;
+        }
+        m_frameStats.trianglesKept += range.primitiveCount;
+        return range;
+    }
+
+    ClusterDrawRange ClusterCuller::AppendVisibleRebased(const ClusterView& view, const MeshCluster* clusters, uint32_t clusterCount,
+        const uint32_t* indexSource, uint32_t rebase, bool isIndex32)
+    {
+        FrameIndexBuffer& frameBuffer = isIndex32 ? m_index32 : m_index16;
+        assert(frameBuffer.mapped != nullptr);
+        ClusterDrawRange range = { frameBuffer.buffer, frameBuffer.usedIndices, 0 };
+        for (uint32_t itr = 0; itr < clusterCount; ++itr)
+        {
+            const auto& cluster = clusters[itr];
+            if (!IsClusterVisible(view, cluster))
+                continue;
+
+            const uint32_t indexCount = cluster.primitiveCount * 3;
+            assert(frameBuffer.usedIndices + indexCount <= frameBuffer.capacity);
+            const uint32_t* srcIndices = indexSource + cluster.indexStart;
+            if (!isIndex32)
+            {
+                uint16_t* dstIndices = static_cast<uint16_t*>(frameBuffer.mapped) + frameBuffer.usedIndices;
+                for (uint32_t index = 0; index < indexCount; ++index)
+                    dstIndices[index] = static_cast<uint16_t>(srcIndices[index] - rebase);
+            }
+            else if (rebase == 0)
+                memcpy(static_cast<uint32_t*>(frameBuffer.mapped) + frameBuffer.usedIndices, srcIndices, indexCount * sizeof(uint32_t));
+            else
+            {
+                uint32_t* dstIndices = static_cast<uint32_t*>(frameBuffer.mapped) + frameBuffer.usedIndices;
+                for (uint32_t index = 0; index < indexCount; ++index)
+                    dstIndices[index] = srcIndices[index] - rebase;
+            }
+            frameBuffer.usedIndices += indexCount;
+            range.primitiveCount += cluster.primitiveCount;
+        }
+        m_frameStats.trianglesKept += range.primitiveCount;
+        return range;
+    }
+
+    bool ClusterCuller::IsClusterVisible(const ClusterView& view, const MeshCluster& cluster)
+    {
+        ++m_frameStats.clustersTested;
+        m_frameStats.trianglesTested += cluster.primitiveCount;
+
+        //cone first: it is one dot product, the frustum is up to twelve
+        if (cluster.IsBackFacing(view.position))
+        {
+            ++m_frameStats.backFacingCulled;
+            return false;
+        }
+        if (!IsSphereInFrustum(view, cluster.center, cluster.radius) || !IsBoxInFrustum(view, cluster.boundsMin, cluster.boundsMax))
+        {
+            ++m_frameStats.frustumCulled;
+            return false;
+        }
+        return true;
+    }
+
+    void ClusterCuller::EndFrame()
+    {
+        for (FrameIndexBuffer* frameBuffer : { &m_index16, &m_index32 })
+        {
+            if (frameBuffer->mapped == nullptr)
+                continue;
+            frameBuffer->buffer->Unlock();
+            frameBuffer->mapped = nullptr;
+        }
+    }
+
+    void ClusterCuller::ReleaseDeviceResources()
+    {
+        EndFrame();
+        for (FrameIndexBuffer* frameBuffer : { &m_index16, &m_index32 })
+        {
+            ComSafeRelease(frameBuffer->buffer);
+            frameBuffer->buffer = nullptr;
+            frameBuffer->capacity = 0;
+        }
+    }
+}
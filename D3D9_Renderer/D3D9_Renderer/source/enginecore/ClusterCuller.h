@@ -0,0 +1,102 @@
+#pragma once
+
+#include <d3d9.h>
+#include <d3dx9.h>
+#include <array>
+
+#include "../renderer/MeshCluster.h"
+
+namespace renderer
+{
+    //>Camera position and world-space frustum planes (normals point inwards)
+    struct ClusterView
+    {
+        D3DXVECTOR3 position;
+        std::array<D3DXPLANE, 6> frustumPlanes;
+    };
+
+    //>Planes of a row-vector world-view-projection matrix (Gribb & Hartmann)
+    [[nodiscard]] ClusterView BuildClusterView(const D3DXMATRIX& worldViewProj, const D3DXVECTOR3& position);
+    [[nodiscard]] bool IsSphereInFrustum(const ClusterView& view, const D3DXVECTOR3& center, float radius);
+    //>Bounding sphere moved by an affine world matrix; the radius grows by the matrix's largest axis scale
+    void TransformSphere(const D3DXVECTOR3& center, float radius, const D3DXMATRIX& world, D3DXVECTOR3& outCenter, float& outRadius);
+
+    //>Where a batch's surviving clusters landed in the frame's index buffers
+    struct ClusterDrawRange
+    {
+        IDirect3DIndexBuffer9* indexBuffer;
+        uint32_t indexStart;
+        uint32_t primitiveCount;
+    };
+
+    //>Per-frame counters, reset by BeginFrame
+    struct ClusterCullStats
+    {
+        ClusterCullStats()
+            :clustersTested(0),
+            frustumCulled(0),
+            backFacingCulled(0),
+            trianglesTested(0),
+            trianglesKept(0)
+        {}
+
+        uint32_t clustersTested;
+        uint32_t frustumCulled;
+        uint32_t backFacingCulled;
+        uint64_t trianglesTested;
+        uint64_t trianglesKept;
+    };
+
+    //>Rejects LOD0 clusters outside the frustum or facing away from the camera and compacts the survivors' indices
+    //>into a dynamic 16-bit and a dynamic 32-bit index buffer per frame. Appends happen between BeginFrame and EndFrame; draws after EndFrame.
+    class ClusterCuller
+    {
+    public:
+        ClusterCuller();
+        ~ClusterCuller();
+
+        ClusterCuller(const ClusterCuller&) = delete;
+        ClusterCuller& operator=(const ClusterCuller&) = delete;
+
+        //>Grows each buffer to its maximum if needed and maps it with DISCARD; a width with no indices gets no buffer.
+        //>False when a buffer that is needed is unavailable.
+        [[nodiscard]] bool BeginFrame(IDirect3DDevice9* device, uint32_t maxIndices16, uint32_t maxIndices32);
+        //>indexSource holds the sub-batch's LOD0 indices in its draw width, already rebased; the range starting at the
+        //>model-wide index sourceIndexStart sits at its start, so a cluster's indices are copied as they are
+        [[nodiscard]] ClusterDrawRange AppendVisible(const ClusterView& view, const MeshCluster* clusters, uint32_t clusterCount,
+            const void* indexSource, uint32_t sourceIndexStart, bool isIndex32);
+        //>Streamed chunks: indexSource is the model-wide index image; rebase is subtracted from every index copied and has
+        //>to leave 16-bit ranges within MaxIndex16Vertices
+        [[nodiscard]] ClusterDrawRange AppendVisibleRebased(const ClusterView& view, const MeshCluster* clusters, uint32_t clusterCount,
+            const uint32_t* indexSource, uint32_t rebase, bool isIndex32);
+        void EndFrame();
+        //>The buffers live in the default pool: release on device lost, they are recreated by the next BeginFrame
+        void ReleaseDeviceResources();
+
+        inline const ClusterCullStats& GetFrameStats() const { return m_frameStats; }
+
+    private:
+        struct FrameIndexBuffer
+        {
+            FrameIndexBuffer()
+                :buffer(nullptr),
+                capacity(0),
+                mapped(nullptr),
+                usedIndices(0)
+            {}
+
+            IDirect3DIndexBuffer9* buffer;
+            uint32_t capacity; //indices
+            void* mapped;      //between BeginFrame and EndFrame
+            uint32_t usedIndices;
+        };
+
+        [[nodiscard]] bool MapBuffer(IDirect3DDevice9* device, FrameIndexBuffer& frameBuffer, uint32_t maxIndices, D3DFORMAT format);
+        //>Cone, sphere and box tests; counts the cluster in the frame stats
+        [[nodiscard]] bool IsClusterVisible(const ClusterView& view, const MeshCluster& cluster);
+
+        FrameIndexBuffer m_index16;
+        FrameIndexBuffer m_index32;
+        ClusterCullStats m_frameStats;
+    };
+}
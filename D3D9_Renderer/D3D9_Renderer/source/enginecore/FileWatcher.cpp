@@ -18,19 +18,42 @@ namespace renderer
     {
         assert(filesystem::exists(filePath));
         
-        auto lastModifiedTime = filesystem::last_write_time(filePath);
+        std::error_code error;
+        auto lastModifiedTime = filesystem::last_write_time(filePath, error);
         
+        //reuse the slot of a removed watch before growing
+        for (size_t itr = 0; itr < m_filePathToWatch.size(); ++itr)
+        {
+            if (m_filePathToWatch[itr].empty())
+            {
+                m_filePathToWatch[itr] = filePath;
+                m_watchFilesLastWriteTime[itr] = lastModifiedTime;
+                return itr;
+            }
+        }
         m_filePathToWatch.emplace_back(filePath);
         m_watchFilesLastWriteTime.emplace_back(lastModifiedTime);
         
         return (m_filePathToWatch.size() - 1); //return the index of the element added
     }
 
+    void FileWatcher::RemoveFileFromWatch(size_t fileIndex)
+    {
+        assert(fileIndex < m_filePathToWatch.size());
+        m_filePathToWatch[fileIndex].clear();
+    }
+
     bool FileWatcher::IsFileModified(size_t fileIndex)
     {
         assert(fileIndex < m_filePathToWatch.size());
+        if (m_filePathToWatch[fileIndex].empty())
+            return false;
 
-        auto time = filesystem::last_write_time(m_filePathToWatch[fileIndex]);
+        //polled every frame: an exporter deleting or renaming the file mid-save must not throw out of the render loop
+        std::error_code error;
+        auto time = filesystem::last_write_time(m_filePathToWatch[fileIndex], error);
+        if (error)
+            return false;
         
         if (time > m_watchFilesLastWriteTime[fileIndex])
         {
@@ -13,9 +13,12 @@ namespace renderer
         ~FileWatcher();
 
         [[nodiscard]]size_t AddFileForWatch(std::string filePath);
+        //>Stops watching; the index may be handed out again by a later AddFileForWatch
+        void RemoveFileFromWatch(size_t fileIndex);
+        //>A file that cannot be read right now (deleted or renamed mid-save) counts as not modified
         bool IsFileModified(size_t fileIndex);
     private:
-        std::vector<std::string> m_filePathToWatch;
+        std::vector<std::string> m_filePathToWatch; //empty where a watch was removed
         std::vector<std::chrono::system_clock::time_point> m_watchFilesLastWriteTime;
     };
 }
\ No newline at end of file
@@ -1,108 +1,778 @@
+#include <cassert>
+#include <algorithm>
+
 #include "ModelManager.h"
 #include "../utils/Logger.h"
+#include "../utils/Time.h"
+#include "../utils/MemoryStats.h"
+#include "../utils/ThreadPool.h"
+#include "../utils/ComHelpers.h"
+#include "../utils/AssetFile.h"
+#include "../utils/AssetPack.h"
+#include "../utils/Hash.h"
+#include "../renderer/TextureCache.h"
 
 namespace renderer
 {
+    namespace
+    {
+        const char* PlaceholderTexturePaths[Material::TextureTypeCount] =
+        {
+            "data/DefaultTex/default_diffuse.png",
+            "data/DefaultTex/default_normal.png",
+            "data/DefaultTex/default_specular.png",
+            "data/DefaultTex/default_opacity.png"
+        };
+    }
+
 	ModelManager::ModelManager()
-		:m_model(new Model())
+		:m_model(new Model()),
+        m_deviceRef(nullptr),
+        m_importJob(),
+        m_loadState(ModelLoadState::Resident),
+        m_loadStopwatch(),
+        m_residentBatches(0),
+        m_residentGroups(0),
+        m_texturesResident(false),
+        m_placeholderTextures(),
+        m_batchDesc(),
+        m_chunkDesc(),
+        m_clusters(),
+        m_subBatches(),
+        m_nodeSpans(),
+        m_instanceGroups(),
+        m_instanceOffsets(),
+        m_instanceTransforms(),
+        m_meshInstanceGroup(),
+        m_modelPath(),
+        m_placements(),
+        m_isStreamingGeometry(false),
+        m_isCullingClusters(false),
+        m_vertexFormat(VertexFormat::Full),
+        m_residencyPolicy(ResidencyPolicy::ReleaseAfterUpload),
+        m_streamSource(),
+        m_compactVertices(),
+        m_indexImage16(),
+        m_indexImage32(),
+        m_clusterIndices16(),
+        m_clusterIndices32(),
+        m_vBufferVertexCount(0),
+        m_iBufferIndexCount(0),
+        m_primitiveCount(0),
+        m_deviceVertexCount(0),
+        m_lod0IndexCount16(0),
+        m_lod0IndexCount32(0)
 	{
 	}
 	ModelManager::~ModelManager()
 	{
+        //the worker writes into m_model; it has to finish before the model goes away
+        if (m_importJob.valid())
+            m_importJob.wait();
+
         delete m_model;
+        for (auto& texture : m_placeholderTextures)
+        {
+            ComSafeRelease(texture);
+        }
+        TextureCache::GetInstance().PurgeUnused();
 	}
-	void ModelManager::AddModelToWorld(IDirect3DDevice9* deviceRef, std::string filePath)
+	uint32_t ModelManager::AddModelToWorld(IDirect3DDevice9* deviceRef, std::string filePath, ImportProfile profile, const D3DXMATRIX* world)
 	{
+        D3DXMATRIX placement;
+        if (world != nullptr)
+            placement = *world;
+        else
+            D3DXMatrixIdentity(&placement);
+
+        //a file that is already imported (or importing) is only placed again; every placement shares its geometry
+        if (!m_placements.empty() && filePath == m_modelPath)
+        {
+            m_placements.push_back(placement);
+            return static_cast<uint32_t>(m_placements.size() - 1);
+        }
+        //the running job writes into m_model until it finishes; a second import cannot share it
+        if (IsImportRunning())
+        {
+            Logger::GetInstance().LogInfo(("[ModelLoad] " + filePath + " refused, " + m_modelPath + " is still importing").c_str());
+            return NoPlacement;
+        }
+        m_modelPath = filePath;
+        m_placements.assign(1, placement);
+
         m_deviceRef = deviceRef;
-		m_model->LoadModelAndParseData(deviceRef, filePath);
-		LoadModel();
+        m_loadStopwatch.Restart();
+
+        //the placeholders are tiny and shared by every material that is not resident yet
+        CreatePlaceholderTextures();
+
+        m_loadState = ModelLoadState::Importing;
+        Model* model = m_model;
+        const VertexFormat vertexFormat = m_vertexFormat;
+        const ResidencyPolicy residencyPolicy = m_residencyPolicy;
+        m_importJob = ThreadPool::GetInstance().Enqueue([model, filePath, profile, vertexFormat, residencyPolicy]()
+            {
+                const bool isImported = model->ImportModel(filePath, profile, vertexFormat);
+                //the images are extracted; freeing the scene here keeps it off the render thread and out of the upload frames
+                if (residencyPolicy == ResidencyPolicy::ReleaseAfterUpload)
+                    model->ReleaseImportScene();
+                return isImported;
+            });
+
+        m_model->GetLoadReport().blockingMs = m_loadStopwatch.GetElapsedMs();
+        return 0;
 	}
 
+    void ModelManager::Update(double budgetMs)
+    {
+        if (m_loadState == ModelLoadState::Importing)
+        {
+            if (m_importJob.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+                return;
+
+            if (!m_importJob.get())
+            {
+                m_loadState = ModelLoadState::Failed;
+                Logger::GetInstance().LogInfo(("[ModelLoad] " + m_model->GetLoadReport().filePath + " failed to import, nothing will be drawn").c_str());
+                return;
+            }
+            LoadModel();
+
+            m_loadState = ModelLoadState::Uploading;
+        }
+
+        if (m_loadState != ModelLoadState::Uploading)
+            return;
+
+        auto& loadReport = m_model->GetLoadReport();
+        ++loadReport.uploadFrames;
+
+        if (!m_texturesResident)
+        {
+            m_texturesResident = m_model->FinalizeTextures(m_deviceRef, budgetMs);
+        }
+
+        //streamed geometry never becomes fully resident; the model is done once its textures are
+        if (m_texturesResident && (m_isStreamingGeometry || (m_residentBatches == m_batchDesc.size() && m_residentGroups == m_instanceGroups.size())))
+        {
+            OnModelResident();
+        }
+    }
+
 	void ModelManager::LoadModel()
 	{
 		int32_t vBufferVertexCount = 0;
 		int32_t iBufferIndexCount = 0;
 		int32_t primitiveCount = 0;
 
-		std::vector<PositionVertex> positionVertices;
-		std::vector<uint32_t> positionIndices;
-
-        uint32_t indexOffset(0);
-
 		vBufferVertexCount = m_model->GetTotalVertices();
 		iBufferIndexCount = m_model->GetTotalIndices();
 		primitiveCount = m_model->GetTotalTriangles();
 
-		auto meshList = m_model->GetMeshes();
+		const auto& meshList = m_model->GetMeshes();
 		auto numMaterials = m_model->GetTotalMaterials();
-		std::vector<BatchDesc> batchDescs(numMaterials);
+        auto& arena = m_model->GetImportArena();
+		ArenaVector<BatchDesc> batchDescs(numMaterials, arena);
 
-		for (auto mesh : meshList)
-		{
-			auto const meshVertices = mesh->GetVertices();
-			auto const meshNormals = mesh->GetNormals();
-            auto const meshTexCoords = mesh->GetTexCoords();
+        //update batch list for offsets
+        for (const auto& mesh : meshList)
+        {
+            AccumulateBatch(batchDescs, mesh->GetMaterialIndex(), mesh->GetNumIndices(), mesh->GetNumTris(), mesh->GetNumVertices());
+            //clusters follow mesh order, so each batch's clusters are contiguous as well
+            auto& batch = batchDescs[mesh->GetMaterialIndex()];
+            if (batch.clusterCount == 0)
+                batch.clusterStart = mesh->GetClusterStart();
+            batch.clusterCount += mesh->GetClusterCount();
+        }
 
-            for (auto vitr = meshVertices.begin(), nitr = meshNormals.begin(), titr = meshTexCoords.begin();
-                vitr != meshVertices.end() && nitr != meshNormals.end() && titr != meshTexCoords.end();
-                vitr += 3, nitr += 3, titr += 2)
+        for (uint16_t itr = 0; itr < batchDescs.size(); ++itr)
+        {
+            if (itr > 0)
             {
-                positionVertices.push_back({ *vitr, *(vitr + 1), *(vitr + 2), //vertices
-                    *nitr, *(nitr + 1), *(nitr + 2), //normals
-                    *(titr), *(titr + 1) }); //texcoords
+                batchDescs[itr].indexStart += batchDescs[itr - 1].indexStart;
+                //meshes are sorted by material, so each batch's vertices are one contiguous range as well
+                batchDescs[itr].vertexStart = batchDescs[itr - 1].vertexStart + batchDescs[itr - 1].vertexCount;
             }
+        }
+
+        BuildBatchLods(batchDescs);
+
+        //the model built the interleaved images in place; take ownership instead of copying them
+        m_positionVertices = m_model->TakeVertexImage();
+        m_positionIndices = m_model->TakeIndexImage();
+        m_compactVertices = m_model->TakeCompactVertexImage();
+        m_clusters = m_model->TakeClusters();
+        BuildInstanceGroups();
+        if (!m_isStreamingGeometry)
+        {
+            BuildSubBatches(batchDescs);
+            vBufferVertexCount = static_cast<int32_t>(m_deviceVertexCount); //duplicates are left out of the device buffer
+        }
+
+		m_batchDesc.insert(m_batchDesc.end(), batchDescs.begin(), batchDescs.end()); //useful when multiple models
+
+        BuildChunks();
+        BuildBatchBounds();
+        MeasureIndexWidths();
+
+        //the cooked file holds the same images; mapping it lets the streamer page chunks in instead of pinning the whole scene
+        if (m_isStreamingGeometry && m_model->OpenCookedModel(m_streamSource))
+        {
+            m_positionVertices = std::vector<PositionVertex>();
+            m_positionIndices = std::vector<uint32_t>();
+            m_compactVertices = std::vector<CompactVertex>(); //CopyVertices encodes each chunk from the mapping instead
+        }
 
-			auto meshIndices = mesh->GetIndices();
-			for (auto index : meshIndices)
-				positionIndices.push_back(index + indexOffset);
+		m_vBufferVertexCount = vBufferVertexCount;
+		m_iBufferIndexCount = iBufferIndexCount;
+		m_primitiveCount = primitiveCount;
 
-            indexOffset += static_cast<uint32_t>(mesh->GetNumVertices());
+        auto& residency = m_model->GetLoadReport().residency;
+        residency.policy = m_residencyPolicy;
+        MeasureResidency(residency.beforeBytes);
+        residency.Before(ResidencyStage::ImportScene) = m_model->GetSceneBytes(); //what the import held, even if already freed
+	}
 
-            //update batch list for offsets
-            auto matIndex = mesh->GetMaterialIndex();
-            
-			if (matIndex < (numMaterials - 1))
+    void ModelManager::CopyVertices(uint32_t vertexStart, uint32_t vertexCount, void* outVertices) const
+    {
+        if (m_vertexFormat == VertexFormat::Full)
+        {
+            memcpy(outVertices, GetVertexSource() + vertexStart, vertexCount * sizeof(PositionVertex));
+            return;
+        }
+        if (!m_compactVertices.empty())
+        {
+            memcpy(outVertices, m_compactVertices.data() + vertexStart, vertexCount * sizeof(CompactVertex));
+            return;
+        }
+        EncodeCompactVertices(GetVertexSource() + vertexStart, vertexCount, m_model->GetVertexQuantization(), static_cast<CompactVertex*>(outVertices), nullptr);
+    }
+
+    void ModelManager::BuildChunks()
+    {
+        const auto& meshList = m_model->GetMeshes();
+        m_chunkDesc.clear();
+        m_chunkDesc.reserve(meshList.size());
+        for (uint32_t meshIndex = 0; meshIndex < meshList.size(); ++meshIndex)
+        {
+            const auto& mesh = meshList[meshIndex];
+            if (mesh->IsDuplicate())
+                continue; //streamed and drawn through its prototype's chunk
+
+            ChunkDesc chunk;
+            chunk.materialIndex = mesh->GetMaterialIndex();
+            chunk.vertexStart = mesh->GetVertexOffset();
+            chunk.vertexCount = static_cast<uint32_t>(mesh->GetNumVertices());
+            chunk.indexStart = mesh->GetIndexOffset();
+            chunk.primitiveCount = static_cast<uint32_t>(mesh->GetNumTris());
+            if (chunk.vertexCount == 0 || chunk.primitiveCount == 0)
+                continue;
+            chunk.vertexStride = GetVertexStride();
+            chunk.indexStride = static_cast<uint32_t>(chunk.vertexCount > MaxIndex16Vertices ? sizeof(uint32_t) : sizeof(uint16_t));
+            chunk.clusterStart = mesh->GetClusterStart();
+            chunk.clusterCount = mesh->GetClusterCount();
+            chunk.transformIndex = mesh->GetTransformIndex();
+            chunk.contentHash = mesh->GetContentHash();
+            chunk.lodCount = mesh->GetLodCount();
+            for (uint32_t level = 0; level < chunk.lodCount; ++level)
             {
-                batchDescs[matIndex + 1].indexStart += static_cast<uint32_t>(mesh->GetNumIndices());
+                const auto lod = mesh->GetLod(level);
+                chunk.lods[level].indexStart = lod.indexOffset;
+                chunk.lods[level].primitiveCount = lod.numIndices / 3;
+                chunk.lods[level].error = lod.error;
             }
 
-            batchDescs[matIndex].primitiveCount += mesh->GetNumTris();
-            batchDescs[matIndex].vertexCount += mesh->GetNumVertices();
-		}
+            MeshBounds bounds = mesh->GetBounds();
+            chunk.instanceGroup = m_meshInstanceGroup[meshIndex];
+            if (chunk.instanceGroup != NoInstanceGroup)
+            {
+                //the streamer ranks a prototype by every copy it draws
+                auto& group = m_instanceGroups[chunk.instanceGroup];
+                group.chunkIndex = static_cast<uint32_t>(m_chunkDesc.size());
+                for (uint32_t itr = 1; itr < group.instanceCount; ++itr)
+                    MergeBounds(bounds, mesh->GetBounds(), m_instanceOffsets[group.instanceStart + itr]);
+            }
+            chunk.boundsMin = bounds.boundsMin;
+            chunk.boundsMax = bounds.boundsMax;
+            chunk.center = bounds.center;
+            chunk.radius = bounds.radius;
+            m_chunkDesc.emplace_back(chunk);
+        }
+    }
 
-        for (uint16_t itr = 0; itr < batchDescs.size(); ++itr)
+    void ModelManager::BuildInstanceGroups()
+    {
+        //prototypes come before their duplicates in mesh order, so each group exists before its first duplicate is seen
+        const auto& meshList = m_model->GetMeshes();
+        m_meshInstanceGroup.assign(meshList.size(), NoInstanceGroup);
+        ArenaVector<uint32_t> nextInstance(m_model->GetImportArena());
+        for (uint32_t meshIndex = 0; meshIndex < meshList.size(); ++meshIndex)
         {
-            if (itr > 0)
+            const auto& mesh = *meshList[meshIndex];
+            if (mesh.IsDuplicate())
             {
-                batchDescs[itr].indexStart += batchDescs[itr - 1].indexStart;
+                const uint32_t groupIndex = m_meshInstanceGroup[mesh.GetPrototypeIndex()];
+                assert(groupIndex != NoInstanceGroup);
+                m_instanceTransforms[nextInstance[groupIndex]] = mesh.GetTransformIndex();
+                m_instanceOffsets[nextInstance[groupIndex]++] = mesh.GetInstanceOffset();
+                continue;
             }
+            if (mesh.GetInstanceCount() == 1)
+                continue;
+
+            InstanceGroupDesc group;
+            group.meshIndex = meshIndex;
+            group.materialIndex = mesh.GetMaterialIndex();
+            group.vertexCount = static_cast<uint32_t>(mesh.GetNumVertices());
+            group.lodCount = mesh.GetLodCount();
+            for (uint32_t level = 0; level < group.lodCount; ++level)
+            {
+                const auto lod = mesh.GetLod(level);
+                group.lods[level].indexStart = lod.indexOffset;
+                group.lods[level].primitiveCount = lod.numIndices / 3;
+                group.lods[level].error = lod.error;
+            }
+            group.center = mesh.GetBounds().center;
+            group.radius = mesh.GetBounds().radius;
+            group.instanceStart = static_cast<uint32_t>(m_instanceOffsets.size());
+            group.instanceCount = mesh.GetInstanceCount();
+
+            m_meshInstanceGroup[meshIndex] = static_cast<uint32_t>(m_instanceGroups.size());
+            m_instanceOffsets.resize(group.instanceStart + group.instanceCount, D3DXVECTOR3(0.0f, 0.0f, 0.0f)); //the prototype's own offset first
+            m_instanceTransforms.resize(group.instanceStart + group.instanceCount, mesh.GetTransformIndex());
+            nextInstance.push_back(group.instanceStart + 1);
+            m_instanceGroups.push_back(group);
         }
+    }
 
-		m_batchDesc.insert(m_batchDesc.end(), batchDescs.begin(), batchDescs.end()); //useful when multiple models
+    void ModelManager::BuildBatchLods(ArenaVector<BatchDesc>& batchDescs) const
+    {
+        //a batch has as many levels as its most reduced mesh. A mesh that stopped reducing earlier counts its coarsest
+        //level in the ones it lacks; the sub-batches draw those indices again. indexStart is the first mesh's range
+        ArenaVector<uint32_t> meshesSeen(batchDescs.size(), 0, m_model->GetImportArena());
+        for (auto& batch : batchDescs)
+        {
+            batch.lodCount = 1;
+            batch.lods[0].indexStart = batch.indexStart;
+            batch.lods[0].primitiveCount = batch.primitiveCount;
+        }
+        for (const auto& mesh : m_model->GetMeshes())
+        {
+            auto& batch = batchDescs[mesh->GetMaterialIndex()];
+            batch.lodCount = (std::max)(batch.lodCount, mesh->GetLodCount());
+            for (uint32_t level = 1; level < MaxMeshLods; ++level)
+            {
+                const auto lod = mesh->GetLod((std::min)(level, mesh->GetLodCount() - 1));
+                auto& range = batch.lods[level];
+                if (meshesSeen[mesh->GetMaterialIndex()] == 0)
+                    range.indexStart = lod.indexOffset;
+                range.primitiveCount += lod.numIndices / 3;
+                range.error = (std::max)(range.error, lod.error);
+            }
+            ++meshesSeen[mesh->GetMaterialIndex()];
+        }
+    }
 
-		positionVertices.shrink_to_fit();
-		positionIndices.shrink_to_fit();
+    void ModelManager::BuildSubBatches(ArenaVector<BatchDesc>& batchDescs)
+    {
+        //meshes are sorted by material and every level keeps that order, so a run of a batch's consecutive meshes is one
+        //contiguous vertex range and one contiguous index range of each level. Instanced meshes break a run: the groups
+        //draw them, and the device vertex buffer only gets the prototype's vertices. Scene nodes do not: a static scene
+        //keeps about one draw per material, and the node spans split a run only once one of its nodes moves.
+        struct MeshRun
+        {
+            size_t firstMesh;
+            size_t endMesh;
+            uint32_t sourceVertex;
+            uint32_t vertexCount;
+            uint32_t lodCount;
+        };
 
-        m_positionVertices = positionVertices;
-        m_positionIndices = positionIndices;
+        const auto& meshList = m_model->GetMeshes();
+        auto& arena = m_model->GetImportArena();
+        ArenaVector<MeshRun> runs(arena);
+        ArenaVector<uint32_t> runBaseVertex(arena);
+        ArenaVector<uint32_t> runSubBatch(arena); //the run's sub-batch of the last level it has, reused for coarser ones
+        size_t firstMesh = 0;
+        while (firstMesh < meshList.size())
+        {
+            const uint32_t batchIndex = meshList[firstMesh]->GetMaterialIndex();
+            size_t endMesh = firstMesh + 1;
+            while (endMesh < meshList.size() && meshList[endMesh]->GetMaterialIndex() == batchIndex)
+                ++endMesh;
 
-		m_vBufferVertexCount = vBufferVertexCount;
-		m_iBufferIndexCount = iBufferIndexCount;
-		m_primitiveCount = primitiveCount;
-	}
+            //a run always takes its first mesh; the following ones join while every index still fits 16 bits
+            runs.clear();
+            runBaseVertex.clear();
+            for (size_t meshItr = firstMesh; meshItr < endMesh; ++meshItr)
+            {
+                const auto& mesh = *meshList[meshItr];
+                if (mesh.IsInstanced())
+                    continue;
+                const auto vertexCount = static_cast<uint32_t>(mesh.GetNumVertices());
+                //a run's meshes also share their level count, so each of its levels stays one contiguous range
+                if (!runs.empty() && runs.back().endMesh == meshItr && runs.back().lodCount == mesh.GetLodCount()
+                    && runs.back().vertexCount + vertexCount <= MaxIndex16Vertices)
+                {
+                    runs.back().endMesh = meshItr + 1;
+                    runs.back().vertexCount += vertexCount;
+                    continue;
+                }
+                runs.push_back({ meshItr, meshItr + 1, mesh.GetVertexOffset(), vertexCount, mesh.GetLodCount() });
+            }
+            for (const auto& run : runs)
+            {
+                runBaseVertex.push_back(m_deviceVertexCount);
+                m_deviceVertexCount += run.vertexCount;
+            }
+            runSubBatch.assign(runs.size(), NoSubBatch);
+
+            auto& batch = batchDescs[batchIndex];
+            for (uint32_t level = 0; level < batch.lodCount; ++level)
+            {
+                batch.subBatchStart[level] = static_cast<uint32_t>(m_subBatches.size());
+                for (size_t runItr = 0; runItr < runs.size(); ++runItr)
+                {
+                    const auto& run = runs[runItr];
+                    if (level >= run.lodCount)
+                    {
+                        //the same device indices as the run's coarsest level, referred to rather than uploaded twice
+                        if (runSubBatch[runItr] != NoSubBatch)
+                        {
+                            SubBatchDesc repeat;
+                            repeat.repeatOf = runSubBatch[runItr];
+                            m_subBatches.push_back(repeat);
+                        }
+                        continue;
+                    }
+                    SubBatchDesc subBatch;
+                    subBatch.baseVertex = runBaseVertex[runItr];
+                    subBatch.sourceVertex = run.sourceVertex;
+                    subBatch.vertexCount = run.vertexCount;
+                    subBatch.sourceIndexStart = meshList[run.firstMesh]->GetLod(level).indexOffset;
+                    subBatch.clusterStart = meshList[run.firstMesh]->GetClusterStart();
+                    subBatch.transformIndex = meshList[run.firstMesh]->GetTransformIndex();
+                    subBatch.nodeSpanStart = static_cast<uint32_t>(m_nodeSpans.size());
+                    subBatch.contentHash = HashSeed;
+                    for (size_t meshItr = run.firstMesh; meshItr < run.endMesh; ++meshItr)
+                    {
+                        const auto& mesh = *meshList[meshItr];
+                        const uint64_t meshHash = mesh.GetContentHash();
+                        subBatch.contentHash = HashBytes(&meshHash, sizeof(meshHash), subBatch.contentHash);
+                        const uint32_t meshPrimitives = mesh.GetLod(level).numIndices / 3;
+                        if (m_nodeSpans.size() > subBatch.nodeSpanStart && m_nodeSpans.back().transformIndex == mesh.GetTransformIndex())
+                            m_nodeSpans.back().primitiveCount += meshPrimitives;
+                        else
+                            m_nodeSpans.push_back({ subBatch.primitiveCount * 3, meshPrimitives, mesh.GetTransformIndex() });
+                        subBatch.primitiveCount += meshPrimitives;
+                        if (level == 0)
+                            subBatch.clusterCount += mesh.GetClusterCount();
+                    }
+                    //one node needs no spans: the sub-batch's transformIndex says it all
+                    if (subBatch.primitiveCount > 0 && m_nodeSpans.size() - subBatch.nodeSpanStart > 1)
+                    {
+                        subBatch.nodeSpanCount = static_cast<uint32_t>(m_nodeSpans.size()) - subBatch.nodeSpanStart;
+                        subBatch.transformIndex = NoTransform;
+                    }
+                    else
+                        m_nodeSpans.resize(subBatch.nodeSpanStart);
+                    runSubBatch[runItr] = NoSubBatch;
+                    if (subBatch.primitiveCount > 0)
+                    {
+                        runSubBatch[runItr] = static_cast<uint32_t>(m_subBatches.size());
+                        AppendSubBatch(subBatch);
+                    }
+                }
+                batch.subBatchCount[level] = static_cast<uint32_t>(m_subBatches.size()) - batch.subBatchStart[level];
+            }
+            firstMesh = endMesh;
+        }
+
+        //one sub-batch per level of each prototype, so a group's level is subBatchStart + level
+        for (auto& group : m_instanceGroups)
+        {
+            const auto& mesh = *meshList[group.meshIndex];
+            group.subBatchStart = static_cast<uint32_t>(m_subBatches.size());
+            for (uint32_t level = 0; level < group.lodCount; ++level)
+            {
+                SubBatchDesc subBatch;
+                subBatch.baseVertex = m_deviceVertexCount;
+                subBatch.sourceVertex = mesh.GetVertexOffset();
+                subBatch.vertexCount = group.vertexCount;
+                subBatch.sourceIndexStart = group.lods[level].indexStart;
+                subBatch.primitiveCount = group.lods[level].primitiveCount;
+                subBatch.transformIndex = mesh.GetTransformIndex();
+                subBatch.contentHash = mesh.GetContentHash();
+                AppendSubBatch(subBatch);
+            }
+            m_deviceVertexCount += group.vertexCount;
+        }
+    }
+
+    void ModelManager::AppendSubBatch(SubBatchDesc subBatch)
+    {
+        subBatch.isIndex32 = subBatch.vertexCount > MaxIndex16Vertices;
+        const uint32_t* srcIndices = m_positionIndices.data() + subBatch.sourceIndexStart;
+        const uint32_t indexCount = subBatch.primitiveCount * 3;
+        if (subBatch.isIndex32)
+        {
+            subBatch.indexStart = static_cast<uint32_t>(m_indexImage32.size());
+            for (uint32_t itr = 0; itr < indexCount; ++itr)
+                m_indexImage32.push_back(srcIndices[itr] - subBatch.sourceVertex);
+        }
+        else
+        {
+            subBatch.indexStart = static_cast<uint32_t>(m_indexImage16.size());
+            for (uint32_t itr = 0; itr < indexCount; ++itr)
+                m_indexImage16.push_back(static_cast<uint16_t>(srcIndices[itr] - subBatch.sourceVertex));
+        }
+        //the culler's copy outlives the upload: the same rebased indices, LOD0 ranges with clusters only
+        if (m_isCullingClusters && subBatch.clusterCount > 0)
+        {
+            if (subBatch.isIndex32)
+            {
+                subBatch.clusterIndexStart = static_cast<uint32_t>(m_clusterIndices32.size());
+                m_clusterIndices32.insert(m_clusterIndices32.end(), m_indexImage32.begin() + subBatch.indexStart, m_indexImage32.end());
+            }
+            else
+            {
+                subBatch.clusterIndexStart = static_cast<uint32_t>(m_clusterIndices16.size());
+                m_clusterIndices16.insert(m_clusterIndices16.end(), m_indexImage16.begin() + subBatch.indexStart, m_indexImage16.end());
+            }
+        }
+        m_subBatches.push_back(subBatch);
+    }
+
+    void ModelManager::MeasureIndexWidths()
+    {
+        //what each draw range costs at its own index width against 32 bits everywhere, plus the LOD0 indices a frame of
+        //cluster culling can emit at each width
+        auto& loadReport = m_model->GetLoadReport();
+        loadReport.fullIndexBytes = 0;
+        loadReport.deviceIndexBytes = 0;
+        loadReport.indexRanges = 0;
+        loadReport.index32Ranges = 0;
+        m_lod0IndexCount16 = 0;
+        m_lod0IndexCount32 = 0;
+        auto addRange = [&](uint32_t indexCount, bool isIndex32, bool isLod0)
+        {
+            loadReport.fullIndexBytes += indexCount * sizeof(uint32_t);
+            loadReport.deviceIndexBytes += indexCount * (isIndex32 ? sizeof(uint32_t) : sizeof(uint16_t));
+            ++loadReport.indexRanges;
+            loadReport.index32Ranges += isIndex32 ? 1 : 0;
+            if (isLod0)
+                (isIndex32 ? m_lod0IndexCount32 : m_lod0IndexCount16) += indexCount;
+        };
+
+        if (m_isStreamingGeometry)
+        {
+            for (const auto& chunk : m_chunkDesc)
+            {
+                for (uint32_t level = 0; level < chunk.lodCount; ++level)
+                    addRange(chunk.lods[level].primitiveCount * 3, chunk.indexStride == sizeof(uint32_t), level == 0);
+            }
+            return;
+        }
+        for (const auto& batch : m_batchDesc)
+        {
+            for (uint32_t level = 0; level < batch.lodCount; ++level)
+            {
+                for (uint32_t itr = 0; itr < batch.subBatchCount[level]; ++itr)
+                {
+                    const auto& subBatch = m_subBatches[batch.subBatchStart[level] + itr];
+                    if (subBatch.repeatOf == NoSubBatch) //a repeat holds no indices of its own
+                        addRange(subBatch.primitiveCount * 3, subBatch.isIndex32, level == 0);
+                }
+            }
+        }
+        //instances are culled whole, never through the cluster culler
+        for (const auto& group : m_instanceGroups)
+        {
+            for (uint32_t level = 0; level < group.lodCount; ++level)
+            {
+                const auto& subBatch = m_subBatches[group.subBatchStart + level];
+                addRange(subBatch.primitiveCount * 3, subBatch.isIndex32, false);
+            }
+        }
+    }
+
+    void ModelManager::BuildBatchBounds()
+    {
+        ArenaVector<MeshBounds> batchBounds(m_batchDesc.size(), m_model->GetImportArena());
+        const auto& meshList = m_model->GetMeshes();
+        for (const auto& mesh : meshList)
+        {
+            if (mesh->IsInstanced() || mesh->GetNumTris() == 0)
+                continue; //drawn by its group, not by the batch, or not drawn at all
+            MergeBounds(batchBounds[mesh->GetMaterialIndex()], mesh->GetBounds());
+        }
+        for (uint32_t itr = 0; itr < m_batchDesc.size(); ++itr)
+        {
+            if (batchBounds[itr].IsEmpty())
+                continue;
+            m_batchDesc[itr].boundsMin = batchBounds[itr].boundsMin;
+            m_batchDesc[itr].boundsMax = batchBounds[itr].boundsMax;
+            m_batchDesc[itr].center = batchBounds[itr].center;
+            m_batchDesc[itr].radius = batchBounds[itr].radius;
+        }
+    }
+
+    void ModelManager::MarkBatchResident(uint32_t batchIndex, double uploadMs)
+    {
+        assert(batchIndex < m_batchDesc.size());
+        if (m_batchDesc[batchIndex].isResident)
+            return;
+
+        m_batchDesc[batchIndex].isResident = true;
+        ++m_residentBatches;
+        m_model->GetLoadReport().geometryUploadMs += uploadMs;
+    }
+
+    void ModelManager::UpdateTransforms()
+    {
+        if (m_model == nullptr || !HasGeometry())
+            return;
+        m_model->GetTransforms().Update();
+    }
+
+    void ModelManager::MarkInstanceGroupResident(uint32_t groupIndex, double uploadMs)
+    {
+        assert(groupIndex < m_instanceGroups.size());
+        if (m_instanceGroups[groupIndex].isResident)
+            return;
+
+        m_instanceGroups[groupIndex].isResident = true;
+        ++m_residentGroups;
+        m_model->GetLoadReport().geometryUploadMs += uploadMs;
+    }
+
+    void ModelManager::CreatePlaceholderTextures()
+    {
+        //acquired through the cache so materials that fall back to the same defaults share these textures
+        auto& textureCache = TextureCache::GetInstance();
+        for (uint32_t texType = 0; texType < Material::TextureTypeCount; ++texType)
+        {
+            if (m_placeholderTextures[texType] != nullptr)
+                continue;
+
+            AssetFile file;
+            if (!file.Open(PlaceholderTexturePaths[texType]))
+                continue;
+            StagingImage image;
+            std::vector<uint8_t> fileData; //only for D3DX, when WIC cannot decode it
+            if (DecodeImage(file.GetData(), file.GetSize(), image))
+                BuildMipChain(image);
+            else
+                fileData.assign(file.GetData(), file.GetData() + file.GetSize());
+            const auto normalizedPath = TextureCache::NormalizePath(PlaceholderTexturePaths[texType]);
+            TextureSource source;
+            source.image = &image;
+            source.fileData = &fileData;
+            m_placeholderTextures[texType] = textureCache.Acquire(m_deviceRef, normalizedPath, HashBytes(file.GetData(), file.GetSize()), source);
+        }
+    }
+
+    void ModelManager::OnModelResident()
+    {
+        m_loadState = ModelLoadState::Resident;
+
+        //the device buffers hold the geometry now; the CPU images are no longer needed
+        const size_t vertexImageBytes = m_positionVertices.size() * sizeof(PositionVertex) + m_compactVertices.size() * sizeof(CompactVertex);
+        const size_t indexImageBytes = m_positionIndices.size() * sizeof(uint32_t) + m_indexImage16.size() * sizeof(uint16_t) + m_indexImage32.size() * sizeof(uint32_t) +
+            m_clusterIndices16.size() * sizeof(uint16_t) + m_clusterIndices32.size() * sizeof(uint32_t);
+        //managed buffers keep their own system memory copy for a device reset, so nothing here has to outlive the upload.
+        //the streamer keeps reading chunks from the images when the cooked file could not be mapped
+        const bool releaseCpuCopies = m_residencyPolicy == ResidencyPolicy::ReleaseAfterUpload;
+        if (releaseCpuCopies && !m_isStreamingGeometry)
+        {
+            m_positionVertices = std::vector<PositionVertex>();
+            m_compactVertices = std::vector<CompactVertex>();
+            m_indexImage16 = std::vector<uint16_t>();
+            m_indexImage32 = std::vector<uint32_t>();
+            m_positionIndices = std::vector<uint32_t>(); //the cluster culler keeps its own LOD0 ranges
+        }
+
+        auto& loadReport = m_model->GetLoadReport();
+        loadReport.totalMs = m_loadStopwatch.GetElapsedMs();
+        loadReport.vertexImageBytes = vertexImageBytes;
+        loadReport.indexImageBytes = indexImageBytes;
+        loadReport.peakWorkingSetBytes = GetPeakWorkingSetBytes();
+
+        //every import table is dead by now; one call hands all of it back
+        auto& arena = m_model->GetImportArena();
+        loadReport.importArenaBlocks = arena.GetPeakBlockCount();
+        loadReport.importArenaReservedBytes = arena.GetReservedBytes();
+        loadReport.importArenaHighWaterBytes = arena.GetHighWaterBytes();
+        arena.Release();
+        if (releaseCpuCopies)
+            m_model->ReleaseTextureStaging();
+
+        auto& residency = loadReport.residency;
+        MeasureResidency(residency.afterBytes);
+        residency.After(ResidencyStage::ImportScene) = m_model->IsSceneResident() ? m_model->GetSceneBytes() : 0;
+        loadReport.LogReport();
+        TextureCache::GetInstance().LogStats();
+        AssetPack::GetInstance().LogReport();
+    }
+
+    void ModelManager::MeasureResidency(std::array<size_t, ResidencyStageCount>& outBytes) const
+    {
+        //capacities, since that is what the allocator holds on to
+        auto bytesOf = [](const auto& image) { return image.capacity() * sizeof(image[0]); };
+        auto stage = [&outBytes](ResidencyStage stage) -> size_t& { return outBytes[static_cast<uint32_t>(stage)]; };
+
+        const auto& meshList = m_model->GetMeshes();
+        size_t meshBytes = meshList.capacity() * sizeof(meshList[0]);
+        for (const auto& mesh : meshList)
+            meshBytes += sizeof(Mesh) + mesh->GetName().capacity();
+
+        outBytes.fill(0);
+        stage(ResidencyStage::ImportArena) = m_model->GetImportArena().GetReservedBytes();
+        stage(ResidencyStage::MeshTable) = meshBytes;
+        stage(ResidencyStage::VertexImage) = bytesOf(m_positionVertices);
+        stage(ResidencyStage::CompactVertexImage) = bytesOf(m_compactVertices);
+        stage(ResidencyStage::IndexImage) = bytesOf(m_positionIndices);
+        stage(ResidencyStage::SubBatchIndices) = bytesOf(m_indexImage16) + bytesOf(m_indexImage32);
+        stage(ResidencyStage::Clusters) = bytesOf(m_clusters) + bytesOf(m_clusterIndices16) + bytesOf(m_clusterIndices32);
+        stage(ResidencyStage::TextureStaging) = m_model->GetTextureStagingBytes();
+        if (m_loadState == ModelLoadState::Resident && !m_isStreamingGeometry) //streamed chunks come and go; the streamer reports those
+        {
+            const auto& loadReport = m_model->GetLoadReport();
+            stage(ResidencyStage::ManagedBuffers) = loadReport.deviceVertexBytes + loadReport.deviceIndexBytes;
+        }
+    }
+
+    void ModelManager::AccumulateBatch(ArenaVector<BatchDesc>& batchDescs, uint32_t matIndex, uint32_t numIndices, uint32_t numTris, uint32_t numVertices)
+    {
+        //indexStart of the next material is turned into a running offset once every mesh is counted
+        if (matIndex < (batchDescs.size() - 1))
+        {
+            batchDescs[matIndex + 1].indexStart += numIndices;
+        }
+
+        batchDescs[matIndex].primitiveCount += numTris;
+        batchDescs[matIndex].vertexCount += numVertices;
+    }
 
 	void ModelManager::SetShaderInputsForMaterialIndex(uint32_t index, ID3DXEffect* shader)
 	{
 		auto material = m_model->GetMaterialAtIndex(index);
-		auto diffuseTex = material->GetTextureOfType(Material::TextureType::Diffuse);
-		auto normalTex = material->GetTextureOfType(Material::TextureType::Normal);
-		auto specTex = material->GetTextureOfType(Material::TextureType::Specular);
-		auto opacityTex = material->GetTextureOfType(Material::TextureType::Opacity);
+		auto textureOrPlaceholder = [this, material](Material::TextureType texType)
+		{
+			auto texture = material->GetTextureOfType(texType);
+			return texture != nullptr ? texture : m_placeholderTextures[static_cast<uint32_t>(texType)];
+		};
+		auto diffuseTex = textureOrPlaceholder(Material::TextureType::Diffuse);
+		auto normalTex = textureOrPlaceholder(Material::TextureType::Normal);
+		auto specTex = textureOrPlaceholder(Material::TextureType::Specular);
+		auto opacityTex = textureOrPlaceholder(Material::TextureType::Opacity);
 
 		shader->SetTexture("g_DiffuseTex", diffuseTex);
 		shader->SetTexture("g_NormalTex", normalTex);
 		shader->SetTexture("g_SpecularTex", specTex);
 		shader->SetTexture("g_OpacityTex", opacityTex);
+		//placeholders are never swizzled
+		shader->SetBool("g_normalMapXY", material->GetTextureOfType(Material::TextureType::Normal) != nullptr && material->IsNormalMapXY());
 		shader->SetVector("g_dirLightDir", &D3DXVECTOR4(1.0f, 1.0f, 0.3f, 1.0f));
 		shader->SetVector("g_dirLightColor", &D3DXVECTOR4(1.0f, 0.69f, 0.32f, 1.0f));
 		shader->SetVector("g_ambientLight", &D3DXVECTOR4(0.4f, 0.8f, 0.99f, 1.0f));
@@ -1,42 +1,177 @@
 #pragma once
 
 #include<vector>
+#include<future>
 
 #include "../renderer/Model.h"
 #include "../renderer/d3d9/VertexDefs.h"
 #include "Batch.h"
+#include "../utils/Time.h"
 
 namespace renderer
 {
+    enum class ModelLoadState
+    {
+        Importing,  //assimp/cooked cache + texture prefetch on a worker thread
+        Uploading,  //render thread is filling buffers and creating textures, a budget per frame
+        Resident,
+        Failed      //the import could not read the file; nothing was built and nothing is drawn
+    };
+
+    constexpr uint32_t NoPlacement = UINT32_MAX; //AddModelToWorld refused the file
+
 	class ModelManager
 	{
 	public:
 		ModelManager();
 		~ModelManager();
 
-		void AddModelToWorld(IDirect3DDevice9* deviceRef, std::string filePath);
+		//>Returns immediately; the import runs on the thread pool and Update() picks it up.
+		//>Adding a file that is already loaded only places it again at world; every placement shares the geometry.
+		//>Returns the index of the placement in GetPlacements(), or NoPlacement for another file while an import is running.
+		uint32_t AddModelToWorld(IDirect3DDevice9* deviceRef, std::string filePath, ImportProfile profile = ImportProfile::Production, const D3DXMATRIX* world = nullptr);
+		//>Render thread, once per frame: finishes the import hand-off and spends up to budgetMs creating textures
+		void Update(double budgetMs);
 		void LoadModel();
+		void MarkBatchResident(uint32_t batchIndex, double uploadMs);
+		void MarkInstanceGroupResident(uint32_t groupIndex, double uploadMs);
+		//>See Model::SetNonPow2Mipmaps. Set before AddModelToWorld.
+		void SetNonPow2Mipmaps(bool isSupported) { m_model->SetNonPow2Mipmaps(isSupported); }
+		//>Streamed geometry is uploaded per chunk by a SceneStreamer instead of through the batch list. Set before AddModelToWorld.
+		void SetGeometryStreaming(bool isStreaming) { m_isStreamingGeometry = isStreaming; }
+		//>Keeps the LOD0 sub-batch indices after upload so a ClusterCuller can compact them every frame. Set before AddModelToWorld.
+		void SetClusterCulling(bool isCulling) { m_isCullingClusters = isCulling; }
+		//>Layout of the device vertex buffers. Set before AddModelToWorld; the renderer checks the device supports Compact.
+		void SetVertexFormat(VertexFormat format) { m_vertexFormat = format; }
+		//>What stays in system memory once the model is resident. Set before AddModelToWorld.
+		void SetResidencyPolicy(ResidencyPolicy policy) { m_residencyPolicy = policy; }
+		//>Content hashes on every chunk and sub-batch, for telling what a reload changed. Set before AddModelToWorld.
+		void SetMeshHashing(bool isHashing) { m_model->SetMeshHashing(isHashing); }
+		//>See Model::SetTextureRevalidation. Set before AddModelToWorld.
+		void SetTextureRevalidation(bool isRevalidating) { m_model->SetTextureRevalidation(isRevalidating); }
+		//>See Model::SetAssetSource. Set before AddModelToWorld.
+		void SetAssetSource(AssetSource source) { m_model->SetAssetSource(source); }
 		void SetShaderInputsForMaterialIndex(uint32_t index, ID3DXEffect* shader);
 
+        inline ModelLoadState GetLoadState() const { return m_loadState; }
+        //>The worker still writes into the model; destroying the manager now would block until it is done
+        inline bool IsImportRunning() const { return m_importJob.valid() && m_importJob.wait_for(std::chrono::seconds(0)) != std::future_status::ready; }
+        //>Batches, chunks and transforms exist: the import finished and did not fail
+        inline bool HasGeometry() const { return m_loadState == ModelLoadState::Uploading || m_loadState == ModelLoadState::Resident; }
+        inline const std::string& GetModelPath() const { return m_modelPath; }
+
         inline Model* GetModel() const { return m_model; }
-        inline std::vector<PositionVertex> GetVertexBufferData() { return m_positionVertices; }
-        inline std::vector<uint32_t> GetIndexBufferData() { return m_positionIndices; }
+        inline VertexFormat GetVertexFormat() const { return m_vertexFormat; }
+        inline uint32_t GetVertexStride() const { return renderer::GetVertexStride(m_vertexFormat); }
+        inline const VertexQuantization& GetVertexQuantization() const { return m_model->GetVertexQuantization(); }
+        inline const MeshBounds& GetBounds() const { return m_model->GetBounds(); }
+        //>CPU vertex image in the device format, until the model is resident (not streaming)
+        inline const uint8_t* GetVertexImageData() const
+        {
+            return m_vertexFormat == VertexFormat::Compact ? reinterpret_cast<const uint8_t*>(m_compactVertices.data()) : reinterpret_cast<const uint8_t*>(m_positionVertices.data());
+        }
+        //>vertexCount vertices from vertexStart in the device format; outVertices holds vertexCount * GetVertexStride() bytes
+        void CopyVertices(uint32_t vertexStart, uint32_t vertexCount, void* outVertices) const;
+        //>A LOD0 sub-batch's indices for the cluster culler, in its draw width and rebased like GetIndex16Data. Only kept
+        //>with cluster culling on; it is all the culler reads, so the model-wide image can go after upload
+        inline const void* GetClusterIndices(const SubBatchDesc& subBatch) const
+        {
+            return subBatch.isIndex32 ? static_cast<const void*>(m_clusterIndices32.data() + subBatch.clusterIndexStart) :
+                static_cast<const void*>(m_clusterIndices16.data() + subBatch.clusterIndexStart);
+        }
+        //>Sub-batch indices relative to their base vertex, until the model is resident (not streaming)
+        inline const std::vector<uint16_t>& GetIndex16Data() const { return m_indexImage16; }
+        inline const std::vector<uint32_t>& GetIndex32Data() const { return m_indexImage32; }
+        //>LOD0 indices of the 16- or 32-bit draw ranges: the most a frame of cluster culling emits at that width
+        inline uint32_t GetLod0IndexCount(bool isIndex32) const { return isIndex32 ? m_lod0IndexCount32 : m_lod0IndexCount16; }
 
         inline int32_t GetVBufferCount() { return m_vBufferVertexCount; }
         inline int32_t GetIBufferCount() { return m_iBufferIndexCount; }
         inline int32_t GetPrimitiveCount() { return m_primitiveCount; }
-        inline std::vector<BatchDesc> GetBatchList() { return m_batchDesc; }
+        inline const std::vector<BatchDesc>& GetBatchList() const { return m_batchDesc; }
+        inline const std::vector<ChunkDesc>& GetChunkList() const { return m_chunkDesc; }
+        //>Draw ranges of every batch level, see BatchDesc::subBatchStart
+        inline const std::vector<SubBatchDesc>& GetSubBatchList() const { return m_subBatches; }
+        //>The sub-batch to draw for an entry of GetSubBatchList: the entry itself, or the one it repeats
+        inline const SubBatchDesc& GetSubBatch(uint32_t index) const
+        {
+            const auto& subBatch = m_subBatches[index];
+            return subBatch.repeatOf == NoSubBatch ? subBatch : m_subBatches[subBatch.repeatOf];
+        }
+        //>Per node stretches of the sub-batches whose meshes hang off several nodes, see SubBatchDesc::nodeSpanStart
+        inline const std::vector<NodeSpan>& GetNodeSpans() const { return m_nodeSpans; }
+        //>Meshes drawn as translated copies of one prototype; their instances are not part of any batch
+        inline const std::vector<InstanceGroupDesc>& GetInstanceGroups() const { return m_instanceGroups; }
+        inline const std::vector<D3DXVECTOR3>& GetInstanceOffsets() const { return m_instanceOffsets; }
+        inline const std::vector<uint32_t>& GetInstanceTransforms() const { return m_instanceTransforms; }
+        //>Scene nodes of the model. Move one with SetLocal; UpdateTransforms applies it before the next frame's draws.
+        inline TransformHierarchy& GetTransforms() { return m_model->GetTransforms(); }
+        inline const TransformHierarchy& GetTransforms() const { return m_model->GetTransforms(); }
+        //>Render thread, once per frame; the hierarchy belongs to the import job until the model is loaded
+        void UpdateTransforms();
+        //>World matrix of every placement of the model; the first is the one AddModelToWorld imported it with
+        inline const std::vector<D3DXMATRIX>& GetPlacements() const { return m_placements; }
+        //>LOD0 clusters; batches and chunks refer to contiguous ranges of it
+        inline const std::vector<MeshCluster>& GetClusterList() const { return m_clusters; }
+        inline bool IsGeometryStreaming() const { return m_isStreamingGeometry; }
+        //>Model-wide images the chunks index into: the mapped cooked model when streaming, the CPU images otherwise
+        inline const PositionVertex* GetVertexSource() const { return m_streamSource.IsOpen() ? m_streamSource.GetVertices() : m_positionVertices.data(); }
+        inline const uint32_t* GetIndexSource() const { return m_streamSource.IsOpen() ? m_streamSource.GetIndices() : m_positionIndices.data(); }
 	private:
+        void AccumulateBatch(ArenaVector<BatchDesc>& batchDescs, uint32_t matIndex, uint32_t numIndices, uint32_t numTris, uint32_t numVertices);
+        void BuildChunks();
+        void BuildBatchLods(ArenaVector<BatchDesc>& batchDescs) const;
+        void BuildInstanceGroups();
+        void BuildSubBatches(ArenaVector<BatchDesc>& batchDescs);
+        void AppendSubBatch(SubBatchDesc subBatch);
+        void MeasureIndexWidths();
+        void BuildBatchBounds();
+        void CreatePlaceholderTextures();
+        void OnModelResident();
+        //>System memory of every stage except the assimp scene, which only the model can size
+        void MeasureResidency(std::array<size_t, ResidencyStageCount>& outBytes) const;
         
         IDirect3DDevice9* m_deviceRef;
         
         Model* m_model;
+        std::future<bool> m_importJob;
+
+        ModelLoadState m_loadState;
+        Stopwatch m_loadStopwatch;
+        uint32_t m_residentBatches;
+        uint32_t m_residentGroups;
+        bool m_texturesResident;
+        IDirect3DTexture9* m_placeholderTextures[Material::TextureTypeCount];
+
 		std::vector<BatchDesc> m_batchDesc;
+        std::vector<ChunkDesc> m_chunkDesc;
+        std::vector<MeshCluster> m_clusters;
+        std::vector<SubBatchDesc> m_subBatches;
+        std::vector<NodeSpan> m_nodeSpans;
+        std::vector<InstanceGroupDesc> m_instanceGroups;
+        std::vector<D3DXVECTOR3> m_instanceOffsets;
+        std::vector<uint32_t> m_instanceTransforms;
+        std::vector<uint32_t> m_meshInstanceGroup; //group of each prototype mesh, NoInstanceGroup otherwise
+        std::string m_modelPath;
+        std::vector<D3DXMATRIX> m_placements;
+        bool m_isStreamingGeometry;
+        bool m_isCullingClusters;
+        VertexFormat m_vertexFormat;
+        ResidencyPolicy m_residencyPolicy;
+        ModelCache m_streamSource; //cooked model kept mapped while streaming; the OS pages it, nothing is committed
         std::vector<PositionVertex> m_positionVertices;
+        std::vector<CompactVertex> m_compactVertices; //device-format copy of m_positionVertices when compact
         std::vector<uint32_t> m_positionIndices;
+        std::vector<uint16_t> m_indexImage16; //sub-batch indices, rebased to each sub-batch's base vertex
+        std::vector<uint32_t> m_indexImage32;
+        std::vector<uint16_t> m_clusterIndices16; //see GetClusterIndices
+        std::vector<uint32_t> m_clusterIndices32;
 
         int32_t m_vBufferVertexCount;
         int32_t m_iBufferIndexCount;
         int32_t m_primitiveCount;
+        uint32_t m_deviceVertexCount; //vertices in the device buffer: every mesh once, duplicates left out
+        uint32_t m_lod0IndexCount16;
+        uint32_t m_lod0IndexCount32;
 	};
 }
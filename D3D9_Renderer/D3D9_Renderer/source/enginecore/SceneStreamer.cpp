@@ -0,0 +1,308 @@
+#include <cassert>
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include <iomanip>
+#include <unordered_map>
+
+#include "SceneStreamer.h"
+#include "../utils/Logger.h"
+#include "../utils/MemoryStats.h"
+#include "../utils/Time.h"
+
+namespace renderer
+{
+    namespace
+    {
+        constexpr float MinStreamPixels = 2.0f;     //chunks smaller than this on screen are not requested
+        constexpr float EvictPixels = 1.0f;         //resident chunks that shrink below this are dropped without budget pressure
+        constexpr float EvictionHysteresis = 1.5f;  //a candidate has to matter this much more than a resident chunk to displace it
+        constexpr float BehindCameraWeight = 0.25f; //still streamed, so turning around does not expose holes for long
+        constexpr uint32_t SteadyStateFrames = 60;  //quiet frames before the residency report is logged
+    }
+
+    SceneStreamer::SceneStreamer(GeometryPool& geometryPool)
+        :m_geometryPool(geometryPool),
+        m_residency(),
+        m_candidates(),
+        m_victims(),
+        m_uploadBudgetBytes(0),
+        m_residentBudgetBytes(0),
+        m_stats(),
+        m_frame(0),
+        m_quietFrames(0),
+        m_steadyReported(false)
+    {
+    }
+
+    SceneStreamer::~SceneStreamer()
+    {
+        ReleaseAll();
+    }
+
+    void SceneStreamer::SetBudgets(size_t uploadBytesPerFrame, size_t residentBytes)
+    {
+        m_uploadBudgetBytes = uploadBytesPerFrame;
+        m_residentBudgetBytes = residentBytes;
+    }
+
+    void SceneStreamer::Update(IDirect3DDevice9* device, const ModelManager& modelManager, const StreamingView& view)
+    {
+        const auto& chunkList = modelManager.GetChunkList();
+        if (m_residency.size() != chunkList.size())
+            ResetResidency(chunkList);
+        ++m_frame;
+
+        bool residencyChanged = false;
+        m_candidates.clear();
+        m_victims.clear();
+        for (uint32_t itr = 0; itr < chunkList.size(); ++itr)
+        {
+            auto& residency = m_residency[itr];
+            residency.priority = ComputePriority(chunkList[itr], view);
+            if (residency.IsResident())
+            {
+                if (residency.priority < EvictPixels)
+                {
+                    EvictChunk(modelManager, itr);
+                    residencyChanged = true;
+                }
+                else
+                    m_victims.push_back(itr);
+            }
+            else if (residency.priority >= MinStreamPixels)
+                m_candidates.push_back(itr);
+        }
+
+        //most important first; victims least important first
+        std::sort(m_candidates.begin(), m_candidates.end(), [this](uint32_t lhs, uint32_t rhs) { return m_residency[lhs].priority > m_residency[rhs].priority; });
+        std::sort(m_victims.begin(), m_victims.end(), [this](uint32_t lhs, uint32_t rhs) { return m_residency[lhs].priority < m_residency[rhs].priority; });
+
+        size_t uploadedBytes = 0;
+        size_t nextVictim = 0;
+        for (const auto chunkIndex : m_candidates)
+        {
+            const size_t chunkBytes = chunkList[chunkIndex].GetSizeInBytes();
+            if (chunkBytes > m_residentBudgetBytes)
+                continue; //can never fit
+
+            //at least one chunk per frame so a single large chunk cannot stall streaming
+            if (uploadedBytes > 0 && uploadedBytes + chunkBytes > m_uploadBudgetBytes)
+                break;
+
+            const float priority = m_residency[chunkIndex].priority;
+            while (m_stats.residentBytes + chunkBytes > m_residentBudgetBytes && nextVictim < m_victims.size() &&
+                m_residency[m_victims[nextVictim]].priority * EvictionHysteresis < priority)
+            {
+                EvictChunk(modelManager, m_victims[nextVictim++]);
+                residencyChanged = true;
+            }
+            //everything further down the list matters less than what is resident
+            if (m_stats.residentBytes + chunkBytes > m_residentBudgetBytes)
+                break;
+
+            if (!UploadChunk(device, modelManager, chunkIndex))
+                break;
+            uploadedBytes += chunkBytes;
+            residencyChanged = true;
+        }
+
+        if (residencyChanged)
+        {
+            m_quietFrames = 0;
+            m_steadyReported = false;
+            m_stats.framesToSteadyState = m_frame;
+        }
+        else if (++m_quietFrames >= SteadyStateFrames && !m_steadyReported)
+        {
+            LogResidencyReport();
+            m_steadyReported = true;
+        }
+    }
+
+    uint32_t SceneStreamer::AdoptUnchangedChunks(SceneStreamer& previous, const ModelManager& previousManager, const ModelManager& modelManager)
+    {
+        const auto& chunkList = modelManager.GetChunkList();
+        const auto& previousChunks = previousManager.GetChunkList();
+        if (m_residency.size() != chunkList.size())
+            ResetResidency(chunkList);
+
+        std::unordered_map<uint64_t, uint32_t> residentByHash;
+        for (uint32_t itr = 0; itr < previous.m_residency.size(); ++itr)
+        {
+            if (previous.m_residency[itr].IsResident() && previousChunks[itr].contentHash != 0) //0: imported without mesh hashing
+                residentByHash.emplace(previousChunks[itr].contentHash, itr);
+        }
+
+        uint32_t adopted = 0;
+        for (uint32_t itr = 0; itr < chunkList.size(); ++itr)
+        {
+            const auto& chunk = chunkList[itr];
+            const auto found = residentByHash.find(chunk.contentHash);
+            if (found == residentByHash.end())
+                continue;
+            //the hash covers the contents; the layout of the ranges has to match as well
+            const auto& previousChunk = previousChunks[found->second];
+            if (previousChunk.GetSizeInBytes() != chunk.GetSizeInBytes() || previousChunk.vertexStride != chunk.vertexStride || previousChunk.indexStride != chunk.indexStride)
+                continue;
+
+            auto& residency = previous.m_residency[found->second];
+            m_residency[itr].vertices = residency.vertices;
+            m_residency[itr].indices = residency.indices;
+            m_residency[itr].lodIndexStart = residency.lodIndexStart;
+            residency.vertices = NoGeometry;
+            residency.indices = NoGeometry;
+            residentByHash.erase(found); //copies with the same contents stream their own ranges
+
+            --previous.m_stats.residentChunks;
+            previous.m_stats.residentBytes -= previousChunk.GetSizeInBytes();
+            ++m_stats.residentChunks;
+            m_stats.residentBytes += chunk.GetSizeInBytes();
+            ++adopted;
+        }
+        return adopted;
+    }
+
+    void SceneStreamer::ResetResidency(const std::vector<ChunkDesc>& chunkList)
+    {
+        ReleaseAll();
+        m_residency.assign(chunkList.size(), ChunkResidency());
+        m_stats = StreamingStats();
+        m_stats.totalChunks = static_cast<uint32_t>(chunkList.size());
+        for (const auto& chunk : chunkList)
+            m_stats.totalBytes += chunk.GetSizeInBytes();
+        m_frame = 0;
+        m_quietFrames = 0;
+        m_steadyReported = false;
+    }
+
+    void SceneStreamer::ReleaseAll()
+    {
+        for (auto& residency : m_residency)
+        {
+            m_geometryPool.Free(residency.vertices);
+            m_geometryPool.Free(residency.indices);
+            residency.vertices = NoGeometry;
+            residency.indices = NoGeometry;
+        }
+        m_stats.residentChunks = 0;
+        m_stats.residentBytes = 0;
+    }
+
+    void SceneStreamer::LogResidencyReport() const
+    {
+        std::ostringstream os;
+        os << std::fixed << std::setprecision(2);
+        os << "[Streaming] steady state after " << m_stats.framesToSteadyState << " frames\n";
+        os << "    resident: " << m_stats.residentChunks << " / " << m_stats.totalChunks << " chunks, ";
+        os << BytesToMB(m_stats.residentBytes) << " / " << BytesToMB(m_stats.totalBytes) << " MB (budget " << BytesToMB(m_residentBudgetBytes) << " MB)\n";
+        os << "    uploads: " << m_stats.uploads << " (" << BytesToMB(m_stats.uploadedBytes) << " MB in " << m_stats.uploadMs << " ms, budget ";
+        os << BytesToMB(m_uploadBudgetBytes) << " MB/frame) | evictions: " << m_stats.evictions;
+
+        Logger::GetInstance().LogInfo(os.str().c_str());
+    }
+
+    float SceneStreamer::ComputePriority(const ChunkDesc& chunk, const StreamingView& view) const
+    {
+        const D3DXVECTOR3 toChunk = chunk.center - view.position;
+        const float distance = D3DXVec3Length(&toChunk);
+        if (distance <= chunk.radius)
+            return (std::numeric_limits<float>::max)(); //camera is inside it
+
+        //projected radius in pixels
+        float pixels = chunk.radius / distance * view.pixelsPerUnitAtUnitDistance;
+        if (D3DXVec3Dot(&toChunk, &view.forward) < -chunk.radius)
+            pixels *= BehindCameraWeight;
+        return pixels;
+    }
+
+    bool SceneStreamer::UploadChunk(IDirect3DDevice9* device, const ModelManager& modelManager, uint32_t chunkIndex)
+    {
+        Stopwatch stopwatch;
+        const auto& chunk = modelManager.GetChunkList()[chunkIndex];
+        auto& residency = m_residency[chunkIndex];
+        const UINT vertexBytes = chunk.vertexCount * chunk.vertexStride;
+        const UINT chunkIndexCount = static_cast<UINT>((chunk.GetSizeInBytes() - vertexBytes) / chunk.indexStride);
+
+        //out of memory is the expected failure here; the chunk simply stays out
+        residency.vertices = m_geometryPool.AllocateVertices(device, chunk.vertexStride, chunk.vertexCount);
+        if (residency.vertices == NoGeometry)
+            return false;
+        const bool isIndex32 = chunk.indexStride == sizeof(uint32_t);
+        residency.indices = m_geometryPool.AllocateIndices(device, isIndex32, chunkIndexCount);
+        if (residency.indices == NoGeometry)
+        {
+            FreeRanges(residency);
+            return false;
+        }
+
+        //a failed lock (a lost device, say) leaves the chunk out, so a later frame retries it instead of drawing garbage
+        void* bufferData = m_geometryPool.Lock(residency.vertices);
+        if (bufferData == nullptr)
+        {
+            FreeRanges(residency);
+            return false;
+        }
+        modelManager.CopyVertices(chunk.vertexStart, chunk.vertexCount, bufferData);
+        m_geometryPool.Unlock(residency.vertices);
+
+        bufferData = m_geometryPool.Lock(residency.indices);
+        if (bufferData == nullptr)
+        {
+            FreeRanges(residency);
+            return false;
+        }
+
+        //the images index the model-wide vertex range; each chunk buffer starts at its own first vertex, which is
+        //what lets almost every chunk use 16-bit indices
+        uint32_t lodIndexStart = 0;
+        for (uint32_t level = 0; level < chunk.lodCount; ++level)
+        {
+            const uint32_t* srcIndices = modelManager.GetIndexSource() + chunk.lods[level].indexStart;
+            const uint32_t indexCount = chunk.lods[level].primitiveCount * 3;
+            if (isIndex32)
+            {
+                uint32_t* dstIndices = static_cast<uint32_t*>(bufferData) + lodIndexStart;
+                for (uint32_t itr = 0; itr < indexCount; ++itr)
+                    dstIndices[itr] = srcIndices[itr] - chunk.vertexStart;
+            }
+            else
+            {
+                uint16_t* dstIndices = static_cast<uint16_t*>(bufferData) + lodIndexStart;
+                for (uint32_t itr = 0; itr < indexCount; ++itr)
+                    dstIndices[itr] = static_cast<uint16_t>(srcIndices[itr] - chunk.vertexStart);
+            }
+            residency.lodIndexStart[level] = lodIndexStart;
+            lodIndexStart += indexCount;
+        }
+        m_geometryPool.Unlock(residency.indices);
+
+        ++m_stats.residentChunks;
+        m_stats.residentBytes += chunk.GetSizeInBytes();
+        ++m_stats.uploads;
+        m_stats.uploadedBytes += chunk.GetSizeInBytes();
+        m_stats.uploadMs += stopwatch.GetElapsedMs();
+        return true;
+    }
+
+    void SceneStreamer::EvictChunk(const ModelManager& modelManager, uint32_t chunkIndex)
+    {
+        auto& residency = m_residency[chunkIndex];
+        assert(residency.IsResident());
+        FreeRanges(residency);
+
+        --m_stats.residentChunks;
+        m_stats.residentBytes -= modelManager.GetChunkList()[chunkIndex].GetSizeInBytes();
+        ++m_stats.evictions;
+    }
+
+    void SceneStreamer::FreeRanges(ChunkResidency& residency)
+    {
+        if (residency.vertices != NoGeometry)
+            m_geometryPool.Free(residency.vertices);
+        if (residency.indices != NoGeometry)
+            m_geometryPool.Free(residency.indices);
+        residency.vertices = NoGeometry;
+        residency.indices = NoGeometry;
+    }
+}
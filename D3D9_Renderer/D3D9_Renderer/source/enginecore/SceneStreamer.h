@@ -0,0 +1,111 @@
+#pragma once
+
+#include <d3d9.h>
+#include <d3dx9.h>
+#include <vector>
+#include <array>
+
+#include "Batch.h"
+#include "ModelManager.h"
+#include "../renderer/d3d9/GeometryPool.h"
+
+namespace renderer
+{
+    //>Where the scene is seen from; priorities are projected sizes in pixels
+    struct StreamingView
+    {
+        D3DXVECTOR3 position;
+        D3DXVECTOR3 forward;
+        float pixelsPerUnitAtUnitDistance; //projection y scale * half the viewport height
+    };
+
+    //>Counters for the residency report, cumulative since the model started streaming
+    struct StreamingStats
+    {
+        StreamingStats()
+            :residentChunks(0),
+            residentBytes(0),
+            totalChunks(0),
+            totalBytes(0),
+            uploads(0),
+            evictions(0),
+            uploadedBytes(0),
+            uploadMs(0.0),
+            framesToSteadyState(0)
+        {}
+
+        uint32_t residentChunks;
+        size_t residentBytes;
+        uint32_t totalChunks;
+        size_t totalBytes;
+        uint32_t uploads;
+        uint32_t evictions;
+        size_t uploadedBytes;
+        double uploadMs;
+        uint32_t framesToSteadyState; //frames from the first streaming frame to the last upload or eviction
+    };
+
+    //>Keeps the chunks that matter most to the camera in device memory, within a per-frame upload budget and a residency budget
+    class SceneStreamer
+    {
+    public:
+        //>One vertex range and one index range in the geometry pool per resident chunk. Indices are rebased to the chunk's
+        //>first vertex, 16-bit unless the chunk is too large (ChunkDesc::indexStride), and every LOD level is stored back to
+        //>back in the index range.
+        struct ChunkResidency
+        {
+            ChunkResidency()
+                :vertices(NoGeometry),
+                indices(NoGeometry),
+                priority(0.0f),
+                lodIndexStart()
+            {}
+
+            inline bool IsResident() const { return vertices != NoGeometry; }
+
+            GeometryHandle vertices;
+            GeometryHandle indices;
+            float priority;
+            std::array<uint32_t, MaxMeshLods> lodIndexStart; //first index of each level within the index range
+        };
+
+        explicit SceneStreamer(GeometryPool& geometryPool);
+        ~SceneStreamer();
+
+        SceneStreamer(const SceneStreamer&) = delete;
+        SceneStreamer& operator=(const SceneStreamer&) = delete;
+
+        void SetBudgets(size_t uploadBytesPerFrame, size_t residentBytes);
+
+        //>Render thread, once per frame: reprioritizes every chunk, evicts and uploads
+        void Update(IDirect3DDevice9* device, const ModelManager& modelManager, const StreamingView& view);
+        //>Takes over previous' resident chunks whose content hash matches one of modelManager's, ranges and all, so a
+        //>reloaded model only streams what changed. Call before the first Update. Returns the chunks taken.
+        uint32_t AdoptUnchangedChunks(SceneStreamer& previous, const ModelManager& previousManager, const ModelManager& modelManager);
+        void ReleaseAll();
+
+        inline const std::vector<ChunkResidency>& GetResidency() const { return m_residency; }
+        inline const StreamingStats& GetStats() const { return m_stats; }
+        void LogResidencyReport() const;
+
+    private:
+        void ResetResidency(const std::vector<ChunkDesc>& chunkList);
+        float ComputePriority(const ChunkDesc& chunk, const StreamingView& view) const;
+        [[nodiscard]] bool UploadChunk(IDirect3DDevice9* device, const ModelManager& modelManager, uint32_t chunkIndex);
+        void EvictChunk(const ModelManager& modelManager, uint32_t chunkIndex);
+        //>Returns whichever of the chunk's ranges are allocated to the pool; the chunk is not resident afterwards
+        void FreeRanges(ChunkResidency& residency);
+
+        GeometryPool& m_geometryPool;
+        std::vector<ChunkResidency> m_residency;
+        std::vector<uint32_t> m_candidates;
+        std::vector<uint32_t> m_victims;
+        size_t m_uploadBudgetBytes;
+        size_t m_residentBudgetBytes;
+
+        StreamingStats m_stats;
+        uint32_t m_frame;
+        uint32_t m_quietFrames;   //consecutive frames without an upload or eviction
+        bool m_steadyReported;
+    };
+}
@@ -0,0 +1,153 @@
+#include <fstream>
+#include <cassert>
+#include <algorithm>
+
+#include "CookedTexture.h"
+#include "../utils/AssetPack.h"
+
+namespace renderer
+{
+    namespace
+    {
+        constexpr uint64_t CookedSectionAlignment = 16;
+
+        inline uint64_t AlignOffset(uint64_t offset)
+        {
+            return (offset + CookedSectionAlignment - 1) & ~(CookedSectionAlignment - 1);
+        }
+
+        void WritePadding(std::ofstream& stream, uint64_t alignedOffset)
+        {
+            static const char zeros[CookedSectionAlignment] = {};
+            const auto current = static_cast<uint64_t>(stream.tellp());
+            assert(alignedOffset >= current);
+            stream.write(zeros, static_cast<std::streamsize>(alignedOffset - current));
+        }
+
+        inline uint32_t GetBlockCount(uint32_t texels)
+        {
+            return texels > 4 ? (texels + 3) / 4 : 1;
+        }
+    }
+
+    CookedTexture::CookedTexture()
+        :m_file(),
+        m_header(nullptr)
+    {
+    }
+
+    CookedTexture::~CookedTexture()
+    {
+        Close();
+    }
+
+    std::string CookedTexture::GetCookedPath(const std::string& sourcePath)
+    {
+        return sourcePath + ".ctex";
+    }
+
+    uint32_t CookedTexture::GetBlockBytes(CookedTextureFormat format)
+    {
+        return format == CookedTextureFormat::BC1 ? 8 : 16;
+    }
+
+    bool CookedTexture::Open(const std::string& cookedPath, uint64_t sourceHash, AssetSource source)
+    {
+        if (OpenFrom(cookedPath, source, sourceHash))
+            return true;
+        return source == AssetSource::Any && AssetPack::GetInstance().Find(cookedPath) != nullptr && OpenFrom(cookedPath, AssetSource::Loose, sourceHash);
+    }
+
+    bool CookedTexture::OpenFrom(const std::string& cookedPath, AssetSource source, uint64_t sourceHash)
+    {
+        Close();
+
+        if (!m_file.Open(cookedPath, source))
+            return false;
+
+        if (m_file.GetSize() < sizeof(CookedTextureHeader))
+        {
+            Close();
+            return false;
+        }
+
+        const auto header = reinterpret_cast<const CookedTextureHeader*>(m_file.GetData());
+        const auto format = static_cast<CookedTextureFormat>(header->format);
+        bool valid = header->magic == CookedTextureMagic &&
+            header->version == CookedTextureVersion &&
+            header->sourceHash == sourceHash &&
+            (format == CookedTextureFormat::BC1 || format == CookedTextureFormat::BC3) &&
+            header->mipCount > 0 && header->mipCount <= CookedTextureMaxMips;
+
+        //every level has to be complete; a truncated write must not be trusted
+        for (uint32_t level = 0; valid && level < header->mipCount; ++level)
+        {
+            const auto& mip = header->mips[level];
+            const uint64_t expectedSize = static_cast<uint64_t>(GetBlockCount(mip.width)) * GetBlockCount(mip.height) * GetBlockBytes(format);
+            valid = mip.dataSize == expectedSize && mip.dataOffset + mip.dataSize <= m_file.GetSize();
+        }
+
+        if (!valid)
+        {
+            Close();
+            return false;
+        }
+
+        m_header = header;
+        return true;
+    }
+
+    void CookedTexture::Close()
+    {
+        m_header = nullptr;
+        m_file.Close();
+    }
+
+    bool CookedTexture::Write(const std::string& cookedPath, uint64_t sourceHash, CookedTextureFormat format, uint32_t flags,
+        uint32_t width, uint32_t height, const std::vector<std::vector<uint8_t>>& levels)
+    {
+        if (levels.empty() || levels.size() > CookedTextureMaxMips)
+            return false;
+
+        CookedTextureHeader header = {};
+        header.magic = CookedTextureMagic;
+        header.version = CookedTextureVersion;
+        header.sourceHash = sourceHash;
+        header.format = static_cast<uint32_t>(format);
+        header.flags = flags;
+        header.width = width;
+        header.height = height;
+        header.mipCount = static_cast<uint32_t>(levels.size());
+
+        uint64_t offset = AlignOffset(sizeof(CookedTextureHeader));
+        for (uint32_t level = 0; level < header.mipCount; ++level)
+        {
+            auto& mip = header.mips[level];
+            mip.width = (std::max)(1u, width >> level);
+            mip.height = (std::max)(1u, height >> level);
+            mip.dataSize = static_cast<uint32_t>(levels[level].size());
+            mip.dataOffset = offset;
+            offset = AlignOffset(offset + mip.dataSize);
+        }
+
+        //write to a temporary and swap it in so a crash mid-write never leaves a valid-looking file behind
+        const std::string tempPath = cookedPath + ".tmp";
+        {
+            std::ofstream stream(tempPath, std::ios::binary | std::ios::trunc);
+            if (!stream)
+                return false;
+
+            stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            for (uint32_t level = 0; level < header.mipCount; ++level)
+            {
+                WritePadding(stream, header.mips[level].dataOffset);
+                stream.write(reinterpret_cast<const char*>(levels[level].data()), static_cast<std::streamsize>(levels[level].size()));
+            }
+
+            if (!stream)
+                return false;
+        }
+
+        return ::MoveFileExA(tempPath.c_str(), cookedPath.c_str(), MOVEFILE_REPLACE_EXISTING) != FALSE;
+    }
+}
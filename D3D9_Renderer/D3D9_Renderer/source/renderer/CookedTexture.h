@@ -0,0 +1,86 @@
+#pragma once
+
+#include <windows.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../utils/AssetFile.h"
+
+namespace renderer
+{
+    constexpr uint32_t CookedTextureMagic = 0x58455443; //'CTEX'
+    constexpr uint32_t CookedTextureVersion = 1;
+    constexpr uint32_t CookedTextureMaxMips = 16;
+
+    //>Values are the D3DFORMAT FourCCs so the runtime can pass them straight to CreateTexture
+    enum class CookedTextureFormat : uint32_t
+    {
+        BC1 = 0x31545844, //'DXT1'
+        BC3 = 0x35545844  //'DXT5'
+    };
+
+    enum CookedTextureFlags : uint32_t
+    {
+        CookedTextureFlagNone = 0,
+        CookedTextureFlagNormalXY = 1 << 0 //BC3 normal map: X in alpha, Y in green, Z rebuilt in the shader
+    };
+
+    struct CookedMipRecord
+    {
+        uint64_t dataOffset; //relative to the start of the file, 16 byte aligned
+        uint32_t dataSize;
+        uint32_t width;
+        uint32_t height;
+        uint32_t reserved;
+    };
+
+    //>On-disk layout: header, mip table, then every level's blocks, largest first
+    struct CookedTextureHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t sourceHash;
+        uint32_t format;
+        uint32_t flags;
+        uint32_t width;
+        uint32_t height;
+        uint32_t mipCount;
+        uint32_t reserved;
+        CookedMipRecord mips[CookedTextureMaxMips];
+    };
+
+    //>Pre-mipped, block-compressed texture written by the TextureCooker, keyed by the hash of the source image file
+    class CookedTexture
+    {
+    public:
+        CookedTexture();
+        ~CookedTexture();
+
+        CookedTexture(const CookedTexture&) = delete;
+        CookedTexture& operator=(const CookedTexture&) = delete;
+
+        static std::string GetCookedPath(const std::string& sourcePath);
+        static uint32_t GetBlockBytes(CookedTextureFormat format);
+
+        //>Maps the cooked file; fails (and leaves it closed) when the source hash or version does not match.
+        //>A packed copy that does not match gives way to the loose file, which may have been re-cooked since the pack was built.
+        [[nodiscard]] bool Open(const std::string& cookedPath, uint64_t sourceHash, AssetSource source = AssetSource::Any);
+        void Close();
+
+        //>levels[i] holds the blocks of mip i, row after row
+        [[nodiscard]] static bool Write(const std::string& cookedPath, uint64_t sourceHash, CookedTextureFormat format, uint32_t flags,
+            uint32_t width, uint32_t height, const std::vector<std::vector<uint8_t>>& levels);
+
+        inline bool IsOpen() const { return m_header != nullptr; }
+        inline const CookedTextureHeader& GetHeader() const { return *m_header; }
+        inline CookedTextureFormat GetFormat() const { return static_cast<CookedTextureFormat>(m_header->format); }
+        inline const uint8_t* GetMipData(uint32_t level) const { return m_file.GetData() + m_header->mips[level].dataOffset; }
+
+    private:
+        [[nodiscard]] bool OpenFrom(const std::string& cookedPath, AssetSource source, uint64_t sourceHash);
+
+        AssetFile m_file;
+        const CookedTextureHeader* m_header;
+    };
+}
@@ -0,0 +1,92 @@
+#include <assimp/postprocess.h>
+
+#include "ImportProfile.h"
+
+namespace renderer
+{
+    uint32_t GetImportFlags(ImportProfile profile)
+    {
+        const uint32_t preview = aiProcess_Triangulate | aiProcess_ConvertToLeftHanded | aiProcess_FlipUVs;
+        const uint32_t production = preview |
+            aiProcess_CalcTangentSpace |
+            aiProcess_JoinIdenticalVertices |
+            aiProcess_RemoveRedundantMaterials |
+            aiProcess_OptimizeMeshes;
+
+        switch (profile)
+        {
+        case ImportProfile::FastPreview:
+            return preview;
+        case ImportProfile::Validation:
+            return production | aiProcess_ValidateDataStructure | aiProcess_FindInvalidData;
+        case ImportProfile::Production:
+        default:
+            return production;
+        }
+    }
+
+    const char* GetImportProfileName(ImportProfile profile)
+    {
+        switch (profile)
+        {
+        case ImportProfile::FastPreview:
+            return "fast-preview";
+        case ImportProfile::Validation:
+            return "validation";
+        case ImportProfile::Production:
+        default:
+            return "production";
+        }
+    }
+
+    const std::vector<ImportStep>& GetImportSteps()
+    {
+        //mirrors the registry order in assimp's PostStepRegistry.cpp, so applying the flags one at a time
+        //produces the same scene as applying them together
+        static const std::vector<ImportStep> steps =
+        {
+            { aiProcess_ValidateDataStructure, "ValidateDataStructure" },
+            { aiProcess_MakeLeftHanded, "MakeLeftHanded" },
+            { aiProcess_FlipUVs, "FlipUVs" },
+            { aiProcess_FlipWindingOrder, "FlipWindingOrder" },
+            { aiProcess_RemoveRedundantMaterials, "RemoveRedundantMaterials" },
+            { aiProcess_FindDegenerates, "FindDegenerates" },
+            { aiProcess_Triangulate, "Triangulate" },
+            { aiProcess_SortByPType, "SortByPType" },
+            { aiProcess_FindInvalidData, "FindInvalidData" },
+            { aiProcess_OptimizeMeshes, "OptimizeMeshes" },
+            { aiProcess_GenNormals, "GenNormals" },
+            { aiProcess_GenSmoothNormals, "GenSmoothNormals" },
+            { aiProcess_CalcTangentSpace, "CalcTangentSpace" },
+            { aiProcess_JoinIdenticalVertices, "JoinIdenticalVertices" },
+            { aiProcess_ImproveCacheLocality, "ImproveCacheLocality" }
+        };
+        return steps;
+    }
+
+    ImportProgressHandler::ImportProgressHandler()
+        :m_stopwatch(),
+        m_parseStartMs(0.0),
+        m_parseMs(0.0),
+        m_updateCount(0)
+    {
+    }
+
+    bool ImportProgressHandler::Update(float percentage)
+    {
+        (void)percentage;
+        ++m_updateCount;
+        return true; //never abort
+    }
+
+    void ImportProgressHandler::UpdateFileRead(int currentStep, int numberOfSteps)
+    {
+        //assimp reports (0, n) right before the format importer runs and (n, n) right after it
+        if (currentStep == 0)
+            m_parseStartMs = m_stopwatch.GetElapsedMs();
+        else if (currentStep >= numberOfSteps)
+            m_parseMs = m_stopwatch.GetElapsedMs() - m_parseStartMs;
+
+        ProgressHandler::UpdateFileRead(currentStep, numberOfSteps);
+    }
+}
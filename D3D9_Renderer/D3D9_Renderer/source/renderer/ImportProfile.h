@@ -0,0 +1,49 @@
+#pragma once
+
+#include <assimp/ProgressHandler.hpp>
+#include <cstdint>
+#include <vector>
+
+#include "../utils/Time.h"
+
+namespace renderer
+{
+    //>Named sets of aiProcess flags, picked per model
+    enum class ImportProfile
+    {
+        FastPreview, //triangulate + handedness only: quickest path to something on screen
+        Production,  //everything the renderer uses (tangents, welded vertices, merged meshes), no validation
+        Validation   //Production plus assimp's data-structure validation and invalid-data scrub
+    };
+
+    //>One aiProcess flag in the order assimp's post-step registry runs it
+    struct ImportStep
+    {
+        uint32_t flag;
+        const char* name;
+    };
+
+    uint32_t GetImportFlags(ImportProfile profile);
+    const char* GetImportProfileName(ImportProfile profile);
+    //>Every step this renderer may request, in assimp's execution order
+    const std::vector<ImportStep>& GetImportSteps();
+
+    //>Splits Importer::ReadFile into file parse (UpdateFileRead start..end) and the scene preprocessing after it
+    class ImportProgressHandler : public Assimp::ProgressHandler
+    {
+    public:
+        ImportProgressHandler();
+
+        bool Update(float percentage = -1.f) override;
+        void UpdateFileRead(int currentStep, int numberOfSteps) override;
+
+        inline double GetParseMs() const { return m_parseMs; }
+        inline uint32_t GetUpdateCount() const { return m_updateCount; }
+
+    private:
+        Stopwatch m_stopwatch;
+        double m_parseStartMs;
+        double m_parseMs;
+        uint32_t m_updateCount;
+    };
+}
@@ -0,0 +1,101 @@
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+#include "LoadReport.h"
+#include "../utils/Logger.h"
+#include "../utils/MemoryStats.h"
+
+namespace renderer
+{
+    void ModelLoadReport::LogImportBreakdown(std::ostream& os) const
+    {
+        //percentages are of importMs so the remainder is the extraction into the vertex/index images
+        const double total = (std::max)(importMs, 1e-6);
+        auto logLine = [&os, total](const char* name, double ms)
+        {
+            os << "\n        " << std::left << std::setw(26) << name << std::right << std::setw(9) << ms << " ms " << std::setw(6) << (100.0 * ms / total) << " %";
+        };
+
+        logLine("parse", parseMs);
+        logLine("preprocess", preprocessMs);
+        for (const auto& step : postProcessSteps)
+        {
+            logLine(step.name, step.ms);
+        }
+        logLine("extract", extractMs);
+        logLine("mesh order", meshOrderMs);
+        logLine("lod chain", lodBuildMs);
+    }
+
+    void ModelLoadReport::LogReport() const
+    {
+        std::ostringstream os;
+        os << std::fixed << std::setprecision(2);
+        const bool isNative = nativeImport.format != NativeFormat::None;
+        os << "[ModelLoad] " << filePath << (loadedFromCache ? " (warm, cooked cache)" : isNative ? " (cold, native)" : " (cold, assimp)") << " profile: " << importProfile << "\n";
+        os << "    hash: " << hashMs << " ms | import: " << importMs << " ms";
+        if (!loadedFromCache)
+        {
+            os << " (extract: " << extractMs << " ms on " << workerThreads << " threads)";
+            os << " | cache write: " << cacheWriteMs << " ms";
+            const auto& cacheBefore = meshOrderBefore.vertexCache;
+            const auto& cacheAfter = meshOrderAfter.vertexCache;
+            os << "\n    mesh order (" << meshOrderMs << " ms): ACMR " << cacheBefore.GetAcmr() << " -> " << cacheAfter.GetAcmr();
+            os << " | ATVR " << cacheBefore.GetAtvr() << " -> " << cacheAfter.GetAtvr();
+            os << " | vertex shader invocations " << cacheBefore.transformedVertices << " -> " << cacheAfter.transformedVertices;
+            os << "\n        vertex fetch overfetch " << meshOrderBefore.vertexFetch.GetOverfetch() << " -> " << meshOrderAfter.vertexFetch.GetOverfetch();
+            os << " (" << BytesToMB(static_cast<size_t>(meshOrderBefore.vertexFetch.fetchedBytes)) << " -> " << BytesToMB(static_cast<size_t>(meshOrderAfter.vertexFetch.fetchedBytes)) << " MB)";
+            if (meshOrderAfter.overdraw.pixelsCovered > 0)
+                os << " | overdraw " << meshOrderBefore.overdraw.GetOverdraw() << " -> " << meshOrderAfter.overdraw.GetOverdraw();
+            LogImportBreakdown(os);
+            if (isNative)
+            {
+                os << "\n    native " << GetNativeFormatName(nativeImport.format) << ": " << BytesToMB(nativeImport.sourceBytes) << " MB parsed in " << nativeImport.parseMs;
+                os << " ms (" << nativeImport.GetParseMBPerSecond() << " MB/s), " << nativeImport.corners << " corners -> " << nativeImport.vertices;
+                os << " vertices welded, " << nativeImport.generatedNormals << " generated normals | build: " << nativeImport.buildMs << " ms";
+            }
+        }
+        os << "\n    scene: " << nodeCount << " nodes, " << meshCount << " meshes";
+        if (!loadedFromCache)
+            os << " from " << sourceMeshCount << " source meshes";
+        if (!bounds.IsEmpty())
+        {
+            os << " | bounds (" << bounds.boundsMin.x << ", " << bounds.boundsMin.y << ", " << bounds.boundsMin.z << ") - (";
+            os << bounds.boundsMax.x << ", " << bounds.boundsMax.y << ", " << bounds.boundsMax.z << "), radius " << bounds.radius;
+        }
+        os << "\n    lods:";
+        for (uint32_t level = 0; level < lodCount; ++level)
+        {
+            const double share = lodLevels[0].triangles > 0 ? 100.0 * lodLevels[level].triangles / lodLevels[0].triangles : 0.0;
+            os << " [" << level << "] " << lodLevels[level].triangles << " tris (" << share << " %, max error " << lodLevels[level].maxError << ")";
+        }
+        if (!loadedFromCache && lodCount > 1)
+            os << " built in " << lodBuildMs << " ms";
+        os << "\n    instancing: " << dedup.duplicateMeshes << " duplicate meshes in " << dedup.instanceGroups << " groups, ";
+        os << BytesToMB(dedup.duplicateVertexBytes + dedup.duplicateIndexBytes) << " MB of geometry shared | found in " << dedupMs << " ms";
+        os << "\n    clusters: " << clusterCount << " (" << (clusterCount > 0 ? static_cast<double>(lodLevels[0].triangles) / clusterCount : 0.0) << " tris avg, ";
+        os << coneClusterCount << " with a normal cone) built in " << clusterBuildMs << " ms";
+        const double vertexSaving = fullVertexBytes > 0 ? 100.0 * (1.0 - static_cast<double>(deviceVertexBytes) / fullVertexBytes) : 0.0;
+        os << "\n    vertex format: " << vertexFormat << ", " << BytesToMB(fullVertexBytes) << " -> " << BytesToMB(deviceVertexBytes) << " MB (" << vertexSaving << " % saved)";
+        if (vertexEncode.vertices > 0)
+        {
+            os << " | max encode error: position " << vertexEncode.maxPositionError << ", normal " << vertexEncode.maxNormalErrorDeg << " deg, tangent frame ";
+            os << vertexEncode.maxTangentErrorDeg << " deg, uv " << vertexEncode.maxUvError << " | encode: " << vertexEncodeMs << " ms";
+        }
+        const double indexSaving = fullIndexBytes > 0 ? 100.0 * (1.0 - static_cast<double>(deviceIndexBytes) / fullIndexBytes) : 0.0;
+        os << "\n    index format: " << indexRanges - index32Ranges << " / " << indexRanges << " draw ranges 16-bit, " << BytesToMB(fullIndexBytes) << " -> ";
+        os << BytesToMB(deviceIndexBytes) << " MB (" << indexSaving << " % saved)";
+        os << "\n    textures: " << uniqueTextures << " unique files for " << textureSlots << " slots, " << cookedTextures << " cooked | decode + mips: " << textureStageMs << " ms on " << textureDecodeThreads << " threads";
+        os << " (" << BytesToMB(textureDecodeInputBytes) / (std::max)(textureStageMs / 1000.0, 1e-6) << " MB/s, " << BytesToMB(textureStagingBytes) << " MB staged)\n";
+        os << "    blocking: " << blockingMs << " ms | geometry upload: " << geometryUploadMs << " ms | texture upload: " << textureUploadMs << " ms";
+        os << " over " << uploadFrames << " frames | resident after: " << totalMs << " ms\n";
+        os << "    vertex image: " << BytesToMB(vertexImageBytes) << " MB | index image: " << BytesToMB(indexImageBytes) << " MB";
+        os << " | peak working set: " << BytesToMB(peakWorkingSetBytes) << " MB";
+        os << "\n    import arena: " << BytesToMB(importArenaHighWaterBytes) << " MB high water in " << importArenaBlocks << " blocks (";
+        os << BytesToMB(importArenaReservedBytes) << " MB reserved), released in one call";
+        residency.Log(os);
+
+        Logger::GetInstance().LogInfo(os.str().c_str());
+    }
+}
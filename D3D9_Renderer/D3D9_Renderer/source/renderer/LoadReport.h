@@ -0,0 +1,175 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include <array>
+
+#include "VertexCacheOptimizer.h"
+#include "MeshOrderOptimizer.h"
+#include "VertexCompression.h"
+#include "MeshDedup.h"
+#include "Mesh.h"
+#include "ResidencyReport.h"
+#include "NativeMeshLoader.h"
+
+namespace renderer
+{
+    //>Wall time of one aiProcess step
+    struct ImportStepTiming
+    {
+        const char* name;
+        double ms;
+    };
+
+    //>CPU simulation of the GPU work one index/vertex order causes
+    struct MeshOrderStats
+    {
+        MeshOrderStats& operator+=(const MeshOrderStats& other)
+        {
+            vertexCache += other.vertexCache;
+            vertexFetch += other.vertexFetch;
+            overdraw += other.overdraw;
+            return *this;
+        }
+
+        VertexCacheStats vertexCache;
+        VertexFetchStats vertexFetch;
+        OverdrawStats overdraw; //empty unless the validation profile was used
+    };
+
+    //>One level of detail summed over every mesh
+    struct LodLevelStats
+    {
+        LodLevelStats()
+            :triangles(0),
+            maxError(0.0f)
+        {}
+
+        uint64_t triangles;
+        float maxError; //model units, the worst mesh of this level
+    };
+
+    //>Timings gathered while bringing a model from disk into the vertex/index images
+    struct ModelLoadReport
+    {
+        ModelLoadReport()
+            :filePath(),
+            importProfile(""),
+            loadedFromCache(false),
+            hashMs(0.0),
+            importMs(0.0),
+            parseMs(0.0),
+            nativeImport(),
+            preprocessMs(0.0),
+            postProcessSteps(),
+            extractMs(0.0),
+            meshOrderMs(0.0),
+            lodBuildMs(0.0),
+            nodeCount(0),
+            sourceMeshCount(0),
+            meshCount(0),
+            bounds(),
+            lodCount(1),
+            lodLevels(),
+            dedupMs(0.0),
+            dedup(),
+            clusterBuildMs(0.0),
+            clusterCount(0),
+            coneClusterCount(0),
+            vertexFormat(""),
+            vertexEncodeMs(0.0),
+            vertexEncode(),
+            fullVertexBytes(0),
+            deviceVertexBytes(0),
+            fullIndexBytes(0),
+            deviceIndexBytes(0),
+            indexRanges(0),
+            index32Ranges(0),
+            meshOrderBefore(),
+            meshOrderAfter(),
+            workerThreads(1),
+            cacheWriteMs(0.0),
+            textureStageMs(0.0),
+            textureDecodeThreads(1),
+            textureDecodeInputBytes(0),
+            textureStagingBytes(0),
+            cookedTextures(0),
+            uniqueTextures(0),
+            textureSlots(0),
+            blockingMs(0.0),
+            geometryUploadMs(0.0),
+            textureUploadMs(0.0),
+            uploadFrames(0),
+            totalMs(0.0),
+            vertexImageBytes(0),
+            indexImageBytes(0),
+            peakWorkingSetBytes(0),
+            importArenaHighWaterBytes(0),
+            importArenaReservedBytes(0),
+            importArenaBlocks(0),
+            residency()
+        {}
+
+        void LogReport() const;
+        //>Per-step share of the cold import: parse, preprocess, each aiProcess step, extraction
+        void LogImportBreakdown(std::ostream& os) const;
+
+        std::string filePath;
+        const char* importProfile; //GetImportProfileName of the profile the model was imported with
+        bool loadedFromCache; //warm start: assimp was skipped
+        double hashMs;        //hashing the source file for the cache key
+        double importMs;      //assimp import on a miss, mapping + parsing the cooked file on a hit
+        double parseMs;       //format importer only (cold start)
+        NativeLoadStats nativeImport; //format None unless the native OBJ/PLY loader replaced assimp (cold start)
+        double preprocessMs;  //assimp's own scene preprocessing + validation that ReadFile always runs
+        std::vector<ImportStepTiming> postProcessSteps; //in execution order, cold start only
+        double extractMs;     //aiMesh -> interleaved vertex/index images (part of importMs)
+        double meshOrderMs;   //cache, overdraw and fetch reordering plus their simulations (part of importMs)
+        MeshOrderStats meshOrderBefore; //exporter order, cold start only
+        MeshOrderStats meshOrderAfter;
+        double lodBuildMs;    //QEM simplification of every mesh (part of importMs, cold start only)
+        uint32_t nodeCount;       //scene nodes kept in the transform hierarchy
+        uint32_t sourceMeshCount; //aiMeshes referenced by at least one node (cold start only)
+        uint32_t meshCount;       //one per node reference, baked with that node's world matrix
+        MeshBounds bounds;        //the model's, merged from the meshes' (extracted with the vertices, or cooked)
+        uint32_t lodCount;    //levels every mesh has
+        std::array<LodLevelStats, MaxMeshLods> lodLevels;
+        double dedupMs;            //hashing and comparing meshes for translated copies (every load, after importMs)
+        MeshDedupStats dedup;
+        double clusterBuildMs;     //LOD0 cluster bounds and normal cones (every load, after importMs)
+        uint32_t clusterCount;
+        uint32_t coneClusterCount; //clusters narrow enough to be rejected as back facing
+        const char* vertexFormat;  //GetVertexFormatName of the device vertex layout
+        double vertexEncodeMs;     //quantizing into CompactVertex, including the error measurement
+        VertexEncodeStats vertexEncode;
+        size_t fullVertexBytes;    //the vertex image as PositionVertex
+        size_t deviceVertexBytes;  //what the vertex buffers hold in the chosen format
+        size_t fullIndexBytes;     //every level with 32-bit indices
+        size_t deviceIndexBytes;   //what the index buffers hold with 16-bit indices wherever a draw range allows
+        uint32_t indexRanges;      //sub-batch levels, or chunk levels when streaming
+        uint32_t index32Ranges;    //ranges spanning more than MaxIndex16Vertices vertices
+        uint32_t workerThreads;
+        double cacheWriteMs;  //writing the cooked file after a miss
+        double textureStageMs; //read + decode + mips of the new texture files on the workers (wall time)
+        uint32_t textureDecodeThreads;
+        size_t textureDecodeInputBytes; //encoded bytes decoded
+        size_t textureStagingBytes;     //decoded BGRA8 mip chains waiting for the render thread
+        uint32_t cookedTextures;        //mapped from .ctex containers instead of decoded
+        uint32_t uniqueTextures; //distinct normalized paths across the materials
+        uint32_t textureSlots;   //material count * texture types, i.e. what per-slot loading decoded
+        double blockingMs;    //time AddModelToWorld held the render thread
+        double geometryUploadMs; //render thread, summed over the frames spent uploading
+        double textureUploadMs;
+        uint32_t uploadFrames; //frames that did upload work before the model became resident
+        double totalMs;       //AddModelToWorld until every batch and texture is resident
+        size_t vertexImageBytes;
+        size_t indexImageBytes;
+        size_t peakWorkingSetBytes; //process peak after the load, includes assimp's scene on a cold start
+        size_t importArenaHighWaterBytes; //transient import tables, handed back in one Release once resident
+        size_t importArenaReservedBytes;  //blocks held at that point, the high water plus abandoned block tails
+        uint32_t importArenaBlocks;
+        ResidencyReport residency;
+    };
+}
@@ -0,0 +1,189 @@
+#include <windows.h>
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <assimp/Importer.hpp>
+
+#include "MappedIOSystem.h"
+#include "../utils/AssetPack.h"
+#include "../utils/FileIO.h"
+#include "../utils/Logger.h"
+#include "../utils/MemoryStats.h"
+#include "../utils/Time.h"
+
+namespace renderer
+{
+    MappedIOStream::MappedIOStream(std::unique_ptr<AssetFile> file)
+        :m_file(std::move(file)),
+        m_data(m_file->GetData()),
+        m_size(m_file->GetSize()),
+        m_cursor(0),
+        m_prefetchedEnd(m_file->IsMapped() ? 0 : m_size) //an inflated pack entry is in memory already
+    {
+    }
+
+    MappedIOStream::MappedIOStream(const uint8_t* data, size_t size)
+        :m_file(),
+        m_data(data),
+        m_size(size),
+        m_cursor(0),
+        m_prefetchedEnd(size) //already in memory
+    {
+    }
+
+    size_t MappedIOStream::Read(void* buffer, size_t size, size_t count)
+    {
+        if (size == 0 || count == 0)
+            return 0;
+
+        //whole elements only, like fread
+        const size_t elementCount = (std::min)(count, (m_size - m_cursor) / size);
+        const size_t bytes = elementCount * size;
+        ReadAhead(bytes);
+        memcpy(buffer, m_data + m_cursor, bytes);
+        m_cursor += bytes;
+        return elementCount;
+    }
+
+    void MappedIOStream::ReadAhead(size_t bytes)
+    {
+        //the importers mostly read front to back, the FBX one the whole file in one call: the OS gets one large request
+        //for the range instead of a fault per page
+        const size_t wantedEnd = (std::min)(m_size, m_cursor + (std::max)(bytes, ImportReadAheadBytes / 2));
+        if (wantedEnd <= m_prefetchedEnd)
+            return;
+        const size_t start = (std::max)(m_cursor, m_prefetchedEnd);
+        const size_t end = (std::min)(m_size, (std::max)(wantedEnd, start + ImportReadAheadBytes));
+        WIN32_MEMORY_RANGE_ENTRY range = { const_cast<uint8_t*>(m_data + start), end - start };
+        ::PrefetchVirtualMemory(::GetCurrentProcess(), 1, &range, 0);
+        m_prefetchedEnd = end;
+    }
+
+    size_t MappedIOStream::Write(const void*, size_t, size_t)
+    {
+        return 0;
+    }
+
+    aiReturn MappedIOStream::Seek(size_t offset, aiOrigin origin)
+    {
+        size_t target;
+        switch (origin)
+        {
+        case aiOrigin_SET:
+            target = offset;
+            break;
+        case aiOrigin_CUR:
+            target = m_cursor + offset;
+            break;
+        case aiOrigin_END:
+            target = m_size - offset; //the offset counts back from the end, as in assimp's memory stream
+            break;
+        default:
+            return aiReturn_FAILURE;
+        }
+        if (target > m_size)
+            return aiReturn_FAILURE;
+        m_cursor = target;
+        return aiReturn_SUCCESS;
+    }
+
+    size_t MappedIOStream::Tell() const
+    {
+        return m_cursor;
+    }
+
+    size_t MappedIOStream::FileSize() const
+    {
+        return m_size;
+    }
+
+    void MappedIOStream::Flush()
+    {
+    }
+
+    MappedIOSystem::MappedIOSystem(AssetSource source)
+        :m_source(source),
+        m_blobs(),
+        m_openCount(0)
+    {
+    }
+
+    void MappedIOSystem::AddBlob(const std::string& filePath, const uint8_t* data, size_t size)
+    {
+        m_blobs[AssetPack::NormalizePath(filePath)] = { data, size };
+    }
+
+    bool MappedIOSystem::Exists(const char* filePath) const
+    {
+        if (m_blobs.count(AssetPack::NormalizePath(filePath)) > 0)
+            return true;
+        if (m_source == AssetSource::Any && AssetPack::GetInstance().Find(filePath) != nullptr)
+            return true;
+        const DWORD attributes = ::GetFileAttributesA(filePath);
+        return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY) == 0;
+    }
+
+    char MappedIOSystem::getOsSeparator() const
+    {
+        return '/'; //AssetPack paths use it, and Windows takes it as well
+    }
+
+    Assimp::IOStream* MappedIOSystem::Open(const char* filePath, const char* mode)
+    {
+        if (strchr(mode, 'w') != nullptr || strchr(mode, 'a') != nullptr || strchr(mode, '+') != nullptr)
+            return nullptr;
+
+        auto blob = m_blobs.find(AssetPack::NormalizePath(filePath));
+        if (blob != m_blobs.end())
+        {
+            ++m_openCount;
+            return new MappedIOStream(blob->second.data, blob->second.size);
+        }
+
+        auto file = std::make_unique<AssetFile>();
+        if (!file->Open(filePath, m_source, MappedFile::AccessPattern::Sequential))
+            return nullptr;
+        ++m_openCount;
+        return new MappedIOStream(std::move(file));
+    }
+
+    void MappedIOSystem::Close(Assimp::IOStream* stream)
+    {
+        delete stream;
+    }
+
+#ifdef RENDERER_BENCHMARKS
+    void LogImportIoComparison(const std::string& filePath)
+    {
+        std::vector<uint8_t> fileData;
+        Stopwatch stopwatch;
+        if (!ReadWholeFile(filePath, fileData))
+            return;
+        const double blobReadMs = stopwatch.GetElapsedMs();
+
+        //reading the blob warmed the file cache, so every variant reads from memory and the difference is the I/O path itself
+        auto timeImport = [&filePath](Assimp::IOSystem* ioSystem)
+        {
+            Assimp::Importer importer;
+            if (ioSystem != nullptr)
+                importer.SetIOHandler(ioSystem);
+            Stopwatch importStopwatch;
+            const bool isImported = importer.ReadFile(filePath, 0) != nullptr;
+            return isImported ? importStopwatch.GetElapsedMs() : -1.0;
+        };
+        const double defaultMs = timeImport(nullptr);
+        const double mappedMs = timeImport(new MappedIOSystem(AssetSource::Loose));
+        auto blobIoSystem = new MappedIOSystem(AssetSource::Loose);
+        blobIoSystem->AddBlob(filePath, fileData.data(), fileData.size());
+        const double blobMs = timeImport(blobIoSystem);
+
+        std::ostringstream os;
+        os << std::fixed << std::setprecision(2);
+        os << "[ImportIO] " << filePath << ", " << BytesToMB(fileData.size()) << " MB, no post-processing\n";
+        os << "    default: " << defaultMs << " ms | mapped: " << mappedMs << " ms | blob: " << blobMs << " ms + " << blobReadMs << " ms read\n";
+        Logger::GetInstance().LogInfo(os.str().c_str());
+    }
+#endif
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <assimp/IOStream.hpp>
+#include <assimp/IOSystem.hpp>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "../utils/AssetFile.h"
+
+namespace renderer
+{
+    constexpr size_t ImportReadAheadBytes = 8 * 1024 * 1024; //prefetched past the cursor of a mapped file, so the copy does not fault page by page
+
+    //>Read-only assimp stream over memory: a mapped or packed file it owns, or a blob that outlives it
+    class MappedIOStream : public Assimp::IOStream
+    {
+    public:
+        explicit MappedIOStream(std::unique_ptr<AssetFile> file);
+        MappedIOStream(const uint8_t* data, size_t size);
+
+        size_t Read(void* buffer, size_t size, size_t count) override;
+        size_t Write(const void* buffer, size_t size, size_t count) override;
+        aiReturn Seek(size_t offset, aiOrigin origin) override;
+        size_t Tell() const override;
+        size_t FileSize() const override;
+        void Flush() override;
+
+    private:
+        void ReadAhead(size_t bytes);
+
+        std::unique_ptr<AssetFile> m_file; //null for a blob
+        const uint8_t* m_data;
+        size_t m_size;
+        size_t m_cursor;
+        size_t m_prefetchedEnd;
+    };
+
+    //>Serves assimp's reads from memory-mapped files with a sequential-scan hint, from the mounted AssetPack, or from blobs
+    //>registered by path. Hand it to Importer::SetIOHandler, which takes ownership. Read-only: opening for writing fails.
+    class MappedIOSystem : public Assimp::IOSystem
+    {
+    public:
+        explicit MappedIOSystem(AssetSource source = AssetSource::Any);
+
+        //>Opens of filePath read data instead of any file; data has to stay valid until the import is done
+        void AddBlob(const std::string& filePath, const uint8_t* data, size_t size);
+
+        bool Exists(const char* filePath) const override;
+        char getOsSeparator() const override;
+        Assimp::IOStream* Open(const char* filePath, const char* mode = "rb") override;
+        void Close(Assimp::IOStream* stream) override;
+
+        inline uint32_t GetOpenCount() const { return m_openCount; }
+
+    private:
+        struct Blob
+        {
+            const uint8_t* data;
+            size_t size;
+        };
+
+        AssetSource m_source;
+        std::unordered_map<std::string, Blob> m_blobs; //by AssetPack::NormalizePath
+        uint32_t m_openCount;
+    };
+
+#ifdef RENDERER_BENCHMARKS
+    //>Imports filePath without post-processing through assimp's default file I/O, the MappedIOSystem, and a blob read up
+    //>front, each with a fresh importer, and logs the time of each
+    void LogImportIoComparison(const std::string& filePath);
+#endif
+}
@@ -6,7 +6,8 @@ namespace renderer
         :m_diffuseTexture(nullptr),
         m_normalTexture(nullptr),
 		m_specularTexture(nullptr),
-		m_opacityTexture(nullptr)
+		m_opacityTexture(nullptr),
+		m_isNormalMapXY(false)
     {
     }
 
@@ -19,6 +20,8 @@ namespace renderer
     }
     void Material::SetTexture(TextureType texType, IDirect3DTexture9* texture)
     {
+        //the material owns one reference per slot; drop the one it is replacing
+        ComSafeRelease(GetTextureOfType(texType));
         switch (texType)
         {
         case TextureType::Diffuse:
@@ -17,16 +17,24 @@ namespace renderer
 			Diffuse,
 			Normal,
 			Specular,
-			Opacity
+			Opacity,
+			Count
 		};
+		static constexpr uint32_t TextureTypeCount = static_cast<uint32_t>(TextureType::Count);
+
 		void SetTexture(TextureType texType, IDirect3DTexture9* texture);
 		IDirect3DTexture9* GetTextureOfType(TextureType texType);
 		IDirect3DTexture9** GetPtrToTextureOfType(TextureType texType);
 
+		//>True when the normal texture is a cooked BC3 map with X in alpha and Y in green
+		inline void SetNormalMapXY(bool isNormalMapXY) { m_isNormalMapXY = isNormalMapXY; }
+		inline bool IsNormalMapXY() const { return m_isNormalMapXY; }
+
 	private:
 		IDirect3DTexture9* m_diffuseTexture;
 		IDirect3DTexture9* m_normalTexture;
 		IDirect3DTexture9* m_specularTexture;
 		IDirect3DTexture9* m_opacityTexture;
+		bool m_isNormalMapXY;
 	};
 }
@@ -1,70 +1,97 @@
 #pragma once
 
 #include <assimp/scene.h>
+#include <d3dx9.h>
+#include <cassert>
 #include <vector>
+#include <array>
 
 #include "Material.h"
+#include "MeshBounds.h"
 
 namespace renderer
 {
+    constexpr uint32_t MaxMeshLods = 4; //LOD0 plus three simplified index lists sharing LOD0's vertices
+    constexpr uint32_t NoPrototypeMesh = UINT32_MAX;
+
+    //>One level of detail: a range of the model-wide index image and its simplification error in model units
+    struct MeshLod
+    {
+        uint32_t indexOffset;
+        uint32_t numIndices;
+        float error;
+    };
+
+    //>Range of one imported mesh inside the model-wide vertex/index images
 	class Mesh
 	{
 	public:
 		Mesh();
 		~Mesh();
 
-		void AppendVertices(float x, float y, float z) noexcept;
-        void AppendNormals(float x, float y, float z) noexcept;
-        void AppendTexCoords(float x, float y) noexcept;
-        void AppendTangents(float x, float y, float z) noexcept;
-        void AppendBiTangents(float x, float y, float z) noexcept;
-        void AppendIndices(const uint32_t vertexA, const uint32_t vertexB, const uint32_t vertexC) noexcept;
-		
 		inline uint16_t GetMaterialIndex() const { return m_materialIndex; }
 		inline int32_t GetNumVertices() const { return m_numVertices; }
-		inline int32_t GetNumNormals() const { return m_numNormals; }
-        inline int32_t GetNumTexCoords() const { return m_numTexcoords; }
-        inline int32_t GetNumTangents() const { return m_numTangents; }
-        inline int32_t GetNumBiTangents() const { return m_numBiTangents; }
         inline int32_t GetNumIndices() const { return m_numIndices; }
         inline int32_t GetNumTris() const { return m_numTris; }
+        inline uint32_t GetVertexOffset() const { return m_vertexOffset; }
+        inline uint32_t GetIndexOffset() const { return m_indexOffset; }
+        inline uint32_t GetLodCount() const { return m_lodCount; }
+        //>Level 0 is the full-resolution range above
+        inline MeshLod GetLod(uint32_t level) const { assert(level < m_lodCount); return level == 0 ? MeshLod{ m_indexOffset, static_cast<uint32_t>(m_numIndices), 0.0f } : m_lods[level]; }
+        //>Range of this mesh's LOD0 clusters in the model's cluster list
+        inline uint32_t GetClusterStart() const { return m_clusterStart; }
+        inline uint32_t GetClusterCount() const { return m_clusterCount; }
+        //>A duplicate draws the geometry of an earlier identical mesh (its prototype) moved by its instance offset
+        inline bool IsDuplicate() const { return m_prototypeIndex != NoPrototypeMesh; }
+        inline uint32_t GetPrototypeIndex() const { return m_prototypeIndex; }
+        inline const D3DXVECTOR3& GetInstanceOffset() const { return m_instanceOffset; }
+        //>Copies of this geometry in the model, itself included; more than one makes it a prototype
+        inline uint32_t GetInstanceCount() const { return m_instanceCount; }
+        inline bool IsInstanced() const { return IsDuplicate() || m_instanceCount > 1; }
+        //>Scene node the mesh hangs off; its vertices are baked with that node's import-time world matrix
+        inline uint32_t GetTransformIndex() const { return m_transformIndex; }
+        //>Hash of the mesh's device data (vertices, every level's indices relative to its first vertex, material), 0 unless
+        //>the model was imported with mesh hashing; equal hashes mean a reload can keep the uploaded copy
+        inline uint64_t GetContentHash() const { return m_contentHash; }
+        //>Box and sphere of the mesh's vertices where it was imported; a duplicate's are its own, not its prototype's
+        inline const MeshBounds& GetBounds() const { return m_bounds; }
 
-		void SetNumVertices(int32_t nVertices);
-		void SetNumNormals(int32_t nNormals);
-        void SetNumTexCoords(int32_t nTexCoords);
-        void SetNumTangents(int32_t nTangents);
-        void SetNumBiTangents(int32_t nBiTangents);
-        void SetNumIndices(int32_t nIndices);
-
+        inline void SetNumVertices(int32_t nVertices) { m_numVertices = nVertices; }
+        inline void SetNumIndices(int32_t nIndices) { m_numIndices = nIndices; }
         inline void SetNumTris(int32_t nTris) { m_numTris = nTris; }
         inline void SetMaterialIndex(int16_t index) { m_materialIndex = index; }
+        inline void SetVertexOffset(uint32_t offset) { m_vertexOffset = offset; }
+        inline void SetIndexOffset(uint32_t offset) { m_indexOffset = offset; }
+        inline void SetLodCount(uint32_t lodCount) { assert(lodCount >= 1 && lodCount <= MaxMeshLods); m_lodCount = lodCount; }
+        inline void SetLod(uint32_t level, const MeshLod& lod) { assert(level > 0 && level < MaxMeshLods); m_lods[level] = lod; }
+        inline void SetClusterRange(uint32_t start, uint32_t count) { m_clusterStart = start; m_clusterCount = count; }
+        inline void SetPrototype(uint32_t prototypeIndex, const D3DXVECTOR3& offset) { m_prototypeIndex = prototypeIndex; m_instanceOffset = offset; }
+        inline void AddInstance() { ++m_instanceCount; }
+        inline void SetTransformIndex(uint32_t index) { m_transformIndex = index; }
+        inline void SetContentHash(uint64_t hash) { m_contentHash = hash; }
+        inline void SetBounds(const MeshBounds& bounds) { m_bounds = bounds; }
         inline void SetName(std::string textureFile) noexcept { m_name = textureFile; }
 
-		[[nodiscard]] inline std::vector<float> GetVertices() const { return m_vertices; }
-        [[nodiscard]] inline std::vector<float> GetNormals() const { return m_normals; }
-        [[nodiscard]] inline std::vector<float> GetTexCoords() const { return m_texcoords; }
-        [[nodiscard]] inline std::vector<float> GetTangents() const { return m_tangents; }
-        [[nodiscard]] inline std::vector<float> GetBiTangents() const { return m_biTangents; }
-		[[nodiscard]] inline std::vector<uint32_t> GetIndices() const { return m_indices; }
         [[nodiscard]] inline std::string GetName() const { return m_name; }
 
 	private:
 		uint16_t m_materialIndex;
 		int32_t m_numVertices;
-		int32_t m_numNormals;
-        int32_t m_numTangents;
-        int32_t m_numBiTangents;
 		int32_t m_numIndices;
-        int32_t m_numTexcoords;
         int32_t m_numTris;
-
-		std::vector<float> m_vertices;
-        std::vector<float> m_normals;
-        std::vector<float> m_texcoords;
-        std::vector<float> m_tangents;
-        std::vector<float> m_biTangents;
-		std::vector<uint32_t> m_indices;
+        uint32_t m_vertexOffset; //first vertex of this mesh in the model-wide vertex buffer
+        uint32_t m_indexOffset;  //first index of this mesh in the model-wide index buffer
+        uint32_t m_lodCount;
+        std::array<MeshLod, MaxMeshLods> m_lods; //[0] unused, see GetLod
+        uint32_t m_clusterStart;
+        uint32_t m_clusterCount;
+        uint32_t m_prototypeIndex; //NoPrototypeMesh unless a duplicate
+        D3DXVECTOR3 m_instanceOffset;
+        uint32_t m_instanceCount;
+        uint32_t m_transformIndex;
+        uint64_t m_contentHash;
+        MeshBounds m_bounds;
         
         std::string m_name;
 	};
-}
\ No newline at end of file
+}
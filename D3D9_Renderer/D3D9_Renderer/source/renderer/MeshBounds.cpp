@@ -0,0 +1,199 @@
+#include <xmmintrin.h>
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <iomanip>
+
+#include "MeshBounds.h"
+#include "../utils/Logger.h"
+#include "../utils/MemoryStats.h"
+#include "../utils/Time.h"
+
+namespace renderer
+{
+    namespace
+    {
+        //x, y, z and the normal's x, which lies in the same vertex: every lane 3 result is thrown away
+        inline __m128 LoadPosition(const PositionVertex& vertex)
+        {
+            return _mm_loadu_ps(&vertex.m_vx);
+        }
+
+        inline D3DXVECTOR3 StoreXYZ(__m128 value)
+        {
+            alignas(16) float lanes[4];
+            _mm_store_ps(lanes, value);
+            return D3DXVECTOR3(lanes[0], lanes[1], lanes[2]);
+        }
+
+        //>Largest squared distance from center to any vertex, four vertices transposed per step
+        float ComputeMaxDistanceSq(const PositionVertex* vertices, size_t vertexCount, const D3DXVECTOR3& center)
+        {
+            const __m128 centerX = _mm_set1_ps(center.x);
+            const __m128 centerY = _mm_set1_ps(center.y);
+            const __m128 centerZ = _mm_set1_ps(center.z);
+            __m128 maxSq = _mm_setzero_ps();
+            size_t itr = 0;
+            for (; itr + 4 <= vertexCount; itr += 4)
+            {
+                __m128 x = LoadPosition(vertices[itr]);
+                __m128 y = LoadPosition(vertices[itr + 1]);
+                __m128 z = LoadPosition(vertices[itr + 2]);
+                __m128 w = LoadPosition(vertices[itr + 3]);
+                _MM_TRANSPOSE4_PS(x, y, z, w);
+                x = _mm_sub_ps(x, centerX);
+                y = _mm_sub_ps(y, centerY);
+                z = _mm_sub_ps(z, centerZ);
+                const __m128 distanceSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+                maxSq = _mm_max_ps(distanceSq, maxSq);
+            }
+
+            alignas(16) float lanes[4];
+            _mm_store_ps(lanes, maxSq);
+            float result = (std::max)((std::max)(lanes[0], lanes[1]), (std::max)(lanes[2], lanes[3]));
+            for (; itr < vertexCount; ++itr)
+            {
+                const D3DXVECTOR3 offset = D3DXVECTOR3(vertices[itr].m_vx, vertices[itr].m_vy, vertices[itr].m_vz) - center;
+                result = (std::max)(result, D3DXVec3Dot(&offset, &offset));
+            }
+            return result;
+        }
+
+        void FinishSphere(const PositionVertex* vertices, size_t vertexCount, MeshBounds& bounds)
+        {
+            bounds.center = (bounds.boundsMin + bounds.boundsMax) * 0.5f;
+            bounds.radius = std::sqrt(ComputeMaxDistanceSq(vertices, vertexCount, bounds.center));
+        }
+    }
+
+    void ComputeBoxBounds(const PositionVertex* vertices, size_t vertexCount, D3DXVECTOR3& outMin, D3DXVECTOR3& outMax)
+    {
+        //two accumulator pairs so consecutive min/max do not wait on each other, seeded with an empty box. The vertex goes
+        //first: minps/maxps return the second operand when either is NaN, so a NaN position is skipped instead of poisoning
+        //the box, and a mesh without one finite vertex comes out empty
+        __m128 min0 = _mm_set1_ps(FLT_MAX);
+        __m128 max0 = _mm_set1_ps(-FLT_MAX);
+        __m128 min1 = min0;
+        __m128 max1 = max0;
+        size_t itr = 0;
+        for (; itr + 4 <= vertexCount; itr += 4)
+        {
+            const __m128 p0 = LoadPosition(vertices[itr]);
+            const __m128 p1 = LoadPosition(vertices[itr + 1]);
+            const __m128 p2 = LoadPosition(vertices[itr + 2]);
+            const __m128 p3 = LoadPosition(vertices[itr + 3]);
+            min0 = _mm_min_ps(p0, min0);
+            max0 = _mm_max_ps(p0, max0);
+            min1 = _mm_min_ps(p1, min1);
+            max1 = _mm_max_ps(p1, max1);
+            min0 = _mm_min_ps(p2, min0);
+            max0 = _mm_max_ps(p2, max0);
+            min1 = _mm_min_ps(p3, min1);
+            max1 = _mm_max_ps(p3, max1);
+        }
+        for (; itr < vertexCount; ++itr)
+        {
+            const __m128 position = LoadPosition(vertices[itr]);
+            min0 = _mm_min_ps(position, min0);
+            max0 = _mm_max_ps(position, max0);
+        }
+        outMin = StoreXYZ(_mm_min_ps(min0, min1));
+        outMax = StoreXYZ(_mm_max_ps(max0, max1));
+    }
+
+    MeshBounds ComputeMeshBounds(const PositionVertex* vertices, size_t vertexCount)
+    {
+        MeshBounds bounds;
+        if (vertexCount == 0)
+            return bounds;
+        ComputeBoxBounds(vertices, vertexCount, bounds.boundsMin, bounds.boundsMax);
+        FinishSphere(vertices, vertexCount, bounds);
+        return bounds;
+    }
+
+    void MergeBounds(MeshBounds& inOutBounds, const MeshBounds& other, const D3DXVECTOR3& offset)
+    {
+        if (other.IsEmpty())
+            return;
+        const D3DXVECTOR3 otherMin = other.boundsMin + offset;
+        const D3DXVECTOR3 otherMax = other.boundsMax + offset;
+        const D3DXVECTOR3 otherCenter = other.center + offset;
+        if (inOutBounds.IsEmpty())
+        {
+            inOutBounds.boundsMin = otherMin;
+            inOutBounds.boundsMax = otherMax;
+            inOutBounds.center = otherCenter;
+            inOutBounds.radius = other.radius;
+            return;
+        }
+
+        const D3DXVECTOR3 previousCenter = inOutBounds.center;
+        const float previousRadius = inOutBounds.radius;
+        D3DXVec3Minimize(&inOutBounds.boundsMin, &inOutBounds.boundsMin, &otherMin);
+        D3DXVec3Maximize(&inOutBounds.boundsMax, &inOutBounds.boundsMax, &otherMax);
+        inOutBounds.center = (inOutBounds.boundsMin + inOutBounds.boundsMax) * 0.5f;
+
+        //every vertex is inside both spheres' union and inside the box, so either bound holds; keep the smaller
+        const D3DXVECTOR3 toPrevious = previousCenter - inOutBounds.center;
+        const D3DXVECTOR3 toOther = otherCenter - inOutBounds.center;
+        const D3DXVECTOR3 halfExtent = (inOutBounds.boundsMax - inOutBounds.boundsMin) * 0.5f;
+        const float sphereRadius = (std::max)(D3DXVec3Length(&toPrevious) + previousRadius, D3DXVec3Length(&toOther) + other.radius);
+        inOutBounds.radius = (std::min)(sphereRadius, D3DXVec3Length(&halfExtent));
+    }
+
+#ifdef RENDERER_BENCHMARKS
+    namespace
+    {
+        constexpr uint32_t BoundsBenchmarkRuns = 16;
+
+        MeshBounds ComputeMeshBoundsScalar(const PositionVertex* vertices, size_t vertexCount)
+        {
+            MeshBounds bounds;
+            for (size_t itr = 0; itr < vertexCount; ++itr)
+            {
+                const D3DXVECTOR3 position(vertices[itr].m_vx, vertices[itr].m_vy, vertices[itr].m_vz);
+                D3DXVec3Minimize(&bounds.boundsMin, &bounds.boundsMin, &position);
+                D3DXVec3Maximize(&bounds.boundsMax, &bounds.boundsMax, &position);
+            }
+            bounds.center = (bounds.boundsMin + bounds.boundsMax) * 0.5f;
+            float radiusSq = 0.0f;
+            for (size_t itr = 0; itr < vertexCount; ++itr)
+            {
+                const D3DXVECTOR3 offset = D3DXVECTOR3(vertices[itr].m_vx, vertices[itr].m_vy, vertices[itr].m_vz) - bounds.center;
+                radiusSq = (std::max)(radiusSq, D3DXVec3Dot(&offset, &offset));
+            }
+            bounds.radius = std::sqrt(radiusSq);
+            return bounds;
+        }
+    }
+
+    void LogBoundsKernelComparison(const PositionVertex* vertices, size_t vertexCount)
+    {
+        if (vertexCount == 0)
+            return;
+
+        MeshBounds scalar;
+        MeshBounds simd;
+        Stopwatch stopwatch;
+        for (uint32_t run = 0; run < BoundsBenchmarkRuns; ++run)
+            scalar = ComputeMeshBoundsScalar(vertices, vertexCount);
+        const double scalarMs = stopwatch.GetElapsedMs() / BoundsBenchmarkRuns;
+        stopwatch.Restart();
+        for (uint32_t run = 0; run < BoundsBenchmarkRuns; ++run)
+            simd = ComputeMeshBounds(vertices, vertexCount);
+        const double simdMs = stopwatch.GetElapsedMs() / BoundsBenchmarkRuns;
+
+        //min/max are exact, so only the radius can differ, by the summation order of its squares
+        const bool isMatching = scalar.boundsMin == simd.boundsMin && scalar.boundsMax == simd.boundsMax &&
+            std::fabs(scalar.radius - simd.radius) <= 1e-5f * (std::max)(scalar.radius, 1.0f);
+        const double inputMB = BytesToMB(vertexCount * sizeof(PositionVertex));
+
+        std::ostringstream os;
+        os << std::fixed << std::setprecision(3);
+        os << "[Bounds] " << vertexCount << " vertices, " << inputMB << " MB, mean of " << BoundsBenchmarkRuns << " runs\n";
+        os << "    scalar: " << scalarMs << " ms (" << inputMB / (scalarMs / 1000.0) << " MB/s) | sse: " << simdMs << " ms (" << inputMB / (simdMs / 1000.0) << " MB/s)";
+        os << " | speedup: " << scalarMs / simdMs << "x | " << (isMatching ? "results match" : "RESULTS DIFFER") << "\n";
+        Logger::GetInstance().LogInfo(os.str().c_str());
+    }
+#endif
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <d3dx9.h>
+#include <cfloat>
+#include <cstddef>
+
+#include "d3d9/VertexDefs.h"
+
+namespace renderer
+{
+    //>Model-space box and a sphere centred on it. Default constructed it is empty; merging anything into it takes that over.
+    struct MeshBounds
+    {
+        MeshBounds()
+            :boundsMin(FLT_MAX, FLT_MAX, FLT_MAX),
+            boundsMax(-FLT_MAX, -FLT_MAX, -FLT_MAX),
+            center(0.0f, 0.0f, 0.0f),
+            radius(0.0f)
+        {}
+
+        inline bool IsEmpty() const { return boundsMin.x > boundsMax.x; }
+        inline float GetDiagonal() const { if (IsEmpty()) return 0.0f; const D3DXVECTOR3 diagonal = boundsMax - boundsMin; return D3DXVec3Length(&diagonal); }
+
+        D3DXVECTOR3 boundsMin;
+        D3DXVECTOR3 boundsMax;
+        D3DXVECTOR3 center; //the box centre
+        float radius;       //to the furthest vertex, never more than the half diagonal
+    };
+
+    //>Box of the positions by an SSE min/max reduction, four vertices per step; an empty range leaves an empty box
+    void ComputeBoxBounds(const PositionVertex* vertices, size_t vertexCount, D3DXVECTOR3& outMin, D3DXVECTOR3& outMax);
+    //>Box, then the sphere around its centre by a second SSE pass for the furthest vertex
+    [[nodiscard]] MeshBounds ComputeMeshBounds(const PositionVertex* vertices, size_t vertexCount);
+    //>Grows inOutBounds over other moved by offset. The sphere stays on the merged box's centre and encloses both spheres.
+    void MergeBounds(MeshBounds& inOutBounds, const MeshBounds& other, const D3DXVECTOR3& offset = D3DXVECTOR3(0.0f, 0.0f, 0.0f));
+
+#ifdef RENDERER_BENCHMARKS
+    //>Times ComputeMeshBounds against a scalar reference of the same two passes over the vertices and logs both rates
+    void LogBoundsKernelComparison(const PositionVertex* vertices, size_t vertexCount);
+#endif
+}
@@ -0,0 +1,92 @@
+#include <algorithm>
+#include <cmath>
+
+#include "MeshCluster.h"
+
+namespace renderer
+{
+    namespace
+    {
+        D3DXVECTOR3 GetPosition(const PositionVertex* vertices, uint32_t baseVertex, uint32_t index)
+        {
+            const auto& vertex = vertices[index - baseVertex];
+            return D3DXVECTOR3(vertex.m_vx, vertex.m_vy, vertex.m_vz);
+        }
+
+        void ComputeClusterBounds(const PositionVertex* vertices, uint32_t baseVertex, const uint32_t* indices, MeshCluster& cluster)
+        {
+            const uint32_t indexCount = cluster.primitiveCount * 3;
+            cluster.boundsMin = GetPosition(vertices, baseVertex, indices[0]);
+            cluster.boundsMax = cluster.boundsMin;
+            for (uint32_t itr = 1; itr < indexCount; ++itr)
+            {
+                const D3DXVECTOR3 position = GetPosition(vertices, baseVertex, indices[itr]);
+                D3DXVec3Minimize(&cluster.boundsMin, &cluster.boundsMin, &position);
+                D3DXVec3Maximize(&cluster.boundsMax, &cluster.boundsMax, &position);
+            }
+
+            //box centre, radius to the furthest vertex: tighter than the half diagonal for flat clusters
+            cluster.center = (cluster.boundsMin + cluster.boundsMax) * 0.5f;
+            float radiusSq = 0.0f;
+            for (uint32_t itr = 0; itr < indexCount; ++itr)
+            {
+                const D3DXVECTOR3 offset = GetPosition(vertices, baseVertex, indices[itr]) - cluster.center;
+                radiusSq = (std::max)(radiusSq, D3DXVec3Dot(&offset, &offset));
+            }
+            cluster.radius = std::sqrt(radiusSq);
+
+            //axis is the mean unit face normal; the cone has to hold every non-degenerate face
+            std::vector<D3DXVECTOR3> normals;
+            normals.reserve(cluster.primitiveCount);
+            D3DXVECTOR3 axis(0.0f, 0.0f, 0.0f);
+            for (uint32_t itr = 0; itr < indexCount; itr += 3)
+            {
+                const D3DXVECTOR3 a = GetPosition(vertices, baseVertex, indices[itr]);
+                const D3DXVECTOR3 edge0 = GetPosition(vertices, baseVertex, indices[itr + 1]) - a;
+                const D3DXVECTOR3 edge1 = GetPosition(vertices, baseVertex, indices[itr + 2]) - a;
+                D3DXVECTOR3 normal;
+                D3DXVec3Cross(&normal, &edge0, &edge1);
+                const float length = D3DXVec3Length(&normal);
+                if (length <= 1e-12f)
+                    continue;
+                normal = normal / length;
+                normals.push_back(normal);
+                axis += normal;
+            }
+            const float axisLength = D3DXVec3Length(&axis);
+            if (normals.empty() || axisLength <= 1e-6f)
+                return;
+            axis = axis / axisLength;
+
+            float minDot = 1.0f;
+            for (const auto& normal : normals)
+                minDot = (std::min)(minDot, D3DXVec3Dot(&normal, &axis));
+            if (minDot <= ClusterConeMinSpread)
+                return;
+
+            cluster.coneAxis = axis;
+            cluster.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+        }
+    }
+
+    void BuildMeshClusters(const PositionVertex* vertices, uint32_t baseVertex, const uint32_t* indices, uint32_t indexStart, uint32_t indexCount,
+        MeshCluster* outClusters)
+    {
+        //the triangle order is already Tipsify's adjacency walk, so consecutive runs are spatially coherent;
+        //splitting evenly keeps every cluster within [ClusterMaxTriangles / 2, ClusterMaxTriangles]
+        const uint32_t triangleCount = indexCount / 3;
+        if (triangleCount == 0)
+            return;
+        const uint32_t clusterCount = GetMeshClusterCount(indexCount);
+        uint32_t firstTriangle = 0;
+        for (uint32_t itr = 0; itr < clusterCount; ++itr)
+        {
+            const uint32_t lastTriangle = static_cast<uint32_t>(static_cast<uint64_t>(triangleCount) * (itr + 1) / clusterCount);
+            MeshCluster& cluster = outClusters[itr];
+            cluster.indexStart = indexStart + firstTriangle * 3;
+            cluster.primitiveCount = lastTriangle - firstTriangle;
+            ComputeClusterBounds(vertices, baseVertex, indices + firstTriangle * 3, cluster);
+            firstTriangle = lastTriangle;
+        }
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <d3dx9.h>
+#include <cstdint>
+#include <vector>
+
+#include "d3d9/VertexDefs.h"
+
+namespace renderer
+{
+    constexpr uint32_t ClusterMaxTriangles = 128; //meshes are cut into runs of ClusterMaxTriangles / 2 to ClusterMaxTriangles triangles
+    constexpr float ClusterConeMinSpread = 0.1f;  //clusters whose normals spread wider than this (min dot to the axis) never cone cull
+
+    //>A contiguous run of one mesh's LOD0 triangles with the bounds the CPU culls it by
+    struct MeshCluster
+    {
+        MeshCluster()
+            :indexStart(0),
+            primitiveCount(0),
+            center(0.0f, 0.0f, 0.0f),
+            radius(0.0f),
+            boundsMin(0.0f, 0.0f, 0.0f),
+            boundsMax(0.0f, 0.0f, 0.0f),
+            coneAxis(0.0f, 0.0f, 0.0f),
+            coneCutoff(1.0f)
+        {}
+
+        //>Every triangle faces away from a viewer at position (Lengyel / meshoptimizer cone test against the bounding sphere)
+        inline bool IsBackFacing(const D3DXVECTOR3& position) const
+        {
+            if (coneCutoff >= 1.0f)
+                return false;
+            const D3DXVECTOR3 toCluster = center - position;
+            return D3DXVec3Dot(&toCluster, &coneAxis) >= coneCutoff * D3DXVec3Length(&toCluster) + radius;
+        }
+
+        uint32_t indexStart; //model-wide, like Mesh::GetIndexOffset
+        uint32_t primitiveCount;
+        D3DXVECTOR3 center;
+        float radius;
+        D3DXVECTOR3 boundsMin;
+        D3DXVECTOR3 boundsMax;
+        D3DXVECTOR3 coneAxis;  //average front face normal
+        float coneCutoff;      //sine of the normal cone's half angle; 1 disables the test
+    };
+
+    //>Clusters BuildMeshClusters cuts indexCount indices into
+    inline uint32_t GetMeshClusterCount(uint32_t indexCount) { return (indexCount / 3 + ClusterMaxTriangles - 1) / ClusterMaxTriangles; }
+    //>Splits one mesh's triangles, in their current order, into GetMeshClusterCount(indexCount) clusters written to outClusters.
+    //>vertices points at the mesh's first vertex; indices are absolute in [baseVertex, baseVertex + vertexCount).
+    //>Faces are front facing when clockwise, matching the shader's CullMode = CCW on the left handed import.
+    void BuildMeshClusters(const PositionVertex* vertices, uint32_t baseVertex, const uint32_t* indices, uint32_t indexStart, uint32_t indexCount,
+        MeshCluster* outClusters);
+}
@@ -0,0 +1,116 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+#include "MeshDedup.h"
+#include "../utils/Hash.h"
+#include "../utils/ThreadPool.h"
+
+namespace renderer
+{
+    namespace
+    {
+        //normals, uvs and the tangent frame follow the position in PositionVertex; a translation leaves them untouched
+        constexpr size_t AttributeOffset = offsetof(PositionVertex, m_nx);
+        constexpr size_t AttributeBytes = sizeof(PositionVertex) - AttributeOffset;
+
+        //>Everything a translated copy keeps bit for bit; positions are compared with a tolerance afterwards
+        uint64_t HashMeshShape(const Mesh& mesh, const PositionVertex* vertices, const uint32_t* indices)
+        {
+            const uint32_t header[3] = { mesh.GetMaterialIndex(), static_cast<uint32_t>(mesh.GetNumVertices()), static_cast<uint32_t>(mesh.GetNumIndices()) };
+            uint64_t hash = HashBytes(header, sizeof(header));
+            const uint32_t* meshIndices = indices + mesh.GetIndexOffset();
+            for (int32_t itr = 0; itr < mesh.GetNumIndices(); ++itr)
+            {
+                const uint32_t localIndex = meshIndices[itr] - mesh.GetVertexOffset();
+                hash = HashBytes(&localIndex, sizeof(localIndex), hash);
+            }
+            const PositionVertex* meshVertices = vertices + mesh.GetVertexOffset();
+            for (int32_t itr = 0; itr < mesh.GetNumVertices(); ++itr)
+                hash = HashBytes(reinterpret_cast<const uint8_t*>(&meshVertices[itr]) + AttributeOffset, AttributeBytes, hash);
+            return hash;
+        }
+
+        //>Full comparison behind a hash match; outOffset moves the prototype onto the copy
+        bool IsTranslatedCopy(const Mesh& prototype, const Mesh& mesh, const PositionVertex* vertices, const uint32_t* indices, D3DXVECTOR3& outOffset)
+        {
+            if (prototype.GetMaterialIndex() != mesh.GetMaterialIndex() || prototype.GetNumVertices() != mesh.GetNumVertices() ||
+                prototype.GetNumIndices() != mesh.GetNumIndices())
+                return false;
+
+            const uint32_t* prototypeIndices = indices + prototype.GetIndexOffset();
+            const uint32_t* meshIndices = indices + mesh.GetIndexOffset();
+            for (int32_t itr = 0; itr < mesh.GetNumIndices(); ++itr)
+            {
+                if (prototypeIndices[itr] - prototype.GetVertexOffset() != meshIndices[itr] - mesh.GetVertexOffset())
+                    return false;
+            }
+
+            const PositionVertex* prototypeVertices = vertices + prototype.GetVertexOffset();
+            const PositionVertex* meshVertices = vertices + mesh.GetVertexOffset();
+            outOffset = D3DXVECTOR3(meshVertices[0].m_vx - prototypeVertices[0].m_vx, meshVertices[0].m_vy - prototypeVertices[0].m_vy,
+                meshVertices[0].m_vz - prototypeVertices[0].m_vz);
+            const float tolerance = (std::max)(prototype.GetBounds().GetDiagonal() * DedupPositionTolerance, 1e-6f);
+            for (int32_t itr = 0; itr < mesh.GetNumVertices(); ++itr)
+            {
+                const auto& lhs = prototypeVertices[itr];
+                const auto& rhs = meshVertices[itr];
+                if (memcmp(reinterpret_cast<const uint8_t*>(&lhs) + AttributeOffset, reinterpret_cast<const uint8_t*>(&rhs) + AttributeOffset, AttributeBytes) != 0)
+                    return false;
+                if (std::fabs(rhs.m_vx - lhs.m_vx - outOffset.x) > tolerance || std::fabs(rhs.m_vy - lhs.m_vy - outOffset.y) > tolerance ||
+                    std::fabs(rhs.m_vz - lhs.m_vz - outOffset.z) > tolerance)
+                    return false;
+            }
+            return true;
+        }
+    }
+
+    MeshDedupStats FindDuplicateMeshes(const std::vector<std::shared_ptr<Mesh>>& meshes, const PositionVertex* vertices, const uint32_t* indices,
+        LinearArena& arena)
+    {
+        const auto numMeshes = static_cast<uint32_t>(meshes.size());
+        ArenaVector<uint64_t> hashes(numMeshes, 0, arena);
+        ThreadPool::GetInstance().ParallelFor(numMeshes, [&](uint32_t slot)
+            {
+                hashes[slot] = HashMeshShape(*meshes[slot], vertices, indices);
+            });
+
+        //the first mesh of each shape becomes the prototype, so duplicates always point backwards
+        MeshDedupStats stats;
+        using PrototypeMap = std::unordered_map<uint64_t, ArenaVector<uint32_t>, std::hash<uint64_t>, std::equal_to<uint64_t>,
+            ArenaAllocator<std::pair<const uint64_t, ArenaVector<uint32_t>>>>;
+        PrototypeMap prototypesByHash(numMeshes, std::hash<uint64_t>(), std::equal_to<uint64_t>(), arena); //sized up front: a rehash would strand the old buckets
+        for (uint32_t itr = 0; itr < numMeshes; ++itr)
+        {
+            auto& mesh = *meshes[itr];
+            if (mesh.GetNumVertices() == 0 || mesh.GetNumIndices() == 0)
+                continue;
+
+            auto& prototypes = prototypesByHash.try_emplace(hashes[itr], arena).first->second;
+            auto prototype = std::find_if(prototypes.begin(), prototypes.end(), [&](uint32_t prototypeIndex)
+                {
+                    D3DXVECTOR3 offset;
+                    if (!IsTranslatedCopy(*meshes[prototypeIndex], mesh, vertices, indices, offset))
+                        return false;
+                    mesh.SetPrototype(prototypeIndex, offset);
+                    return true;
+                });
+            if (prototype == prototypes.end())
+            {
+                prototypes.push_back(itr);
+                continue;
+            }
+
+            auto& prototypeMesh = *meshes[*prototype];
+            if (prototypeMesh.GetInstanceCount() == 1)
+                ++stats.instanceGroups;
+            prototypeMesh.AddInstance();
+            ++stats.duplicateMeshes;
+            stats.duplicateVertexBytes += static_cast<size_t>(mesh.GetNumVertices()) * sizeof(PositionVertex);
+            for (uint32_t level = 0; level < mesh.GetLodCount(); ++level)
+                stats.duplicateIndexBytes += static_cast<size_t>(mesh.GetLod(level).numIndices) * sizeof(uint32_t);
+        }
+        return stats;
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <memory>
+
+#include "d3d9/VertexDefs.h"
+#include "Mesh.h"
+#include "../utils/ArenaAllocator.h"
+
+namespace renderer
+{
+    constexpr float DedupPositionTolerance = 1e-5f; //largest position mismatch between copies, as a fraction of the mesh's bounding box diagonal
+
+    //>What deduplication found over one model
+    struct MeshDedupStats
+    {
+        MeshDedupStats()
+            :instanceGroups(0),
+            duplicateMeshes(0),
+            duplicateVertexBytes(0),
+            duplicateIndexBytes(0)
+        {}
+
+        uint32_t instanceGroups;     //prototypes with at least one duplicate
+        uint32_t duplicateMeshes;
+        size_t duplicateVertexBytes; //PositionVertex bytes the duplicates no longer need
+        size_t duplicateIndexBytes;  //every level, 32-bit
+    };
+
+    //>Marks each mesh that repeats an earlier one as its duplicate (see Mesh::SetPrototype). Copies have the same material,
+    //>the same indices relative to their first vertex, bit-identical normals, tangent frames and uvs, and positions that
+    //>differ by one translation within DedupPositionTolerance. Exporters that bake node transforms into the vertices
+    //>leave exactly this behind for every repeated prop; rotated or scaled copies stay separate meshes.
+    //>The hashes and the shape table are allocated from arena.
+    MeshDedupStats FindDuplicateMeshes(const std::vector<std::shared_ptr<Mesh>>& meshes, const PositionVertex* vertices, const uint32_t* indices,
+        LinearArena& arena);
+}
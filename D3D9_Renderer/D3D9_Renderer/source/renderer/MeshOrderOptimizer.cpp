@@ -0,0 +1,315 @@
+#include <algorithm>
+#include <vector>
+#include <limits>
+#include <cmath>
+#include <cassert>
+
+#include "MeshOrderOptimizer.h"
+#include "VertexCacheOptimizer.h"
+
+namespace renderer
+{
+    namespace
+    {
+        struct Float3
+        {
+            float x, y, z;
+        };
+
+        inline Float3 GetPosition(const PositionVertex& vertex) { return { vertex.m_vx, vertex.m_vy, vertex.m_vz }; }
+        inline Float3 Sub(const Float3& a, const Float3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+        inline Float3 Cross(const Float3& a, const Float3& b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+        inline float Dot(const Float3& a, const Float3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+        inline float Length(const Float3& a) { return std::sqrt(Dot(a, a)); }
+
+        //>Post-transform FIFO replay shared by the splitter and the fetch simulator
+        class FifoCache
+        {
+        public:
+            explicit FifoCache(uint32_t vertexCount)
+                :m_loadedAt(vertexCount, UINT64_MAX),
+                m_misses(0)
+            {}
+
+            [[nodiscard]] inline bool Access(uint32_t vertex)
+            {
+                if (m_loadedAt[vertex] != UINT64_MAX && m_misses - m_loadedAt[vertex] < VertexCacheSimulateSize)
+                    return true;
+                m_loadedAt[vertex] = m_misses++;
+                return false;
+            }
+            //>Pushes everything out without touching the per-vertex state
+            inline void Flush() { m_misses += VertexCacheSimulateSize; }
+
+        private:
+            std::vector<uint64_t> m_loadedAt;
+            uint64_t m_misses;
+        };
+
+        //>Cluster boundaries (first triangle of each cluster) plus the triangle count as the end sentinel
+        std::vector<uint32_t> SplitIntoClusters(const uint32_t* indices, uint32_t triangleCount, uint32_t baseVertex, uint32_t vertexCount, float cacheThreshold)
+        {
+            //hard boundaries: triangles that miss on all three vertices start from a cold cache anyway
+            std::vector<uint32_t> hardBoundaries;
+            {
+                FifoCache cache(vertexCount);
+                for (uint32_t triangle = 0; triangle < triangleCount; ++triangle)
+                {
+                    uint32_t misses = 0;
+                    for (uint32_t corner = 0; corner < 3; ++corner)
+                        misses += cache.Access(indices[triangle * 3 + corner] - baseVertex) ? 0 : 1;
+                    if (triangle == 0 || misses == 3)
+                        hardBoundaries.push_back(triangle);
+                }
+            }
+            hardBoundaries.push_back(triangleCount);
+
+            const double meshAcmr = SimulateVertexCache(indices, triangleCount * 3, baseVertex, vertexCount).GetAcmr();
+
+            //soft boundaries: cut a hard cluster wherever the part so far is already within the threshold on its own
+            std::vector<uint32_t> boundaries;
+            FifoCache cache(vertexCount);
+            for (size_t hard = 0; hard + 1 < hardBoundaries.size(); ++hard)
+            {
+                const uint32_t end = hardBoundaries[hard + 1];
+                uint32_t start = hardBoundaries[hard];
+                uint32_t misses = 0;
+                boundaries.push_back(start);
+                cache.Flush();
+                for (uint32_t triangle = start; triangle < end; ++triangle)
+                {
+                    for (uint32_t corner = 0; corner < 3; ++corner)
+                        misses += cache.Access(indices[triangle * 3 + corner] - baseVertex) ? 0 : 1;
+
+                    const uint32_t clusterTriangles = triangle + 1 - start;
+                    if (triangle + 1 < end && static_cast<double>(misses) / clusterTriangles <= cacheThreshold * meshAcmr)
+                    {
+                        start = triangle + 1;
+                        misses = 0;
+                        boundaries.push_back(start);
+                        cache.Flush();
+                    }
+                }
+            }
+            boundaries.push_back(triangleCount);
+            return boundaries;
+        }
+
+        //>Minimal depth-tested rasterizer for one orthographic view; counts every fragment that passes the depth test
+        void RasterizeView(const std::vector<Float3>& viewVertices, const uint32_t* indices, uint32_t indexCount, uint32_t baseVertex, std::vector<float>& depthBuffer, OverdrawStats& stats)
+        {
+            std::fill(depthBuffer.begin(), depthBuffer.end(), (std::numeric_limits<float>::max)());
+            for (uint32_t itr = 0; itr + 2 < indexCount; itr += 3)
+            {
+                Float3 v0 = viewVertices[indices[itr] - baseVertex];
+                Float3 v1 = viewVertices[indices[itr + 1] - baseVertex];
+                Float3 v2 = viewVertices[indices[itr + 2] - baseVertex];
+
+                //clockwise is front facing, as with D3DCULL_CCW
+                const float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+                if (area >= 0.0f)
+                    continue;
+                std::swap(v1, v2);
+
+                const int32_t minX = (std::max)(0, static_cast<int32_t>(std::floor((std::min)({ v0.x, v1.x, v2.x }))));
+                const int32_t minY = (std::max)(0, static_cast<int32_t>(std::floor((std::min)({ v0.y, v1.y, v2.y }))));
+                const int32_t maxX = (std::min)(static_cast<int32_t>(OverdrawGridSize) - 1, static_cast<int32_t>(std::ceil((std::max)({ v0.x, v1.x, v2.x }))));
+                const int32_t maxY = (std::min)(static_cast<int32_t>(OverdrawGridSize) - 1, static_cast<int32_t>(std::ceil((std::max)({ v0.y, v1.y, v2.y }))));
+                const float invArea = 1.0f / -area;
+
+                for (int32_t y = minY; y <= maxY; ++y)
+                {
+                    const float py = static_cast<float>(y) + 0.5f;
+                    for (int32_t x = minX; x <= maxX; ++x)
+                    {
+                        const float px = static_cast<float>(x) + 0.5f;
+                        const float w0 = (v2.x - v1.x) * (py - v1.y) - (v2.y - v1.y) * (px - v1.x);
+                        const float w1 = (v0.x - v2.x) * (py - v2.y) - (v0.y - v2.y) * (px - v2.x);
+                        const float w2 = (v1.x - v0.x) * (py - v0.y) - (v1.y - v0.y) * (px - v0.x);
+                        if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+                            continue;
+
+                        const float depth = (w0 * v0.z + w1 * v1.z + w2 * v2.z) * invArea;
+                        float& stored = depthBuffer[y * OverdrawGridSize + x];
+                        if (depth < stored)
+                        {
+                            stored = depth;
+                            ++stats.pixelsShaded;
+                        }
+                    }
+                }
+            }
+
+            for (const auto depth : depthBuffer)
+            {
+                if (depth != (std::numeric_limits<float>::max)())
+                    ++stats.pixelsCovered;
+            }
+        }
+    }
+
+    void OptimizeOverdraw(const PositionVertex* vertices, uint32_t* indices, uint32_t indexCount, uint32_t baseVertex, uint32_t vertexCount, float cacheThreshold)
+    {
+        const uint32_t triangleCount = indexCount / 3;
+        if (cacheThreshold <= 1.0f || triangleCount < 2)
+            return;
+
+        const auto boundaries = SplitIntoClusters(indices, triangleCount, baseVertex, vertexCount, cacheThreshold);
+        const size_t clusterCount = boundaries.size() - 1;
+        if (clusterCount < 2)
+            return;
+
+        //area weighted centroid and normal of every cluster and of the whole mesh
+        std::vector<Float3> clusterCentroids(clusterCount);
+        std::vector<Float3> clusterNormals(clusterCount);
+        Float3 meshCentroid = { 0.0f, 0.0f, 0.0f };
+        float meshArea = 0.0f;
+        for (size_t cluster = 0; cluster < clusterCount; ++cluster)
+        {
+            Float3 centroid = { 0.0f, 0.0f, 0.0f };
+            Float3 normal = { 0.0f, 0.0f, 0.0f };
+            float clusterArea = 0.0f;
+            for (uint32_t triangle = boundaries[cluster]; triangle < boundaries[cluster + 1]; ++triangle)
+            {
+                const Float3 p0 = GetPosition(vertices[indices[triangle * 3] - baseVertex]);
+                const Float3 p1 = GetPosition(vertices[indices[triangle * 3 + 1] - baseVertex]);
+                const Float3 p2 = GetPosition(vertices[indices[triangle * 3 + 2] - baseVertex]);
+                const Float3 faceNormal = Cross(Sub(p1, p0), Sub(p2, p0)); //length is twice the area
+                const float area = Length(faceNormal);
+                centroid.x += (p0.x + p1.x + p2.x) * area;
+                centroid.y += (p0.y + p1.y + p2.y) * area;
+                centroid.z += (p0.z + p1.z + p2.z) * area;
+                normal.x += faceNormal.x;
+                normal.y += faceNormal.y;
+                normal.z += faceNormal.z;
+                clusterArea += area;
+            }
+            meshCentroid.x += centroid.x;
+            meshCentroid.y += centroid.y;
+            meshCentroid.z += centroid.z;
+            meshArea += clusterArea;
+
+            const float invArea = clusterArea > 0.0f ? 1.0f / (clusterArea * 3.0f) : 0.0f;
+            clusterCentroids[cluster] = { centroid.x * invArea, centroid.y * invArea, centroid.z * invArea };
+            const float normalLength = Length(normal);
+            clusterNormals[cluster] = normalLength > 0.0f ? Float3{ normal.x / normalLength, normal.y / normalLength, normal.z / normalLength } : normal;
+        }
+        const float invMeshArea = meshArea > 0.0f ? 1.0f / (meshArea * 3.0f) : 0.0f;
+        meshCentroid = { meshCentroid.x * invMeshArea, meshCentroid.y * invMeshArea, meshCentroid.z * invMeshArea };
+
+        //clusters far out along their own normal occlude the rest from most directions: draw them first
+        std::vector<float> sortKeys(clusterCount);
+        for (size_t cluster = 0; cluster < clusterCount; ++cluster)
+            sortKeys[cluster] = Dot(Sub(clusterCentroids[cluster], meshCentroid), clusterNormals[cluster]);
+
+        std::vector<uint32_t> clusterOrder(clusterCount);
+        for (uint32_t cluster = 0; cluster < clusterCount; ++cluster)
+            clusterOrder[cluster] = cluster;
+        std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&sortKeys](uint32_t lhs, uint32_t rhs) { return sortKeys[lhs] > sortKeys[rhs]; });
+
+        std::vector<uint32_t> reordered;
+        reordered.reserve(indexCount);
+        for (const auto cluster : clusterOrder)
+            reordered.insert(reordered.end(), indices + boundaries[cluster] * 3, indices + boundaries[cluster + 1] * 3);
+        std::copy(reordered.begin(), reordered.end(), indices);
+    }
+
+    void OptimizeVertexFetch(PositionVertex* vertices, uint32_t* indices, uint32_t indexCount, uint32_t baseVertex, uint32_t vertexCount)
+    {
+        constexpr uint32_t Unassigned = 0xFFFFFFFF;
+        std::vector<uint32_t> remap(vertexCount, Unassigned);
+        uint32_t nextVertex = 0;
+        for (uint32_t itr = 0; itr < indexCount; ++itr)
+        {
+            const uint32_t vertex = indices[itr] - baseVertex;
+            assert(vertex < vertexCount);
+            if (remap[vertex] == Unassigned)
+                remap[vertex] = nextVertex++;
+            indices[itr] = remap[vertex] + baseVertex;
+        }
+        for (auto& slot : remap)
+        {
+            if (slot == Unassigned)
+                slot = nextVertex++;
+        }
+
+        std::vector<PositionVertex> reordered(vertexCount);
+        for (uint32_t vertex = 0; vertex < vertexCount; ++vertex)
+            reordered[remap[vertex]] = vertices[vertex];
+        std::copy(reordered.begin(), reordered.end(), vertices);
+    }
+
+    VertexFetchStats SimulateVertexFetch(const uint32_t* indices, uint32_t indexCount, uint32_t baseVertex, uint32_t vertexCount)
+    {
+        VertexFetchStats stats;
+        FifoCache transformCache(vertexCount);
+        std::vector<bool> isReferenced(vertexCount, false);
+        std::vector<uint64_t> fetchLines(VertexFetchCacheLines, UINT64_MAX);
+        for (uint32_t itr = 0; itr < indexCount; ++itr)
+        {
+            const uint32_t vertex = indices[itr] - baseVertex;
+            if (!isReferenced[vertex])
+            {
+                isReferenced[vertex] = true;
+                stats.uniqueVertexBytes += sizeof(PositionVertex);
+            }
+            if (transformCache.Access(vertex))
+                continue;
+
+            //addresses are in the model-wide vertex buffer, so line boundaries match what the GPU sees
+            const uint64_t firstByte = static_cast<uint64_t>(indices[itr]) * sizeof(PositionVertex);
+            const uint64_t lastByte = firstByte + sizeof(PositionVertex) - 1;
+            for (uint64_t line = firstByte / VertexFetchLineSize; line <= lastByte / VertexFetchLineSize; ++line)
+            {
+                uint64_t& cached = fetchLines[line % VertexFetchCacheLines];
+                if (cached != line)
+                {
+                    cached = line;
+                    stats.fetchedBytes += VertexFetchLineSize;
+                }
+            }
+        }
+        return stats;
+    }
+
+    OverdrawStats SimulateOverdraw(const PositionVertex* vertices, const uint32_t* indices, uint32_t indexCount, uint32_t baseVertex, uint32_t vertexCount)
+    {
+        OverdrawStats stats;
+        if (vertexCount == 0 || indexCount < 3)
+            return stats;
+
+        Float3 boundsMin = GetPosition(vertices[0]);
+        Float3 boundsMax = boundsMin;
+        for (uint32_t vertex = 1; vertex < vertexCount; ++vertex)
+        {
+            const Float3 position = GetPosition(vertices[vertex]);
+            boundsMin = { (std::min)(boundsMin.x, position.x), (std::min)(boundsMin.y, position.y), (std::min)(boundsMin.z, position.z) };
+            boundsMax = { (std::max)(boundsMax.x, position.x), (std::max)(boundsMax.y, position.y), (std::max)(boundsMax.z, position.z) };
+        }
+        const float extent = (std::max)({ boundsMax.x - boundsMin.x, boundsMax.y - boundsMin.y, boundsMax.z - boundsMin.z });
+        if (extent <= 0.0f)
+            return stats;
+        const float scale = static_cast<float>(OverdrawGridSize) / extent;
+
+        std::vector<Float3> viewVertices(vertexCount);
+        std::vector<float> depthBuffer(OverdrawGridSize * OverdrawGridSize);
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            for (const float direction : { 1.0f, -1.0f })
+            {
+                //looking down +/- axis; the other two axes in cyclic order keep the handedness, and
+                //mirroring u for the negative direction is a half turn around v, which keeps it as well
+                for (uint32_t vertex = 0; vertex < vertexCount; ++vertex)
+                {
+                    const Float3 local = Sub(GetPosition(vertices[vertex]), boundsMin);
+                    const float coords[3] = { local.x * scale, local.y * scale, local.z * scale };
+                    const float u = coords[(axis + 1) % 3];
+                    const float v = coords[(axis + 2) % 3];
+                    viewVertices[vertex] = { direction > 0.0f ? u : static_cast<float>(OverdrawGridSize) - u, v, coords[axis] * direction };
+                }
+                RasterizeView(viewVertices, indices, indexCount, baseVertex, depthBuffer, stats);
+            }
+        }
+        return stats;
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+
+#include "d3d9/VertexDefs.h"
+
+namespace renderer
+{
+    constexpr float OverdrawCacheThreshold = 1.05f; //ACMR the overdraw pass may give up, relative to the cache-optimized order; <= 1 disables it
+    constexpr uint32_t VertexFetchLineSize = 64;    //bytes per line of the simulated vertex fetch cache
+    constexpr uint32_t VertexFetchCacheLines = 256; //direct mapped, 16 KB
+    constexpr uint32_t OverdrawGridSize = 128;      //resolution of each simulated view
+
+    //>Bytes pulled through a small vertex fetch cache on post-transform cache misses
+    struct VertexFetchStats
+    {
+        VertexFetchStats()
+            :fetchedBytes(0),
+            uniqueVertexBytes(0)
+        {}
+
+        //>1.0 means every referenced vertex byte was read exactly once
+        inline double GetOverfetch() const { return uniqueVertexBytes > 0 ? static_cast<double>(fetchedBytes) / uniqueVertexBytes : 0.0; }
+
+        VertexFetchStats& operator+=(const VertexFetchStats& other)
+        {
+            fetchedBytes += other.fetchedBytes;
+            uniqueVertexBytes += other.uniqueVertexBytes;
+            return *this;
+        }
+
+        uint64_t fetchedBytes;
+        uint64_t uniqueVertexBytes;
+    };
+
+    //>Fragments shaded with early depth test vs pixels covered, summed over six axis-aligned orthographic views
+    struct OverdrawStats
+    {
+        OverdrawStats()
+            :pixelsCovered(0),
+            pixelsShaded(0)
+        {}
+
+        inline double GetOverdraw() const { return pixelsCovered > 0 ? static_cast<double>(pixelsShaded) / pixelsCovered : 0.0; }
+
+        OverdrawStats& operator+=(const OverdrawStats& other)
+        {
+            pixelsCovered += other.pixelsCovered;
+            pixelsShaded += other.pixelsShaded;
+            return *this;
+        }
+
+        uint64_t pixelsCovered;
+        uint64_t pixelsShaded;
+    };
+
+    //>All functions work on one mesh: vertices points at its first vertex, indices are absolute and lie in [baseVertex, baseVertex + vertexCount)
+
+    //>Splits a cache-optimized triangle order into clusters at points where the cache is cold (or where cutting costs
+    //>less than cacheThreshold), then draws the outward-facing clusters furthest from the mesh centre first (Sander et al. 2007)
+    void OptimizeOverdraw(const PositionVertex* vertices, uint32_t* indices, uint32_t indexCount, uint32_t baseVertex, uint32_t vertexCount, float cacheThreshold);
+    //>Renumbers the vertices of one mesh in first-use order; unreferenced vertices move to the end of its range
+    void OptimizeVertexFetch(PositionVertex* vertices, uint32_t* indices, uint32_t indexCount, uint32_t baseVertex, uint32_t vertexCount);
+
+    [[nodiscard]] VertexFetchStats SimulateVertexFetch(const uint32_t* indices, uint32_t indexCount, uint32_t baseVertex, uint32_t vertexCount);
+    [[nodiscard]] OverdrawStats SimulateOverdraw(const PositionVertex* vertices, const uint32_t* indices, uint32_t indexCount, uint32_t baseVertex, uint32_t vertexCount);
+}
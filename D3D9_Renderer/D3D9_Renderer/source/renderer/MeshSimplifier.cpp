@@ -0,0 +1,364 @@
+#include <algorithm>
+#include <unordered_map>
+#include <cmath>
+#include <cstring>
+#include <cassert>
+
+#include "MeshSimplifier.h"
+
+namespace renderer
+{
+    namespace
+    {
+        //>Symmetric 4x4 error quadric, upper triangle only, with the total weight of the planes it holds
+        struct Quadric
+        {
+            double a00, a01, a02, a03;
+            double a11, a12, a13;
+            double a22, a23;
+            double a33;
+            double weight;
+
+            void AddPlane(double nx, double ny, double nz, double d, double w)
+            {
+                a00 += w * nx * nx; a01 += w * nx * ny; a02 += w * nx * nz; a03 += w * nx * d;
+                a11 += w * ny * ny; a12 += w * ny * nz; a13 += w * ny * d;
+                a22 += w * nz * nz; a23 += w * nz * d;
+                a33 += w * d * d;
+                weight += w;
+            }
+
+            void Add(const Quadric& other)
+            {
+                a00 += other.a00; a01 += other.a01; a02 += other.a02; a03 += other.a03;
+                a11 += other.a11; a12 += other.a12; a13 += other.a13;
+                a22 += other.a22; a23 += other.a23;
+                a33 += other.a33;
+                weight += other.weight;
+            }
+
+            //>Weighted sum of squared distances from (x, y, z) to the accumulated planes
+            double Evaluate(double x, double y, double z) const
+            {
+                const double result = a00 * x * x + 2.0 * a01 * x * y + 2.0 * a02 * x * z + 2.0 * a03 * x +
+                    a11 * y * y + 2.0 * a12 * y * z + 2.0 * a13 * y +
+                    a22 * z * z + 2.0 * a23 * z +
+                    a33;
+                return (std::max)(result, 0.0);
+            }
+        };
+
+        //>Mean squared distance, by area, from (x, y, z) to the planes of both quadrics; its root is a distance in model units
+        inline double GetCollapseCost(const Quadric& from, const Quadric& to, const double position[3])
+        {
+            const double weight = from.weight + to.weight;
+            if (weight <= 0.0)
+                return 0.0;
+            return (from.Evaluate(position[0], position[1], position[2]) + to.Evaluate(position[0], position[1], position[2])) / weight;
+        }
+
+        struct Collapse
+        {
+            uint32_t from;
+            uint32_t to;
+            double cost;
+        };
+
+        inline uint64_t GetEdgeKey(uint32_t a, uint32_t b)
+        {
+            return a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+        }
+
+        //>Position of a local vertex as doubles
+        inline void GetPosition(const PositionVertex& vertex, double out[3])
+        {
+            out[0] = vertex.m_vx;
+            out[1] = vertex.m_vy;
+            out[2] = vertex.m_vz;
+        }
+
+        //>Vertices welded by exact position, so an attribute seam is seen as one topological vertex with several wedges
+        struct WeldedTopology
+        {
+            std::vector<uint32_t> canonical;   //first vertex at the same position; quadrics are kept on it
+            std::vector<uint32_t> nextWedge;   //circular list of the vertices sharing a position; a vertex alone points at itself
+            std::vector<bool> isBorder;        //on an open or non-manifold welded edge: never moves
+        };
+
+        WeldedTopology WeldVertices(const PositionVertex* vertices, uint32_t vertexCount, const std::vector<uint32_t>& localIndices)
+        {
+            struct PositionKey
+            {
+                float x, y, z;
+                bool operator==(const PositionKey& other) const { return x == other.x && y == other.y && z == other.z; }
+            };
+            struct PositionHasher
+            {
+                size_t operator()(const PositionKey& key) const
+                {
+                    uint32_t bits[3];
+                    std::memcpy(bits, &key, sizeof(bits));
+                    return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+                }
+            };
+
+            WeldedTopology topology;
+            topology.canonical.resize(vertexCount);
+            topology.nextWedge.resize(vertexCount);
+            topology.isBorder.assign(vertexCount, false);
+            std::vector<uint32_t> lastWedge(vertexCount);
+            std::unordered_map<PositionKey, uint32_t, PositionHasher> firstVertexAt;
+            firstVertexAt.reserve(vertexCount);
+            for (uint32_t vertex = 0; vertex < vertexCount; ++vertex)
+            {
+                const PositionKey key = { vertices[vertex].m_vx, vertices[vertex].m_vy, vertices[vertex].m_vz };
+                const auto inserted = firstVertexAt.emplace(key, vertex);
+                const uint32_t first = inserted.first->second;
+                topology.canonical[vertex] = first;
+                if (inserted.second)
+                {
+                    topology.nextWedge[vertex] = vertex;
+                    lastWedge[vertex] = vertex;
+                }
+                else
+                {
+                    topology.nextWedge[lastWedge[first]] = vertex;
+                    topology.nextWedge[vertex] = first;
+                    lastWedge[first] = vertex;
+                }
+            }
+
+            std::unordered_map<uint64_t, uint32_t> edgeUses;
+            edgeUses.reserve(localIndices.size());
+            for (size_t itr = 0; itr < localIndices.size(); itr += 3)
+            {
+                for (uint32_t corner = 0; corner < 3; ++corner)
+                {
+                    const uint32_t a = topology.canonical[localIndices[itr + corner]];
+                    const uint32_t b = topology.canonical[localIndices[itr + (corner + 1) % 3]];
+                    ++edgeUses[GetEdgeKey(a, b)];
+                }
+            }
+
+            std::vector<bool> isCanonicalBorder(vertexCount, false);
+            for (const auto& edge : edgeUses)
+            {
+                if (edge.second == 2)
+                    continue;
+                isCanonicalBorder[static_cast<uint32_t>(edge.first >> 32)] = true;
+                isCanonicalBorder[static_cast<uint32_t>(edge.first & 0xFFFFFFFF)] = true;
+            }
+            for (uint32_t vertex = 0; vertex < vertexCount; ++vertex)
+                topology.isBorder[vertex] = isCanonicalBorder[topology.canonical[vertex]];
+            return topology;
+        }
+
+        //>The vertex at toPosition's welded position that shares a triangle with 'wedge', or vertexCount when there is none
+        uint32_t FindSeamPartner(const std::vector<uint32_t>& localIndices, const std::vector<uint32_t>& adjacencyOffsets,
+            const std::vector<uint32_t>& adjacency, const std::vector<uint32_t>& canonical, uint32_t wedge, uint32_t toCanonical)
+        {
+            const auto vertexCount = static_cast<uint32_t>(canonical.size());
+            uint32_t partner = vertexCount;
+            for (uint32_t itr = adjacencyOffsets[wedge]; itr < adjacencyOffsets[wedge + 1]; ++itr)
+            {
+                const uint32_t* triangle = &localIndices[adjacency[itr] * 3];
+                for (uint32_t corner = 0; corner < 3; ++corner)
+                {
+                    if (canonical[triangle[corner]] != toCanonical)
+                        continue;
+                    if (partner != vertexCount && partner != triangle[corner])
+                        return vertexCount; //two wedges of the target meet this one; which keeps the attributes is ambiguous
+                    partner = triangle[corner];
+                }
+            }
+            return partner;
+        }
+
+        //>True when moving 'from' onto 'to' turns any surviving triangle around 'from' upside down
+        bool FlipsTriangle(const PositionVertex* vertices, const std::vector<uint32_t>& localIndices,
+            const std::vector<uint32_t>& adjacencyOffsets, const std::vector<uint32_t>& adjacency, uint32_t from, uint32_t to)
+        {
+            for (uint32_t itr = adjacencyOffsets[from]; itr < adjacencyOffsets[from + 1]; ++itr)
+            {
+                const uint32_t* triangle = &localIndices[adjacency[itr] * 3];
+                if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+                    continue; //collapses away
+
+                double p[3][3];
+                double q[3][3];
+                for (uint32_t corner = 0; corner < 3; ++corner)
+                {
+                    GetPosition(vertices[triangle[corner]], p[corner]);
+                    GetPosition(vertices[triangle[corner] == from ? to : triangle[corner]], q[corner]);
+                }
+                auto normal = [](const double t[3][3], double n[3])
+                {
+                    const double e1[3] = { t[1][0] - t[0][0], t[1][1] - t[0][1], t[1][2] - t[0][2] };
+                    const double e2[3] = { t[2][0] - t[0][0], t[2][1] - t[0][1], t[2][2] - t[0][2] };
+                    n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+                    n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+                    n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+                };
+                double before[3];
+                double after[3];
+                normal(p, before);
+                normal(q, after);
+                if (before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= 0.0)
+                    return true;
+            }
+            return false;
+        }
+    }
+
+    float SimplifyMesh(const PositionVertex* vertices, uint32_t baseVertex, uint32_t vertexCount,
+        const uint32_t* indices, uint32_t indexCount, uint32_t targetIndexCount, float maxError,
+        std::vector<uint32_t>& outIndices)
+    {
+        std::vector<uint32_t> localIndices(indices, indices + indexCount);
+        for (auto& index : localIndices)
+            index -= baseVertex;
+
+        const auto topology = WeldVertices(vertices, vertexCount, localIndices);
+        const auto& canonical = topology.canonical;
+
+        //area-weighted plane quadrics of every triangle on its three welded corners
+        std::vector<Quadric> quadrics(vertexCount, Quadric{});
+        for (size_t itr = 0; itr < localIndices.size(); itr += 3)
+        {
+            double p0[3], p1[3], p2[3];
+            GetPosition(vertices[localIndices[itr]], p0);
+            GetPosition(vertices[localIndices[itr + 1]], p1);
+            GetPosition(vertices[localIndices[itr + 2]], p2);
+            const double e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+            const double e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+            double n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+            const double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            if (length <= 0.0)
+                continue;
+            n[0] /= length; n[1] /= length; n[2] /= length;
+            const double d = -(n[0] * p0[0] + n[1] * p0[1] + n[2] * p0[2]);
+            for (uint32_t corner = 0; corner < 3; ++corner)
+                quadrics[canonical[localIndices[itr + corner]]].AddPlane(n[0], n[1], n[2], d, length * 0.5);
+        }
+
+        const double errorLimit = static_cast<double>(maxError) * maxError;
+        double reachedError = 0.0;
+        std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+        std::vector<uint32_t> adjacency;
+        std::vector<uint32_t> cursor(vertexCount);
+        std::vector<Collapse> collapses;
+        std::vector<uint32_t> collapseTarget(vertexCount);
+        std::vector<bool> isTouched(vertexCount);
+        std::vector<std::pair<uint32_t, uint32_t>> wedgeMoves; //(from, to) of every wedge one collapse moves
+
+        //each pass collapses an independent set of edges cheapest first, then compacts the index list
+        while (localIndices.size() > targetIndexCount)
+        {
+            const uint32_t triangleCount = static_cast<uint32_t>(localIndices.size() / 3);
+
+            std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0u);
+            for (const auto index : localIndices)
+                ++adjacencyOffsets[index + 1];
+            for (uint32_t vertex = 0; vertex < vertexCount; ++vertex)
+                adjacencyOffsets[vertex + 1] += adjacencyOffsets[vertex];
+            adjacency.resize(localIndices.size());
+            std::copy(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1, cursor.begin());
+            for (uint32_t itr = 0; itr < localIndices.size(); ++itr)
+                adjacency[cursor[localIndices[itr]]++] = itr / 3;
+
+            collapses.clear();
+            for (uint32_t itr = 0; itr < localIndices.size(); ++itr)
+            {
+                const uint32_t from = localIndices[itr];
+                const uint32_t to = localIndices[itr - itr % 3 + (itr + 1) % 3];
+                if (canonical[from] == canonical[to])
+                    continue;
+                const Quadric& fromQuadric = quadrics[canonical[from]];
+                const Quadric& toQuadric = quadrics[canonical[to]];
+                double target[3];
+                GetPosition(vertices[to], target);
+                if (!topology.isBorder[from])
+                    collapses.push_back({ from, to, GetCollapseCost(fromQuadric, toQuadric, target) });
+                double source[3];
+                GetPosition(vertices[from], source);
+                if (!topology.isBorder[to])
+                    collapses.push_back({ to, from, GetCollapseCost(toQuadric, fromQuadric, source) });
+            }
+            std::sort(collapses.begin(), collapses.end(), [](const Collapse& lhs, const Collapse& rhs) { return lhs.cost < rhs.cost; });
+
+            //a collapse removes about two triangles; stop a little past the target rather than overshooting it
+            const uint32_t targetTriangles = targetIndexCount / 3;
+            const uint32_t collapseBudget = (std::max)((triangleCount - targetTriangles) / 2, 1u);
+            uint32_t collapseCount = 0;
+            for (uint32_t vertex = 0; vertex < vertexCount; ++vertex)
+                collapseTarget[vertex] = vertex;
+            std::fill(isTouched.begin(), isTouched.end(), false);
+
+            for (const auto& collapse : collapses)
+            {
+                if (collapse.cost > errorLimit)
+                    break;
+
+                //every wedge at 'from' moves onto the wedge of 'to' it shares a triangle with, so each side of a UV or
+                //normal seam keeps its own attributes. A wedge without such a neighbour means the edge leaves the seam.
+                wedgeMoves.clear();
+                bool isValid = true;
+                uint32_t wedge = collapse.from;
+                do
+                {
+                    if (adjacencyOffsets[wedge] != adjacencyOffsets[wedge + 1])
+                    {
+                        const uint32_t partner = wedge == collapse.from ? collapse.to :
+                            FindSeamPartner(localIndices, adjacencyOffsets, adjacency, canonical, wedge, canonical[collapse.to]);
+                        if (partner == vertexCount || isTouched[wedge] || isTouched[partner] ||
+                            FlipsTriangle(vertices, localIndices, adjacencyOffsets, adjacency, wedge, partner))
+                        {
+                            isValid = false;
+                            break;
+                        }
+                        wedgeMoves.emplace_back(wedge, partner);
+                    }
+                    wedge = topology.nextWedge[wedge];
+                } while (wedge != collapse.from);
+                if (!isValid)
+                    continue;
+
+                for (const auto& move : wedgeMoves)
+                {
+                    collapseTarget[move.first] = move.second;
+                    //the neighbourhood's triangles change shape, so the flip tests of this pass no longer hold there
+                    for (uint32_t itr = adjacencyOffsets[move.first]; itr < adjacencyOffsets[move.first + 1]; ++itr)
+                    {
+                        const uint32_t* triangle = &localIndices[adjacency[itr] * 3];
+                        isTouched[triangle[0]] = isTouched[triangle[1]] = isTouched[triangle[2]] = true;
+                    }
+                }
+                quadrics[canonical[collapse.to]].Add(quadrics[canonical[collapse.from]]);
+                reachedError = (std::max)(reachedError, collapse.cost);
+                if (++collapseCount >= collapseBudget)
+                    break;
+            }
+            if (collapseCount == 0)
+                break;
+
+            size_t writeCursor = 0;
+            for (size_t itr = 0; itr < localIndices.size(); itr += 3)
+            {
+                const uint32_t a = collapseTarget[localIndices[itr]];
+                const uint32_t b = collapseTarget[localIndices[itr + 1]];
+                const uint32_t c = collapseTarget[localIndices[itr + 2]];
+                if (a == b || b == c || c == a)
+                    continue;
+                localIndices[writeCursor++] = a;
+                localIndices[writeCursor++] = b;
+                localIndices[writeCursor++] = c;
+            }
+            localIndices.resize(writeCursor);
+        }
+
+        outIndices.resize(localIndices.size());
+        for (size_t itr = 0; itr < localIndices.size(); ++itr)
+            outIndices[itr] = localIndices[itr] + baseVertex;
+        return static_cast<float>(std::sqrt(reachedError));
+    }
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "d3d9/VertexDefs.h"
+
+namespace renderer
+{
+    //>Quadric error metric edge-collapse simplification (Garland & Heckbert 1997) onto existing vertices, so every
+    //>level can share the mesh's vertex range. Border vertices are locked to keep meshes crack free; attribute-seam
+    //>vertices only collapse along their seam, each wedge onto its own side's neighbour, so UVs and normals survive.
+    //>vertices points at the mesh's first vertex; indices are absolute in [baseVertex, baseVertex + vertexCount).
+    //>Stops at targetIndexCount or once the next collapse would exceed maxError. Returns the error reached: the
+    //>area-weighted RMS distance to the planes of the input indices, in model units.
+    //>Runs on pool workers, so it never touches an arena: outIndices and the scratch are the caller's task-local heap.
+    float SimplifyMesh(const PositionVertex* vertices, uint32_t baseVertex, uint32_t vertexCount,
+        const uint32_t* indices, uint32_t indexCount, uint32_t targetIndexCount, float maxError,
+        std::vector<uint32_t>& outIndices);
+}
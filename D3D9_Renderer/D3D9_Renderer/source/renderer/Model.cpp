@@ -2,15 +2,192 @@
 #include <assimp/mesh.h>
 #include <cassert>
 #include <algorithm>
+#include <numeric>
+#include <unordered_map>
+#include <atomic>
+#include <cstring>
 
 #include "Model.h"
 #include "../utils/ComHelpers.h"
+#include "../utils/Time.h"
+#include "../utils/Logger.h"
+#include "../utils/ThreadPool.h"
+#include "../utils/Hash.h"
+#include "../utils/FileIO.h"
+#include "../utils/AssetFile.h"
+#include "../utils/AssetPack.h"
+#include "TextureCache.h"
+#include "TextureDecoder.h"
+#include "CookedTexture.h"
+#include "ImportProfile.h"
+#include "MappedIOSystem.h"
+#include "VertexCacheOptimizer.h"
+#include "MeshOrderOptimizer.h"
+#include "MeshSimplifier.h"
+#include "MeshCluster.h"
+#include "MeshDedup.h"
+#include "MeshBounds.h"
+#include "NativeMeshLoader.h"
 
 namespace renderer
 {
+    namespace
+    {
+        //>Per Material::TextureType: what a material without that texture is drawn with
+        const char* const DefaultTexturePaths[Material::TextureTypeCount] =
+        {
+            "data/DefaultTex/default_diffuse.png",
+            "data/DefaultTex/default_normal.png",
+            "data/DefaultTex/default_specular.png",
+            "data/DefaultTex/default_opacity.png"
+        };
+
+        std::string GetTexturePathOrDefault(aiMaterial* material, aiTextureType type, const std::string& fileDir, const char* defaultPath)
+        {
+            if (material->GetTextureCount(type) > 0)
+            {
+                aiString path;
+                material->GetTexture(type, 0, &path);
+                return fileDir + path.C_Str();
+            }
+            return defaultPath;
+        }
+
+        //>A swizzled normal map only samples correctly from a normal slot; any other use decodes the source instead
+        bool IsCookedLayoutUsable(const CookedTexture& cooked, const std::vector<std::pair<uint32_t, Material::TextureType>>& slots)
+        {
+            if ((cooked.GetHeader().flags & CookedTextureFlagNormalXY) == 0)
+                return true;
+            return std::all_of(slots.begin(), slots.end(), [](const std::pair<uint32_t, Material::TextureType>& slot) { return slot.second == Material::TextureType::Normal; });
+        }
+
+        //>Row-vector (D3D) copy of an assimp matrix, which transforms column vectors
+        D3DXMATRIX ToD3DMatrix(const aiMatrix4x4& matrix)
+        {
+            return D3DXMATRIX(matrix.a1, matrix.b1, matrix.c1, matrix.d1,
+                matrix.a2, matrix.b2, matrix.c2, matrix.d2,
+                matrix.a3, matrix.b3, matrix.c3, matrix.d3,
+                matrix.a4, matrix.b4, matrix.c4, matrix.d4);
+        }
+
+        //>Moves one extracted vertex slice into scene space: normals by the inverse transpose, the tangent frame by the matrix itself
+        void TransformVertices(PositionVertex* vertices, uint32_t vertexCount, const D3DXMATRIX& world)
+        {
+            D3DXMATRIX normalMatrix;
+            if (D3DXMatrixInverse(&normalMatrix, nullptr, &world) == nullptr)
+                D3DXMatrixIdentity(&normalMatrix);
+            D3DXMatrixTranspose(&normalMatrix, &normalMatrix);
+
+            for (uint32_t iter = 0; iter < vertexCount; ++iter)
+            {
+                PositionVertex& vertex = vertices[iter];
+                D3DXVECTOR3 position(vertex.m_vx, vertex.m_vy, vertex.m_vz);
+                D3DXVECTOR3 normal(vertex.m_nx, vertex.m_ny, vertex.m_nz);
+                D3DXVECTOR3 tangent(vertex.m_tangx, vertex.m_tangy, vertex.m_tangz);
+                D3DXVECTOR3 biTangent(vertex.m_biTangx, vertex.m_biTangy, vertex.m_biTangz);
+                D3DXVec3TransformCoord(&position, &position, &world);
+                D3DXVec3TransformNormal(&normal, &normal, &normalMatrix);
+                D3DXVec3TransformNormal(&tangent, &tangent, &world);
+                D3DXVec3TransformNormal(&biTangent, &biTangent, &world);
+                D3DXVec3Normalize(&normal, &normal);
+                D3DXVec3Normalize(&tangent, &tangent);
+                D3DXVec3Normalize(&biTangent, &biTangent);
+
+                vertex.m_vx = position.x; vertex.m_vy = position.y; vertex.m_vz = position.z;
+                vertex.m_nx = normal.x; vertex.m_ny = normal.y; vertex.m_nz = normal.z;
+                vertex.m_tangx = tangent.x; vertex.m_tangy = tangent.y; vertex.m_tangz = tangent.z;
+                vertex.m_biTangx = biTangent.x; vertex.m_biTangy = biTangent.y; vertex.m_biTangz = biTangent.z;
+            }
+        }
+
+        //>Bytes of the per-vertex, face and bone arrays; node and material property overhead is left out
+        size_t EstimateSceneBytes(const aiScene& scene)
+        {
+            size_t bytes = 0;
+            for (uint32_t itr = 0; itr < scene.mNumMeshes; ++itr)
+            {
+                const aiMesh& mesh = *scene.mMeshes[itr];
+                size_t vertexBytes = sizeof(aiVector3D);
+                vertexBytes += mesh.HasNormals() ? sizeof(aiVector3D) : 0;
+                vertexBytes += mesh.HasTangentsAndBitangents() ? 2 * sizeof(aiVector3D) : 0;
+                for (uint32_t channel = 0; channel < AI_MAX_NUMBER_OF_TEXTURECOORDS; ++channel)
+                    vertexBytes += mesh.HasTextureCoords(channel) ? sizeof(aiVector3D) : 0;
+                for (uint32_t channel = 0; channel < AI_MAX_NUMBER_OF_COLOR_SETS; ++channel)
+                    vertexBytes += mesh.HasVertexColors(channel) ? sizeof(aiColor4D) : 0;
+
+                bytes += sizeof(aiMesh) + vertexBytes * mesh.mNumVertices + static_cast<size_t>(mesh.mNumFaces) * sizeof(aiFace);
+                for (uint32_t face = 0; face < mesh.mNumFaces; ++face)
+                    bytes += mesh.mFaces[face].mNumIndices * sizeof(unsigned int);
+                for (uint32_t bone = 0; bone < mesh.mNumBones; ++bone)
+                    bytes += sizeof(aiBone) + mesh.mBones[bone]->mNumWeights * sizeof(aiVertexWeight);
+            }
+            return bytes;
+        }
+
+        //>Writes one aiMesh straight into its slice of the model-wide images, baked with its node's world matrix
+        void ExtractMesh(const aiMesh& srcMesh, const D3DXMATRIX& world, Mesh& mesh, PositionVertex* vertexSlice, uint32_t* indexSlice)
+        {
+            const auto numVert = srcMesh.mNumVertices;
+            const auto numFaces = srcMesh.mNumFaces;
+
+            mesh.SetNumVertices(numVert);
+            mesh.SetNumIndices(numFaces * 3);
+            mesh.SetNumTris(numFaces);
+
+            const bool hasTexCoords = srcMesh.HasTextureCoords(0);
+            const bool hasTangents = srcMesh.HasTangentsAndBitangents();
+
+            for (uint32_t iter = 0; iter < numVert; ++iter)
+            {
+                PositionVertex& vertex = vertexSlice[iter];
+                vertex.m_vx = srcMesh.mVertices[iter].x;
+                vertex.m_vy = srcMesh.mVertices[iter].y;
+                vertex.m_vz = srcMesh.mVertices[iter].z;
+
+                vertex.m_nx = srcMesh.mNormals[iter].x;
+                vertex.m_ny = srcMesh.mNormals[iter].y;
+                vertex.m_nz = srcMesh.mNormals[iter].z;
+
+                vertex.m_tx = hasTexCoords ? srcMesh.mTextureCoords[0][iter].x : 0.0f;
+                vertex.m_ty = hasTexCoords ? srcMesh.mTextureCoords[0][iter].y : 0.0f;
+
+                vertex.m_tangx = hasTangents ? srcMesh.mTangents[iter].x : 0.0f;
+                vertex.m_tangy = hasTangents ? srcMesh.mTangents[iter].y : 0.0f;
+                vertex.m_tangz = hasTangents ? srcMesh.mTangents[iter].z : 0.0f;
+
+                vertex.m_biTangx = hasTangents ? srcMesh.mBitangents[iter].x : 0.0f;
+                vertex.m_biTangy = hasTangents ? srcMesh.mBitangents[iter].y : 0.0f;
+                vertex.m_biTangz = hasTangents ? srcMesh.mBitangents[iter].z : 0.0f;
+            }
+
+            D3DXMATRIX identity;
+            D3DXMatrixIdentity(&identity);
+            const bool isIdentity = memcmp(&world, &identity, sizeof(D3DXMATRIX)) == 0;
+            if (!isIdentity)
+                TransformVertices(vertexSlice, numVert, world);
+
+            //indices are rebased onto the merged vertex buffer here, so no later pass has to touch them.
+            //a mirroring node turns the triangles inside out, which swapping two corners undoes
+            const uint32_t baseVertex = mesh.GetVertexOffset();
+            const bool isMirrored = !isIdentity && D3DXMatrixDeterminant(&world) < 0.0f;
+            const uint32_t second = isMirrored ? 2 : 1;
+            const uint32_t third = isMirrored ? 1 : 2;
+            for (uint32_t iter = 0; iter < numFaces; ++iter)
+            {
+                const auto& face = srcMesh.mFaces[iter];
+                indexSlice[iter * 3] = face.mIndices[0] + baseVertex;
+                indexSlice[iter * 3 + 1] = face.mIndices[second] + baseVertex;
+                indexSlice[iter * 3 + 2] = face.mIndices[third] + baseVertex;
+            }
+            mesh.SetName(srcMesh.mName.C_Str());
+            mesh.SetMaterialIndex(static_cast<int16_t>(srcMesh.mMaterialIndex));
+        }
+    }
+
     Model::Model()
         :m_importer(),
         m_scene(nullptr),
+        m_sceneBytes(0),
         m_numMeshes(0),
         m_totalVertices(0),
         m_totalNormals(0),
@@ -18,8 +195,26 @@ namespace renderer
         m_totalIndices(0),
         m_numTris(0),
         m_meshes(),
+        m_vertexImage(),
+        m_indexImage(),
+        m_clusters(),
+        m_compactVertexImage(),
+        m_vertexQuantization(),
+        m_bounds(),
+        m_vertexFormat(VertexFormat::Full),
         m_fileDir(),
-        m_deviceRef(nullptr)
+        m_cachePath(),
+        m_sourceHash(0),
+        m_importFlags(0),
+        m_importProfile(ImportProfile::Production),
+        m_isHashingMeshes(false),
+        m_isRevalidatingTextures(false),
+        m_isMippingNonPow2(false),
+        m_assetSource(AssetSource::Any),
+        m_nextPendingTexture(0),
+        m_cookedModel(),
+        m_loadReport(),
+        m_importArena()
     {
     }
 
@@ -33,174 +228,809 @@ namespace renderer
 		}
     }
 
-    void Model::LoadModelAndParseData(IDirect3DDevice9* device, std::string filepath)
+    bool Model::ImportModel(const std::string& filepath, ImportProfile profile, VertexFormat vertexFormat)
     {
         m_fileDir = filepath.substr(0, filepath.find_last_of("/") + 1);
-        m_deviceRef = device;
+        m_loadReport.filePath = filepath;
+        m_loadReport.importProfile = GetImportProfileName(profile);
+        m_importProfile = profile;
+        m_vertexFormat = vertexFormat;
+        m_loadReport.vertexFormat = GetVertexFormatName(vertexFormat);
+
+        Stopwatch stopwatch;
+        m_cachePath = ModelCache::GetCachePath(filepath);
+        if (m_assetSource == AssetSource::Any)
+            AssetPack::GetInstance().Prefetch({ m_cachePath }); //paged in while the key is worked out
+        m_sourceHash = ModelCache::HashSourceFile(filepath, m_assetSource);
+        m_importFlags = GetImportFlags(profile);
+        m_loadReport.hashMs = stopwatch.GetElapsedMs();
+
+        stopwatch.Restart();
+        if (m_cookedModel.Open(m_cachePath, m_sourceHash, m_importFlags))
+        {
+            m_loadReport.loadedFromCache = true;
+            ProcessCookedModel();
+            m_cookedModel.Close();
+            m_loadReport.importMs = stopwatch.GetElapsedMs();
+            GatherLodStats();
+            FindDuplicateMeshes();
+            BuildClusters();
+            EncodeCompactVertices();
+            HashMeshContents();
+            StageTextures();
+            return true;
+        }
+
+        //OBJ and binary PLY are read natively; assimp takes every other format and whatever the native loader turns down
+        if (GetNativeFormat(filepath) == NativeFormat::None || !ImportNative(filepath))
+        {
+            ImportScene(filepath);
+            if (m_scene == nullptr)
+                return false; //missing, corrupt or half written; ImportScene logged why. Nothing is cooked from it
+            m_sceneBytes = EstimateSceneBytes(*m_scene);
+            ProcessModelVertexIndex();
+        }
+        m_loadReport.importMs = stopwatch.GetElapsedMs();
+
+        WriteCookedModel();
+        GatherLodStats();
+        FindDuplicateMeshes();
+        BuildClusters();
+        EncodeCompactVertices();
+        HashMeshContents();
+        StageTextures();
+        return true;
+    }
+
+    void Model::ImportScene(const std::string& filepath)
+    {
+        //read without post-processing, then apply the profile one step at a time so each can be timed.
+        //the steps are applied in assimp's own pipeline order, which gives the same scene as passing all flags to ReadFile
+        ImportProgressHandler progressHandler;
+        m_importer.SetProgressHandler(&progressHandler);
+
+#ifdef RENDERER_BENCHMARKS
+        LogImportIoComparison(filepath);
+#endif
+
+        //the model and whatever it references (.mtl, external buffers) are read from the pack or mapped, never through fread;
+        //the importer owns the handler and deletes it with itself or the next SetIOHandler
+        m_importer.SetIOHandler(new MappedIOSystem(m_assetSource));
+
+        Stopwatch stopwatch;
+        m_scene = m_importer.ReadFile(filepath, 0);
+        const double readMs = stopwatch.GetElapsedMs();
+        m_loadReport.parseMs = progressHandler.GetParseMs();
+        m_loadReport.preprocessMs = readMs - m_loadReport.parseMs;
 
-        const auto flags = aiProcess_CalcTangentSpace |
-            aiProcess_Triangulate |
-            aiProcess_ConvertToLeftHanded |
-            aiProcess_JoinIdenticalVertices |
-            aiProcess_RemoveRedundantMaterials | aiProcess_ValidateDataStructure |
-            aiProcess_FlipUVs | aiProcess_OptimizeMeshes;
+        if (m_scene != nullptr)
+        {
+            for (const auto& step : GetImportSteps())
+            {
+                if ((m_importFlags & step.flag) == 0)
+                    continue;
+
+                stopwatch.Restart();
+                m_scene = m_importer.ApplyPostProcessing(step.flag);
+                m_loadReport.postProcessSteps.push_back({ step.name, stopwatch.GetElapsedMs() });
+                if (m_scene == nullptr)
+                    break; //ValidateDataStructure rejected the scene; assimp already freed it
+            }
+        }
 
-        m_scene = m_importer.ReadFile(filepath, flags);
-        assert(m_scene != nullptr);
-        m_numMeshes = m_scene->mNumMeshes;
+        if (m_scene == nullptr)
+            Logger::GetInstance().LogInfo((std::string("[ModelLoad] import failed: ") + m_importer.GetErrorString()).c_str());
 
-        ProcessModelVertexIndex();
+        //the handler lives on this stack frame; the importer must not keep a dangling pointer
+        m_importer.SetProgressHandler(nullptr);
+    }
+
+    bool Model::FinalizeTextures(IDirect3DDevice9* device, double budgetMs)
+    {
+        Stopwatch stopwatch;
+        auto& textureCache = TextureCache::GetInstance();
+        while (m_nextPendingTexture < m_pendingTextures.size())
+        {
+            auto& pending = m_pendingTextures[m_nextPendingTexture++];
+            TextureSource source;
+            source.cooked = pending.cooked.get();
+            source.image = &pending.staging;
+            source.fileData = &pending.fileData;
+            for (const auto& slot : pending.slots)
+            {
+                //one reference per slot; Material releases each of them
+                auto texture = textureCache.Acquire(device, pending.normalizedPath, pending.contentHash, source);
+                auto material = m_materials[slot.first];
+                material->SetTexture(slot.second, texture);
+                if (slot.second == Material::TextureType::Normal)
+                    material->SetNormalMapXY((textureCache.GetCookedFlags(pending.contentHash) & CookedTextureFlagNormalXY) != 0);
+            }
+            //the staged pixels and the mapping are dead weight once the texture exists
+            pending.cooked.reset();
+            pending.staging = StagingImage();
+            pending.fileData = std::vector<uint8_t>();
+
+            if (stopwatch.GetElapsedMs() >= budgetMs)
+                break;
+        }
+        m_loadReport.textureUploadMs += stopwatch.GetElapsedMs();
+        return m_nextPendingTexture == m_pendingTextures.size();
+    }
+
+    void Model::ReleaseImportScene()
+    {
+        m_importer.FreeScene();
+        m_scene = nullptr;
+    }
+
+    void Model::ReleaseTextureStaging()
+    {
+        assert(m_nextPendingTexture == m_pendingTextures.size());
+        m_pendingTextures = std::vector<PendingTexture>();
+        m_nextPendingTexture = 0;
+    }
+
+    size_t Model::GetTextureStagingBytes() const
+    {
+        size_t bytes = 0;
+        for (const auto& pending : m_pendingTextures)
+            bytes += pending.staging.GetSizeInBytes() + pending.fileData.capacity();
+        return bytes;
+    }
+
+    void Model::BuildTransformHierarchy(ArenaVector<MeshReference>& outReferences)
+    {
+        //depth first with an explicit stack; a node is added before any of its children, which is the order Update relies on
+        m_transforms.Clear();
+        ArenaVector<std::pair<const aiNode*, uint32_t>> pending(m_importArena);
+        pending.emplace_back(m_scene->mRootNode, NoParentTransform);
+        while (!pending.empty())
+        {
+            const auto [node, parent] = pending.back();
+            pending.pop_back();
+
+            const uint32_t index = m_transforms.AddNode(parent, ToD3DMatrix(node->mTransformation), node->mName.C_Str());
+            for (uint32_t itr = 0; itr < node->mNumMeshes; ++itr)
+                outReferences.push_back({ node->mMeshes[itr], index });
+            for (uint32_t itr = node->mNumChildren; itr > 0; --itr)
+                pending.emplace_back(node->mChildren[itr - 1], index);
+        }
     }
 
     void Model::ProcessModelVertexIndex()
     {
-        m_meshes.reserve(m_numMeshes);
         auto const meshes = m_scene->mMeshes;
         aiMaterial** materials = m_scene->mMaterials;
         uint32_t numMaterials = m_scene->mNumMaterials;
 
-        int32_t totalVertices = 0;
-        int32_t totalIndices = 0;
-
         this->ProcessModelMaterials(materials, numMaterials); //get the material list ready for ref-counting
 
-        for (auto itr = 0; itr < m_numMeshes; ++itr)
+        //every node reference becomes its own mesh, so an aiMesh placed by several nodes is extracted once per placement
+        ArenaVector<MeshReference> references(m_importArena);
+        BuildTransformHierarchy(references);
+        ArenaVector<uint8_t> isReferenced(m_scene->mNumMeshes, 0, m_importArena);
+        for (const auto& reference : references)
+            isReferenced[reference.sourceMesh] = 1;
+        m_loadReport.nodeCount = m_transforms.GetCount();
+        m_loadReport.sourceMeshCount = static_cast<uint32_t>(std::count(isReferenced.begin(), isReferenced.end(), static_cast<uint8_t>(1)));
+        m_numMeshes = static_cast<int32_t>(references.size());
+        m_loadReport.meshCount = static_cast<uint32_t>(m_numMeshes);
+
+        //sort by material up front so every mesh knows its final slot before extraction starts
+        const auto numMeshes = static_cast<uint32_t>(m_numMeshes);
+        ArenaVector<uint32_t> meshOrder(numMeshes, m_importArena);
+        std::iota(meshOrder.begin(), meshOrder.end(), 0u);
+        std::stable_sort(meshOrder.begin(), meshOrder.end(), [meshes, &references](uint32_t a, uint32_t b)
+            {
+                return meshes[references[a].sourceMesh]->mMaterialIndex < meshes[references[b].sourceMesh]->mMaterialIndex;
+            });
+
+        //exclusive prefix sum over the sorted order: each mesh owns [offset, offset + count) of the merged buffers
+        ArenaVector<uint32_t> vertexOffsets(numMeshes, m_importArena);
+        ArenaVector<uint32_t> indexOffsets(numMeshes, m_importArena);
+        uint32_t totalVertices = 0;
+        uint32_t totalIndices = 0;
+        for (uint32_t slot = 0; slot < numMeshes; ++slot)
         {
-            std::unique_ptr<Mesh> mesh = std::make_unique<Mesh>();
+            const auto srcMesh = meshes[references[meshOrder[slot]].sourceMesh];
+            vertexOffsets[slot] = totalVertices;
+            indexOffsets[slot] = totalIndices;
+            totalVertices += srcMesh->mNumVertices;
+            totalIndices += srcMesh->mNumFaces * 3;
+        }
+        m_numTris = static_cast<int32_t>(totalIndices / 3); //assigned, so a reused Model does not accumulate
 
-            totalVertices += meshes[itr]->mNumVertices;
-            totalIndices += meshes[itr]->mNumFaces * 3;
-            m_numTris += meshes[itr]->mNumFaces;
+        Stopwatch stopwatch;
+        m_vertexImage.resize(totalVertices);
+        m_indexImage.resize(totalIndices);
+        m_meshes.resize(numMeshes);
+        auto& threadPool = ThreadPool::GetInstance();
+        threadPool.ParallelFor(numMeshes, [&](uint32_t slot)
+            {
+                const auto& reference = references[meshOrder[slot]];
+                auto mesh = std::make_shared<Mesh>();
+                mesh->SetVertexOffset(vertexOffsets[slot]);
+                mesh->SetIndexOffset(indexOffsets[slot]);
+                mesh->SetTransformIndex(reference.transformIndex);
+                ExtractMesh(*meshes[reference.sourceMesh], m_transforms.GetWorld(reference.transformIndex), *mesh,
+                    m_vertexImage.data() + vertexOffsets[slot], m_indexImage.data() + indexOffsets[slot]);
+                //the mesh's vertices were just written and are still in this core's cache
+                mesh->SetBounds(ComputeMeshBounds(m_vertexImage.data() + vertexOffsets[slot], static_cast<size_t>(mesh->GetNumVertices())));
+                m_meshes[slot] = std::move(mesh); //each worker only writes its own slot
+            });
+        m_loadReport.extractMs = stopwatch.GetElapsedMs();
+        m_loadReport.workerThreads = threadPool.GetThreadCount() + 1; //workers + calling thread
+        GatherModelBounds();
+
+#ifdef RENDERER_BENCHMARKS
+        LogBoundsKernelComparison(m_vertexImage.data(), m_vertexImage.size());
+#endif
+
+        FinishImportedGeometry();
+    }
 
-            mesh->SetNumVertices(meshes[itr]->mNumVertices);
-            mesh->SetNumNormals(meshes[itr]->mNumVertices); //number of normals = number of vertices
-            mesh->SetNumTexCoords(meshes[itr]->mNumVertices); //number of texcoord = number of vertices
-            mesh->SetNumTangents(meshes[itr]->mNumVertices);
-            mesh->SetNumBiTangents(meshes[itr]->mNumVertices);
-            mesh->SetNumIndices(meshes[itr]->mNumFaces * 3);
-            mesh->SetNumTris(meshes[itr]->mNumFaces);
+    bool Model::ImportNative(const std::string& filepath)
+    {
+        NativeModel native;
+        NativeLoadStats stats;
+        const bool computeTangents = (m_importFlags & aiProcess_CalcTangentSpace) != 0;
+        if (!LoadNativeModel(filepath, m_assetSource, computeTangents, native, stats))
+        {
+            Logger::GetInstance().LogInfo(("[ModelLoad] native " + std::string(GetNativeFormatName(stats.format)) + " load declined, importing through assimp: " + filepath).c_str());
+            return false;
+        }
+
+#ifdef RENDERER_BENCHMARKS
+        LogNativeImportComparison(filepath, m_importFlags, stats);
+#endif
+
+        m_materialDescs.reserve(native.materials.size());
+        for (const auto& material : native.materials)
+        {
+            MaterialDesc desc;
+            for (uint32_t type = 0; type < Material::TextureTypeCount; ++type)
+                desc.texturePaths[type] = material.texturePaths[type].empty() ? DefaultTexturePaths[type] : m_fileDir + material.texturePaths[type];
+            m_materialDescs.emplace_back(desc);
+        }
+        CreateMaterials();
 
-            const auto numVert = meshes[itr]->mNumVertices;
+        //neither format has a node graph: every mesh hangs off one identity root, as assimp builds it for them
+        D3DXMATRIX identity;
+        D3DXMatrixIdentity(&identity);
+        m_transforms.Clear();
+        const uint32_t root = m_transforms.AddNode(NoParentTransform, identity, filepath.substr(m_fileDir.size()));
+
+        Stopwatch stopwatch;
+        m_vertexImage = std::move(native.vertices);
+        m_indexImage = std::move(native.indices);
+        m_meshes.reserve(native.meshes.size());
+        for (const auto& nativeMesh : native.meshes)
+        {
+            auto mesh = std::make_shared<Mesh>();
+            mesh->SetName(nativeMesh.name);
+            mesh->SetMaterialIndex(static_cast<int16_t>(nativeMesh.materialIndex));
+            mesh->SetVertexOffset(nativeMesh.vertexOffset);
+            mesh->SetIndexOffset(nativeMesh.indexOffset);
+            mesh->SetTransformIndex(root);
+            mesh->SetNumVertices(nativeMesh.vertexCount);
+            mesh->SetNumIndices(nativeMesh.indexCount);
+            mesh->SetNumTris(nativeMesh.indexCount / 3);
+            mesh->SetBounds(ComputeMeshBounds(m_vertexImage.data() + nativeMesh.vertexOffset, nativeMesh.vertexCount));
+            m_meshes.emplace_back(std::move(mesh));
+        }
+        m_numMeshes = static_cast<int32_t>(m_meshes.size());
+        m_numTris = static_cast<int32_t>(stats.triangles);
+        m_loadReport.nodeCount = m_transforms.GetCount();
+        m_loadReport.sourceMeshCount = static_cast<uint32_t>(m_meshes.size());
+        m_loadReport.meshCount = static_cast<uint32_t>(m_meshes.size());
+
+        //the native loader has no preprocess or post-process steps: parsing covers welding, building the normals and tangents
+        m_loadReport.parseMs = stats.parseMs;
+        m_loadReport.extractMs = stats.buildMs + stopwatch.GetElapsedMs();
+        m_loadReport.nativeImport = stats;
+        GatherModelBounds();
+
+        FinishImportedGeometry();
+        return true;
+    }
+
+    void Model::FinishImportedGeometry()
+    {
+        OptimizeMeshOrder();
+        if (m_importProfile != ImportProfile::FastPreview)
+            BuildLods();
+
+        m_totalVertices = static_cast<int32_t>(m_vertexImage.size());
+        m_totalNormals = m_totalVertices;
+        m_totalIndices = static_cast<int32_t>(m_indexImage.size()); //LOD0 plus every simplified level
+    }
+
+    void Model::OptimizeMeshOrder()
+    {
+        //exporters emit triangles and vertices in authoring order. Per mesh: triangles for the post-transform cache,
+        //then clusters for overdraw, then vertices in first-use order for fetch. The cooked cache stores the result
+        Stopwatch stopwatch;
+        const auto numMeshes = static_cast<uint32_t>(m_meshes.size());
+        const bool analyzeOverdraw = m_importProfile == ImportProfile::Validation; //the rasterizer is too slow for every import
+        ArenaVector<MeshOrderStats> statsBefore(numMeshes, m_importArena);
+        ArenaVector<MeshOrderStats> statsAfter(numMeshes, m_importArena);
+        auto measure = [this, analyzeOverdraw](const Mesh& mesh, MeshOrderStats& stats)
+        {
+            const uint32_t* indices = m_indexImage.data() + mesh.GetIndexOffset();
+            const auto indexCount = static_cast<uint32_t>(mesh.GetNumIndices());
+            const auto vertexCount = static_cast<uint32_t>(mesh.GetNumVertices());
+            stats.vertexCache = SimulateVertexCache(indices, indexCount, mesh.GetVertexOffset(), vertexCount);
+            stats.vertexFetch = SimulateVertexFetch(indices, indexCount, mesh.GetVertexOffset(), vertexCount);
+            if (analyzeOverdraw)
+                stats.overdraw = SimulateOverdraw(m_vertexImage.data() + mesh.GetVertexOffset(), indices, indexCount, mesh.GetVertexOffset(), vertexCount);
+        };
 
-            uint32_t iter = 0;
-            for (iter = 0; iter < numVert; ++iter)
+        ThreadPool::GetInstance().ParallelFor(numMeshes, [&](uint32_t slot)
             {
-                float x = meshes[itr]->mVertices[iter].x;
-                float y = meshes[itr]->mVertices[iter].y;
-                float z = meshes[itr]->mVertices[iter].z;
-                mesh->AppendVertices(x, y, z);
+                const auto& mesh = *m_meshes[slot];
+                PositionVertex* vertices = m_vertexImage.data() + mesh.GetVertexOffset();
+                uint32_t* indices = m_indexImage.data() + mesh.GetIndexOffset();
+                const auto indexCount = static_cast<uint32_t>(mesh.GetNumIndices());
+                const auto vertexCount = static_cast<uint32_t>(mesh.GetNumVertices());
 
-                x = meshes[itr]->mNormals[iter].x;
-                y = meshes[itr]->mNormals[iter].y;
-                z = meshes[itr]->mNormals[iter].z;
-                mesh->AppendNormals(x, y, z);
+                measure(mesh, statsBefore[slot]);
+                OptimizeVertexCache(indices, indexCount, mesh.GetVertexOffset(), vertexCount);
+                OptimizeOverdraw(vertices, indices, indexCount, mesh.GetVertexOffset(), vertexCount, OverdrawCacheThreshold);
+                OptimizeVertexFetch(vertices, indices, indexCount, mesh.GetVertexOffset(), vertexCount);
+                measure(mesh, statsAfter[slot]);
+            });
+        for (uint32_t slot = 0; slot < numMeshes; ++slot)
+        {
+            m_loadReport.meshOrderBefore += statsBefore[slot];
+            m_loadReport.meshOrderAfter += statsAfter[slot];
+        }
+        m_loadReport.meshOrderMs = stopwatch.GetElapsedMs();
+    }
 
-				x = meshes[itr]->HasTextureCoords(0) ? meshes[itr]->mTextureCoords[0][iter].x : 0.0f;
-                y = meshes[itr]->HasTextureCoords(0) ? meshes[itr]->mTextureCoords[0][iter].y : 0.0f;
-                mesh->AppendTexCoords(x, y);
+    void Model::BuildLods()
+    {
+        Stopwatch stopwatch;
+        const auto numMeshes = static_cast<uint32_t>(m_meshes.size());
+        //[slot * MaxMeshLods + level]; level 0 stays empty, LOD0 is already in the index image. Heap, not the import
+        //arena: a level's size is only known once a worker has simplified it, and it is freed once appended below
+        std::vector<std::vector<uint32_t>> lodIndices(static_cast<size_t>(numMeshes) * MaxMeshLods);
+        ArenaVector<std::array<float, MaxMeshLods>> lodErrors(numMeshes, m_importArena);
+        ArenaVector<uint32_t> lodCounts(numMeshes, 1, m_importArena);
+        ThreadPool::GetInstance().ParallelFor(numMeshes, [&](uint32_t slot)
+            {
+                const auto& mesh = *m_meshes[slot];
+                const PositionVertex* vertices = m_vertexImage.data() + mesh.GetVertexOffset();
+                const uint32_t* indices = m_indexImage.data() + mesh.GetIndexOffset();
+                const auto indexCount = static_cast<uint32_t>(mesh.GetNumIndices());
+                const auto vertexCount = static_cast<uint32_t>(mesh.GetNumVertices());
+                if (vertexCount == 0)
+                    return;
 
-                if (meshes[itr]->HasTangentsAndBitangents())
-                {
-                    x = meshes[itr]->mTangents[iter].x;
-                    y = meshes[itr]->mTangents[iter].y;
-                    z = meshes[itr]->mTangents[iter].z;
-                    mesh->AppendTangents(x, y, z);
-
-                    x = meshes[itr]->mBitangents[iter].x;
-                    y = meshes[itr]->mBitangents[iter].y;
-                    z = meshes[itr]->mBitangents[iter].z;
-                    mesh->AppendBiTangents(x, y, z);
-                }
-                else
+                const float maxError = LodMaxRelativeError * mesh.GetBounds().GetDiagonal();
+
+                //each level is simplified from the one before, which is a fraction of LOD0's work. Its own error is
+                //measured against that level, so the distance to the real surface is bounded by the sum of the steps.
+                const uint32_t* sourceIndices = indices;
+                uint32_t sourceIndexCount = indexCount;
+                float reachedError = 0.0f;
+                for (uint32_t level = 1; level < MaxMeshLods; ++level)
                 {
-                    x = y = z = 0.0f;
-                    mesh->AppendTangents(x, y, z);
-                    mesh->AppendBiTangents(x, y, z);
+                    const uint32_t targetIndexCount = (indexCount >> level) / 3 * 3;
+                    auto& levelIndices = lodIndices[slot * MaxMeshLods + level];
+                    const float error = SimplifyMesh(vertices, mesh.GetVertexOffset(), vertexCount, sourceIndices, sourceIndexCount, targetIndexCount,
+                        (std::max)(maxError - reachedError, 0.0f), levelIndices);
+                    if (levelIndices.size() >= sourceIndexCount)
+                    {
+                        levelIndices.clear(); //nothing collapsed: the level would only duplicate the one before
+                        break;
+                    }
+                    OptimizeVertexCache(levelIndices.data(), static_cast<uint32_t>(levelIndices.size()), mesh.GetVertexOffset(), vertexCount);
+                    reachedError += error;
+                    lodErrors[slot][level] = reachedError;
+                    lodCounts[slot] = level + 1;
+                    sourceIndices = levelIndices.data();
+                    sourceIndexCount = static_cast<uint32_t>(levelIndices.size());
                 }
-            }
+            });
 
-            const auto numFaces = meshes[itr]->mNumFaces;
-            for (iter = 0; iter < numFaces; ++iter)
+        //appended level by level in mesh order: like LOD0, each material's range of a level stays contiguous across the
+        //meshes that have the level. A mesh that stopped reducing draws its coarsest level in place of the rest
+        m_indexImage.reserve(m_indexImage.size() + std::accumulate(lodIndices.begin(), lodIndices.end(), size_t(0),
+            [](size_t sum, const std::vector<uint32_t>& levelIndices) { return sum + levelIndices.size(); }));
+        for (uint32_t level = 1; level < MaxMeshLods; ++level)
+        {
+            for (uint32_t slot = 0; slot < numMeshes; ++slot)
             {
-                const uint32_t vertexA = meshes[itr]->mFaces[iter].mIndices[0];
-                const uint32_t vertexB = meshes[itr]->mFaces[iter].mIndices[1];
-                const uint32_t vertexC = meshes[itr]->mFaces[iter].mIndices[2];
+                if (level >= lodCounts[slot])
+                    continue;
+                const auto& levelIndices = lodIndices[slot * MaxMeshLods + level];
+                m_meshes[slot]->SetLod(level, { static_cast<uint32_t>(m_indexImage.size()), static_cast<uint32_t>(levelIndices.size()), lodErrors[slot][level] });
+                m_indexImage.insert(m_indexImage.end(), levelIndices.begin(), levelIndices.end());
+            }
+        }
+        for (uint32_t slot = 0; slot < numMeshes; ++slot)
+            m_meshes[slot]->SetLodCount(lodCounts[slot]);
+        m_loadReport.lodBuildMs = stopwatch.GetElapsedMs();
+    }
 
-                mesh->AppendIndices(vertexA, vertexB, vertexC);
+    void Model::GatherModelBounds()
+    {
+        m_bounds = MeshBounds();
+        for (const auto& mesh : m_meshes)
+            MergeBounds(m_bounds, mesh->GetBounds());
+        m_loadReport.bounds = m_bounds;
+    }
+
+    void Model::GatherLodStats()
+    {
+        auto& lodLevels = m_loadReport.lodLevels;
+        m_loadReport.lodCount = MaxMeshLods;
+        for (const auto& mesh : m_meshes)
+        {
+            m_loadReport.lodCount = (std::min)(m_loadReport.lodCount, mesh->GetLodCount());
+            for (uint32_t level = 0; level < mesh->GetLodCount(); ++level)
+            {
+                const auto lod = mesh->GetLod(level);
+                lodLevels[level].triangles += lod.numIndices / 3;
+                lodLevels[level].maxError = (std::max)(lodLevels[level].maxError, lod.error);
             }
-            mesh->SetName(meshes[itr]->mName.C_Str());
-            mesh->SetMaterialIndex(meshes[itr]->mMaterialIndex);
-			
-            m_meshes.emplace_back(std::move(mesh));
         }
+    }
+
+    void Model::FindDuplicateMeshes()
+    {
+        //like the clusters, cheap enough next to the import to redo on every load instead of cooking it
+        Stopwatch stopwatch;
+        m_loadReport.dedup = renderer::FindDuplicateMeshes(m_meshes, m_vertexImage.data(), m_indexImage.data(), m_importArena);
+        m_loadReport.dedupMs = stopwatch.GetElapsedMs();
+    }
+
+    void Model::BuildClusters()
+    {
+        //derived from the cooked index order in a single pass, so it is cheaper to redo on every load than to store
+        Stopwatch stopwatch;
+        const auto numMeshes = static_cast<uint32_t>(m_meshes.size());
+        //every mesh's range is sized before the fork, so the workers only write into storage that already exists
+        m_clusters.clear();
+        uint32_t clusterTotal = 0;
+        for (uint32_t slot = 0; slot < numMeshes; ++slot)
+        {
+            auto& mesh = *m_meshes[slot];
+            const uint32_t clusterCount = mesh.IsDuplicate() ? 0 : GetMeshClusterCount(static_cast<uint32_t>(mesh.GetNumIndices()));
+            mesh.SetClusterRange(clusterTotal, clusterCount);
+            clusterTotal += clusterCount;
+        }
+        m_clusters.resize(clusterTotal);
+        ThreadPool::GetInstance().ParallelFor(numMeshes, [&](uint32_t slot)
+            {
+                const auto& mesh = *m_meshes[slot];
+                if (mesh.IsDuplicate())
+                    return; //instances are culled whole; only the prototype's geometry is drawn
+                BuildMeshClusters(m_vertexImage.data() + mesh.GetVertexOffset(), mesh.GetVertexOffset(), m_indexImage.data() + mesh.GetIndexOffset(),
+                    mesh.GetIndexOffset(), static_cast<uint32_t>(mesh.GetNumIndices()), m_clusters.data() + mesh.GetClusterStart());
+            });
+
+        m_loadReport.clusterCount = static_cast<uint32_t>(m_clusters.size());
+        m_loadReport.coneClusterCount = static_cast<uint32_t>(std::count_if(m_clusters.begin(), m_clusters.end(), [](const MeshCluster& cluster) { return cluster.coneCutoff < 1.0f; }));
+        m_loadReport.clusterBuildMs = stopwatch.GetElapsedMs();
+    }
 
-        //sort Meshlist
-		std::sort(m_meshes.begin(), m_meshes.end(), [](std::shared_ptr<Mesh> a, std::shared_ptr<Mesh> b)
-			{
-				return a->GetMaterialIndex() < b->GetMaterialIndex();
-			});
+    void Model::EncodeCompactVertices()
+    {
+        m_loadReport.fullVertexBytes = m_vertexImage.size() * sizeof(PositionVertex);
+        m_loadReport.deviceVertexBytes = m_loadReport.fullVertexBytes;
+        if (m_vertexFormat != VertexFormat::Compact)
+            return;
 
-        m_totalVertices = totalVertices;
-        m_totalNormals = totalVertices;
-        m_totalIndices = totalIndices;
+        //one quantization box for the whole model, so every batch shares the same decode constants
+        Stopwatch stopwatch;
+        m_vertexQuantization = ComputeVertexQuantization(m_bounds);
+        m_compactVertexImage.resize(m_vertexImage.size());
+        const auto numMeshes = static_cast<uint32_t>(m_meshes.size());
+        ArenaVector<VertexEncodeStats> meshStats(numMeshes, m_importArena);
+        ThreadPool::GetInstance().ParallelFor(numMeshes, [&](uint32_t slot)
+            {
+                const auto& mesh = *m_meshes[slot];
+                renderer::EncodeCompactVertices(m_vertexImage.data() + mesh.GetVertexOffset(), static_cast<size_t>(mesh.GetNumVertices()), m_vertexQuantization,
+                    m_compactVertexImage.data() + mesh.GetVertexOffset(), &meshStats[slot]);
+            });
+        for (const auto& stats : meshStats)
+            m_loadReport.vertexEncode += stats;
+        m_loadReport.deviceVertexBytes = m_compactVertexImage.size() * sizeof(CompactVertex);
+        m_loadReport.vertexEncodeMs = stopwatch.GetElapsedMs();
     }
+
+    void Model::HashMeshContents()
+    {
+        if (!m_isHashingMeshes)
+            return;
+
+        //what the device ends up holding: the compact encoding depends on the model-wide box as well as on the mesh
+        uint64_t seed = HashSeed;
+        if (m_vertexFormat == VertexFormat::Compact)
+        {
+            seed = HashBytes(&m_vertexQuantization.scale, sizeof(m_vertexQuantization.scale), seed);
+            seed = HashBytes(&m_vertexQuantization.offset, sizeof(m_vertexQuantization.offset), seed);
+        }
+        ThreadPool::GetInstance().ParallelFor(static_cast<uint32_t>(m_meshes.size()), [&](uint32_t slot)
+            {
+                auto& mesh = *m_meshes[slot];
+                const uint16_t materialIndex = mesh.GetMaterialIndex();
+                uint64_t hash = HashBytes(&materialIndex, sizeof(materialIndex), seed);
+                hash = HashBytes(m_vertexImage.data() + mesh.GetVertexOffset(), static_cast<size_t>(mesh.GetNumVertices()) * sizeof(PositionVertex), hash);
+                //relative to the first vertex, so a mesh that only moved within the image keeps its hash. Each level is
+                //rebased into task-local scratch and hashed in one call
+                std::vector<uint32_t> rebased;
+                for (uint32_t level = 0; level < mesh.GetLodCount(); ++level)
+                {
+                    const auto lod = mesh.GetLod(level);
+                    const uint32_t* indices = m_indexImage.data() + lod.indexOffset;
+                    rebased.resize(lod.numIndices);
+                    std::transform(indices, indices + lod.numIndices, rebased.begin(), [&mesh](uint32_t index) { return index - mesh.GetVertexOffset(); });
+                    hash = HashBytes(rebased.data(), rebased.size() * sizeof(uint32_t), hash);
+                }
+                mesh.SetContentHash(hash);
+            });
+    }
+
     void Model::ProcessModelMaterials(aiMaterial** materials, uint32_t materialCount)
     {
-        m_materials.reserve(materialCount);
+        m_materialDescs.reserve(materialCount);
         
         for (uint32_t itr = 0; itr < materialCount; ++itr)
         {
-            Material* material = new Material();
-            aiString path;
-           
-			if (materials[itr]->GetTextureCount(aiTextureType_DIFFUSE) > 0)
-			{
-				materials[itr]->GetTexture(aiTextureType_DIFFUSE, 0, &path);
-				std::string fullTexturePath = m_fileDir + path.C_Str();
-				ComResult(D3DXCreateTextureFromFileA(m_deviceRef, fullTexturePath.c_str(), material->GetPtrToTextureOfType(Material::TextureType::Diffuse)));
-			}
-            else
-            {
-                std::string fullTexturePath = "data/DefaultTex/default_diffuse.png";
-                ComResult(D3DXCreateTextureFromFileA(m_deviceRef, fullTexturePath.c_str(), material->GetPtrToTextureOfType(Material::TextureType::Diffuse)));
+            MaterialDesc desc;
+            desc.texturePaths[static_cast<uint32_t>(Material::TextureType::Diffuse)] = GetTexturePathOrDefault(materials[itr], aiTextureType_DIFFUSE, m_fileDir, DefaultTexturePaths[static_cast<uint32_t>(Material::TextureType::Diffuse)]);
+            desc.texturePaths[static_cast<uint32_t>(Material::TextureType::Normal)] = GetTexturePathOrDefault(materials[itr], aiTextureType_HEIGHT, m_fileDir, DefaultTexturePaths[static_cast<uint32_t>(Material::TextureType::Normal)]);
+            desc.texturePaths[static_cast<uint32_t>(Material::TextureType::Specular)] = GetTexturePathOrDefault(materials[itr], aiTextureType_SHININESS, m_fileDir, DefaultTexturePaths[static_cast<uint32_t>(Material::TextureType::Specular)]);
+            desc.texturePaths[static_cast<uint32_t>(Material::TextureType::Opacity)] = GetTexturePathOrDefault(materials[itr], aiTextureType_OPACITY, m_fileDir, DefaultTexturePaths[static_cast<uint32_t>(Material::TextureType::Opacity)]);
+            m_materialDescs.emplace_back(desc);
+        }
+
+        CreateMaterials();
+    }
+
+    void Model::CreateMaterials()
+    {
+        //textures are attached later by FinalizeTextures; until then the materials are drawn with placeholders
+        m_materials.reserve(m_materialDescs.size());
+        for (size_t itr = 0; itr < m_materialDescs.size(); ++itr)
+        {
+            m_materials.emplace_back(new Material());
+        }
+    }
+
+    void Model::StageTextures()
+    {
+        Stopwatch stopwatch;
+        double benchmarkMs = 0.0;
+        auto& textureCache = TextureCache::GetInstance();
+        std::unordered_map<std::string, size_t> pendingByPath;
+        ArenaVector<uint32_t> toDecode(m_importArena);
+        for (uint32_t matIndex = 0; matIndex < m_materialDescs.size(); ++matIndex)
+        {
+            for (uint32_t texType = 0; texType < Material::TextureTypeCount; ++texType)
+            {
+                const auto& sourcePath = m_materialDescs[matIndex].texturePaths[texType];
+                const auto normalizedPath = TextureCache::NormalizePath(sourcePath);
+                const auto slot = std::make_pair(matIndex, static_cast<Material::TextureType>(texType));
+
+                auto found = pendingByPath.find(normalizedPath);
+                if (found != pendingByPath.end())
+                {
+                    m_pendingTextures[found->second].slots.emplace_back(slot);
+                    continue;
+                }
+
+                PendingTexture pending;
+                pending.sourcePath = sourcePath;
+                pending.normalizedPath = normalizedPath;
+                pending.contentHash = 0;
+                pending.slots.emplace_back(slot);
+
+                if (m_isRevalidatingTextures || !textureCache.FindContentHash(normalizedPath, pending.contentHash))
+                    toDecode.emplace_back(static_cast<uint32_t>(m_pendingTextures.size()));
+
+                pendingByPath.emplace(normalizedPath, m_pendingTextures.size());
+                m_pendingTextures.emplace_back(std::move(pending));
             }
+        }
 
-			if (materials[itr]->GetTextureCount(aiTextureType_HEIGHT) > 0)
-			{
-				materials[itr]->GetTexture(aiTextureType_HEIGHT, 0, &path);
-				std::string fullTexturePath = m_fileDir + path.C_Str();
-				ComResult(D3DXCreateTextureFromFileA(m_deviceRef, fullTexturePath.c_str(), material->GetPtrToTextureOfType(Material::TextureType::Normal)));
-			}
-            else
+#ifdef RENDERER_BENCHMARKS
+        {
+            std::vector<std::vector<uint8_t>> files(toDecode.size());
+            std::vector<const std::vector<uint8_t>*> filePtrs;
+            for (size_t itr = 0; itr < toDecode.size(); ++itr)
             {
-                std::string fullTexturePath = "data/DefaultTex/default_normal.png";
-                ComResult(D3DXCreateTextureFromFileA(m_deviceRef, fullTexturePath.c_str(), material->GetPtrToTextureOfType(Material::TextureType::Normal)));
+                if (ReadWholeFile(m_pendingTextures[toDecode[itr]].sourcePath, files[itr]))
+                    filePtrs.emplace_back(&files[itr]);
             }
+            Stopwatch benchmarkTimer;
+            LogTextureDecodeSweep(filePtrs);
+            benchmarkMs = benchmarkTimer.GetElapsedMs(); //the sweep logs its own times; it is not part of staging
+        }
+#endif
+
+        //the OS reads the packed files in the background while the first ones decode
+        if (m_assetSource == AssetSource::Any)
+        {
+            std::vector<std::string> prefetchPaths;
+            for (const auto pendingIndex : toDecode)
+            {
+                prefetchPaths.emplace_back(CookedTexture::GetCookedPath(m_pendingTextures[pendingIndex].sourcePath));
+                prefetchPaths.emplace_back(m_pendingTextures[pendingIndex].sourcePath);
+            }
+            AssetPack::GetInstance().Prefetch(prefetchPaths);
+        }
+
+        //hash and decode (or map the cooked container of) every new file in parallel; each task only touches its own entry
+        std::atomic<size_t> inputBytes(0);
+        std::atomic<size_t> stagingBytes(0);
+        std::atomic<uint32_t> cookedTextures(0);
+        auto& threadPool = ThreadPool::GetInstance();
+        threadPool.ParallelFor(static_cast<uint32_t>(toDecode.size()), [&](uint32_t itr)
+            {
+                auto& pending = m_pendingTextures[toDecode[itr]];
+                //a packed file's hash is in the pack directory: a texture that is resident or cooked is never read
+                AssetFile source;
+                const bool isHashKnown = m_assetSource == AssetSource::Any && AssetPack::GetInstance().FindContentHash(pending.sourcePath, pending.contentHash);
+                if (!isHashKnown)
+                {
+                    if (!source.Open(pending.sourcePath, m_assetSource))
+                    {
+                        Logger::GetInstance().LogInfo(("Could not read texture: " + pending.sourcePath).c_str());
+                        return;
+                    }
+                    pending.contentHash = HashBytes(source.GetData(), source.GetSize());
+                }
+                if (textureCache.HasContent(pending.contentHash))
+                    return; //the same bytes are resident already, under this path or another; Acquire hands that texture out
+
+                //a cooked container for exactly these source bytes skips the decode; its mapping stays open until upload
+                auto cooked = std::make_unique<CookedTexture>();
+                if (cooked->Open(CookedTexture::GetCookedPath(pending.sourcePath), pending.contentHash, m_assetSource) && IsCookedLayoutUsable(*cooked, pending.slots))
+                {
+                    pending.cooked = std::move(cooked);
+                    ++cookedTextures;
+                    return;
+                }
+                if (!source.IsOpen() && !source.Open(pending.sourcePath, m_assetSource))
+                {
+                    Logger::GetInstance().LogInfo(("Could not read texture: " + pending.sourcePath).c_str());
+                    return;
+                }
+
+                inputBytes += source.GetSize();
+                if (DecodeImage(source.GetData(), source.GetSize(), pending.staging))
+                {
+                    //a device without non-power-of-two mips gets level 0; TextureCache sizes it for the device
+                    if (m_isMippingNonPow2 || pending.staging.IsPowerOfTwo())
+                        BuildMipChain(pending.staging);
+                    stagingBytes += pending.staging.GetSizeInBytes();
+                }
+                else
+                {
+                    pending.fileData.assign(source.GetData(), source.GetData() + source.GetSize()); //D3DX fallback
+                }
+            });
+
+        m_loadReport.textureStageMs = stopwatch.GetElapsedMs() - benchmarkMs;
+        m_loadReport.textureDecodeThreads = threadPool.GetThreadCount() + 1;
+        m_loadReport.textureDecodeInputBytes = inputBytes;
+        m_loadReport.textureStagingBytes = stagingBytes;
+        m_loadReport.cookedTextures = cookedTextures;
+        m_loadReport.uniqueTextures = static_cast<uint32_t>(m_pendingTextures.size());
+        m_loadReport.textureSlots = static_cast<uint32_t>(m_materialDescs.size() * Material::TextureTypeCount);
+    }
 
-			if (materials[itr]->GetTextureCount(aiTextureType_SHININESS) > 0)
-			{
-				materials[itr]->GetTexture(aiTextureType_SHININESS, 0, &path);
-				std::string fullTexturePath = m_fileDir + path.C_Str();
-				ComResult(D3DXCreateTextureFromFileA(m_deviceRef, fullTexturePath.c_str(), material->GetPtrToTextureOfType(Material::TextureType::Specular)));
-			}
-			else
-			{
-				std::string fullTexturePath = "data/DefaultTex/default_specular.png";
-				ComResult(D3DXCreateTextureFromFileA(m_deviceRef, fullTexturePath.c_str(), material->GetPtrToTextureOfType(Material::TextureType::Specular)));
-			}
-
-			if (materials[itr]->GetTextureCount(aiTextureType_OPACITY) > 0)
-			{
-				materials[itr]->GetTexture(aiTextureType_OPACITY, 0, &path);
-				std::string fullTexturePath = m_fileDir + path.C_Str();
-				ComResult(D3DXCreateTextureFromFileA(m_deviceRef, fullTexturePath.c_str(), material->GetPtrToTextureOfType(Material::TextureType::Opacity)));
-			}
-			else
-			{
-				std::string fullTexturePath = "data/DefaultTex/default_opacity.png";
-				ComResult(D3DXCreateTextureFromFileA(m_deviceRef, fullTexturePath.c_str(), material->GetPtrToTextureOfType(Material::TextureType::Opacity)));
-			}
-           m_materials.emplace_back(material);
-        }
-    }
-}
\ No newline at end of file
+    void Model::ProcessCookedModel()
+    {
+        const auto& header = m_cookedModel.GetHeader();
+        const auto cookedMaterials = m_cookedModel.GetMaterials();
+
+        m_materialDescs.reserve(header.materialCount);
+        for (uint32_t itr = 0; itr < header.materialCount; ++itr)
+        {
+            MaterialDesc desc;
+            for (uint32_t texType = 0; texType < Material::TextureTypeCount; ++texType)
+                desc.texturePaths[texType] = cookedMaterials[itr].texturePaths[texType];
+            m_materialDescs.emplace_back(desc);
+        }
+        CreateMaterials();
+
+        const auto nodeRecords = m_cookedModel.GetNodes();
+        m_transforms.Clear();
+        for (uint32_t itr = 0; itr < header.nodeCount; ++itr)
+            m_transforms.AddNode(nodeRecords[itr].parent, D3DXMATRIX(nodeRecords[itr].local), nodeRecords[itr].name);
+
+        //the cooked images are already interleaved and rebased: one copy out of the mapping
+        m_vertexImage.assign(m_cookedModel.GetVertices(), m_cookedModel.GetVertices() + header.vertexCount);
+        m_indexImage.assign(m_cookedModel.GetIndices(), m_cookedModel.GetIndices() + header.indexCount);
+
+        const auto meshRecords = m_cookedModel.GetMeshes();
+        uint32_t vertexOffset = 0;
+        m_meshes.reserve(header.meshCount);
+        for (uint32_t itr = 0; itr < header.meshCount; ++itr)
+        {
+            auto mesh = std::make_shared<Mesh>();
+            mesh->SetNumVertices(static_cast<int32_t>(meshRecords[itr].numVertices));
+            mesh->SetNumIndices(static_cast<int32_t>(meshRecords[itr].numIndices));
+            mesh->SetNumTris(static_cast<int32_t>(meshRecords[itr].numTris));
+            mesh->SetMaterialIndex(static_cast<int16_t>(meshRecords[itr].materialIndex));
+            mesh->SetVertexOffset(vertexOffset);
+            mesh->SetIndexOffset(meshRecords[itr].lods[0].indexOffset);
+            mesh->SetLodCount(meshRecords[itr].lodCount);
+            for (uint32_t level = 1; level < meshRecords[itr].lodCount; ++level)
+            {
+                const auto& lod = meshRecords[itr].lods[level];
+                mesh->SetLod(level, { lod.indexOffset, lod.numIndices, lod.error });
+            }
+            mesh->SetName(meshRecords[itr].name);
+            mesh->SetTransformIndex(meshRecords[itr].transformIndex);
+            MeshBounds bounds;
+            bounds.boundsMin = D3DXVECTOR3(meshRecords[itr].boundsMin);
+            bounds.boundsMax = D3DXVECTOR3(meshRecords[itr].boundsMax);
+            bounds.center = D3DXVECTOR3(meshRecords[itr].center);
+            bounds.radius = meshRecords[itr].radius;
+            mesh->SetBounds(bounds);
+            vertexOffset += meshRecords[itr].numVertices;
+            m_meshes.emplace_back(std::move(mesh));
+        }
+
+        m_numMeshes = static_cast<int32_t>(header.meshCount);
+        m_loadReport.meshCount = header.meshCount;
+        m_loadReport.nodeCount = header.nodeCount;
+        m_numTris = static_cast<int32_t>(header.triangleCount);
+        m_totalVertices = static_cast<int32_t>(header.vertexCount);
+        m_totalNormals = m_totalVertices;
+        m_totalIndices = static_cast<int32_t>(header.indexCount);
+        GatherModelBounds();
+    }
+
+    void Model::WriteCookedModel()
+    {
+        ArenaVector<CookedMeshRecord> meshRecords(m_meshes.size(), CookedMeshRecord{}, m_importArena);
+        for (size_t itr = 0; itr < m_meshes.size(); ++itr)
+        {
+            auto& record = meshRecords[itr];
+            record.materialIndex = m_meshes[itr]->GetMaterialIndex();
+            record.numVertices = static_cast<uint32_t>(m_meshes[itr]->GetNumVertices());
+            record.numIndices = static_cast<uint32_t>(m_meshes[itr]->GetNumIndices());
+            record.numTris = static_cast<uint32_t>(m_meshes[itr]->GetNumTris());
+            record.lodCount = m_meshes[itr]->GetLodCount();
+            record.transformIndex = m_meshes[itr]->GetTransformIndex();
+            const auto& bounds = m_meshes[itr]->GetBounds();
+            memcpy(record.boundsMin, static_cast<const float*>(bounds.boundsMin), sizeof(record.boundsMin));
+            memcpy(record.boundsMax, static_cast<const float*>(bounds.boundsMax), sizeof(record.boundsMax));
+            memcpy(record.center, static_cast<const float*>(bounds.center), sizeof(record.center));
+            record.radius = bounds.radius;
+            for (uint32_t level = 0; level < record.lodCount; ++level)
+            {
+                const auto lod = m_meshes[itr]->GetLod(level);
+                record.lods[level] = { lod.indexOffset, lod.numIndices, lod.error, 0 };
+            }
+            strncpy_s(record.name, m_meshes[itr]->GetName().c_str(), _TRUNCATE);
+        }
+
+        ArenaVector<CookedNodeRecord> nodeRecords(m_transforms.GetCount(), CookedNodeRecord{}, m_importArena);
+        for (uint32_t itr = 0; itr < m_transforms.GetCount(); ++itr)
+        {
+            auto& record = nodeRecords[itr];
+            record.parent = m_transforms.GetParent(itr);
+            memcpy(record.local, static_cast<const float*>(m_transforms.GetLocal(itr)), sizeof(record.local));
+            strncpy_s(record.name, m_transforms.GetName(itr).c_str(), _TRUNCATE);
+        }
+
+        ArenaVector<CookedMaterialRecord> materialRecords(m_materialDescs.size(), m_importArena);
+        for (size_t itr = 0; itr < m_materialDescs.size(); ++itr)
+        {
+            for (uint32_t texType = 0; texType < Material::TextureTypeCount; ++texType)
+                strncpy_s(materialRecords[itr].texturePaths[texType], m_materialDescs[itr].texturePaths[texType].c_str(), _TRUNCATE);
+        }
+
+        Stopwatch stopwatch;
+        if (!ModelCache::Write(m_cachePath, m_sourceHash, m_importFlags, nodeRecords, meshRecords, materialRecords, m_vertexImage, m_indexImage))
+            Logger::GetInstance().LogInfo(("Could not write cooked model cache: " + m_cachePath).c_str());
+        m_loadReport.cacheWriteMs = stopwatch.GetElapsedMs();
+    }
+}
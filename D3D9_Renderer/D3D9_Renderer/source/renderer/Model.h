@@ -3,21 +3,33 @@
 #include <string>
 #include <assimp/Importer.hpp>
 #include <vector>
+#include <array>
 #include <memory>
 #include <cassert>
 
 #include "Mesh.h"
+#include "ModelCache.h"
+#include "LoadReport.h"
+#include "TextureDecoder.h"
+#include "CookedTexture.h"
+#include "ImportProfile.h"
+#include "MeshCluster.h"
+#include "MeshBounds.h"
+#include "VertexCompression.h"
+#include "TransformHierarchy.h"
+#include "../utils/ArenaAllocator.h"
 
 namespace renderer
 {
 	using Scene = aiScene;
 	using Importer = Assimp::Importer;
 
+    constexpr float LodMaxRelativeError = 0.1f; //simplification stops once the error reaches this fraction of the mesh's bounding box diagonal
+
+    //>Resolved texture file per Material::TextureType slot (defaults already substituted)
     struct MaterialDesc
     {
-        uint32_t textureCount;
-        std::vector<std::string> diffuseTexture;
-        std::vector<std::string> normalTexture;
+        std::array<std::string, Material::TextureTypeCount> texturePaths;
     };
 
 	class Model
@@ -26,7 +38,12 @@ namespace renderer
 		Model();
 		~Model();
 
-		void LoadModelAndParseData(IDirect3DDevice9* device, std::string filepath);
+		//>CPU-only: safe to run on a worker thread. Leaves the materials without textures until FinalizeTextures.
+		//>A compact vertexFormat also fills the compact vertex image; the full one is kept for CPU-side bounds.
+		//>False when the file could not be imported; the model is left without geometry then.
+		[[nodiscard]] bool ImportModel(const std::string& filepath, ImportProfile profile, VertexFormat vertexFormat);
+		//>Render thread: creates the staged textures until budgetMs is spent (at least one per call). True once all are resident.
+		[[nodiscard]] bool FinalizeTextures(IDirect3DDevice9* device, double budgetMs);
 
 		//>Getters
 		inline int32_t GetTotalMeshes() const { return m_numMeshes; }
@@ -37,22 +54,123 @@ namespace renderer
         inline int32_t GetTotalTexCoord() const { return m_totalTexCoords; }
         inline int32_t GetTotalIndices() const { return m_totalIndices; }
 		
-        inline std::vector<std::shared_ptr<Mesh>> GetMeshes() const { return m_meshes; }
+        inline const std::vector<std::shared_ptr<Mesh>>& GetMeshes() const { return m_meshes; }
         inline Material* GetMaterialAtIndex(uint32_t matIndex) const { assert(matIndex < m_materials.size()); return m_materials[matIndex]; }
+
+        //>Interleaved, rebased vertex/index images. Taking them moves the storage out; no copy is made.
+        inline const std::vector<PositionVertex>& GetVertexImage() const { return m_vertexImage; }
+        inline const std::vector<uint32_t>& GetIndexImage() const { return m_indexImage; }
+        inline std::vector<PositionVertex> TakeVertexImage() { return std::move(m_vertexImage); }
+        inline std::vector<uint32_t> TakeIndexImage() { return std::move(m_indexImage); }
+        //>Empty unless the model was imported with VertexFormat::Compact
+        inline std::vector<CompactVertex> TakeCompactVertexImage() { return std::move(m_compactVertexImage); }
+        inline const VertexQuantization& GetVertexQuantization() const { return m_vertexQuantization; }
+        //>LOD0 clusters of every mesh, in mesh order (see Mesh::GetClusterStart)
+        inline std::vector<MeshCluster> TakeClusters() { return std::move(m_clusters); }
+        //>Every mesh's bounds merged, duplicates included, in model space where it was imported
+        inline const MeshBounds& GetBounds() const { return m_bounds; }
+
+        //>Scene nodes; every mesh refers to one through Mesh::GetTransformIndex
+        inline TransformHierarchy& GetTransforms() { return m_transforms; }
+        inline const TransformHierarchy& GetTransforms() const { return m_transforms; }
+
+        inline ModelLoadReport& GetLoadReport() { return m_loadReport; }
+        //>Backs the transient tables of the import and of ModelManager::LoadModel; released once the model is resident
+        inline LinearArena& GetImportArena() { return m_importArena; }
+        //>Frees assimp's scene; nothing after ImportModel reads it. Safe on the import worker once ImportModel returned.
+        void ReleaseImportScene();
+        //>Drops the texture bookkeeping once FinalizeTextures returned true
+        void ReleaseTextureStaging();
+        inline bool IsSceneResident() const { return m_scene != nullptr; }
+        //>Estimated size of the assimp scene the import read, 0 on a warm start; kept after ReleaseImportScene for the report
+        inline size_t GetSceneBytes() const { return m_sceneBytes; }
+        [[nodiscard]] size_t GetTextureStagingBytes() const;
+        //>Maps the cooked file written (or read) by ImportModel; fails when no up-to-date one exists
+        [[nodiscard]] inline bool OpenCookedModel(ModelCache& cache) const { return cache.Open(m_cachePath, m_sourceHash, m_importFlags); }
+        //>Fills Mesh::GetContentHash during the import, so a reload of the file can tell which meshes changed. Set before ImportModel.
+        inline void SetMeshHashing(bool isHashing) { m_isHashingMeshes = isHashing; }
+        //>Re-reads texture files the TextureCache already knows by path; only files whose bytes changed are decoded again.
+        //>Set before ImportModel.
+        inline void SetTextureRevalidation(bool isRevalidating) { m_isRevalidatingTextures = isRevalidating; }
+        //>The device mips non-power-of-two textures (no D3DPTEXTURECAPS_POW2); otherwise those are staged with level 0 only.
+        //>Set before ImportModel.
+        inline void SetNonPow2Mipmaps(bool isSupported) { m_isMippingNonPow2 = isSupported; }
+        //>Where the model, its cooked cache and its textures are read from. Set before ImportModel.
+        inline void SetAssetSource(AssetSource source) { m_assetSource = source; }
         
 	private:
+        //>One unique texture file: read, hashed and decoded on the workers, acquired from the TextureCache on the render thread
+        struct PendingTexture
+        {
+            std::string sourcePath;
+            std::string normalizedPath;
+            uint64_t contentHash;
+            std::unique_ptr<CookedTexture> cooked; //set when an up-to-date .ctex exists; nothing is decoded then
+            StagingImage staging;          //empty when cooked, when the cache already knows the path or WIC could not decode it
+            std::vector<uint8_t> fileData; //encoded bytes, only kept when WIC failed and D3DX has to decode
+            std::vector<std::pair<uint32_t, Material::TextureType>> slots; //(material index, texture type) users
+        };
+
+        //>One aiMesh placed by one node
+        struct MeshReference
+        {
+            uint32_t sourceMesh;
+            uint32_t transformIndex;
+        };
+
+        void ImportScene(const std::string& filepath);
+        //>OBJ and binary PLY without assimp; false leaves the model untouched for the assimp path
+        [[nodiscard]] bool ImportNative(const std::string& filepath);
+        void BuildTransformHierarchy(ArenaVector<MeshReference>& outReferences);
 		void ProcessModelVertexIndex();
+        //>Mesh order, LODs and totals once either importer filled the images, meshes and bounds
+        void FinishImportedGeometry();
+        void OptimizeMeshOrder();
+        void BuildLods();
+        void GatherModelBounds();
+        void GatherLodStats();
+        void FindDuplicateMeshes();
+        void BuildClusters();
+        void EncodeCompactVertices();
+        void HashMeshContents();
         void ProcessModelMaterials(aiMaterial** materials, uint32_t materialCount);
+        void ProcessCookedModel();
+        void WriteCookedModel();
+        void CreateMaterials();
+        void StageTextures();
 
         std::string m_fileDir;
-        IDirect3DDevice9* m_deviceRef;
+        std::string m_cachePath;
+        uint64_t m_sourceHash;
+        uint32_t m_importFlags;
+        ImportProfile m_importProfile;
+        bool m_isHashingMeshes;
+        bool m_isRevalidatingTextures;
+        bool m_isMippingNonPow2;
+        AssetSource m_assetSource;
+
+        ModelCache m_cookedModel;
+        ModelLoadReport m_loadReport;
+        LinearArena m_importArena;
 
 		const Scene* m_scene;
+        size_t m_sceneBytes;
 
 		Importer m_importer;
 		
         std::vector<std::shared_ptr<Mesh>> m_meshes;
+        TransformHierarchy m_transforms;
+        std::vector<PositionVertex> m_vertexImage;
+        std::vector<uint32_t> m_indexImage;
+        std::vector<MeshCluster> m_clusters;
+        std::vector<CompactVertex> m_compactVertexImage;
+        VertexQuantization m_vertexQuantization;
+        MeshBounds m_bounds;
+        VertexFormat m_vertexFormat;
         std::vector<Material*> m_materials;
+        std::vector<MaterialDesc> m_materialDescs;
+        std::vector<PendingTexture> m_pendingTextures;
+        size_t m_nextPendingTexture;
 
 		int32_t m_numMeshes;
         int32_t m_numTris;
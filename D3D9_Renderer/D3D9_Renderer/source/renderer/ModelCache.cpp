@@ -0,0 +1,203 @@
+#include <fstream>
+#include <cassert>
+#include <cstring>
+
+#include "ModelCache.h"
+#include "../utils/Hash.h"
+#include "../utils/AssetPack.h"
+
+namespace renderer
+{
+    namespace
+    {
+        constexpr uint64_t CookedSectionAlignment = 16;
+
+        inline uint64_t AlignOffset(uint64_t offset)
+        {
+            return (offset + CookedSectionAlignment - 1) & ~(CookedSectionAlignment - 1);
+        }
+
+        void WritePadding(std::ofstream& stream, uint64_t alignedOffset)
+        {
+            static const char zeros[CookedSectionAlignment] = {};
+            const auto current = static_cast<uint64_t>(stream.tellp());
+            assert(alignedOffset >= current);
+            stream.write(zeros, static_cast<std::streamsize>(alignedOffset - current));
+        }
+
+        //>count records of stride bytes at offset lie inside the file. The offset is checked before anything is added to it,
+        //>and a 32-bit count times a record size cannot overflow 64 bits
+        inline bool IsSectionInFile(uint64_t offset, uint32_t count, uint64_t stride, uint64_t fileSize)
+        {
+            return offset % CookedSectionAlignment == 0 && offset <= fileSize && count * stride <= fileSize - offset;
+        }
+
+        inline bool IsTerminated(const char* text, size_t capacity)
+        {
+            return memchr(text, 0, capacity) != nullptr;
+        }
+
+        //>Every record names ranges inside the images and tables the header describes, and strings that end in it
+        bool AreRecordsValid(const CookedModelHeader& header, const CookedNodeRecord* nodes, const CookedMeshRecord* meshes, const CookedMaterialRecord* materials)
+        {
+            for (uint32_t itr = 0; itr < header.nodeCount; ++itr)
+            {
+                if ((nodes[itr].parent != NoParentTransform && nodes[itr].parent >= itr) || !IsTerminated(nodes[itr].name, CookedNameLength))
+                    return false;
+            }
+            for (uint32_t itr = 0; itr < header.materialCount; ++itr)
+            {
+                for (const auto& path : materials[itr].texturePaths)
+                {
+                    if (!IsTerminated(path, MAX_PATH))
+                        return false;
+                }
+            }
+            uint64_t vertexTotal = 0;
+            for (uint32_t itr = 0; itr < header.meshCount; ++itr)
+            {
+                const auto& mesh = meshes[itr];
+                vertexTotal += mesh.numVertices;
+                if (mesh.materialIndex >= header.materialCount || mesh.lodCount == 0 || mesh.lodCount > MaxMeshLods
+                    || (mesh.transformIndex != NoTransform && mesh.transformIndex >= header.nodeCount) || !IsTerminated(mesh.name, CookedNameLength))
+                    return false;
+                for (uint32_t level = 0; level < mesh.lodCount; ++level)
+                {
+                    if (static_cast<uint64_t>(mesh.lods[level].indexOffset) + mesh.lods[level].numIndices > header.indexCount)
+                        return false;
+                }
+            }
+            return vertexTotal <= header.vertexCount;
+        }
+    }
+
+    ModelCache::ModelCache()
+        :m_file(),
+        m_header(nullptr)
+    {
+    }
+
+    ModelCache::~ModelCache()
+    {
+        Close();
+    }
+
+    std::string ModelCache::GetCachePath(const std::string& sourcePath)
+    {
+        return sourcePath + ".mdlcache";
+    }
+
+    uint64_t ModelCache::HashSourceFile(const std::string& sourcePath, AssetSource source)
+    {
+        //a packed source is hashed by the packer; the directory answers without reading the file
+        return AssetFile::HashContents(sourcePath, source);
+    }
+
+    bool ModelCache::Open(const std::string& cachePath, uint64_t sourceHash, uint32_t importFlags)
+    {
+        if (OpenFrom(cachePath, AssetSource::Any, sourceHash, importFlags))
+            return true;
+        return AssetPack::GetInstance().Find(cachePath) != nullptr && OpenFrom(cachePath, AssetSource::Loose, sourceHash, importFlags);
+    }
+
+    bool ModelCache::OpenFrom(const std::string& cachePath, AssetSource source, uint64_t sourceHash, uint32_t importFlags)
+    {
+        Close();
+
+        if (!m_file.Open(cachePath, source))
+            return false;
+
+        if (m_file.GetSize() < sizeof(CookedModelHeader))
+        {
+            Close();
+            return false;
+        }
+
+        const auto header = reinterpret_cast<const CookedModelHeader*>(m_file.GetData());
+        const bool keyMatches = header->magic == CookedModelMagic &&
+            header->version == CookedModelVersion &&
+            header->sourceHash == sourceHash &&
+            header->importFlags == importFlags &&
+            header->vertexStride == sizeof(PositionVertex);
+
+        //a truncated or corrupted file must not be trusted either: every section has to lie inside the mapping, and so
+        //does every range the mesh records point at. The caller imports through assimp instead
+        const uint64_t fileSize = m_file.GetSize();
+        const bool sectionsFit = keyMatches &&
+            IsSectionInFile(header->nodeTableOffset, header->nodeCount, sizeof(CookedNodeRecord), fileSize) &&
+            IsSectionInFile(header->meshTableOffset, header->meshCount, sizeof(CookedMeshRecord), fileSize) &&
+            IsSectionInFile(header->materialTableOffset, header->materialCount, sizeof(CookedMaterialRecord), fileSize) &&
+            IsSectionInFile(header->vertexDataOffset, header->vertexCount, sizeof(PositionVertex), fileSize) &&
+            IsSectionInFile(header->indexDataOffset, header->indexCount, sizeof(uint32_t), fileSize);
+        const uint8_t* data = m_file.GetData();
+        if (!sectionsFit || !AreRecordsValid(*header, reinterpret_cast<const CookedNodeRecord*>(data + header->nodeTableOffset),
+            reinterpret_cast<const CookedMeshRecord*>(data + header->meshTableOffset), reinterpret_cast<const CookedMaterialRecord*>(data + header->materialTableOffset)))
+        {
+            Close();
+            return false;
+        }
+
+        m_header = header;
+        return true;
+    }
+
+    void ModelCache::Close()
+    {
+        m_header = nullptr;
+        m_file.Close();
+    }
+
+    bool ModelCache::Write(const std::string& cachePath, uint64_t sourceHash, uint32_t importFlags,
+        const ArenaVector<CookedNodeRecord>& nodes,
+        const ArenaVector<CookedMeshRecord>& meshes,
+        const ArenaVector<CookedMaterialRecord>& materials,
+        const std::vector<PositionVertex>& vertices,
+        const std::vector<uint32_t>& indices)
+    {
+        CookedModelHeader header = {};
+        header.magic = CookedModelMagic;
+        header.version = CookedModelVersion;
+        header.sourceHash = sourceHash;
+        header.importFlags = importFlags;
+        header.vertexStride = sizeof(PositionVertex);
+        header.nodeCount = static_cast<uint32_t>(nodes.size());
+        header.meshCount = static_cast<uint32_t>(meshes.size());
+        header.materialCount = static_cast<uint32_t>(materials.size());
+        header.vertexCount = static_cast<uint32_t>(vertices.size());
+        header.indexCount = static_cast<uint32_t>(indices.size());
+        header.triangleCount = 0; //LOD0 only; the index image also holds the simplified levels
+        for (const auto& mesh : meshes)
+            header.triangleCount += mesh.numTris;
+
+        header.nodeTableOffset = AlignOffset(sizeof(CookedModelHeader));
+        header.meshTableOffset = AlignOffset(header.nodeTableOffset + nodes.size() * sizeof(CookedNodeRecord));
+        header.materialTableOffset = AlignOffset(header.meshTableOffset + meshes.size() * sizeof(CookedMeshRecord));
+        header.vertexDataOffset = AlignOffset(header.materialTableOffset + materials.size() * sizeof(CookedMaterialRecord));
+        header.indexDataOffset = AlignOffset(header.vertexDataOffset + vertices.size() * sizeof(PositionVertex));
+
+        //write to a temporary and swap it in so a crash mid-write never leaves a valid-looking cache behind
+        const std::string tempPath = cachePath + ".tmp";
+        {
+            std::ofstream stream(tempPath, std::ios::binary | std::ios::trunc);
+            if (!stream)
+                return false;
+
+            stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            WritePadding(stream, header.nodeTableOffset);
+            stream.write(reinterpret_cast<const char*>(nodes.data()), static_cast<std::streamsize>(nodes.size() * sizeof(CookedNodeRecord)));
+            WritePadding(stream, header.meshTableOffset);
+            stream.write(reinterpret_cast<const char*>(meshes.data()), static_cast<std::streamsize>(meshes.size() * sizeof(CookedMeshRecord)));
+            WritePadding(stream, header.materialTableOffset);
+            stream.write(reinterpret_cast<const char*>(materials.data()), static_cast<std::streamsize>(materials.size() * sizeof(CookedMaterialRecord)));
+            WritePadding(stream, header.vertexDataOffset);
+            stream.write(reinterpret_cast<const char*>(vertices.data()), static_cast<std::streamsize>(vertices.size() * sizeof(PositionVertex)));
+            WritePadding(stream, header.indexDataOffset);
+            stream.write(reinterpret_cast<const char*>(indices.data()), static_cast<std::streamsize>(indices.size() * sizeof(uint32_t)));
+
+            if (!stream)
+                return false;
+        }
+
+        return ::MoveFileExA(tempPath.c_str(), cachePath.c_str(), MOVEFILE_REPLACE_EXISTING) != FALSE;
+    }
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <windows.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Material.h"
+#include "Mesh.h"
+#include "d3d9/VertexDefs.h"
+#include "TransformHierarchy.h"
+#include "../utils/AssetFile.h"
+#include "../utils/ArenaAllocator.h"
+
+namespace renderer
+{
+    constexpr uint32_t CookedModelMagic = 0x434C444D; //'MDLC'
+    constexpr uint32_t CookedModelVersion = 8;        //bump whenever the layout or the import pipeline output changes
+    constexpr uint32_t CookedNameLength = 64;
+
+    //>On-disk layout. Every section offset is relative to the start of the file and 16 byte aligned.
+    struct CookedModelHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t sourceHash;
+        uint32_t importFlags;
+        uint32_t vertexStride;
+        uint32_t meshCount;
+        uint32_t materialCount;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t triangleCount;
+        uint32_t nodeCount;
+        uint64_t nodeTableOffset;
+        uint64_t meshTableOffset;
+        uint64_t materialTableOffset;
+        uint64_t vertexDataOffset;
+        uint64_t indexDataOffset;
+    };
+
+    struct CookedLodRecord
+    {
+        uint32_t indexOffset;
+        uint32_t numIndices;
+        float error;
+        uint32_t reserved;
+    };
+
+    //>Meshes are stored in the material-sorted order used to build the batches
+    struct CookedMeshRecord
+    {
+        uint32_t materialIndex;
+        uint32_t numVertices;
+        uint32_t numIndices;
+        uint32_t numTris;
+        uint32_t lodCount;
+        uint32_t transformIndex;
+        uint32_t reserved[2];
+        CookedLodRecord lods[MaxMeshLods]; //[0] is the full-resolution range
+        float boundsMin[3];
+        float boundsMax[3];
+        float center[3];
+        float radius;
+        char name[CookedNameLength];
+    };
+
+    //>Scene nodes parent before child, as TransformHierarchy stores them
+    struct CookedNodeRecord
+    {
+        uint32_t parent; //NoParentTransform for roots
+        uint32_t reserved[3];
+        float local[16]; //row-vector (D3D) layout
+        char name[CookedNameLength];
+    };
+
+    struct CookedMaterialRecord
+    {
+        char texturePaths[Material::TextureTypeCount][MAX_PATH];
+    };
+
+    //>Versioned binary cache of the post-processed import, keyed by the source file hash and the aiProcess flags
+    class ModelCache
+    {
+    public:
+        ModelCache();
+        ~ModelCache();
+
+        ModelCache(const ModelCache&) = delete;
+        ModelCache& operator=(const ModelCache&) = delete;
+
+        static std::string GetCachePath(const std::string& sourcePath);
+        [[nodiscard]] static uint64_t HashSourceFile(const std::string& sourcePath, AssetSource source = AssetSource::Any);
+
+        //>Maps the cooked file; fails (and leaves the cache closed) when the key or version does not match.
+        //>A packed copy that does not match gives way to the loose file, which may have been re-cooked since the pack was built.
+        [[nodiscard]] bool Open(const std::string& cachePath, uint64_t sourceHash, uint32_t importFlags);
+        void Close();
+
+        [[nodiscard]] static bool Write(const std::string& cachePath, uint64_t sourceHash, uint32_t importFlags,
+            const ArenaVector<CookedNodeRecord>& nodes,
+            const ArenaVector<CookedMeshRecord>& meshes,
+            const ArenaVector<CookedMaterialRecord>& materials,
+            const std::vector<PositionVertex>& vertices,
+            const std::vector<uint32_t>& indices);
+
+        inline bool IsOpen() const { return m_header != nullptr; }
+        inline const CookedModelHeader& GetHeader() const { return *m_header; }
+        inline const CookedNodeRecord* GetNodes() const { return reinterpret_cast<const CookedNodeRecord*>(m_file.GetData() + m_header->nodeTableOffset); }
+        inline const CookedMeshRecord* GetMeshes() const { return reinterpret_cast<const CookedMeshRecord*>(m_file.GetData() + m_header->meshTableOffset); }
+        inline const CookedMaterialRecord* GetMaterials() const { return reinterpret_cast<const CookedMaterialRecord*>(m_file.GetData() + m_header->materialTableOffset); }
+        inline const PositionVertex* GetVertices() const { return reinterpret_cast<const PositionVertex*>(m_file.GetData() + m_header->vertexDataOffset); }
+        inline const uint32_t* GetIndices() const { return reinterpret_cast<const uint32_t*>(m_file.GetData() + m_header->indexDataOffset); }
+
+    private:
+        [[nodiscard]] bool OpenFrom(const std::string& cachePath, AssetSource source, uint64_t sourceHash, uint32_t importFlags);
+
+        AssetFile m_file;
+        const CookedModelHeader* m_header;
+    };
+}
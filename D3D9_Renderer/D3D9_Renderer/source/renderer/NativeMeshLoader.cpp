@@ -0,0 +1,1186 @@
+#include <d3dx9.h>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+#include <unordered_map>
+
+#include "NativeMeshLoader.h"
+#include "../utils/Logger.h"
+#include "../utils/MemoryStats.h"
+#include "../utils/Time.h"
+
+#ifdef RENDERER_BENCHMARKS
+#include <assimp/Importer.hpp>
+#include "MappedIOSystem.h"
+#endif
+
+namespace renderer
+{
+    namespace
+    {
+        constexpr uint32_t NoMaterial = UINT32_MAX;
+        constexpr uint32_t MaxFloatTokenLength = 63; //longer tokens are not numbers any exporter writes
+
+        //exact in a double: a mantissa below 2^53 times one of these rounds once, like strtod would
+        constexpr double PowersOf10[] =
+        {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+
+        inline bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+        inline bool IsBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+        inline const char* SkipBlanks(const char* cursor, const char* end)
+        {
+            while (cursor < end && IsBlank(*cursor))
+                ++cursor;
+            return cursor;
+        }
+
+        inline const char* SkipLine(const char* cursor, const char* end)
+        {
+            const void* newline = memchr(cursor, '\n', static_cast<size_t>(end - cursor));
+            return newline != nullptr ? static_cast<const char*>(newline) + 1 : end;
+        }
+
+        //>The rest of the line without surrounding blanks
+        std::string ReadRestOfLine(const char* cursor, const char* end)
+        {
+            cursor = SkipBlanks(cursor, end);
+            const char* lineEnd = cursor;
+            while (lineEnd < end && *lineEnd != '\n')
+                ++lineEnd;
+            while (lineEnd > cursor && IsBlank(lineEnd[-1]))
+                --lineEnd;
+            return std::string(cursor, lineEnd);
+        }
+
+        //>keyword at cursor followed by a blank (or the end of the line)
+        inline bool MatchKeyword(const char* cursor, const char* end, const char* keyword)
+        {
+            const size_t length = strlen(keyword);
+            if (static_cast<size_t>(end - cursor) < length || memcmp(cursor, keyword, length) != 0)
+                return false;
+            return cursor + length == end || IsBlank(cursor[length]) || cursor[length] == '\n';
+        }
+
+        //>Decimal float without locale or allocation. Falls back to strtod for what the fast path cannot round exactly
+        //>(more than 19 significant digits, exponents past 1e22) and for inf/nan.
+        bool ParseFloat(const char*& cursor, const char* end, float& out)
+        {
+            cursor = SkipBlanks(cursor, end);
+            const char* start = cursor;
+            bool isNegative = false;
+            if (cursor < end && (*cursor == '-' || *cursor == '+'))
+            {
+                isNegative = *cursor == '-';
+                ++cursor;
+            }
+
+            uint64_t mantissa = 0;
+            int32_t exponent = 0;
+            uint32_t significantDigits = 0;
+            bool hasDigits = false;
+            bool isExact = true;
+            for (; cursor < end && IsDigit(*cursor); ++cursor)
+            {
+                hasDigits = true;
+                if (significantDigits < 19)
+                {
+                    mantissa = mantissa * 10 + static_cast<uint64_t>(*cursor - '0');
+                    significantDigits += mantissa != 0 ? 1 : 0;
+                }
+                else
+                {
+                    ++exponent;
+                    isExact = false;
+                }
+            }
+            if (cursor < end && *cursor == '.')
+            {
+                for (++cursor; cursor < end && IsDigit(*cursor); ++cursor)
+                {
+                    hasDigits = true;
+                    if (significantDigits < 19)
+                    {
+                        mantissa = mantissa * 10 + static_cast<uint64_t>(*cursor - '0');
+                        significantDigits += mantissa != 0 ? 1 : 0;
+                        --exponent;
+                    }
+                    else
+                    {
+                        isExact = false;
+                    }
+                }
+            }
+            if (hasDigits && cursor < end && (*cursor == 'e' || *cursor == 'E'))
+            {
+                const char* exponentStart = cursor++;
+                bool isExponentNegative = false;
+                if (cursor < end && (*cursor == '-' || *cursor == '+'))
+                    isExponentNegative = *cursor++ == '-';
+                if (cursor < end && IsDigit(*cursor))
+                {
+                    int32_t value = 0;
+                    for (; cursor < end && IsDigit(*cursor); ++cursor)
+                        value = (std::min)(value * 10 + (*cursor - '0'), 100000);
+                    exponent += isExponentNegative ? -value : value;
+                }
+                else
+                {
+                    cursor = exponentStart; //an 'e' without digits is not part of the number
+                }
+            }
+
+            if (hasDigits && isExact && mantissa < (1ull << 53) && exponent >= -22 && exponent <= 22)
+            {
+                double value = static_cast<double>(mantissa);
+                value = exponent < 0 ? value / PowersOf10[-exponent] : value * PowersOf10[exponent];
+                out = static_cast<float>(isNegative ? -value : value);
+                return true;
+            }
+
+            //the token up to the next blank, through the C runtime
+            const char* tokenEnd = start;
+            while (tokenEnd < end && !IsBlank(*tokenEnd) && *tokenEnd != '\n' && static_cast<uint32_t>(tokenEnd - start) < MaxFloatTokenLength)
+                ++tokenEnd;
+            char token[MaxFloatTokenLength + 1];
+            const size_t length = static_cast<size_t>(tokenEnd - start);
+            memcpy(token, start, length);
+            token[length] = '\0';
+            char* parsedEnd = nullptr;
+            const double value = strtod(token, &parsedEnd);
+            if (parsedEnd == token)
+                return false;
+            cursor = start + (parsedEnd - token);
+            out = static_cast<float>(value);
+            return true;
+        }
+
+        bool ParseInt(const char*& cursor, const char* end, int64_t& out)
+        {
+            bool isNegative = false;
+            if (cursor < end && (*cursor == '-' || *cursor == '+'))
+            {
+                isNegative = *cursor == '-';
+                ++cursor;
+            }
+            if (cursor >= end || !IsDigit(*cursor))
+                return false;
+            int64_t value = 0;
+            for (; cursor < end && IsDigit(*cursor); ++cursor)
+                value = (std::min)(value * 10 + (*cursor - '0'), static_cast<int64_t>(INT32_MAX));
+            out = isNegative ? -value : value;
+            return true;
+        }
+
+        inline uint64_t MixHash(uint64_t value)
+        {
+            //splitmix64 finalizer: every key bit reaches the low bits the table masks with
+            value ^= value >> 30;
+            value *= 0xBF58476D1CE4E5B9ull;
+            value ^= value >> 27;
+            value *= 0x94D049BB133111EBull;
+            return value ^ (value >> 31);
+        }
+
+        //>Open addressing with linear probing over plain-old-data keys compared bytewise; grows at half load
+        template<typename Key>
+        class WeldTable
+        {
+        public:
+            explicit WeldTable(size_t expectedCount)
+                :m_slots(),
+                m_count(0)
+            {
+                size_t capacity = 64;
+                while (capacity < expectedCount * 2)
+                    capacity <<= 1;
+                m_slots.resize(capacity);
+            }
+
+            //>The value already stored for key, or value after storing it
+            uint32_t FindOrInsert(const Key& key, uint32_t value, bool& outIsInserted)
+            {
+                if ((m_count + 1) * 2 > m_slots.size())
+                    Grow();
+                const size_t mask = m_slots.size() - 1;
+                for (size_t slot = key.GetHash() & mask; ; slot = (slot + 1) & mask)
+                {
+                    auto& entry = m_slots[slot];
+                    if (!entry.isUsed)
+                    {
+                        entry = { key, value, true };
+                        ++m_count;
+                        outIsInserted = true;
+                        return value;
+                    }
+                    if (memcmp(&entry.key, &key, sizeof(Key)) == 0)
+                    {
+                        outIsInserted = false;
+                        return entry.value;
+                    }
+                }
+            }
+
+        private:
+            struct Slot
+            {
+                Key key;
+                uint32_t value;
+                bool isUsed;
+            };
+
+            void Grow()
+            {
+                std::vector<Slot> previous(m_slots.size() * 2);
+                previous.swap(m_slots);
+                const size_t mask = m_slots.size() - 1;
+                for (const auto& entry : previous)
+                {
+                    if (!entry.isUsed)
+                        continue;
+                    size_t slot = entry.key.GetHash() & mask;
+                    while (m_slots[slot].isUsed)
+                        slot = (slot + 1) & mask;
+                    m_slots[slot] = entry;
+                }
+            }
+
+            std::vector<Slot> m_slots;
+            size_t m_count;
+        };
+
+        //>An OBJ corner: its position, texture coordinate and normal indices (-1 for none) in one material's mesh
+        struct ObjCornerKey
+        {
+            uint32_t material;
+            int32_t position;
+            int32_t texCoord;
+            int32_t normal;
+
+            inline uint64_t GetHash() const
+            {
+                return MixHash((static_cast<uint64_t>(material) << 32 | static_cast<uint32_t>(position)) ^
+                    MixHash(static_cast<uint64_t>(static_cast<uint32_t>(texCoord)) << 32 | static_cast<uint32_t>(normal)));
+            }
+        };
+        static_assert(sizeof(ObjCornerKey) == 16, "ObjCornerKey is compared bytewise");
+
+        //>A PLY vertex by value: exporters often write one per face corner
+        struct PlyVertexKey
+        {
+            float values[8]; //position, normal, uv
+
+            inline uint64_t GetHash() const
+            {
+                uint64_t hash = 0;
+                for (uint32_t itr = 0; itr < 8; itr += 2)
+                {
+                    uint64_t pair;
+                    memcpy(&pair, values + itr, sizeof(pair));
+                    hash = MixHash(hash ^ pair);
+                }
+                return hash;
+            }
+        };
+        static_assert(sizeof(PlyVertexKey) == 32, "PlyVertexKey is compared bytewise");
+
+        //>A position alone, to smooth generated normals across texture seams
+        struct PositionKey
+        {
+            float values[3];
+            uint32_t reserved; //zero; keeps the key free of padding
+
+            inline uint64_t GetHash() const
+            {
+                uint64_t xy;
+                memcpy(&xy, values, sizeof(xy));
+                uint32_t z;
+                memcpy(&z, values + 2, sizeof(z));
+                return MixHash(xy ^ MixHash(z));
+            }
+        };
+        static_assert(sizeof(PositionKey) == 16, "PositionKey is compared bytewise");
+
+        //>One material's welded vertices and local triangles while a file is read
+        struct MeshBuilder
+        {
+            std::vector<PositionVertex> vertices;
+            std::vector<uint32_t> positionIds; //per vertex: the source position, shared across seams for generated normals
+            std::vector<uint8_t> hasNormal;
+            std::vector<uint32_t> indices;     //local to vertices, counter-clockwise as in the file
+            bool hasTexCoords;
+        };
+
+        struct ParsedModel
+        {
+            std::vector<MeshBuilder> builders; //parallel to materials
+            std::vector<NativeMaterial> materials;
+            uint32_t positionCount; //range of MeshBuilder::positionIds
+        };
+
+        //>Appends the triangles of a polygon, fanned from its first corner
+        inline void AddPolygon(MeshBuilder& builder, const std::vector<uint32_t>& polygon)
+        {
+            for (size_t itr = 2; itr < polygon.size(); ++itr)
+            {
+                builder.indices.push_back(polygon[0]);
+                builder.indices.push_back(polygon[itr - 1]);
+                builder.indices.push_back(polygon[itr]);
+            }
+        }
+
+        //>Path of a map_* statement: its last token, after any -option values
+        std::string GetMtlTexturePath(const std::string& arguments)
+        {
+            const size_t start = arguments.find_last_of(" \t");
+            return start == std::string::npos ? arguments : arguments.substr(start + 1);
+        }
+
+        //>Materials of a .mtl file in declaration order; texture statements map to the slots assimp's OBJ importer fills
+        void ParseMtl(const std::string& mtlPath, AssetSource source, ParsedModel& model, std::unordered_map<std::string, uint32_t>& materialByName,
+            NativeLoadStats& stats)
+        {
+            AssetFile file;
+            if (!file.Open(mtlPath, source))
+            {
+                Logger::GetInstance().LogInfo(("[NativeLoad] material library not found, using default textures: " + mtlPath).c_str());
+                return;
+            }
+            stats.sourceBytes += file.GetSize();
+
+            const char* cursor = reinterpret_cast<const char*>(file.GetData());
+            const char* end = cursor + file.GetSize();
+            NativeMaterial* current = nullptr;
+            for (; cursor < end; cursor = SkipLine(cursor, end))
+            {
+                cursor = SkipBlanks(cursor, end);
+                if (MatchKeyword(cursor, end, "newmtl"))
+                {
+                    const std::string name = ReadRestOfLine(cursor + 6, end);
+                    if (materialByName.count(name) == 0)
+                    {
+                        materialByName.emplace(name, static_cast<uint32_t>(model.materials.size()));
+                        model.materials.push_back({ name, {} });
+                        model.builders.emplace_back();
+                    }
+                    current = &model.materials[materialByName[name]];
+                    continue;
+                }
+                if (current == nullptr)
+                    continue;
+
+                Material::TextureType type;
+                size_t keywordLength;
+                if (MatchKeyword(cursor, end, "map_Kd"))
+                {
+                    type = Material::TextureType::Diffuse;
+                    keywordLength = 6;
+                }
+                else if (MatchKeyword(cursor, end, "map_bump") || MatchKeyword(cursor, end, "map_Bump"))
+                {
+                    type = Material::TextureType::Normal;
+                    keywordLength = 8;
+                }
+                else if (MatchKeyword(cursor, end, "bump"))
+                {
+                    type = Material::TextureType::Normal;
+                    keywordLength = 4;
+                }
+                else if (MatchKeyword(cursor, end, "map_Ns"))
+                {
+                    type = Material::TextureType::Specular;
+                    keywordLength = 6;
+                }
+                else if (MatchKeyword(cursor, end, "map_d"))
+                {
+                    type = Material::TextureType::Opacity;
+                    keywordLength = 5;
+                }
+                else
+                {
+                    continue;
+                }
+                current->texturePaths[static_cast<uint32_t>(type)] = GetMtlTexturePath(ReadRestOfLine(cursor + keywordLength, end));
+            }
+        }
+
+        //>Resolves a 1-based (or negative, relative) OBJ index against count; false when out of range
+        inline bool ResolveObjIndex(int64_t index, size_t count, int32_t& out)
+        {
+            const int64_t resolved = index < 0 ? static_cast<int64_t>(count) + index : index - 1;
+            if (resolved < 0 || resolved >= static_cast<int64_t>(count))
+                return false;
+            out = static_cast<int32_t>(resolved);
+            return true;
+        }
+
+        bool ParseObj(const std::string& filePath, const uint8_t* data, size_t size, AssetSource source, ParsedModel& model, NativeLoadStats& stats)
+        {
+            //one element per ~30 bytes is about what exporters write; the arrays grow past it when needed
+            std::vector<float> positions;
+            std::vector<float> texCoords;
+            std::vector<float> normals;
+            positions.reserve(size / 30 * 3);
+            normals.reserve(size / 30 * 3);
+            texCoords.reserve(size / 30 * 2);
+            WeldTable<ObjCornerKey> corners(size / 30);
+            std::unordered_map<std::string, uint32_t> materialByName;
+            std::vector<uint32_t> polygon;
+            uint32_t currentMaterial = NoMaterial;
+            const std::string fileDir = filePath.substr(0, filePath.find_last_of("/\\") + 1);
+
+            const char* cursor = reinterpret_cast<const char*>(data);
+            const char* end = cursor + size;
+            uint32_t line = 0;
+            for (; cursor < end; cursor = SkipLine(cursor, end))
+            {
+                ++line;
+                cursor = SkipBlanks(cursor, end);
+                if (cursor >= end)
+                    break;
+
+                if (cursor[0] == 'v' && cursor + 1 < end && IsBlank(cursor[1]))
+                {
+                    ++cursor;
+                    float x, y, z;
+                    if (!ParseFloat(cursor, end, x) || !ParseFloat(cursor, end, y) || !ParseFloat(cursor, end, z))
+                        break;
+                    positions.insert(positions.end(), { x, y, z }); //a w or vertex colour after it is ignored
+                }
+                else if (MatchKeyword(cursor, end, "vt"))
+                {
+                    cursor += 2;
+                    float u = 0.0f;
+                    float v = 0.0f;
+                    if (!ParseFloat(cursor, end, u))
+                        break;
+                    const char* afterU = cursor;
+                    if (!ParseFloat(cursor, end, v))
+                        cursor = afterU; //1D texture coordinates have no v
+                    texCoords.insert(texCoords.end(), { u, v });
+                }
+                else if (MatchKeyword(cursor, end, "vn"))
+                {
+                    cursor += 2;
+                    float x, y, z;
+                    if (!ParseFloat(cursor, end, x) || !ParseFloat(cursor, end, y) || !ParseFloat(cursor, end, z))
+                        break;
+                    normals.insert(normals.end(), { x, y, z });
+                }
+                else if (cursor[0] == 'f' && cursor + 1 < end && IsBlank(cursor[1]))
+                {
+                    if (currentMaterial == NoMaterial)
+                    {
+                        //faces before any usemtl, as assimp names them
+                        auto inserted = materialByName.emplace("DefaultMaterial", static_cast<uint32_t>(model.materials.size()));
+                        if (inserted.second)
+                        {
+                            model.materials.push_back({ "DefaultMaterial", {} });
+                            model.builders.emplace_back();
+                        }
+                        currentMaterial = inserted.first->second;
+                    }
+                    auto& builder = model.builders[currentMaterial];
+
+                    ++cursor;
+                    polygon.clear();
+                    while (true)
+                    {
+                        cursor = SkipBlanks(cursor, end);
+                        if (cursor >= end || *cursor == '\n' || *cursor == '#')
+                            break;
+
+                        ObjCornerKey key = { currentMaterial, -1, -1, -1 };
+                        int64_t index;
+                        if (!ParseInt(cursor, end, index) || !ResolveObjIndex(index, positions.size() / 3, key.position))
+                            break;
+                        if (cursor < end && *cursor == '/')
+                        {
+                            ++cursor;
+                            if (cursor < end && *cursor != '/' && (!ParseInt(cursor, end, index) || !ResolveObjIndex(index, texCoords.size() / 2, key.texCoord)))
+                                break;
+                            if (cursor < end && *cursor == '/')
+                            {
+                                ++cursor;
+                                if (!ParseInt(cursor, end, index) || !ResolveObjIndex(index, normals.size() / 3, key.normal))
+                                    break;
+                            }
+                        }
+                        ++stats.corners;
+
+                        bool isInserted;
+                        const uint32_t vertexIndex = corners.FindOrInsert(key, static_cast<uint32_t>(builder.vertices.size()), isInserted);
+                        if (isInserted)
+                        {
+                            const float* position = &positions[key.position * 3];
+                            PositionVertex vertex(position[0], position[1], position[2], 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+                            if (key.normal >= 0)
+                            {
+                                vertex.m_nx = normals[key.normal * 3];
+                                vertex.m_ny = normals[key.normal * 3 + 1];
+                                vertex.m_nz = normals[key.normal * 3 + 2];
+                            }
+                            if (key.texCoord >= 0)
+                            {
+                                vertex.m_tx = texCoords[key.texCoord * 2];
+                                vertex.m_ty = texCoords[key.texCoord * 2 + 1];
+                                builder.hasTexCoords = true;
+                            }
+                            builder.vertices.push_back(vertex);
+                            builder.positionIds.push_back(static_cast<uint32_t>(key.position));
+                            builder.hasNormal.push_back(key.normal >= 0 ? 1 : 0);
+                        }
+                        polygon.push_back(vertexIndex);
+                    }
+                    if (cursor < end && *cursor != '\n' && *cursor != '#')
+                    {
+                        Logger::GetInstance().LogInfo(("[NativeLoad] malformed face at line " + std::to_string(line) + " of " + filePath).c_str());
+                        return false;
+                    }
+                    AddPolygon(builder, polygon);
+                    continue;
+                }
+                else if (MatchKeyword(cursor, end, "usemtl"))
+                {
+                    const std::string name = ReadRestOfLine(cursor + 6, end);
+                    auto inserted = materialByName.emplace(name, static_cast<uint32_t>(model.materials.size()));
+                    if (inserted.second)
+                    {
+                        model.materials.push_back({ name, {} }); //not in the library: default textures
+                        model.builders.emplace_back();
+                    }
+                    currentMaterial = inserted.first->second;
+                }
+                else if (MatchKeyword(cursor, end, "mtllib"))
+                {
+                    ParseMtl(fileDir + ReadRestOfLine(cursor + 6, end), source, model, materialByName, stats);
+                }
+                //o, g, s, l, p and comments carry nothing the renderer keeps
+                continue;
+            }
+            if (cursor < end)
+            {
+                Logger::GetInstance().LogInfo(("[NativeLoad] malformed vertex data at line " + std::to_string(line) + " of " + filePath).c_str());
+                return false;
+            }
+            model.positionCount = static_cast<uint32_t>(positions.size() / 3);
+            return true;
+        }
+
+        enum class PlyType : uint8_t
+        {
+            Invalid,
+            Int8,
+            UInt8,
+            Int16,
+            UInt16,
+            Int32,
+            UInt32,
+            Float32,
+            Float64
+        };
+
+        PlyType ParsePlyType(const std::string& name)
+        {
+            if (name == "char" || name == "int8") return PlyType::Int8;
+            if (name == "uchar" || name == "uint8") return PlyType::UInt8;
+            if (name == "short" || name == "int16") return PlyType::Int16;
+            if (name == "ushort" || name == "uint16") return PlyType::UInt16;
+            if (name == "int" || name == "int32") return PlyType::Int32;
+            if (name == "uint" || name == "uint32") return PlyType::UInt32;
+            if (name == "float" || name == "float32") return PlyType::Float32;
+            if (name == "double" || name == "float64") return PlyType::Float64;
+            return PlyType::Invalid;
+        }
+
+        inline size_t GetPlyTypeSize(PlyType type)
+        {
+            switch (type)
+            {
+            case PlyType::Int8: case PlyType::UInt8: return 1;
+            case PlyType::Int16: case PlyType::UInt16: return 2;
+            case PlyType::Int32: case PlyType::UInt32: case PlyType::Float32: return 4;
+            case PlyType::Float64: return 8;
+            default: return 0;
+            }
+        }
+
+        struct PlyProperty
+        {
+            std::string name;
+            PlyType type;      //of the value, or of each list item
+            PlyType countType; //Invalid unless a list
+        };
+
+        struct PlyElement
+        {
+            std::string name;
+            uint64_t count;
+            std::vector<PlyProperty> properties;
+        };
+
+        //>One value as a double; the caller checked that its bytes are inside the file
+        inline double ReadPlyValue(const uint8_t* bytes, PlyType type, bool isByteSwapped)
+        {
+            uint8_t value[8];
+            const size_t size = GetPlyTypeSize(type);
+            if (isByteSwapped)
+            {
+                for (size_t itr = 0; itr < size; ++itr)
+                    value[itr] = bytes[size - 1 - itr];
+            }
+            else
+            {
+                memcpy(value, bytes, size);
+            }
+
+            switch (type)
+            {
+            case PlyType::Int8: return static_cast<int8_t>(value[0]);
+            case PlyType::UInt8: return value[0];
+            case PlyType::Int16: { int16_t result; memcpy(&result, value, 2); return result; }
+            case PlyType::UInt16: { uint16_t result; memcpy(&result, value, 2); return result; }
+            case PlyType::Int32: { int32_t result; memcpy(&result, value, 4); return result; }
+            case PlyType::UInt32: { uint32_t result; memcpy(&result, value, 4); return result; }
+            case PlyType::Float32: { float result; memcpy(&result, value, 4); return result; }
+            case PlyType::Float64: { double result; memcpy(&result, value, 8); return result; }
+            default: return 0.0;
+            }
+        }
+
+        //>Header up to end_header; outBodyOffset is where the binary data starts
+        bool ParsePlyHeader(const uint8_t* data, size_t size, std::vector<PlyElement>& outElements, bool& outIsByteSwapped, size_t& outBodyOffset,
+            std::string& outError)
+        {
+            const char* cursor = reinterpret_cast<const char*>(data);
+            const char* end = cursor + size;
+            bool hasFormat = false;
+            bool isFirstLine = true;
+            while (cursor < end)
+            {
+                const char* lineEnd = static_cast<const char*>(memchr(cursor, '\n', static_cast<size_t>(end - cursor)));
+                if (lineEnd == nullptr)
+                    break;
+                std::istringstream line(std::string(cursor, lineEnd));
+                cursor = lineEnd + 1;
+                std::string keyword;
+                line >> keyword;
+                if (isFirstLine)
+                {
+                    if (keyword != "ply")
+                    {
+                        outError = "not a PLY file";
+                        return false;
+                    }
+                    isFirstLine = false;
+                    continue;
+                }
+
+                if (keyword == "format")
+                {
+                    std::string format;
+                    line >> format;
+                    //the native loader is for the binary files large scans come as; ASCII ones are left to assimp
+                    if (format != "binary_little_endian" && format != "binary_big_endian")
+                    {
+                        outError = "format " + format + " is left to assimp";
+                        return false;
+                    }
+                    outIsByteSwapped = format == "binary_big_endian"; //every target this renderer runs on is little endian
+                    hasFormat = true;
+                }
+                else if (keyword == "element")
+                {
+                    PlyElement element;
+                    line >> element.name >> element.count;
+                    if (line.fail())
+                    {
+                        outError = "malformed element";
+                        return false;
+                    }
+                    outElements.emplace_back(std::move(element));
+                }
+                else if (keyword == "property")
+                {
+                    if (outElements.empty())
+                    {
+                        outError = "property outside of an element";
+                        return false;
+                    }
+                    std::string typeName;
+                    line >> typeName;
+                    PlyProperty property = { "", PlyType::Invalid, PlyType::Invalid };
+                    if (typeName == "list")
+                    {
+                        std::string countTypeName;
+                        line >> countTypeName >> typeName;
+                        property.countType = ParsePlyType(countTypeName);
+                        if (property.countType == PlyType::Invalid || property.countType == PlyType::Float32 || property.countType == PlyType::Float64)
+                        {
+                            outError = "bad list count type " + countTypeName;
+                            return false;
+                        }
+                    }
+                    property.type = ParsePlyType(typeName);
+                    line >> property.name;
+                    if (property.type == PlyType::Invalid || line.fail())
+                    {
+                        outError = "bad property type " + typeName;
+                        return false;
+                    }
+                    outElements.back().properties.emplace_back(std::move(property));
+                }
+                else if (keyword == "end_header")
+                {
+                    outBodyOffset = static_cast<size_t>(cursor - reinterpret_cast<const char*>(data));
+                    if (!hasFormat)
+                        outError = "no format line";
+                    return hasFormat;
+                }
+                //comment and obj_info lines are skipped
+            }
+            outError = "no end_header";
+            return false;
+        }
+
+        //>Bytes of one entry of an element without lists; 0 when it has one
+        size_t GetPlyFixedStride(const PlyElement& element)
+        {
+            size_t stride = 0;
+            for (const auto& property : element.properties)
+            {
+                if (property.countType != PlyType::Invalid)
+                    return 0;
+                stride += GetPlyTypeSize(property.type);
+            }
+            return stride;
+        }
+
+        bool ParsePly(const std::string& filePath, const uint8_t* data, size_t size, ParsedModel& model, NativeLoadStats& stats)
+        {
+            std::vector<PlyElement> elements;
+            bool isByteSwapped = false;
+            size_t offset = 0;
+            std::string error;
+            if (!ParsePlyHeader(data, size, elements, isByteSwapped, offset, error))
+            {
+                Logger::GetInstance().LogInfo(("[NativeLoad] " + filePath + ": " + error).c_str());
+                return false;
+            }
+
+            model.materials.push_back({ "DefaultMaterial", {} }); //PLY carries no materials
+            model.builders.emplace_back();
+            auto& builder = model.builders[0];
+            std::vector<uint32_t> weldedIndex; //file vertex -> welded vertex
+            std::vector<uint32_t> polygon;
+            bool hasVertices = false;
+
+            auto fail = [&filePath](const char* reason)
+            {
+                Logger::GetInstance().LogInfo(("[NativeLoad] " + filePath + ": " + reason).c_str());
+                return false;
+            };
+
+            for (const auto& element : elements)
+            {
+                const size_t stride = GetPlyFixedStride(element);
+                if (element.name == "vertex")
+                {
+                    if (stride == 0)
+                        return fail("list properties on vertices");
+                    if (element.count > UINT32_MAX || element.count * stride > size - offset)
+                        return fail("vertex data past the end of the file");
+
+                    //byte offset of each attribute inside an entry; SIZE_MAX for the ones the file does not have
+                    enum Attribute { X, Y, Z, NX, NY, NZ, U, V, AttributeCount };
+                    size_t attributeOffsets[AttributeCount];
+                    PlyType attributeTypes[AttributeCount];
+                    std::fill(std::begin(attributeOffsets), std::end(attributeOffsets), SIZE_MAX);
+                    static const char* const names[AttributeCount][3] =
+                    {
+                        { "x", "x", "x" }, { "y", "y", "y" }, { "z", "z", "z" },
+                        { "nx", "nx", "nx" }, { "ny", "ny", "ny" }, { "nz", "nz", "nz" },
+                        { "u", "s", "texture_u" }, { "v", "t", "texture_v" }
+                    };
+                    size_t propertyOffset = 0;
+                    for (const auto& property : element.properties)
+                    {
+                        for (uint32_t attribute = 0; attribute < AttributeCount; ++attribute)
+                        {
+                            if (property.name == names[attribute][0] || property.name == names[attribute][1] || property.name == names[attribute][2])
+                            {
+                                attributeOffsets[attribute] = propertyOffset;
+                                attributeTypes[attribute] = property.type;
+                            }
+                        }
+                        propertyOffset += GetPlyTypeSize(property.type);
+                    }
+                    if (attributeOffsets[X] == SIZE_MAX || attributeOffsets[Y] == SIZE_MAX || attributeOffsets[Z] == SIZE_MAX)
+                        return fail("vertices without x, y, z");
+                    const bool hasNormals = attributeOffsets[NX] != SIZE_MAX && attributeOffsets[NY] != SIZE_MAX && attributeOffsets[NZ] != SIZE_MAX;
+                    builder.hasTexCoords = attributeOffsets[U] != SIZE_MAX && attributeOffsets[V] != SIZE_MAX;
+
+                    const auto count = static_cast<uint32_t>(element.count);
+                    weldedIndex.resize(count);
+                    WeldTable<PlyVertexKey> vertices(count);
+                    WeldTable<PositionKey> positions(hasNormals ? 0 : count);
+                    builder.vertices.reserve(count);
+                    for (uint32_t itr = 0; itr < count; ++itr)
+                    {
+                        const uint8_t* entry = data + offset + itr * stride;
+                        PlyVertexKey key = {};
+                        for (uint32_t attribute = 0; attribute < AttributeCount; ++attribute)
+                        {
+                            if (attributeOffsets[attribute] != SIZE_MAX)
+                                key.values[attribute] = static_cast<float>(ReadPlyValue(entry + attributeOffsets[attribute], attributeTypes[attribute], isByteSwapped));
+                        }
+
+                        bool isInserted;
+                        weldedIndex[itr] = vertices.FindOrInsert(key, static_cast<uint32_t>(builder.vertices.size()), isInserted);
+                        if (!isInserted)
+                            continue;
+                        const float* values = key.values;
+                        builder.vertices.emplace_back(values[X], values[Y], values[Z], values[NX], values[NY], values[NZ], values[U], values[V],
+                            0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f); //tangents are summed into later
+                        builder.hasNormal.push_back(hasNormals ? 1 : 0);
+                        uint32_t positionId = itr;
+                        if (!hasNormals)
+                        {
+                            const PositionKey position = { { values[X], values[Y], values[Z] }, 0 };
+                            positionId = positions.FindOrInsert(position, itr, isInserted);
+                        }
+                        builder.positionIds.push_back(positionId);
+                    }
+                    model.positionCount = count;
+                    hasVertices = true;
+                    offset += static_cast<size_t>(element.count) * stride;
+                    continue;
+                }
+
+                if (element.name == "face")
+                {
+                    if (!hasVertices)
+                        return fail("faces before the vertices");
+                    for (uint64_t itr = 0; itr < element.count; ++itr)
+                    {
+                        for (const auto& property : element.properties)
+                        {
+                            const size_t itemSize = GetPlyTypeSize(property.type);
+                            if (property.countType == PlyType::Invalid)
+                            {
+                                if (itemSize > size - offset)
+                                    return fail("face data past the end of the file");
+                                offset += itemSize;
+                                continue;
+                            }
+
+                            const size_t countSize = GetPlyTypeSize(property.countType);
+                            if (countSize > size - offset)
+                                return fail("face data past the end of the file");
+                            const auto itemCount = static_cast<size_t>(ReadPlyValue(data + offset, property.countType, isByteSwapped));
+                            offset += countSize;
+                            if (itemCount * itemSize > size - offset)
+                                return fail("face data past the end of the file");
+                            if (property.name != "vertex_indices" && property.name != "vertex_index")
+                            {
+                                offset += itemCount * itemSize;
+                                continue;
+                            }
+
+                            polygon.clear();
+                            for (size_t corner = 0; corner < itemCount; ++corner, offset += itemSize)
+                            {
+                                const double index = ReadPlyValue(data + offset, property.type, isByteSwapped);
+                                if (index < 0.0 || index >= static_cast<double>(weldedIndex.size()))
+                                    return fail("face index out of range");
+                                polygon.push_back(weldedIndex[static_cast<size_t>(index)]);
+                            }
+                            stats.corners += itemCount;
+                            AddPolygon(builder, polygon);
+                        }
+                    }
+                    continue;
+                }
+
+                //edges, materials and whatever else a scanner adds
+                if (stride > 0)
+                {
+                    if (element.count * stride > size - offset)
+                        return fail("data past the end of the file");
+                    offset += static_cast<size_t>(element.count) * stride;
+                    continue;
+                }
+                for (uint64_t itr = 0; itr < element.count; ++itr)
+                {
+                    for (const auto& property : element.properties)
+                    {
+                        size_t bytes = GetPlyTypeSize(property.type);
+                        if (property.countType != PlyType::Invalid)
+                        {
+                            const size_t countSize = GetPlyTypeSize(property.countType);
+                            if (countSize > size - offset)
+                                return fail("data past the end of the file");
+                            bytes = static_cast<size_t>(ReadPlyValue(data + offset, property.countType, isByteSwapped)) * bytes;
+                            offset += countSize;
+                        }
+                        if (bytes > size - offset)
+                            return fail("data past the end of the file");
+                        offset += bytes;
+                    }
+                }
+            }
+            return hasVertices;
+        }
+
+        //>Area-weighted face normals summed per source position, for the vertices the file gave none. Runs on the file's
+        //>counter-clockwise faces before the handedness conversion, like assimp's GenSmoothNormals would.
+        void GenerateNormals(MeshBuilder& builder, std::vector<D3DXVECTOR3>& positionNormals)
+        {
+            const D3DXVECTOR3 zero(0.0f, 0.0f, 0.0f);
+            for (size_t itr = 0; itr + 2 < builder.indices.size(); itr += 3)
+            {
+                const auto& a = builder.vertices[builder.indices[itr]];
+                const auto& b = builder.vertices[builder.indices[itr + 1]];
+                const auto& c = builder.vertices[builder.indices[itr + 2]];
+                const D3DXVECTOR3 edge0(b.m_vx - a.m_vx, b.m_vy - a.m_vy, b.m_vz - a.m_vz);
+                const D3DXVECTOR3 edge1(c.m_vx - a.m_vx, c.m_vy - a.m_vy, c.m_vz - a.m_vz);
+                D3DXVECTOR3 normal;
+                D3DXVec3Cross(&normal, &edge0, &edge1);
+                for (uint32_t corner = 0; corner < 3; ++corner)
+                    positionNormals[builder.positionIds[builder.indices[itr + corner]]] += normal;
+            }
+            for (size_t itr = 0; itr < builder.vertices.size(); ++itr)
+            {
+                if (builder.hasNormal[itr])
+                    continue;
+                D3DXVECTOR3 normal = positionNormals[builder.positionIds[itr]];
+                if (D3DXVec3Length(&normal) <= 1e-20f)
+                    normal = D3DXVECTOR3(0.0f, 1.0f, 0.0f); //only degenerate faces touch it
+                D3DXVec3Normalize(&normal, &normal);
+                auto& vertex = builder.vertices[itr];
+                vertex.m_nx = normal.x;
+                vertex.m_ny = normal.y;
+                vertex.m_nz = normal.z;
+            }
+            //back to zero for the next builder; only the touched entries
+            for (const auto positionId : builder.positionIds)
+                positionNormals[positionId] = zero;
+        }
+
+        //>aiProcess_ConvertToLeftHanded: z negated, v flipped, faces turned clockwise
+        void ConvertToLeftHanded(MeshBuilder& builder)
+        {
+            for (auto& vertex : builder.vertices)
+            {
+                vertex.m_vz = -vertex.m_vz;
+                vertex.m_nz = -vertex.m_nz;
+                if (builder.hasTexCoords)
+                    vertex.m_ty = 1.0f - vertex.m_ty; //meshes without uvs keep the zeros extraction writes
+            }
+            for (size_t itr = 0; itr + 2 < builder.indices.size(); itr += 3)
+                std::swap(builder.indices[itr + 1], builder.indices[itr + 2]);
+        }
+
+        //>Per-face tangent and bitangent as assimp's CalcTangentSpace forms them, summed per vertex and made orthogonal to its normal
+        void ComputeTangents(MeshBuilder& builder)
+        {
+            for (size_t itr = 0; itr + 2 < builder.indices.size(); itr += 3)
+            {
+                auto& v0 = builder.vertices[builder.indices[itr]];
+                auto& v1 = builder.vertices[builder.indices[itr + 1]];
+                auto& v2 = builder.vertices[builder.indices[itr + 2]];
+                const D3DXVECTOR3 edge0(v1.m_vx - v0.m_vx, v1.m_vy - v0.m_vy, v1.m_vz - v0.m_vz);
+                const D3DXVECTOR3 edge1(v2.m_vx - v0.m_vx, v2.m_vy - v0.m_vy, v2.m_vz - v0.m_vz);
+                float sx = v1.m_tx - v0.m_tx;
+                float sy = v1.m_ty - v0.m_ty;
+                float tx = v2.m_tx - v0.m_tx;
+                float ty = v2.m_ty - v0.m_ty;
+                const float dirCorrection = (tx * sy - ty * sx) < 0.0f ? -1.0f : 1.0f;
+                if (sx * ty == sy * tx)
+                {
+                    //no uv area: any frame in the plane will do
+                    sx = 0.0f;
+                    sy = 1.0f;
+                    tx = 1.0f;
+                    ty = 0.0f;
+                }
+                const D3DXVECTOR3 tangent = (edge1 * sy - edge0 * ty) * dirCorrection;
+                const D3DXVECTOR3 biTangent = (edge1 * sx - edge0 * tx) * dirCorrection;
+                for (PositionVertex* vertex : { &v0, &v1, &v2 })
+                {
+                    vertex->m_tangx += tangent.x;
+                    vertex->m_tangy += tangent.y;
+                    vertex->m_tangz += tangent.z;
+                    vertex->m_biTangx += biTangent.x;
+                    vertex->m_biTangy += biTangent.y;
+                    vertex->m_biTangz += biTangent.z;
+                }
+            }
+
+            for (auto& vertex : builder.vertices)
+            {
+                const D3DXVECTOR3 normal(vertex.m_nx, vertex.m_ny, vertex.m_nz);
+                auto orthogonalize = [&normal](float& x, float& y, float& z)
+                {
+                    D3DXVECTOR3 axis(x, y, z);
+                    axis -= normal * D3DXVec3Dot(&normal, &axis);
+                    if (D3DXVec3Length(&axis) > 1e-20f)
+                        D3DXVec3Normalize(&axis, &axis);
+                    x = axis.x;
+                    y = axis.y;
+                    z = axis.z;
+                };
+                orthogonalize(vertex.m_tangx, vertex.m_tangy, vertex.m_tangz);
+                orthogonalize(vertex.m_biTangx, vertex.m_biTangy, vertex.m_biTangz);
+            }
+        }
+
+        //>Finishes every used builder into outModel; unused materials are dropped and the rest renumbered in order
+        void BuildModel(ParsedModel& parsed, bool computeTangents, NativeModel& outModel, NativeLoadStats& stats)
+        {
+            size_t vertexCount = 0;
+            size_t indexCount = 0;
+            for (const auto& builder : parsed.builders)
+            {
+                if (builder.indices.empty())
+                    continue;
+                vertexCount += builder.vertices.size();
+                indexCount += builder.indices.size();
+            }
+            outModel.vertices.reserve(vertexCount);
+            outModel.indices.reserve(indexCount);
+
+            std::vector<D3DXVECTOR3> positionNormals;
+            for (size_t material = 0; material < parsed.builders.size(); ++material)
+            {
+                auto& builder = parsed.builders[material];
+                if (builder.indices.empty())
+                    continue;
+
+                const auto missingNormals = static_cast<uint32_t>(std::count(builder.hasNormal.begin(), builder.hasNormal.end(), static_cast<uint8_t>(0)));
+                if (missingNormals > 0)
+                {
+                    positionNormals.resize(parsed.positionCount, D3DXVECTOR3(0.0f, 0.0f, 0.0f));
+                    GenerateNormals(builder, positionNormals);
+                    stats.generatedNormals += missingNormals;
+                }
+                ConvertToLeftHanded(builder);
+                if (computeTangents && builder.hasTexCoords)
+                    ComputeTangents(builder); //assimp leaves meshes without uvs without tangents too
+
+                NativeMesh mesh;
+                mesh.name = parsed.materials[material].name;
+                mesh.materialIndex = static_cast<uint32_t>(outModel.materials.size());
+                mesh.vertexOffset = static_cast<uint32_t>(outModel.vertices.size());
+                mesh.vertexCount = static_cast<uint32_t>(builder.vertices.size());
+                mesh.indexOffset = static_cast<uint32_t>(outModel.indices.size());
+                mesh.indexCount = static_cast<uint32_t>(builder.indices.size());
+                outModel.vertices.insert(outModel.vertices.end(), builder.vertices.begin(), builder.vertices.end());
+                for (const auto index : builder.indices)
+                    outModel.indices.push_back(index + mesh.vertexOffset);
+                outModel.meshes.emplace_back(std::move(mesh));
+                outModel.materials.emplace_back(std::move(parsed.materials[material]));
+
+                //the builder's storage goes as soon as it is copied out
+                builder = MeshBuilder();
+            }
+            stats.vertices = static_cast<uint32_t>(outModel.vertices.size());
+            stats.triangles = static_cast<uint32_t>(outModel.indices.size() / 3);
+        }
+    }
+
+    NativeFormat GetNativeFormat(const std::string& filePath)
+    {
+        const size_t dot = filePath.find_last_of('.');
+        if (dot == std::string::npos)
+            return NativeFormat::None;
+        std::string extension = filePath.substr(dot + 1);
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+        if (extension == "obj")
+            return NativeFormat::Obj;
+        if (extension == "ply")
+            return NativeFormat::Ply;
+        return NativeFormat::None;
+    }
+
+    const char* GetNativeFormatName(NativeFormat format)
+    {
+        switch (format)
+        {
+        case NativeFormat::Obj:
+            return "obj";
+        case NativeFormat::Ply:
+            return "ply";
+        case NativeFormat::None:
+        default:
+            return "none";
+        }
+    }
+
+    bool LoadNativeModel(const std::string& filePath, AssetSource source, bool computeTangents, NativeModel& outModel, NativeLoadStats& outStats)
+    {
+        outStats = NativeLoadStats();
+        outStats.format = GetNativeFormat(filePath);
+        if (outStats.format == NativeFormat::None)
+            return false;
+
+        Stopwatch stopwatch;
+        AssetFile file;
+        if (!file.Open(filePath, source))
+            return false;
+        outStats.sourceBytes = file.GetSize();
+
+        ParsedModel parsed;
+        parsed.positionCount = 0;
+        const bool isParsed = outStats.format == NativeFormat::Obj ?
+            ParseObj(filePath, file.GetData(), file.GetSize(), source, parsed, outStats) :
+            ParsePly(filePath, file.GetData(), file.GetSize(), parsed, outStats);
+        file.Close();
+        outStats.parseMs = stopwatch.GetElapsedMs();
+        if (!isParsed)
+            return false;
+
+        stopwatch.Restart();
+        outModel = NativeModel();
+        BuildModel(parsed, computeTangents, outModel, outStats);
+        outStats.buildMs = stopwatch.GetElapsedMs();
+        if (outModel.meshes.empty())
+        {
+            Logger::GetInstance().LogInfo(("[NativeLoad] no triangles in " + filePath).c_str());
+            return false;
+        }
+        return true;
+    }
+
+#ifdef RENDERER_BENCHMARKS
+    void LogNativeImportComparison(const std::string& filePath, uint32_t importFlags, const NativeLoadStats& nativeStats)
+    {
+        //the same file and post-processing through assimp, read from memory like the native path
+        Assimp::Importer importer;
+        importer.SetIOHandler(new MappedIOSystem());
+        Stopwatch stopwatch;
+        const bool isImported = importer.ReadFile(filePath, importFlags) != nullptr;
+        const double assimpMs = stopwatch.GetElapsedMs();
+
+        const double sourceMB = BytesToMB(nativeStats.sourceBytes);
+        const double nativeMs = nativeStats.parseMs + nativeStats.buildMs;
+        std::ostringstream os;
+        os << std::fixed << std::setprecision(2);
+        os << "[NativeLoad] " << filePath << ", " << sourceMB << " MB\n";
+        os << "    native " << GetNativeFormatName(nativeStats.format) << ": " << nativeMs << " ms (parse " << nativeStats.parseMs << " ms, ";
+        os << nativeStats.GetParseMBPerSecond() << " MB/s) | assimp: ";
+        if (isImported)
+            os << assimpMs << " ms (" << sourceMB / (assimpMs / 1000.0) << " MB/s) | speedup: " << assimpMs / (std::max)(nativeMs, 1e-6) << "x\n";
+        else
+            os << "failed: " << importer.GetErrorString() << "\n";
+        Logger::GetInstance().LogInfo(os.str().c_str());
+    }
+#endif
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Material.h"
+#include "d3d9/VertexDefs.h"
+#include "../utils/AssetFile.h"
+
+namespace renderer
+{
+    //>Model formats read by the native loader instead of assimp
+    enum class NativeFormat
+    {
+        None,
+        Obj,
+        Ply //binary, either byte order; ASCII files are left to assimp
+    };
+
+    //>Picked by the file extension
+    [[nodiscard]] NativeFormat GetNativeFormat(const std::string& filePath);
+    [[nodiscard]] const char* GetNativeFormatName(NativeFormat format);
+
+    //>Texture files of one material relative to the model's directory; an empty path takes the default texture
+    struct NativeMaterial
+    {
+        std::string name;
+        std::array<std::string, Material::TextureTypeCount> texturePaths;
+    };
+
+    //>One material's triangles: ranges of NativeModel's vertices and indices, the indices absolute like Mesh::GetIndexOffset's
+    struct NativeMesh
+    {
+        std::string name;
+        uint32_t materialIndex;
+        uint32_t vertexOffset;
+        uint32_t vertexCount;
+        uint32_t indexOffset;
+        uint32_t indexCount;
+    };
+
+    //>The layout Model's extraction writes, converted like an aiProcess_ConvertToLeftHanded import: z negated, v flipped
+    //>and faces clockwise. Meshes are in material order and every material is used by one of them.
+    struct NativeModel
+    {
+        std::vector<PositionVertex> vertices;
+        std::vector<uint32_t> indices;
+        std::vector<NativeMesh> meshes;
+        std::vector<NativeMaterial> materials;
+    };
+
+    struct NativeLoadStats
+    {
+        NativeLoadStats()
+            :format(NativeFormat::None),
+            sourceBytes(0),
+            parseMs(0.0),
+            buildMs(0.0),
+            corners(0),
+            vertices(0),
+            triangles(0),
+            generatedNormals(0)
+        {}
+
+        //>Source megabytes per second of parsing and welding
+        inline double GetParseMBPerSecond() const { return parseMs > 0.0 ? static_cast<double>(sourceBytes) / (1024.0 * 1024.0) / (parseMs / 1000.0) : 0.0; }
+
+        NativeFormat format;
+        size_t sourceBytes;        //the model file plus an OBJ's material library
+        double parseMs;            //tokenizing, triangulating and welding corners into vertices
+        double buildMs;            //missing normals, handedness, tangents and the model-wide arrays
+        uint64_t corners;          //face corners read, before welding
+        uint32_t vertices;         //after welding
+        uint32_t triangles;
+        uint32_t generatedNormals; //vertices the file gave no normal
+    };
+
+    //>Reads an OBJ (with its material library) or a binary PLY without assimp. Polygons are fan triangulated, identical
+    //>corners welded through a hash table, missing normals built from area-weighted faces and tangents computed when asked.
+    //>False when the file cannot be read or needs something only assimp handles; outModel is unspecified then.
+    [[nodiscard]] bool LoadNativeModel(const std::string& filePath, AssetSource source, bool computeTangents, NativeModel& outModel, NativeLoadStats& outStats);
+
+#ifdef RENDERER_BENCHMARKS
+    //>Reads filePath through assimp with importFlags and logs its time and throughput next to the native load's
+    void LogNativeImportComparison(const std::string& filePath, uint32_t importFlags, const NativeLoadStats& nativeStats);
+#endif
+}
@@ -0,0 +1,49 @@
+#include <iomanip>
+#include <ostream>
+
+#include "ResidencyReport.h"
+#include "../utils/MemoryStats.h"
+
+namespace renderer
+{
+    const char* GetResidencyPolicyName(ResidencyPolicy policy)
+    {
+        return policy == ResidencyPolicy::KeepCpuCopies ? "keep cpu copies" : "release after upload";
+    }
+
+    const char* GetResidencyStageName(ResidencyStage stage)
+    {
+        switch (stage)
+        {
+        case ResidencyStage::ImportScene: return "assimp scene";
+        case ResidencyStage::ImportArena: return "import arena";
+        case ResidencyStage::MeshTable: return "mesh table";
+        case ResidencyStage::VertexImage: return "vertex image";
+        case ResidencyStage::CompactVertexImage: return "compact vertex image";
+        case ResidencyStage::IndexImage: return "index image";
+        case ResidencyStage::SubBatchIndices: return "sub-batch indices";
+        case ResidencyStage::Clusters: return "clusters";
+        case ResidencyStage::TextureStaging: return "texture staging";
+        case ResidencyStage::ManagedBuffers: return "managed buffer copies";
+        default: return "unknown";
+        }
+    }
+
+    void ResidencyReport::Log(std::ostream& os) const
+    {
+        size_t totalBefore = 0;
+        size_t totalAfter = 0;
+        os << "\n    residency (" << GetResidencyPolicyName(policy) << "), MB before upload -> resident:";
+        for (uint32_t itr = 0; itr < ResidencyStageCount; ++itr)
+        {
+            if (beforeBytes[itr] == 0 && afterBytes[itr] == 0)
+                continue;
+            os << "\n        " << std::left << std::setw(26) << GetResidencyStageName(static_cast<ResidencyStage>(itr)) << std::right;
+            os << std::setw(9) << BytesToMB(beforeBytes[itr]) << " -> " << std::setw(9) << BytesToMB(afterBytes[itr]);
+            totalBefore += beforeBytes[itr];
+            totalAfter += afterBytes[itr];
+        }
+        os << "\n        " << std::left << std::setw(26) << "total" << std::right;
+        os << std::setw(9) << BytesToMB(totalBefore) << " -> " << std::setw(9) << BytesToMB(totalAfter);
+    }
+}
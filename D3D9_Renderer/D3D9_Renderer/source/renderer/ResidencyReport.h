@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <array>
+
+namespace renderer
+{
+    //>What a model keeps in system memory once its device resources exist
+    enum class ResidencyPolicy
+    {
+        ReleaseAfterUpload, //only what later frames or a device reset read: the LOD0 index image for the cluster culler, the cooked mapping when streaming
+        KeepCpuCopies       //the assimp scene and every CPU image stay, e.g. for tools that read the geometry back
+    };
+
+    //>System memory a load goes through, in the order it is produced
+    enum class ResidencyStage
+    {
+        ImportScene,       //assimp's aiScene (estimated from its arrays), cold start only
+        ImportArena,       //blocks of the import's LinearArena
+        MeshTable,         //Mesh objects and their names
+        VertexImage,       //model-wide PositionVertex image
+        CompactVertexImage,
+        IndexImage,        //model-wide 32-bit image, every level
+        SubBatchIndices,   //the 16- and 32-bit images rebased per sub-batch for the device buffers
+        Clusters,
+        TextureStaging,    //decoded mip chains and D3DX fallback bytes waiting for the render thread
+        ManagedBuffers,    //the D3D runtime's system memory copy of the D3DPOOL_MANAGED geometry, which is what survives a device reset
+        Count
+    };
+    constexpr uint32_t ResidencyStageCount = static_cast<uint32_t>(ResidencyStage::Count);
+
+    const char* GetResidencyPolicyName(ResidencyPolicy policy);
+    const char* GetResidencyStageName(ResidencyStage stage);
+
+    //>Bytes held per stage when the upload starts and once the model is resident
+    struct ResidencyReport
+    {
+        ResidencyReport()
+            :policy(ResidencyPolicy::ReleaseAfterUpload),
+            beforeBytes(),
+            afterBytes()
+        {}
+
+        inline size_t& Before(ResidencyStage stage) { return beforeBytes[static_cast<uint32_t>(stage)]; }
+        inline size_t& After(ResidencyStage stage) { return afterBytes[static_cast<uint32_t>(stage)]; }
+        void Log(std::ostream& os) const;
+
+        ResidencyPolicy policy;
+        std::array<size_t, ResidencyStageCount> beforeBytes;
+        std::array<size_t, ResidencyStageCount> afterBytes;
+    };
+}
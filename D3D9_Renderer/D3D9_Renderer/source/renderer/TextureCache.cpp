@@ -0,0 +1,313 @@
+#include <algorithm>
+#include <cassert>
+#include <sstream>
+#include <iomanip>
+#include <d3dx9.h>
+
+#include "TextureCache.h"
+#include "../utils/ComHelpers.h"
+#include "../utils/Logger.h"
+#include "../utils/MemoryStats.h"
+#include "../utils/AssetPack.h"
+
+namespace renderer
+{
+    namespace
+    {
+        size_t GetSurfaceBytes(D3DFORMAT format, UINT width, UINT height)
+        {
+            const size_t blocksWide = (std::max)(1u, (width + 3) / 4);
+            const size_t blocksHigh = (std::max)(1u, (height + 3) / 4);
+            switch (format)
+            {
+            case D3DFMT_DXT1:
+                return blocksWide * blocksHigh * 8;
+            case D3DFMT_DXT2:
+            case D3DFMT_DXT3:
+            case D3DFMT_DXT4:
+            case D3DFMT_DXT5:
+                return blocksWide * blocksHigh * 16;
+            case D3DFMT_L8:
+            case D3DFMT_A8:
+                return static_cast<size_t>(width) * height;
+            case D3DFMT_R5G6B5:
+            case D3DFMT_A8L8:
+            case D3DFMT_A1R5G5B5:
+            case D3DFMT_X1R5G5B5:
+                return static_cast<size_t>(width) * height * 2;
+            default:
+                return static_cast<size_t>(width) * height * 4;
+            }
+        }
+
+        size_t GetTextureBytes(IDirect3DTexture9* texture)
+        {
+            size_t bytes = 0;
+            const DWORD levelCount = texture->GetLevelCount();
+            for (DWORD level = 0; level < levelCount; ++level)
+            {
+                D3DSURFACE_DESC desc;
+                if (texture->GetLevelDesc(level, &desc) == S_OK)
+                    bytes += GetSurfaceBytes(desc.Format, desc.Width, desc.Height);
+            }
+            return bytes;
+        }
+    }
+
+    TextureCache::TextureCache()
+        :m_mutex(),
+        m_pathToContent(),
+        m_entries(),
+        m_stats()
+    {
+    }
+
+    TextureCache::~TextureCache()
+    {
+        //runs at static destruction, after the device is gone: releasing a texture here would touch a dead device
+        assert(m_entries.empty() && "TextureCache::Shutdown has to run before the device is released");
+    }
+
+    void TextureCache::Shutdown()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& keyVal : m_entries)
+        {
+            ComSafeRelease(keyVal.second.texture);
+        }
+        m_entries.clear();
+        m_pathToContent.clear();
+        m_stats.residentBytes = 0;
+    }
+
+    void TextureCache::MapPath(const std::string& normalizedPath, uint64_t contentHash)
+    {
+        auto inserted = m_pathToContent.emplace(normalizedPath, contentHash);
+        if (!inserted.second)
+        {
+            if (inserted.first->second == contentHash)
+                return;
+            //the file was edited: its path moves to the new contents
+            auto previous = m_entries.find(inserted.first->second);
+            if (previous != m_entries.end())
+            {
+                auto& paths = previous->second.paths;
+                paths.erase(std::remove(paths.begin(), paths.end(), normalizedPath), paths.end());
+            }
+            inserted.first->second = contentHash;
+        }
+        m_entries[contentHash].paths.push_back(normalizedPath);
+    }
+
+    std::string TextureCache::NormalizePath(const std::string& path)
+    {
+        //the same form the asset pack keys its entries by
+        return AssetPack::NormalizePath(path);
+    }
+
+    bool TextureCache::FindContentHash(const std::string& normalizedPath, uint64_t& outHash) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto found = m_pathToContent.find(normalizedPath);
+        if (found == m_pathToContent.end())
+            return false;
+        outHash = found->second;
+        return true;
+    }
+
+    bool TextureCache::HasContent(uint64_t contentHash) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_entries.find(contentHash) != m_entries.end();
+    }
+
+    IDirect3DTexture9* TextureCache::CreateFromStagingImage(IDirect3DDevice9* device, const StagingImage& image)
+    {
+        const auto& top = image.mips.front();
+        IDirect3DTexture9* texture = nullptr;
+        UINT levelCount = static_cast<UINT>(image.mips.size());
+        if (!image.IsPowerOfTwo())
+        {
+            D3DCAPS9 caps;
+            device->GetDeviceCaps(&caps);
+            if ((caps.TextureCaps & D3DPTEXTURECAPS_POW2) != 0)
+            {
+                if ((caps.TextureCaps & D3DPTEXTURECAPS_NONPOW2CONDITIONAL) == 0)
+                    return CreateScaledToPowerOfTwo(device, image);
+                levelCount = 1; //conditional support: a single level only
+            }
+        }
+        ComResult(device->CreateTexture(top.width, top.height, levelCount, NULL, D3DFMT_A8R8G8B8, D3DPOOL_MANAGED, &texture, nullptr));
+        if (texture == nullptr)
+            return nullptr;
+
+        for (UINT level = 0; level < levelCount; ++level)
+        {
+            const auto& mip = image.mips[level];
+            const size_t rowBytes = static_cast<size_t>(mip.width) * 4;
+            D3DLOCKED_RECT lockedRect;
+            if (texture->LockRect(level, &lockedRect, nullptr, NULL) != S_OK)
+                continue;
+
+            auto dst = static_cast<uint8_t*>(lockedRect.pBits);
+            for (uint32_t row = 0; row < mip.height; ++row)
+            {
+                memcpy(dst + static_cast<size_t>(row) * lockedRect.Pitch, mip.pixels.data() + row * rowBytes, rowBytes);
+            }
+            texture->UnlockRect(level);
+        }
+        return texture;
+    }
+
+    IDirect3DTexture9* TextureCache::CreateScaledToPowerOfTwo(IDirect3DDevice9* device, const StagingImage& image)
+    {
+        //D3DX rounds the size up to what the device takes, box filters level 0 into it and builds the chain from there
+        const auto& top = image.mips.front();
+        IDirect3DTexture9* texture = nullptr;
+        ComResult(D3DXCreateTexture(device, top.width, top.height, 0, NULL, D3DFMT_A8R8G8B8, D3DPOOL_MANAGED, &texture));
+        if (texture == nullptr)
+            return nullptr;
+
+        IDirect3DSurface9* surface = nullptr;
+        const RECT sourceRect = { 0, 0, static_cast<LONG>(top.width), static_cast<LONG>(top.height) };
+        if (texture->GetSurfaceLevel(0, &surface) == S_OK)
+        {
+            ComResult(D3DXLoadSurfaceFromMemory(surface, nullptr, nullptr, top.pixels.data(), D3DFMT_A8R8G8B8, top.width * 4, nullptr, &sourceRect, D3DX_FILTER_BOX, 0));
+            ComSafeRelease(surface);
+        }
+        ComResult(D3DXFilterTexture(texture, nullptr, 0, D3DX_FILTER_BOX));
+        return texture;
+    }
+
+    IDirect3DTexture9* TextureCache::CreateFromCookedTexture(IDirect3DDevice9* device, const CookedTexture& cooked)
+    {
+        const auto& header = cooked.GetHeader();
+        const uint32_t blockBytes = CookedTexture::GetBlockBytes(cooked.GetFormat());
+        IDirect3DTexture9* texture = nullptr;
+        ComResult(device->CreateTexture(header.width, header.height, header.mipCount, NULL, static_cast<D3DFORMAT>(header.format), D3DPOOL_MANAGED, &texture, nullptr));
+        if (texture == nullptr)
+            return nullptr;
+
+        //no decode: each level's blocks go from the mapped file straight into the locked level
+        for (UINT level = 0; level < header.mipCount; ++level)
+        {
+            const auto& mip = header.mips[level];
+            const uint32_t blocksWide = (std::max)(1u, (mip.width + 3) / 4);
+            const uint32_t blocksHigh = (std::max)(1u, (mip.height + 3) / 4);
+            const size_t rowBytes = static_cast<size_t>(blocksWide) * blockBytes;
+            D3DLOCKED_RECT lockedRect;
+            if (texture->LockRect(level, &lockedRect, nullptr, NULL) != S_OK)
+                continue;
+
+            auto dst = static_cast<uint8_t*>(lockedRect.pBits);
+            const uint8_t* src = cooked.GetMipData(level);
+            if (static_cast<size_t>(lockedRect.Pitch) == rowBytes)
+            {
+                memcpy(dst, src, mip.dataSize);
+            }
+            else
+            {
+                for (uint32_t row = 0; row < blocksHigh; ++row)
+                {
+                    memcpy(dst + static_cast<size_t>(row) * lockedRect.Pitch, src + row * rowBytes, rowBytes);
+                }
+            }
+            texture->UnlockRect(level);
+        }
+        return texture;
+    }
+
+    IDirect3DTexture9* TextureCache::Acquire(IDirect3DDevice9* device, const std::string& normalizedPath, uint64_t contentHash, const TextureSource& source)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_stats.acquires;
+
+        //two paths with identical bytes share one texture as well
+        auto found = m_entries.find(contentHash);
+        if (found != m_entries.end())
+        {
+            MapPath(normalizedPath, contentHash);
+            ++m_stats.duplicateDecodesAvoided;
+            m_stats.savedBytes += found->second.sizeInBytes;
+            found->second.texture->AddRef();
+            return found->second.texture;
+        }
+
+        IDirect3DTexture9* texture = nullptr;
+        uint32_t cookedFlags = CookedTextureFlagNone;
+        const bool fromCooked = source.cooked != nullptr && source.cooked->IsOpen();
+        if (fromCooked)
+        {
+            texture = CreateFromCookedTexture(device, *source.cooked);
+            cookedFlags = source.cooked->GetHeader().flags;
+        }
+        else if (source.image != nullptr && !source.image->IsEmpty())
+        {
+            texture = CreateFromStagingImage(device, *source.image);
+        }
+        else if (source.fileData != nullptr && !source.fileData->empty())
+        {
+            ComResult(D3DXCreateTextureFromFileInMemory(device, source.fileData->data(), static_cast<UINT>(source.fileData->size()), &texture));
+        }
+        if (texture == nullptr)
+            return nullptr;
+
+        Entry entry;
+        entry.texture = texture; //the cache keeps the creation reference
+        entry.sizeInBytes = GetTextureBytes(texture);
+        entry.cookedFlags = cookedFlags;
+        m_entries.emplace(contentHash, entry);
+        MapPath(normalizedPath, contentHash);
+
+        if (fromCooked)
+            ++m_stats.cookedLoads;
+        else
+            ++m_stats.decodes;
+        m_stats.residentBytes += entry.sizeInBytes;
+
+        texture->AddRef();
+        return texture;
+    }
+
+    uint32_t TextureCache::GetCookedFlags(uint64_t contentHash) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto found = m_entries.find(contentHash);
+        return found != m_entries.end() ? found->second.cookedFlags : CookedTextureFlagNone;
+    }
+
+    void TextureCache::PurgeUnused()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto itr = m_entries.begin(); itr != m_entries.end();)
+        {
+            //AddRef/Release both return the new count; 1 after Release means only the cache holds it
+            itr->second.texture->AddRef();
+            if (itr->second.texture->Release() > 1)
+            {
+                ++itr;
+                continue;
+            }
+
+            //a later FindContentHash must not hand out a hash whose texture is gone
+            for (const auto& path : itr->second.paths)
+                m_pathToContent.erase(path);
+
+            m_stats.residentBytes -= itr->second.sizeInBytes;
+            ComSafeRelease(itr->second.texture);
+            itr = m_entries.erase(itr);
+        }
+    }
+
+    void TextureCache::LogStats() const
+    {
+        const auto stats = GetStats();
+        std::ostringstream os;
+        os << std::fixed << std::setprecision(2);
+        os << "[TextureCache] acquires: " << stats.acquires << " | decodes: " << stats.decodes << " | cooked: " << stats.cookedLoads;
+        os << " | duplicate decodes avoided: " << stats.duplicateDecodesAvoided << "\n";
+        os << "    resident: " << BytesToMB(stats.residentBytes) << " MB | saved: " << BytesToMB(stats.savedBytes) << " MB";
+
+        Logger::GetInstance().LogInfo(os.str().c_str());
+    }
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <d3d9.h>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "TextureDecoder.h"
+#include "CookedTexture.h"
+
+namespace renderer
+{
+    //>What the workers produced for one texture file; the first one that is set wins
+    struct TextureSource
+    {
+        TextureSource()
+            :cooked(nullptr),
+            image(nullptr),
+            fileData(nullptr)
+        {}
+
+        const CookedTexture* cooked;          //pre-mipped blocks, copied straight out of the mapping
+        const StagingImage* image;            //decoded + mipped on the workers
+        const std::vector<uint8_t>* fileData; //encoded bytes for D3DX (formats WIC cannot read)
+    };
+
+    //>Content-addressed registry of device textures. Every Acquire hands out one COM reference; holders Release it.
+    class TextureCache
+    {
+    public:
+        struct Stats
+        {
+            uint32_t acquires;
+            uint32_t decodes;
+            uint32_t cookedLoads;             //came from a .ctex without decoding
+            uint32_t duplicateDecodesAvoided; //acquires served from an existing texture
+            size_t residentBytes;             //device memory of the unique textures
+            size_t savedBytes;                //what the avoided decodes would have cost
+        };
+
+        TextureCache();
+        ~TextureCache();
+
+        TextureCache(const TextureCache&) = delete;
+        TextureCache& operator=(const TextureCache&) = delete;
+
+        inline static TextureCache& GetInstance()
+        {
+            static TextureCache instance;
+            return instance;
+        }
+
+        //>Lower case, forward slashes, "." and ".." folded
+        static std::string NormalizePath(const std::string& path);
+
+        //>Thread safe. True if the path was already decoded; outHash then names its contents and the file need not be read.
+        [[nodiscard]] bool FindContentHash(const std::string& normalizedPath, uint64_t& outHash) const;
+        //>Thread safe. True if a texture with these contents exists; Acquire then needs no source for it.
+        [[nodiscard]] bool HasContent(uint64_t contentHash) const;
+
+        //>Render thread. source may be empty when FindContentHash succeeded. Returns an AddRef'd texture or nullptr.
+        [[nodiscard]] IDirect3DTexture9* Acquire(IDirect3DDevice9* device, const std::string& normalizedPath, uint64_t contentHash, const TextureSource& source);
+        //>CookedTextureFlags of the texture behind contentHash; 0 for anything that was not cooked
+        [[nodiscard]] uint32_t GetCookedFlags(uint64_t contentHash) const;
+
+        //>Drops textures that nobody but the cache references any more, and every path that named them
+        void PurgeUnused();
+        //>Releases every texture and forgets every path. Call before the device is destroyed; the static instance
+        //>outlives it and its destructor releases nothing.
+        void Shutdown();
+
+        inline Stats GetStats() const { std::lock_guard<std::mutex> lock(m_mutex); return m_stats; }
+        void LogStats() const;
+
+    private:
+        static IDirect3DTexture9* CreateFromStagingImage(IDirect3DDevice9* device, const StagingImage& image);
+        //>Non-power-of-two image on a device that only takes power-of-two textures
+        static IDirect3DTexture9* CreateScaledToPowerOfTwo(IDirect3DDevice9* device, const StagingImage& image);
+        static IDirect3DTexture9* CreateFromCookedTexture(IDirect3DDevice9* device, const CookedTexture& cooked);
+
+        struct Entry
+        {
+            IDirect3DTexture9* texture;
+            size_t sizeInBytes;
+            uint32_t cookedFlags;
+            std::vector<std::string> paths; //keys of m_pathToContent naming this texture, removed with it
+        };
+
+        //>Points normalizedPath at contentHash, taking it off the texture it named before
+        void MapPath(const std::string& normalizedPath, uint64_t contentHash);
+
+        mutable std::mutex m_mutex;
+        std::unordered_map<std::string, uint64_t> m_pathToContent;
+        std::unordered_map<uint64_t, Entry> m_entries;
+        Stats m_stats;
+    };
+}
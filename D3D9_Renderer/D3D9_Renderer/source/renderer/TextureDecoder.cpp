@@ -0,0 +1,176 @@
+#include <windows.h>
+#include <wincodec.h>
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+#include <thread>
+
+#include "TextureDecoder.h"
+#include "../utils/ComHelpers.h"
+#include "../utils/Logger.h"
+#include "../utils/MemoryStats.h"
+#include "../utils/ThreadPool.h"
+#include "../utils/Time.h"
+
+namespace renderer
+{
+    namespace
+    {
+        //>Null on a thread without COM; ThreadPool workers have it
+        IWICImagingFactory* GetThreadImagingFactory()
+        {
+            thread_local struct FactoryHolder
+            {
+                FactoryHolder()
+                    :factory(nullptr)
+                {
+                    CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory));
+                }
+                ~FactoryHolder() { ComSafeRelease(factory); }
+                IWICImagingFactory* factory;
+            } holder;
+            return holder.factory;
+        }
+    }
+
+    size_t StagingImage::GetSizeInBytes() const
+    {
+        size_t bytes = 0;
+        for (const auto& mip : mips)
+        {
+            bytes += mip.pixels.size();
+        }
+        return bytes;
+    }
+
+    bool DecodeImage(const uint8_t* data, size_t size, StagingImage& outImage)
+    {
+        outImage.mips.clear();
+
+        IWICImagingFactory* factory = GetThreadImagingFactory();
+        if (factory == nullptr || data == nullptr || size == 0)
+            return false;
+
+        IWICStream* stream = nullptr;
+        IWICBitmapDecoder* decoder = nullptr;
+        IWICBitmapFrameDecode* frame = nullptr;
+        IWICFormatConverter* converter = nullptr;
+
+        bool decoded = false;
+        if (SUCCEEDED(factory->CreateStream(&stream)) &&
+            SUCCEEDED(stream->InitializeFromMemory(const_cast<BYTE*>(data), static_cast<DWORD>(size))) &&
+            SUCCEEDED(factory->CreateDecoderFromStream(stream, nullptr, WICDecodeMetadataCacheOnDemand, &decoder)) &&
+            SUCCEEDED(decoder->GetFrame(0, &frame)) &&
+            SUCCEEDED(factory->CreateFormatConverter(&converter)) &&
+            SUCCEEDED(converter->Initialize(frame, GUID_WICPixelFormat32bppBGRA, WICBitmapDitherTypeNone, nullptr, 0.0, WICBitmapPaletteTypeCustom)))
+        {
+            UINT width = 0;
+            UINT height = 0;
+            if (SUCCEEDED(converter->GetSize(&width, &height)) && width > 0 && height > 0)
+            {
+                StagingImage::MipLevel level;
+                level.width = width;
+                level.height = height;
+                level.pixels.resize(static_cast<size_t>(width) * height * 4);
+                decoded = SUCCEEDED(converter->CopyPixels(nullptr, width * 4, static_cast<UINT>(level.pixels.size()), level.pixels.data()));
+                if (decoded)
+                    outImage.mips.emplace_back(std::move(level));
+            }
+        }
+
+        ComSafeRelease(converter);
+        ComSafeRelease(frame);
+        ComSafeRelease(decoder);
+        ComSafeRelease(stream);
+        return decoded;
+    }
+
+    void BuildMipChain(StagingImage& image)
+    {
+        if (image.IsEmpty())
+            return;
+
+        image.mips.resize(1);
+        while (image.mips.back().width > 1 || image.mips.back().height > 1)
+        {
+            const auto& src = image.mips.back();
+            StagingImage::MipLevel dst;
+            dst.width = (std::max)(1u, src.width / 2);
+            dst.height = (std::max)(1u, src.height / 2);
+            dst.pixels.resize(static_cast<size_t>(dst.width) * dst.height * 4);
+
+            //2x2 box; the last row/column of an odd-sized level is clamped rather than dropped
+            const size_t srcPitch = static_cast<size_t>(src.width) * 4;
+            for (uint32_t y = 0; y < dst.height; ++y)
+            {
+                const uint32_t y0 = (std::min)(y * 2, src.height - 1);
+                const uint32_t y1 = (std::min)(y * 2 + 1, src.height - 1);
+                const uint8_t* row0 = src.pixels.data() + y0 * srcPitch;
+                const uint8_t* row1 = src.pixels.data() + y1 * srcPitch;
+                uint8_t* out = dst.pixels.data() + static_cast<size_t>(y) * dst.width * 4;
+                for (uint32_t x = 0; x < dst.width; ++x)
+                {
+                    const size_t x0 = static_cast<size_t>((std::min)(x * 2, src.width - 1)) * 4;
+                    const size_t x1 = static_cast<size_t>((std::min)(x * 2 + 1, src.width - 1)) * 4;
+                    for (uint32_t channel = 0; channel < 4; ++channel)
+                    {
+                        const uint32_t sum = row0[x0 + channel] + row0[x1 + channel] + row1[x0 + channel] + row1[x1 + channel];
+                        out[x * 4 + channel] = static_cast<uint8_t>((sum + 2) / 4);
+                    }
+                }
+            }
+            image.mips.emplace_back(std::move(dst));
+        }
+    }
+
+#ifdef RENDERER_BENCHMARKS
+    void LogTextureDecodeSweep(const std::vector<const std::vector<uint8_t>*>& encodedFiles)
+    {
+        size_t inputBytes = 0;
+        for (const auto file : encodedFiles)
+        {
+            inputBytes += file->size();
+        }
+
+        std::ostringstream os;
+        os << std::fixed << std::setprecision(2);
+        os << "[TextureDecode] sweep over " << encodedFiles.size() << " files, " << BytesToMB(inputBytes) << " MB encoded\n";
+
+        const uint32_t maxThreads = (std::max)(1u, std::thread::hardware_concurrency());
+        double singleThreadMs = 0.0;
+        for (uint32_t numThreads = 1; ; numThreads = (std::min)(numThreads * 2, maxThreads))
+        {
+            //a private pool so the sweep does not depend on how the shared one was sized; the caller is one of the threads
+            ThreadPool pool(numThreads > 1 ? numThreads - 1 : 1);
+            const auto count = static_cast<uint32_t>(encodedFiles.size());
+            Stopwatch stopwatch;
+            auto decodeOne = [&encodedFiles](uint32_t itr)
+            {
+                StagingImage image;
+                if (DecodeImage(encodedFiles[itr]->data(), encodedFiles[itr]->size(), image))
+                    BuildMipChain(image);
+            };
+            if (numThreads == 1)
+            {
+                for (uint32_t itr = 0; itr < count; ++itr)
+                    decodeOne(itr);
+            }
+            else
+            {
+                pool.ParallelFor(count, decodeOne);
+            }
+            const double wallMs = stopwatch.GetElapsedMs();
+            if (numThreads == 1)
+                singleThreadMs = wallMs;
+
+            os << "    threads: " << numThreads << " | wall: " << wallMs << " ms | " << BytesToMB(inputBytes) / (wallMs / 1000.0) << " MB/s";
+            os << " | speedup: " << singleThreadMs / wallMs << "x\n";
+
+            if (numThreads == maxThreads)
+                break;
+        }
+
+        Logger::GetInstance().LogInfo(os.str().c_str());
+    }
+#endif
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#pragma comment (lib, "windowscodecs.lib")
+
+#include <cstdint>
+#include <vector>
+
+namespace renderer
+{
+    //>CPU-side BGRA8 image with its full mip chain, ready to be copied level by level into a D3DFMT_A8R8G8B8 texture
+    struct StagingImage
+    {
+        struct MipLevel
+        {
+            uint32_t width;
+            uint32_t height;
+            std::vector<uint8_t> pixels; //tightly packed, width * 4 bytes per row
+        };
+
+        inline bool IsEmpty() const { return mips.empty(); }
+        inline bool IsPowerOfTwo() const { return !mips.empty() && (mips[0].width & (mips[0].width - 1)) == 0 && (mips[0].height & (mips[0].height - 1)) == 0; }
+        size_t GetSizeInBytes() const;
+
+        std::vector<MipLevel> mips;
+    };
+
+    //>Decodes a PNG/JPEG/BMP/TIFF file image via WIC. Needs COM on the calling thread, which ThreadPool workers have;
+    //>elsewhere it returns false and the caller falls back to D3DX. It never initializes COM itself.
+    [[nodiscard]] bool DecodeImage(const uint8_t* data, size_t size, StagingImage& outImage);
+    //>Box-filters level 0 down to 1x1
+    void BuildMipChain(StagingImage& image);
+
+#ifdef RENDERER_BENCHMARKS
+    //>Decodes + mips every file once per thread count (1, 2, 4, .. hardware threads) and logs wall time and MB/s
+    void LogTextureDecodeSweep(const std::vector<const std::vector<uint8_t>*>& encodedFiles);
+#endif
+}
@@ -0,0 +1,112 @@
+#include <cassert>
+#include <algorithm>
+
+#include "TransformHierarchy.h"
+
+namespace renderer
+{
+    TransformHierarchy::TransformHierarchy()
+        :m_parents(),
+        m_locals(),
+        m_worlds(),
+        m_bindInverses(),
+        m_deltas(),
+        m_dirtyFlags(),
+        m_movedFlags(),
+        m_names(),
+        m_movedCount(0),
+        m_isDirty(false)
+    {
+    }
+
+    TransformHierarchy::~TransformHierarchy()
+    {
+    }
+
+    uint32_t TransformHierarchy::AddNode(uint32_t parent, const D3DXMATRIX& local, const std::string& name)
+    {
+        const auto index = static_cast<uint32_t>(m_parents.size());
+        assert(parent == NoParentTransform || parent < index);
+
+        D3DXMATRIXA16 world = local;
+        if (parent != NoParentTransform)
+            D3DXMatrixMultiply(&world, &local, &m_worlds[parent]);
+
+        //a degenerate (zero scale) node bakes to a point; moving it later cannot bring its geometry back
+        D3DXMATRIXA16 bindInverse;
+        if (D3DXMatrixInverse(&bindInverse, nullptr, &world) == nullptr)
+            D3DXMatrixIdentity(&bindInverse);
+        D3DXMATRIXA16 delta;
+        D3DXMatrixIdentity(&delta);
+
+        m_parents.push_back(parent);
+        m_locals.push_back(local);
+        m_worlds.push_back(world);
+        m_bindInverses.push_back(bindInverse);
+        m_deltas.push_back(delta);
+        m_dirtyFlags.push_back(0);
+        m_movedFlags.push_back(0);
+        m_names.push_back(name);
+        return index;
+    }
+
+    void TransformHierarchy::Clear()
+    {
+        m_parents.clear();
+        m_locals.clear();
+        m_worlds.clear();
+        m_bindInverses.clear();
+        m_deltas.clear();
+        m_dirtyFlags.clear();
+        m_movedFlags.clear();
+        m_names.clear();
+        m_movedCount = 0;
+        m_isDirty = false;
+    }
+
+    void TransformHierarchy::SetLocal(uint32_t index, const D3DXMATRIX& local)
+    {
+        assert(index < m_parents.size());
+        m_locals[index] = local;
+        m_dirtyFlags[index] = 1;
+        m_isDirty = true;
+    }
+
+    uint32_t TransformHierarchy::Update()
+    {
+        if (!m_isDirty)
+            return 0;
+
+        //parents come first, so a parent's flag and world matrix are final by the time its children are visited
+        uint32_t updated = 0;
+        const auto count = static_cast<uint32_t>(m_parents.size());
+        for (uint32_t itr = 0; itr < count; ++itr)
+        {
+            const uint32_t parent = m_parents[itr];
+            if (parent != NoParentTransform)
+                m_dirtyFlags[itr] |= m_dirtyFlags[parent];
+            if (m_dirtyFlags[itr] == 0)
+                continue;
+
+            if (parent == NoParentTransform)
+                m_worlds[itr] = m_locals[itr];
+            else
+                D3DXMatrixMultiply(&m_worlds[itr], &m_locals[itr], &m_worlds[parent]);
+            D3DXMatrixMultiply(&m_deltas[itr], &m_bindInverses[itr], &m_worlds[itr]);
+
+            m_movedCount += m_movedFlags[itr] == 0 ? 1 : 0;
+            m_movedFlags[itr] = 1;
+            ++updated;
+        }
+
+        std::fill(m_dirtyFlags.begin(), m_dirtyFlags.end(), static_cast<uint8_t>(0));
+        m_isDirty = false;
+        return updated;
+    }
+
+    uint32_t TransformHierarchy::FindNode(const std::string& name) const
+    {
+        const auto found = std::find(m_names.begin(), m_names.end(), name);
+        return found == m_names.end() ? NoParentTransform : static_cast<uint32_t>(found - m_names.begin());
+    }
+}
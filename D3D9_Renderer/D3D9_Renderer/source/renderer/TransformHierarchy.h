@@ -0,0 +1,57 @@
+#pragma once
+
+#include <d3dx9.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace renderer
+{
+    constexpr uint32_t NoTransform = UINT32_MAX; //no scene node: identity
+    constexpr uint32_t NoParentTransform = NoTransform;
+
+    //>Flattened scene node hierarchy in structure-of-arrays layout. Nodes are stored parent before child, so one linear
+    //>pass over contiguous, 16 byte aligned matrices updates every dirty subtree.
+    //>Vertices are baked with the world matrix a node had when it was added (its bind pose); draws apply GetDelta,
+    //>the move since then, which stays identity for every node that is never touched.
+    class TransformHierarchy
+    {
+    public:
+        TransformHierarchy();
+        ~TransformHierarchy();
+
+        //>parent has to be an earlier node (or NoParentTransform); returns the new node's index
+        uint32_t AddNode(uint32_t parent, const D3DXMATRIX& local, const std::string& name);
+        void Clear();
+
+        //>Marks the node and, at the next Update, everything below it dirty
+        void SetLocal(uint32_t index, const D3DXMATRIX& local);
+        //>Recomputes the world matrix and delta of every dirty node and its descendants; returns how many were updated
+        uint32_t Update();
+
+        //>First node with that name, NoParentTransform when there is none
+        [[nodiscard]] uint32_t FindNode(const std::string& name) const;
+
+        inline uint32_t GetCount() const { return static_cast<uint32_t>(m_parents.size()); }
+        inline uint32_t GetParent(uint32_t index) const { return m_parents[index]; }
+        inline const std::string& GetName(uint32_t index) const { return m_names[index]; }
+        inline const D3DXMATRIX& GetLocal(uint32_t index) const { return m_locals[index]; }
+        inline const D3DXMATRIX& GetWorld(uint32_t index) const { return m_worlds[index]; }
+        inline const D3DXMATRIX& GetDelta(uint32_t index) const { return m_deltas[index]; }
+        //>True while the node is still where its vertices were baked
+        inline bool IsAtRest(uint32_t index) const { return m_movedFlags[index] == 0; }
+        inline bool HasMovedNodes() const { return m_movedCount > 0; }
+
+    private:
+        std::vector<uint32_t> m_parents;
+        std::vector<D3DXMATRIXA16> m_locals;
+        std::vector<D3DXMATRIXA16> m_worlds;
+        std::vector<D3DXMATRIXA16> m_bindInverses; //inverse world matrix at AddNode
+        std::vector<D3DXMATRIXA16> m_deltas;       //bind inverse * world
+        std::vector<uint8_t> m_dirtyFlags;
+        std::vector<uint8_t> m_movedFlags;
+        std::vector<std::string> m_names;
+        uint32_t m_movedCount;
+        bool m_isDirty;
+    };
+}
@@ -0,0 +1,149 @@
+#include <vector>
+#include <cassert>
+
+#include "VertexCacheOptimizer.h"
+
+namespace renderer
+{
+    namespace
+    {
+        constexpr uint32_t InvalidVertex = 0xFFFFFFFF;
+
+        //>Vertex -> triangles it belongs to, in CSR form
+        struct TriangleAdjacency
+        {
+            std::vector<uint32_t> offsets;   //vertexCount + 1 entries
+            std::vector<uint32_t> triangles;
+        };
+
+        void BuildAdjacency(const std::vector<uint32_t>& localIndices, uint32_t vertexCount, TriangleAdjacency& adjacency, std::vector<uint32_t>& liveTriangles)
+        {
+            liveTriangles.assign(vertexCount, 0);
+            for (const auto index : localIndices)
+                ++liveTriangles[index];
+
+            adjacency.offsets.resize(vertexCount + 1);
+            adjacency.offsets[0] = 0;
+            for (uint32_t vertex = 0; vertex < vertexCount; ++vertex)
+                adjacency.offsets[vertex + 1] = adjacency.offsets[vertex] + liveTriangles[vertex];
+
+            adjacency.triangles.resize(localIndices.size());
+            std::vector<uint32_t> cursor(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+            for (uint32_t itr = 0; itr < localIndices.size(); ++itr)
+                adjacency.triangles[cursor[localIndices[itr]]++] = itr / 3;
+        }
+
+        //>Most recently cached candidate that will still be in the cache after its remaining triangles are emitted
+        uint32_t GetNextFanVertex(const std::vector<uint32_t>& candidates, const std::vector<uint32_t>& liveTriangles, const std::vector<uint32_t>& cacheTime,
+            uint32_t timestamp, std::vector<uint32_t>& deadEnds, uint32_t& scanCursor, uint32_t vertexCount)
+        {
+            uint32_t bestVertex = InvalidVertex;
+            int64_t bestPriority = -1;
+            for (const auto vertex : candidates)
+            {
+                if (liveTriangles[vertex] == 0)
+                    continue;
+
+                int64_t priority = 0;
+                const uint32_t age = timestamp - cacheTime[vertex];
+                if (age + 2 * liveTriangles[vertex] <= VertexCacheOptimizeSize)
+                    priority = age;
+                if (priority > bestPriority)
+                {
+                    bestPriority = priority;
+                    bestVertex = vertex;
+                }
+            }
+            if (bestVertex != InvalidVertex)
+                return bestVertex;
+
+            //dead end: back up through recently emitted vertices, then fall back to the next unfinished one in order
+            while (!deadEnds.empty())
+            {
+                const uint32_t vertex = deadEnds.back();
+                deadEnds.pop_back();
+                if (liveTriangles[vertex] > 0)
+                    return vertex;
+            }
+            while (scanCursor < vertexCount)
+            {
+                if (liveTriangles[scanCursor] > 0)
+                    return scanCursor;
+                ++scanCursor;
+            }
+            return InvalidVertex;
+        }
+    }
+
+    void OptimizeVertexCache(uint32_t* indices, uint32_t indexCount, uint32_t baseVertex, uint32_t vertexCount)
+    {
+        if (indexCount < 6 || vertexCount == 0)
+            return;
+
+        std::vector<uint32_t> localIndices(indices, indices + indexCount);
+        for (auto& index : localIndices)
+        {
+            assert(index >= baseVertex && index - baseVertex < vertexCount);
+            index -= baseVertex;
+        }
+
+        TriangleAdjacency adjacency;
+        std::vector<uint32_t> liveTriangles;
+        BuildAdjacency(localIndices, vertexCount, adjacency, liveTriangles);
+
+        //timestamps start past the cache size so no vertex counts as cached before it is emitted
+        std::vector<uint32_t> cacheTime(vertexCount, 0);
+        uint32_t timestamp = VertexCacheOptimizeSize + 1;
+        std::vector<bool> isEmitted(indexCount / 3, false);
+        std::vector<uint32_t> deadEnds;
+        std::vector<uint32_t> candidates;
+        deadEnds.reserve(indexCount);
+
+        uint32_t outCursor = 0;
+        uint32_t scanCursor = 0;
+        uint32_t fanVertex = localIndices[0];
+        while (fanVertex != InvalidVertex)
+        {
+            candidates.clear();
+            for (uint32_t itr = adjacency.offsets[fanVertex]; itr < adjacency.offsets[fanVertex + 1]; ++itr)
+            {
+                const uint32_t triangle = adjacency.triangles[itr];
+                if (isEmitted[triangle])
+                    continue;
+
+                for (uint32_t corner = 0; corner < 3; ++corner)
+                {
+                    const uint32_t vertex = localIndices[triangle * 3 + corner];
+                    indices[outCursor++] = vertex + baseVertex;
+                    deadEnds.push_back(vertex);
+                    candidates.push_back(vertex);
+                    --liveTriangles[vertex];
+                    if (timestamp - cacheTime[vertex] > VertexCacheOptimizeSize)
+                        cacheTime[vertex] = timestamp++;
+                }
+                isEmitted[triangle] = true;
+            }
+            fanVertex = GetNextFanVertex(candidates, liveTriangles, cacheTime, timestamp, deadEnds, scanCursor, vertexCount);
+        }
+        assert(outCursor == indexCount);
+    }
+
+    VertexCacheStats SimulateVertexCache(const uint32_t* indices, uint32_t indexCount, uint32_t baseVertex, uint32_t vertexCount)
+    {
+        //a vertex is still cached while fewer than VertexCacheSimulateSize misses happened since it was loaded
+        VertexCacheStats stats;
+        std::vector<uint64_t> loadedAt(vertexCount, UINT64_MAX);
+        uint64_t misses = 0;
+        for (uint32_t itr = 0; itr < indexCount; ++itr)
+        {
+            const uint32_t vertex = indices[itr] - baseVertex;
+            if (loadedAt[vertex] == UINT64_MAX)
+                ++stats.uniqueVertices;
+            if (loadedAt[vertex] == UINT64_MAX || misses - loadedAt[vertex] >= VertexCacheSimulateSize)
+                loadedAt[vertex] = misses++;
+        }
+        stats.transformedVertices = misses;
+        stats.triangles = indexCount / 3;
+        return stats;
+    }
+}
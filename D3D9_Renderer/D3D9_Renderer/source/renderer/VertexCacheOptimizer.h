@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+
+namespace renderer
+{
+    constexpr uint32_t VertexCacheOptimizeSize = 16; //Tipsify's target cache size; small enough to suit older post-transform caches
+    constexpr uint32_t VertexCacheSimulateSize = 32; //FIFO size used to measure ACMR/ATVR
+
+    //>Result of replaying an index list through a FIFO post-transform cache
+    struct VertexCacheStats
+    {
+        VertexCacheStats()
+            :transformedVertices(0),
+            triangles(0),
+            uniqueVertices(0)
+        {}
+
+        inline double GetAcmr() const { return triangles > 0 ? static_cast<double>(transformedVertices) / triangles : 0.0; }
+        inline double GetAtvr() const { return uniqueVertices > 0 ? static_cast<double>(transformedVertices) / uniqueVertices : 0.0; }
+
+        VertexCacheStats& operator+=(const VertexCacheStats& other)
+        {
+            transformedVertices += other.transformedVertices;
+            triangles += other.triangles;
+            uniqueVertices += other.uniqueVertices;
+            return *this;
+        }
+
+        uint64_t transformedVertices; //cache misses, i.e. vertex shader invocations
+        uint64_t triangles;
+        uint64_t uniqueVertices;      //vertices referenced at least once; the ATVR floor is 1.0
+    };
+
+    //>Reorders the triangles of one mesh for the post-transform cache (Tipsify, Sander et al. 2007). Linear time.
+    //>Indices are absolute: every one of them lies in [baseVertex, baseVertex + vertexCount).
+    void OptimizeVertexCache(uint32_t* indices, uint32_t indexCount, uint32_t baseVertex, uint32_t vertexCount);
+    [[nodiscard]] VertexCacheStats SimulateVertexCache(const uint32_t* indices, uint32_t indexCount, uint32_t baseVertex, uint32_t vertexCount);
+}
@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "VertexCompression.h"
+
+namespace renderer
+{
+    namespace
+    {
+        constexpr float RadiansToDegrees = 57.2957795f;
+
+        int16_t EncodeSnorm16(float value)
+        {
+            //SHORTN decodes as value / 32767, so -32768 is never produced
+            const float clamped = (std::min)((std::max)(value, -1.0f), 1.0f);
+            return static_cast<int16_t>(std::lround(clamped * 32767.0f));
+        }
+
+        float DecodeSnorm16(int16_t value)
+        {
+            return (std::max)(value / 32767.0f, -1.0f);
+        }
+
+        uint8_t EncodeUnorm8(float value)
+        {
+            const float clamped = (std::min)((std::max)(value, 0.0f), 1.0f);
+            return static_cast<uint8_t>(std::lround(clamped * 255.0f));
+        }
+
+        //>Round to nearest; out of range values clamp to the largest half instead of becoming infinite
+        uint16_t FloatToHalf(float value)
+        {
+            uint32_t bits = 0;
+            memcpy(&bits, &value, sizeof(bits));
+            const uint32_t sign = (bits >> 16) & 0x8000u;
+            const int32_t exponent = static_cast<int32_t>((bits >> 23) & 0xffu) - 127 + 15;
+            uint32_t mantissa = bits & 0x7fffffu;
+
+            if (((bits >> 23) & 0xffu) == 0xffu)
+                return static_cast<uint16_t>(sign | 0x7c00u | (mantissa != 0 ? 0x200u : 0u)); //inf / nan
+            if (exponent >= 31)
+                return static_cast<uint16_t>(sign | 0x7bffu);
+            if (exponent <= 0)
+            {
+                if (exponent < -10)
+                    return static_cast<uint16_t>(sign);
+                //denormal: shift the implicit one in
+                mantissa |= 0x800000u;
+                const uint32_t shift = static_cast<uint32_t>(14 - exponent);
+                uint32_t half = mantissa >> shift;
+                if ((mantissa >> (shift - 1)) & 1u)
+                    ++half;
+                return static_cast<uint16_t>(sign | half);
+            }
+
+            uint32_t half = sign | (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+            if (mantissa & 0x1000u)
+                ++half; //a carry into the exponent is still the correctly rounded value
+            if ((half & 0x7fffu) >= 0x7c00u)
+                half = sign | 0x7bffu;
+            return static_cast<uint16_t>(half);
+        }
+
+        float HalfToFloat(uint16_t half)
+        {
+            const float sign = (half & 0x8000u) ? -1.0f : 1.0f;
+            const uint32_t exponent = (half >> 10) & 0x1fu;
+            const uint32_t mantissa = half & 0x3ffu;
+            if (exponent == 0)
+                return sign * std::ldexp(static_cast<float>(mantissa), -24);
+            if (exponent == 31)
+                return sign * INFINITY;
+            return sign * std::ldexp(static_cast<float>(mantissa | 0x400u), static_cast<int>(exponent) - 25);
+        }
+
+        //>Octahedral map folded on z (Meyer et al. 2010); zero components count as positive, as in RenderCompactVS
+        void EncodeOctahedral(const D3DXVECTOR3& normal, int16_t& outX, int16_t& outY)
+        {
+            const float l1 = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+            if (l1 <= 0.0f)
+            {
+                outX = outY = 0;
+                return;
+            }
+            float x = normal.x / l1;
+            float y = normal.y / l1;
+            if (normal.z < 0.0f)
+            {
+                const float foldedX = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+                const float foldedY = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+                x = foldedX;
+                y = foldedY;
+            }
+            outX = EncodeSnorm16(x);
+            outY = EncodeSnorm16(y);
+        }
+
+        D3DXVECTOR3 DecodeOctahedral(int16_t encodedX, int16_t encodedY)
+        {
+            D3DXVECTOR3 normal(DecodeSnorm16(encodedX), DecodeSnorm16(encodedY), 0.0f);
+            normal.z = 1.0f - std::fabs(normal.x) - std::fabs(normal.y);
+            const float fold = (std::max)(-normal.z, 0.0f);
+            normal.x += normal.x >= 0.0f ? -fold : fold;
+            normal.y += normal.y >= 0.0f ? -fold : fold;
+            D3DXVec3Normalize(&normal, &normal);
+            return normal;
+        }
+
+        //>Angle between two directions in degrees; 0 when the reference is degenerate (the mesh had no tangents)
+        float AngleErrorDeg(const D3DXVECTOR3& reference, const D3DXVECTOR3& decoded)
+        {
+            const float referenceLength = D3DXVec3Length(&reference);
+            const float decodedLength = D3DXVec3Length(&decoded);
+            if (referenceLength <= 1e-6f || decodedLength <= 1e-6f)
+                return 0.0f;
+            const float cosAngle = D3DXVec3Dot(&reference, &decoded) / (referenceLength * decodedLength);
+            return std::acos((std::min)((std::max)(cosAngle, -1.0f), 1.0f)) * RadiansToDegrees;
+        }
+    }
+
+    VertexEncodeStats& VertexEncodeStats::operator+=(const VertexEncodeStats& other)
+    {
+        vertices += other.vertices;
+        maxPositionError = (std::max)(maxPositionError, other.maxPositionError);
+        maxNormalErrorDeg = (std::max)(maxNormalErrorDeg, other.maxNormalErrorDeg);
+        maxTangentErrorDeg = (std::max)(maxTangentErrorDeg, other.maxTangentErrorDeg);
+        maxUvError = (std::max)(maxUvError, other.maxUvError);
+        return *this;
+    }
+
+    const char* GetVertexFormatName(VertexFormat format)
+    {
+        return format == VertexFormat::Compact ? "compact" : "full";
+    }
+
+    VertexQuantization ComputeVertexQuantization(const MeshBounds& bounds)
+    {
+        VertexQuantization quantization;
+        if (bounds.IsEmpty())
+            return quantization;
+
+        quantization.offset = (bounds.boundsMin + bounds.boundsMax) * 0.5f;
+        quantization.scale = (bounds.boundsMax - bounds.boundsMin) * 0.5f;
+        //a flat axis still needs a non-zero scale to divide by
+        quantization.scale.x = (std::max)(quantization.scale.x, 1e-6f);
+        quantization.scale.y = (std::max)(quantization.scale.y, 1e-6f);
+        quantization.scale.z = (std::max)(quantization.scale.z, 1e-6f);
+        return quantization;
+    }
+
+    void EncodeCompactVertices(const PositionVertex* vertices, size_t vertexCount, const VertexQuantization& quantization,
+        CompactVertex* outVertices, VertexEncodeStats* stats)
+    {
+        for (size_t itr = 0; itr < vertexCount; ++itr)
+        {
+            const PositionVertex& src = vertices[itr];
+            CompactVertex& dst = outVertices[itr];
+
+            dst.position[0] = EncodeSnorm16((src.m_vx - quantization.offset.x) / quantization.scale.x);
+            dst.position[1] = EncodeSnorm16((src.m_vy - quantization.offset.y) / quantization.scale.y);
+            dst.position[2] = EncodeSnorm16((src.m_vz - quantization.offset.z) / quantization.scale.z);
+            dst.position[3] = 0;
+
+            const D3DXVECTOR3 normal(src.m_nx, src.m_ny, src.m_nz);
+            EncodeOctahedral(normal, dst.normal[0], dst.normal[1]);
+
+            //the bitangent is rebuilt as cross(normal, tangent) * sign, so only its handedness is kept
+            const D3DXVECTOR3 tangent(src.m_tangx, src.m_tangy, src.m_tangz);
+            const D3DXVECTOR3 biTangent(src.m_biTangx, src.m_biTangy, src.m_biTangz);
+            D3DXVECTOR3 unitTangent(0.0f, 0.0f, 0.0f);
+            if (D3DXVec3Length(&tangent) > 1e-6f)
+                D3DXVec3Normalize(&unitTangent, &tangent);
+            D3DXVECTOR3 rebuilt;
+            D3DXVec3Cross(&rebuilt, &normal, &tangent);
+            const bool positiveHandedness = D3DXVec3Dot(&rebuilt, &biTangent) >= 0.0f;
+            dst.tangent[0] = EncodeUnorm8(unitTangent.x * 0.5f + 0.5f);
+            dst.tangent[1] = EncodeUnorm8(unitTangent.y * 0.5f + 0.5f);
+            dst.tangent[2] = EncodeUnorm8(unitTangent.z * 0.5f + 0.5f);
+            dst.tangent[3] = positiveHandedness ? 255 : 0;
+
+            dst.uv[0] = FloatToHalf(src.m_tx);
+            dst.uv[1] = FloatToHalf(src.m_ty);
+
+            if (stats == nullptr)
+                continue;
+
+            //decode exactly as the vertex declaration and RenderCompactVS do
+            const D3DXVECTOR3 position(src.m_vx, src.m_vy, src.m_vz);
+            const D3DXVECTOR3 decodedPosition(DecodeSnorm16(dst.position[0]) * quantization.scale.x + quantization.offset.x,
+                DecodeSnorm16(dst.position[1]) * quantization.scale.y + quantization.offset.y,
+                DecodeSnorm16(dst.position[2]) * quantization.scale.z + quantization.offset.z);
+            const D3DXVECTOR3 positionError = decodedPosition - position;
+            const D3DXVECTOR3 decodedNormal = DecodeOctahedral(dst.normal[0], dst.normal[1]);
+            const D3DXVECTOR3 decodedTangent(dst.tangent[0] / 255.0f * 2.0f - 1.0f, dst.tangent[1] / 255.0f * 2.0f - 1.0f, dst.tangent[2] / 255.0f * 2.0f - 1.0f);
+            D3DXVECTOR3 decodedBiTangent;
+            D3DXVec3Cross(&decodedBiTangent, &decodedNormal, &decodedTangent);
+            decodedBiTangent = decodedBiTangent * (dst.tangent[3] / 255.0f * 2.0f - 1.0f);
+
+            ++stats->vertices;
+            stats->maxPositionError = (std::max)(stats->maxPositionError, D3DXVec3Length(&positionError));
+            stats->maxNormalErrorDeg = (std::max)(stats->maxNormalErrorDeg, AngleErrorDeg(normal, decodedNormal));
+            stats->maxTangentErrorDeg = (std::max)(stats->maxTangentErrorDeg, AngleErrorDeg(tangent, decodedTangent));
+            stats->maxTangentErrorDeg = (std::max)(stats->maxTangentErrorDeg, AngleErrorDeg(biTangent, decodedBiTangent));
+            stats->maxUvError = (std::max)(stats->maxUvError, std::fabs(HalfToFloat(dst.uv[0]) - src.m_tx));
+            stats->maxUvError = (std::max)(stats->maxUvError, std::fabs(HalfToFloat(dst.uv[1]) - src.m_ty));
+        }
+    }
+}
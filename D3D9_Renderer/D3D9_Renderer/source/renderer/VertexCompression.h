@@ -0,0 +1,51 @@
+#pragma once
+
+#include <d3dx9.h>
+#include <cstdint>
+
+#include "d3d9/VertexDefs.h"
+#include "MeshBounds.h"
+
+namespace renderer
+{
+    //>Maps SHORT4N positions back to model space: position = value * scale + offset (the bounds' half extent and centre)
+    struct VertexQuantization
+    {
+        VertexQuantization()
+            :scale(1.0f, 1.0f, 1.0f),
+            offset(0.0f, 0.0f, 0.0f)
+        {}
+
+        D3DXVECTOR3 scale;
+        D3DXVECTOR3 offset;
+    };
+
+    //>Worst decode error over the encoded vertices
+    struct VertexEncodeStats
+    {
+        VertexEncodeStats()
+            :vertices(0),
+            maxPositionError(0.0f),
+            maxNormalErrorDeg(0.0f),
+            maxTangentErrorDeg(0.0f),
+            maxUvError(0.0f)
+        {}
+
+        VertexEncodeStats& operator+=(const VertexEncodeStats& other);
+
+        uint64_t vertices;
+        float maxPositionError;   //model units
+        float maxNormalErrorDeg;
+        float maxTangentErrorDeg; //tangent and rebuilt bitangent
+        float maxUvError;
+    };
+
+    [[nodiscard]] const char* GetVertexFormatName(VertexFormat format);
+    [[nodiscard]] inline uint32_t GetVertexStride(VertexFormat format) { return format == VertexFormat::Compact ? sizeof(CompactVertex) : sizeof(PositionVertex); }
+
+    //>From the box of every vertex the encoding has to cover (Model::GetBounds)
+    [[nodiscard]] VertexQuantization ComputeVertexQuantization(const MeshBounds& bounds);
+    //>stats is optional; measuring decodes every vertex again
+    void EncodeCompactVertices(const PositionVertex* vertices, size_t vertexCount, const VertexQuantization& quantization,
+        CompactVertex* outVertices, VertexEncodeStats* stats);
+}
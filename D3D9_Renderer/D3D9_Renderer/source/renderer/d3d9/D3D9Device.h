@@ -47,11 +47,24 @@ namespace renderer
         {
             auto result = m_d3dDevice->SetStreamSource(streamNumber, vBuffer.GetRawPtr(), offsetInBytes, stride);
             return result;
+        }
+		[[maybe_unused]] inline HRESULT SetStreamSource(UINT streamNumber, IDirect3DVertexBuffer9* vBuffer, UINT offsetInBytes, UINT stride)
+        {
+            return m_d3dDevice->SetStreamSource(streamNumber, vBuffer, offsetInBytes, stride);
+        }
+		[[maybe_unused]] inline HRESULT SetIndices(IDirect3DIndexBuffer9* indexBuffer)
+        {
+            return m_d3dDevice->SetIndices(indexBuffer);
         }
 		[[maybe_unused]] inline HRESULT SetIndices(StaticBuffer<IDirect3DIndexBuffer9>& indexBuffer)
         {
             auto result = m_d3dDevice->SetIndices(indexBuffer.GetRawPtr());
             return result;
+        }
+		//>D3DSTREAMSOURCE_INDEXEDDATA | count on the geometry stream, D3DSTREAMSOURCE_INSTANCEDATA | 1 on the instance stream; 1 restores plain draws
+		[[maybe_unused]] inline HRESULT SetStreamSourceFreq(UINT streamNumber, UINT setting)
+        {
+            return m_d3dDevice->SetStreamSourceFreq(streamNumber, setting);
         }
 		inline void SetFVF(int32_t fvf) { m_d3dDevice->SetFVF(fvf); }
 
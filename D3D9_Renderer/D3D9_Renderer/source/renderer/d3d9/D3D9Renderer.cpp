@@ -1,20 +1,84 @@
 #include <cassert>
 #include <iostream>
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
 
 #include "D3D9Renderer.h"
 #include "../../utils/ComHelpers.h"
 #include "../../utils/Logger.h"
+#include "../../utils/AssetPack.h"
+#include "../TextureCache.h"
 
 namespace renderer
 {
+    namespace
+    {
+        //>Every sub-batch at the same place with the same size and width: a reload can then write into the live ranges
+        bool IsSameGeometryLayout(const ModelManager& live, const ModelManager& reload)
+        {
+            const auto& liveSubBatches = live.GetSubBatchList();
+            const auto& reloadSubBatches = reload.GetSubBatchList();
+            if (live.GetVertexStride() != reload.GetVertexStride() || liveSubBatches.size() != reloadSubBatches.size())
+                return false;
+            for (size_t itr = 0; itr < liveSubBatches.size(); ++itr)
+            {
+                const auto& lhs = liveSubBatches[itr];
+                const auto& rhs = reloadSubBatches[itr];
+                if (lhs.baseVertex != rhs.baseVertex || lhs.vertexCount != rhs.vertexCount || lhs.indexStart != rhs.indexStart
+                    || lhs.primitiveCount != rhs.primitiveCount || lhs.isIndex32 != rhs.isIndex32 || lhs.repeatOf != rhs.repeatOf)
+                    return false;
+            }
+            return true;
+        }
+
+        //>World matrix an InstanceVertex carries; the fourth column is implied
+        D3DXMATRIX GetInstanceWorld(const InstanceVertex& instance)
+        {
+            const auto& columns = instance.worldColumns;
+            return D3DXMATRIX(columns[0][0], columns[1][0], columns[2][0], 0.0f,
+                columns[0][1], columns[1][1], columns[2][1], 0.0f,
+                columns[0][2], columns[1][2], columns[2][2], 0.0f,
+                columns[0][3], columns[1][3], columns[2][3], 1.0f);
+        }
+
+        //>Every node the sub-batch's meshes hang off is still where its vertices were baked
+        bool IsSubBatchAtRest(const TransformHierarchy& transforms, const std::vector<NodeSpan>& nodeSpans, const SubBatchDesc& subBatch)
+        {
+            if (subBatch.nodeSpanCount == 0)
+                return transforms.IsAtRest(subBatch.transformIndex);
+            if (!transforms.HasMovedNodes())
+                return true;
+            for (uint32_t itr = 0; itr < subBatch.nodeSpanCount; ++itr)
+            {
+                if (!transforms.IsAtRest(nodeSpans[subBatch.nodeSpanStart + itr].transformIndex))
+                    return false;
+            }
+            return true;
+        }
+
+        //>The model or its pending reload still has a worker writing into it
+        bool IsImportRunning(const SceneModel& model)
+        {
+            return model.manager.IsImportRunning() || (model.reload != nullptr && model.reload->manager.IsImportRunning());
+        }
+    }
+
     D3D9Renderer::D3D9Renderer()
         :m_d3d9(Direct3DCreate9(D3D_SDK_VERSION)),
         m_device(std::make_unique<D3D9Device>()),
         m_d3dCaps(),
-        m_modelManager(),
+        m_geometryPool(),
+        m_models(),
+        m_retiredModels(),
+        m_clusterCuller(),
+        m_frameDraws(),
+        m_frameInstances(),
+        m_instanceBuffer(),
+        m_lodStats(),
+        m_lodFrame(0),
         m_hWindow(),
-        m_vBuffer(),
-        m_iBuffer(),
         m_vertexDeclarations(),
         m_camera(),
         m_vBufferVertexCount(0),
@@ -45,16 +109,32 @@ namespace renderer
 
     void D3D9Renderer::UnInit()
     {
+        for (auto& model : m_models)
+        {
+            if (model != nullptr)
+                ReleaseModelGeometry(*model);
+        }
+        //the models' materials hold texture references; they go first, then the cache, all while the device is alive
+        m_models.clear();
+        m_retiredModels.clear(); //shutting down: waiting on their imports is fine here
+        TextureCache::GetInstance().Shutdown();
+        m_geometryPool.ReleaseAll();
+        m_clusterCuller.ReleaseDeviceResources();
+        m_instanceBuffer.ReleaseDeviceResources();
 		ComSafeRelease(m_d3d9);
 		ComSafeRelease(m_vertexDeclarations.positionVertexDecl);
+		ComSafeRelease(m_vertexDeclarations.compactVertexDecl);
+		ComSafeRelease(m_vertexDeclarations.positionInstancedDecl);
+		ComSafeRelease(m_vertexDeclarations.compactInstancedDecl);
     }
 
     void D3D9Renderer::PrepareForRendering()
     {
         BuildMatrices();
-        AddModels();
-        SetupVertexDeclaration();
-        SetupStaticBuffers();
+        if (!AssetPack::GetInstance().Mount(ASSET_PACK_PATH))
+            Logger::GetInstance().LogInfo("[AssetPack] no pack mounted, reading loose files");
+        SetupVertexDeclaration(); //before the models: one only gets the compact format if its declaration was created
+        AddModels(); //returns before the import is done; buffers are set up once the geometry arrives
 
         std::string shaderPath = "source/renderer/d3d9/shaders/TexturedShader.hlsl";
 		m_shader.CreateShader(m_device->GetRawDevicePtr(), shaderPath);
@@ -64,6 +144,12 @@ namespace renderer
     void D3D9Renderer::PreRender()
     {
         UpdateMatrices();
+        UpdateModelStreaming();
+        for (auto& model : m_models)
+        {
+            if (model != nullptr)
+                model->manager.UpdateTransforms();
+        }
 
         m_device->Clear(NULL, nullptr, D3DCLEAR_TARGET | D3DCLEAR_ZBUFFER, D3DCOLOR_ARGB(255, 169, 255, 255), 1.0f, NULL);
         HRESULT result = CheckDeviceStatus();
@@ -77,16 +163,446 @@ namespace renderer
         if (m_fileWatcher.IsFileModified(m_shaderFileWatchIndex))
             m_shader.ReloadShader();
 
-        m_device->SetIndices(m_iBuffer);
-        auto batchList = m_modelManager.GetBatchList();
+        //one culler frame for every model, its buffers sized for all of their LOD0 ranges together
+        uint32_t lod0IndexCount16 = 0;
+        uint32_t lod0IndexCount32 = 0;
+        for (const auto& model : m_models)
+        {
+            if (model == nullptr)
+                continue;
+            lod0IndexCount16 += model->manager.GetLod0IndexCount(false);
+            lod0IndexCount32 += model->manager.GetLod0IndexCount(true);
+        }
+        const bool isCulling = CULL_MESH_CLUSTERS && m_clusterCuller.BeginFrame(m_device->GetRawDevicePtr(), lod0IndexCount16, lod0IndexCount32);
+
+        m_frameDraws.clear();
+        m_frameInstances.clear();
+        for (uint32_t itr = 0; itr < m_models.size(); ++itr)
+        {
+            if (m_models[itr] == nullptr)
+                continue;
+            if (m_models[itr]->manager.IsGeometryStreaming())
+                AppendStreamedChunks(itr, isCulling);
+            else if (m_models[itr]->vertices != NoGeometry) //still importing: nothing to draw yet
+                AppendBatchDraws(itr, isCulling);
+        }
+        m_clusterCuller.EndFrame();
+        //after every plain draw, so SubmitFrameDraws switches to the instanced declaration once
+        for (uint32_t itr = 0; itr < m_models.size(); ++itr)
+        {
+            if (m_models[itr] != nullptr && (m_models[itr]->manager.IsGeometryStreaming() || m_models[itr]->vertices != NoGeometry))
+                AppendInstancedDraws(itr);
+        }
+
+        SubmitFrameDraws();
+        ReportGeometryStats();
+    }
+
+    void D3D9Renderer::AppendBatchDraws(uint32_t modelIndex, bool isCulling)
+    {
+        auto& model = *m_models[modelIndex];
+        const auto& modelManager = model.manager;
+        const auto& batchList = modelManager.GetBatchList();
+        const auto& clusterList = modelManager.GetClusterList();
+        const auto& transforms = modelManager.GetTransforms();
+        const D3DXMATRIX& placement = modelManager.GetPlacements().front();
+        const StreamingView view = BuildStreamingView(placement);
+        const ClusterView clusterView = BuildClusterView(placement * m_viewMat * m_projMat, view.position);
+        const bool hasMovedNodes = transforms.HasMovedNodes(); //batch bounds span several nodes and only hold in the import pose
+        //looked up every frame: a compaction may have moved the ranges
+        const GeometryRange vertexRange = m_geometryPool.GetRange(model.vertices);
+        const GeometryRange index16Range = model.indices16 != NoGeometry ? m_geometryPool.GetRange(model.indices16) : GeometryRange();
+        const GeometryRange index32Range = model.indices32 != NoGeometry ? m_geometryPool.GetRange(model.indices32) : GeometryRange();
+        model.batchLods.resize(batchList.size(), 0);
         for (uint32_t itr = 0; itr < batchList.size(); ++itr)
         {
-            m_device->SetStreamSource(0, m_vBuffer, 0, sizeof(PositionVertex));
-            m_worldViewProjMat = m_worldMat * m_viewMat * m_projMat;
-            RenderBatch(batchList[itr].vertexCount, batchList[itr].indexStart, batchList[itr].primitiveCount, itr);
+            const auto& batch = batchList[itr];
+            if (!batch.isResident || batch.primitiveCount == 0)
+                continue;
+            if (isCulling && !hasMovedNodes && !IsSphereInFrustum(clusterView, batch.center, batch.radius))
+                continue;
+
+            const uint32_t lod = SelectDrawLod(model.batchLods, itr, batch.lods, batch.lodCount, batch.center, batch.radius, view);
+            for (uint32_t subItr = 0; subItr < batch.subBatchCount[lod]; ++subItr)
+            {
+                const auto& subBatch = modelManager.GetSubBatch(batch.subBatchStart[lod] + subItr);
+                const GeometryRange& indexRange = subBatch.isIndex32 ? index32Range : index16Range;
+                FrameDraw draw = { vertexRange.vertexBuffer, indexRange.indexBuffer, static_cast<INT>(vertexRange.start + subBatch.baseVertex), 0, subBatch.vertexCount,
+                    indexRange.start + subBatch.indexStart, subBatch.primitiveCount, itr, 0, 0, subBatch.transformIndex, modelIndex };
+                const bool isAtRest = IsSubBatchAtRest(transforms, modelManager.GetNodeSpans(), subBatch);
+                if (isCulling && lod == 0 && subBatch.clusterCount > 0 && isAtRest)
+                {
+                    const auto range = m_clusterCuller.AppendVisible(clusterView, clusterList.data() + subBatch.clusterStart, subBatch.clusterCount,
+                        modelManager.GetClusterIndices(subBatch), subBatch.sourceIndexStart, subBatch.isIndex32);
+                    draw.indexBuffer = range.indexBuffer;
+                    draw.indexStart = range.indexStart;
+                    draw.primitiveCount = range.primitiveCount;
+                }
+                if (draw.primitiveCount > 0)
+                    AppendSubBatchDraw(draw, modelManager, subBatch);
+            }
+        }
+    }
+
+    void D3D9Renderer::AppendSubBatchDraw(const FrameDraw& draw, const ModelManager& modelManager, const SubBatchDesc& subBatch)
+    {
+        //at rest the nodes' deltas are all identity, so the whole run is one draw; the culler's compacted ranges only exist then
+        const auto& nodeSpans = modelManager.GetNodeSpans();
+        if (subBatch.nodeSpanCount == 0 || IsSubBatchAtRest(modelManager.GetTransforms(), nodeSpans, subBatch))
+        {
+            m_frameDraws.push_back(draw);
+            return;
+        }
+        for (uint32_t itr = 0; itr < subBatch.nodeSpanCount; ++itr)
+        {
+            const auto& span = nodeSpans[subBatch.nodeSpanStart + itr];
+            FrameDraw spanDraw = draw;
+            spanDraw.indexStart = draw.indexStart + span.indexOffset;
+            spanDraw.primitiveCount = span.primitiveCount;
+            spanDraw.transformIndex = span.transformIndex;
+            if (spanDraw.primitiveCount > 0)
+                m_frameDraws.push_back(spanDraw);
+        }
+    }
+
+    void D3D9Renderer::AppendStreamedChunks(uint32_t modelIndex, bool isCulling)
+    {
+        auto& model = *m_models[modelIndex];
+        const auto& modelManager = model.manager;
+        const auto& chunkList = modelManager.GetChunkList();
+        const auto& clusterList = modelManager.GetClusterList();
+        const auto& residency = model.streamer.GetResidency();
+        const auto& transforms = modelManager.GetTransforms();
+        const D3DXMATRIX& placement = modelManager.GetPlacements().front();
+        const StreamingView view = BuildStreamingView(placement);
+        const ClusterView clusterView = BuildClusterView(placement * m_viewMat * m_projMat, view.position);
+        model.chunkLods.resize(chunkList.size(), 0);
+        for (uint32_t itr = 0; itr < residency.size(); ++itr)
+        {
+            if (!residency[itr].IsResident())
+                continue;
+
+            const auto& chunk = chunkList[itr];
+            if (chunk.instanceGroup != NoInstanceGroup)
+                continue; //drawn per copy by AppendInstancedDraws
+            //a moved node carries its chunk's bounds along; its clusters are only valid in the import pose
+            const bool isAtRest = transforms.IsAtRest(chunk.transformIndex);
+            D3DXVECTOR3 center = chunk.center;
+            float radius = chunk.radius;
+            if (!isAtRest)
+                TransformSphere(chunk.center, chunk.radius, transforms.GetDelta(chunk.transformIndex), center, radius);
+            if (isCulling && !IsSphereInFrustum(clusterView, center, radius))
+                continue;
+
+            const uint32_t lod = SelectDrawLod(model.chunkLods, itr, chunk.lods, chunk.lodCount, center, radius, view);
+            const GeometryRange vertexRange = m_geometryPool.GetRange(residency[itr].vertices);
+            const GeometryRange indexRange = m_geometryPool.GetRange(residency[itr].indices);
+            FrameDraw draw = { vertexRange.vertexBuffer, indexRange.indexBuffer, static_cast<INT>(vertexRange.start), 0, chunk.vertexCount, indexRange.start + residency[itr].lodIndexStart[lod],
+                chunk.lods[lod].primitiveCount, chunk.materialIndex, 0, 0, chunk.transformIndex, modelIndex };
+            if (isCulling && isAtRest && lod == 0 && chunk.clusterCount > 0)
+            {
+                //the chunk's vertex range starts at its first vertex, so the compacted indices are rebased like its own
+                const auto range = m_clusterCuller.AppendVisibleRebased(clusterView, clusterList.data() + chunk.clusterStart, chunk.clusterCount, modelManager.GetIndexSource(),
+                    chunk.vertexStart, chunk.indexStride == sizeof(uint32_t));
+                draw.indexBuffer = range.indexBuffer;
+                draw.indexStart = range.indexStart;
+                draw.primitiveCount = range.primitiveCount;
+            }
+            if (draw.primitiveCount > 0)
+                m_frameDraws.push_back(draw);
         }
     }
 
+    void D3D9Renderer::AppendInstancedDraws(uint32_t modelIndex)
+    {
+        auto& model = *m_models[modelIndex];
+        const auto& modelManager = model.manager;
+        const bool isStreaming = modelManager.IsGeometryStreaming();
+        const auto& groupList = modelManager.GetInstanceGroups();
+        const auto& instanceOffsets = modelManager.GetInstanceOffsets();
+        const auto& instanceTransforms = modelManager.GetInstanceTransforms();
+        const auto& subBatchList = modelManager.GetSubBatchList();
+        const auto& residency = model.streamer.GetResidency();
+        D3DXMATRIX identity;
+        D3DXMatrixIdentity(&identity);
+        const StreamingView worldLodView = BuildStreamingView(identity);
+        const ClusterView worldView = BuildClusterView(m_viewMat * m_projMat, worldLodView.position);
+        GeometryRange vertexRange = {};
+        GeometryRange index16Range = {};
+        GeometryRange index32Range = {};
+        if (!isStreaming)
+        {
+            vertexRange = m_geometryPool.GetRange(model.vertices);
+            if (model.indices16 != NoGeometry)
+                index16Range = m_geometryPool.GetRange(model.indices16);
+            if (model.indices32 != NoGeometry)
+                index32Range = m_geometryPool.GetRange(model.indices32);
+        }
+
+        model.groupLods.resize(groupList.size(), 0);
+        for (uint32_t itr = 0; itr < groupList.size(); ++itr)
+        {
+            const auto& group = groupList[itr];
+            if (isStreaming ? (group.chunkIndex >= residency.size() || !residency[group.chunkIndex].IsResident()) : !group.isResident)
+                continue;
+
+            const auto instanceStart = static_cast<UINT>(m_frameInstances.size());
+            const uint32_t instanceCount = AppendVisibleInstances(modelManager, instanceOffsets.data() + group.instanceStart, instanceTransforms.data() + group.instanceStart, group.instanceCount, 0,
+                group.lods, group.lodCount, group.center, group.radius, worldView, worldLodView, model.groupLods[itr]);
+            if (instanceCount == 0)
+                continue;
+
+            const uint32_t lod = model.groupLods[itr];
+            FrameDraw draw = {};
+            if (isStreaming)
+            {
+                const GeometryRange chunkVertices = m_geometryPool.GetRange(residency[group.chunkIndex].vertices);
+                const GeometryRange chunkIndices = m_geometryPool.GetRange(residency[group.chunkIndex].indices);
+                draw = { chunkVertices.vertexBuffer, chunkIndices.indexBuffer, static_cast<INT>(chunkVertices.start), 0, group.vertexCount,
+                    chunkIndices.start + residency[group.chunkIndex].lodIndexStart[lod], group.lods[lod].primitiveCount, group.materialIndex };
+            }
+            else
+            {
+                const auto& subBatch = subBatchList[group.subBatchStart + lod];
+                const GeometryRange& indexRange = subBatch.isIndex32 ? index32Range : index16Range;
+                draw = { vertexRange.vertexBuffer, indexRange.indexBuffer, static_cast<INT>(vertexRange.start + subBatch.baseVertex), 0, subBatch.vertexCount,
+                    indexRange.start + subBatch.indexStart, subBatch.primitiveCount, group.materialIndex };
+            }
+            draw.instanceStart = instanceStart;
+            draw.instanceCount = instanceCount;
+            draw.transformIndex = NoTransform; //every copy has its own node, applied in its instance matrix
+            draw.modelIndex = modelIndex;
+            if (draw.primitiveCount > 0)
+                m_frameDraws.push_back(draw);
+        }
+
+        //further placements of the model draw everything else instanced as well; their level is picked without hysteresis
+        //and their node moves are applied per draw, so the bounds they are culled by are the import pose
+        if (modelManager.GetPlacements().size() < 2)
+            return;
+
+        const D3DXVECTOR3 noOffset(0.0f, 0.0f, 0.0f);
+        if (isStreaming)
+        {
+            const auto& chunkList = modelManager.GetChunkList();
+            for (uint32_t itr = 0; itr < residency.size(); ++itr)
+            {
+                const auto& chunk = chunkList[itr];
+                if (!residency[itr].IsResident() || chunk.instanceGroup != NoInstanceGroup)
+                    continue;
+
+                uint32_t lod = 0;
+                const auto instanceStart = static_cast<UINT>(m_frameInstances.size());
+                const uint32_t instanceCount = AppendVisibleInstances(modelManager, &noOffset, nullptr, 1, 1, chunk.lods, chunk.lodCount, chunk.center, chunk.radius, worldView, worldLodView, lod);
+                if (instanceCount == 0)
+                    continue;
+                const GeometryRange chunkVertices = m_geometryPool.GetRange(residency[itr].vertices);
+                const GeometryRange chunkIndices = m_geometryPool.GetRange(residency[itr].indices);
+                m_frameDraws.push_back({ chunkVertices.vertexBuffer, chunkIndices.indexBuffer, static_cast<INT>(chunkVertices.start), 0, chunk.vertexCount,
+                    chunkIndices.start + residency[itr].lodIndexStart[lod], chunk.lods[lod].primitiveCount, chunk.materialIndex, instanceStart, instanceCount, chunk.transformIndex, modelIndex });
+            }
+            return;
+        }
+
+        const auto& batchList = modelManager.GetBatchList();
+        for (uint32_t itr = 0; itr < batchList.size(); ++itr)
+        {
+            const auto& batch = batchList[itr];
+            if (!batch.isResident || batch.primitiveCount == 0)
+                continue;
+
+            uint32_t lod = 0;
+            const auto instanceStart = static_cast<UINT>(m_frameInstances.size());
+            const uint32_t instanceCount = AppendVisibleInstances(modelManager, &noOffset, nullptr, 1, 1, batch.lods, batch.lodCount, batch.center, batch.radius, worldView, worldLodView, lod);
+            if (instanceCount == 0)
+                continue;
+            for (uint32_t subItr = 0; subItr < batch.subBatchCount[lod]; ++subItr)
+            {
+                const auto& subBatch = modelManager.GetSubBatch(batch.subBatchStart[lod] + subItr);
+                const GeometryRange& indexRange = subBatch.isIndex32 ? index32Range : index16Range;
+                AppendSubBatchDraw({ vertexRange.vertexBuffer, indexRange.indexBuffer, static_cast<INT>(vertexRange.start + subBatch.baseVertex), 0, subBatch.vertexCount,
+                    indexRange.start + subBatch.indexStart, subBatch.primitiveCount, itr, instanceStart, instanceCount, subBatch.transformIndex, modelIndex }, modelManager, subBatch);
+            }
+        }
+    }
+
+    uint32_t D3D9Renderer::AppendVisibleInstances(const ModelManager& modelManager, const D3DXVECTOR3* offsets, const uint32_t* transformIndices, uint32_t offsetCount, uint32_t firstPlacement,
+        const std::array<LodRange, MaxMeshLods>& lods, uint32_t lodCount, const D3DXVECTOR3& center, float radius, const ClusterView& worldView, const StreamingView& worldLodView, uint32_t& inOutLod)
+    {
+        //every copy is culled on its own; the draw uses the finest level any visible copy asks for
+        const auto& placements = modelManager.GetPlacements();
+        const auto& transforms = modelManager.GetTransforms();
+        uint32_t finestLod = lodCount - 1;
+        uint32_t instanceCount = 0;
+        for (uint32_t placement = firstPlacement; placement < placements.size(); ++placement)
+        {
+            for (uint32_t itr = 0; itr < offsetCount; ++itr)
+            {
+                D3DXMATRIX world;
+                D3DXMatrixTranslation(&world, offsets[itr].x, offsets[itr].y, offsets[itr].z);
+                if (transformIndices != nullptr && !transforms.IsAtRest(transformIndices[itr]))
+                    world *= transforms.GetDelta(transformIndices[itr]);
+                world *= placements[placement];
+
+                D3DXVECTOR3 worldCenter;
+                float worldRadius;
+                TransformSphere(center, radius, world, worldCenter, worldRadius);
+                if (!IsSphereInFrustum(worldView, worldCenter, worldRadius))
+                    continue;
+
+                if (SELECT_MESH_LODS)
+                    finestLod = (std::min)(finestLod, SelectLod(lods, lodCount, worldCenter, worldRadius, worldLodView.position, worldLodView.pixelsPerUnitAtUnitDistance, inOutLod));
+                else
+                    finestLod = 0;
+
+                //columns of the affine part, so the shader rebuilds the matrix from three float4s
+                InstanceVertex instance;
+                for (int32_t column = 0; column < 3; ++column)
+                {
+                    for (int32_t row = 0; row < 4; ++row)
+                        instance.worldColumns[column][row] = world(row, column);
+                }
+                m_frameInstances.push_back(instance);
+                ++instanceCount;
+            }
+        }
+
+        if (instanceCount > 0)
+        {
+            inOutLod = finestLod;
+            CountLodDraw(lods, finestLod, instanceCount);
+        }
+        return instanceCount;
+    }
+
+    void D3D9Renderer::SubmitFrameDraws()
+    {
+        const bool canInstance = !m_frameInstances.empty()
+            && m_instanceBuffer.Upload(m_device->GetRawDevicePtr(), m_frameInstances.data(), static_cast<uint32_t>(m_frameInstances.size()));
+        const D3DXMATRIX viewProjMat = m_viewMat * m_projMat;
+
+        IDirect3DVertexDeclaration9* boundDecl = nullptr;
+        IDirect3DVertexBuffer9* boundVertices = nullptr;
+        IDirect3DIndexBuffer9* boundIndices = nullptr;
+        bool isInstancing = false;
+        for (const auto& draw : m_frameDraws)
+        {
+            auto& modelManager = m_models[draw.modelIndex]->manager;
+            const bool isCompact = modelManager.GetVertexFormat() == VertexFormat::Compact;
+            IDirect3DVertexDeclaration9* instancedDecl = isCompact ? m_vertexDeclarations.compactInstancedDecl : m_vertexDeclarations.positionInstancedDecl;
+            //without the instance stream (the upload failed or the declaration is missing) every copy is drawn on its own
+            const bool isInstanced = draw.instanceCount > 0 && canInstance && instancedDecl != nullptr;
+            IDirect3DVertexDeclaration9* vertexDecl = isInstanced ? instancedDecl : (isCompact ? m_vertexDeclarations.compactVertexDecl : m_vertexDeclarations.positionVertexDecl);
+            if (vertexDecl != boundDecl)
+            {
+                m_device->SetVertexDeclaration(vertexDecl);
+                boundDecl = vertexDecl;
+            }
+            if (draw.vertexBuffer != boundVertices)
+            {
+                //pool pages hold a single stride, so the buffer decides it
+                m_device->SetStreamSource(0, draw.vertexBuffer, 0, modelManager.GetVertexStride());
+                boundVertices = draw.vertexBuffer;
+            }
+            if (draw.indexBuffer != boundIndices)
+            {
+                m_device->SetIndices(draw.indexBuffer);
+                boundIndices = draw.indexBuffer;
+            }
+            if (isInstanced)
+            {
+                //stream 0 repeats the indexed geometry instanceCount times, stream 1 advances one InstanceVertex per copy
+                m_device->SetStreamSourceFreq(0, D3DSTREAMSOURCE_INDEXEDDATA | draw.instanceCount);
+                m_device->SetStreamSource(1, m_instanceBuffer.GetVertexBuffer(), draw.instanceStart * sizeof(InstanceVertex), sizeof(InstanceVertex));
+                m_device->SetStreamSourceFreq(1, D3DSTREAMSOURCE_INSTANCEDATA | 1u);
+                isInstancing = true;
+            }
+            else if (isInstancing)
+            {
+                m_device->SetStreamSourceFreq(0, 1);
+                m_device->SetStreamSourceFreq(1, 1);
+                isInstancing = false;
+            }
+
+            //an instanced draw gets the node move alone: RenderInstancedVS applies it before each copy's own matrix
+            const auto& transforms = modelManager.GetTransforms();
+            const D3DXMATRIX& placement = modelManager.GetPlacements().front();
+            const bool isMoved = draw.transformIndex != NoTransform && !transforms.IsAtRest(draw.transformIndex);
+            if (isInstanced)
+            {
+                if (isMoved)
+                    m_worldMat = transforms.GetDelta(draw.transformIndex);
+                else
+                    D3DXMatrixIdentity(&m_worldMat);
+            }
+            else if (draw.instanceCount > 0)
+            {
+                for (UINT copy = 0; copy < draw.instanceCount; ++copy)
+                {
+                    const D3DXMATRIX instanceWorld = GetInstanceWorld(m_frameInstances[draw.instanceStart + copy]);
+                    m_worldMat = isMoved ? transforms.GetDelta(draw.transformIndex) * instanceWorld : instanceWorld;
+                    m_worldViewProjMat = m_worldMat * viewProjMat;
+                    RenderBatch(modelManager, false, draw.baseVertex, draw.minVertexIndex, draw.numVertices, draw.indexStart, draw.primitiveCount, draw.materialIndex);
+                }
+                continue;
+            }
+            else
+                m_worldMat = isMoved ? transforms.GetDelta(draw.transformIndex) * placement : placement;
+            m_worldViewProjMat = m_worldMat * viewProjMat;
+            RenderBatch(modelManager, isInstanced, draw.baseVertex, draw.minVertexIndex, draw.numVertices, draw.indexStart, draw.primitiveCount, draw.materialIndex);
+        }
+
+        if (isInstancing)
+        {
+            m_device->SetStreamSourceFreq(0, 1);
+            m_device->SetStreamSourceFreq(1, 1);
+            m_device->SetStreamSource(1, nullptr, 0, 0);
+        }
+    }
+
+    uint32_t D3D9Renderer::SelectDrawLod(std::vector<uint32_t>& drawLods, uint32_t itr, const std::array<LodRange, MaxMeshLods>& lods, uint32_t lodCount,
+        const D3DXVECTOR3& center, float radius, const StreamingView& view)
+    {
+        if (SELECT_MESH_LODS)
+            drawLods[itr] = SelectLod(lods, lodCount, center, radius, view.position, view.pixelsPerUnitAtUnitDistance, drawLods[itr]);
+
+        const uint32_t lod = (std::min)(drawLods[itr], lodCount - 1);
+        CountLodDraw(lods, lod, 1);
+        return lod;
+    }
+
+    void D3D9Renderer::CountLodDraw(const std::array<LodRange, MaxMeshLods>& lods, uint32_t lod, uint32_t instanceCount)
+    {
+        m_lodStats.fullTriangles += static_cast<uint64_t>(lods[0].primitiveCount) * instanceCount;
+        m_lodStats.drawnTriangles += static_cast<uint64_t>(lods[lod].primitiveCount) * instanceCount;
+        ++m_lodStats.drawsPerLod[lod];
+    }
+
+    void D3D9Renderer::ReportGeometryStats()
+    {
+        //only the last frame of each interval is reported, so the numbers match what is on screen
+        if (++m_lodFrame % LOD_REPORT_INTERVAL_FRAMES == 0 && m_lodStats.fullTriangles > 0)
+        {
+            const double saved = 100.0 * (1.0 - static_cast<double>(m_lodStats.drawnTriangles) / m_lodStats.fullTriangles);
+            std::ostringstream os;
+            os << std::fixed << std::setprecision(1);
+            os << "[LOD] drawn " << m_lodStats.drawnTriangles << " / " << m_lodStats.fullTriangles << " triangles (" << saved << " % fewer) | draws per level";
+            for (const auto draws : m_lodStats.drawsPerLod)
+                os << " " << draws;
+
+            const auto& clusterStats = m_clusterCuller.GetFrameStats();
+            if (clusterStats.clustersTested > 0)
+            {
+                const double culled = 100.0 * (1.0 - static_cast<double>(clusterStats.trianglesKept) / clusterStats.trianglesTested);
+                os << "\n[Clusters] kept " << clusterStats.trianglesKept << " / " << clusterStats.trianglesTested << " LOD0 triangles (" << culled << " % culled) | ";
+                os << clusterStats.clustersTested << " clusters: " << clusterStats.frustumCulled << " outside the frustum, " << clusterStats.backFacingCulled << " back facing";
+            }
+            Logger::GetInstance().LogInfo(os.str().c_str());
+            m_geometryPool.LogReport();
+        }
+        m_lodStats = LodFrameStats();
+    }
+
     void D3D9Renderer::PostRender()
     {
         m_device->EndScene();
@@ -175,9 +691,64 @@ namespace renderer
         ComResult(m_device->CreateVertexDeclaration(positionVertexElements, &m_vertexDeclarations.positionVertexDecl));
         assert(m_vertexDeclarations.positionVertexDecl);
 
+        if (SupportsCompactVertices())
+        {
+            //see CompactVertex; RenderCompactVS rebuilds the position, normal and bitangent
+            D3DVERTEXELEMENT9 compactVertexElements[] =
+            {
+                { defaultVal, defaultVal, D3DDECLTYPE_SHORT4N, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_POSITION, 0},
+                { defaultVal, 8, D3DDECLTYPE_SHORT2N, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_NORMAL, 0},
+                { defaultVal, 12, D3DDECLTYPE_UBYTE4N, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TANGENT, 0},
+                { defaultVal, 16, D3DDECLTYPE_FLOAT16_2, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 0 },
+                D3DDECL_END()
+            };
+            ComResult(m_device->CreateVertexDeclaration(compactVertexElements, &m_vertexDeclarations.compactVertexDecl));
+
+            D3DVERTEXELEMENT9 compactInstancedElements[] =
+            {
+                { defaultVal, defaultVal, D3DDECLTYPE_SHORT4N, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_POSITION, 0},
+                { defaultVal, 8, D3DDECLTYPE_SHORT2N, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_NORMAL, 0},
+                { defaultVal, 12, D3DDECLTYPE_UBYTE4N, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TANGENT, 0},
+                { defaultVal, 16, D3DDECLTYPE_FLOAT16_2, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 0 },
+                { 1, 0, D3DDECLTYPE_FLOAT4, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 1 },
+                { 1, 16, D3DDECLTYPE_FLOAT4, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 2 },
+                { 1, 32, D3DDECLTYPE_FLOAT4, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 3 },
+                D3DDECL_END()
+            };
+            ComResult(m_device->CreateVertexDeclaration(compactInstancedElements, &m_vertexDeclarations.compactInstancedDecl));
+        }
+
+        //stream 1 carries an InstanceVertex per copy for RenderInstancedVS
+        D3DVERTEXELEMENT9 positionInstancedElements[] =
+        {
+            { defaultVal, defaultVal, D3DDECLTYPE_FLOAT3, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_POSITION, 0},
+            { defaultVal, sizeof(float) * 3, D3DDECLTYPE_FLOAT3, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_NORMAL, 0},
+            { defaultVal, sizeof(float) * 6, D3DDECLTYPE_FLOAT2, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 0 },
+            { defaultVal, sizeof(float) * 8, D3DDECLTYPE_FLOAT3, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TANGENT, 0},
+            { defaultVal, sizeof(float) * 11, D3DDECLTYPE_FLOAT3, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_BINORMAL, 0},
+            { 1, 0, D3DDECLTYPE_FLOAT4, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 1 },
+            { 1, sizeof(float) * 4, D3DDECLTYPE_FLOAT4, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 2 },
+            { 1, sizeof(float) * 8, D3DDECLTYPE_FLOAT4, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 3 },
+            D3DDECL_END()
+        };
+        ComResult(m_device->CreateVertexDeclaration(positionInstancedElements, &m_vertexDeclarations.positionInstancedDecl));
+
         m_device->SetVertexDeclaration(m_vertexDeclarations.positionVertexDecl);
     }
 
+    bool D3D9Renderer::SupportsNonPow2Mipmaps() const
+    {
+        //NONPOW2CONDITIONAL still sets POW2, and it allows no mip levels
+        return (m_d3dCaps.TextureCaps & D3DPTEXTURECAPS_POW2) == 0;
+    }
+
+    bool D3D9Renderer::SupportsCompactVertices() const
+    {
+        //every type CompactVertex uses is optional in D3D9; FLOAT3/FLOAT2 (VertexFormat::Full) are the only guaranteed ones
+        constexpr DWORD requiredTypes = D3DDTCAPS_SHORT4N | D3DDTCAPS_SHORT2N | D3DDTCAPS_UBYTE4N | D3DDTCAPS_FLOAT16_2;
+        return (m_d3dCaps.DeclTypes & requiredTypes) == requiredTypes;
+    }
+
     void D3D9Renderer::BuildMatrices()
     {
         m_viewMat = m_camera.GetViewMatrix();
@@ -201,36 +772,49 @@ namespace renderer
         m_device->SetTransform(D3DTS_WORLD, m_worldMat);
     }
 
-    void D3D9Renderer::RenderBatch(UINT numVertices, UINT startIndex, UINT primitiveCount, UINT matIndex)
+    void D3D9Renderer::RenderBatch(ModelManager& modelManager, bool isInstanced, INT baseVertex, UINT minVertexIndex, UINT numVertices, UINT startIndex, UINT primitiveCount, UINT matIndex)
     {
         UINT numPasses(0);
 		std::map<D3DXHANDLE, D3DXTECHNIQUE_DESC> techniqueData = m_shader.GetTechniqueData();
+		//each vertex format has its own technique; only the one matching the bound declaration may run
+		const bool isCompact = modelManager.GetVertexFormat() == VertexFormat::Compact;
+		const char* techniqueName = isInstanced ? (isCompact ? "TexCompactInstanced" : "TexInstanced") : (isCompact ? "TexCompact" : "Tex");
 		
 		for (auto& keyVal : techniqueData)
 		{
+			if (strcmp(keyVal.second.Name, techniqueName) != 0)
+				continue;
 			m_shader.SetTechniqueAndBegin(keyVal.first);
 			for (uint32_t passItr = 0; passItr < keyVal.second.Passes; ++passItr)
 			{
 				m_shader.BeginPass(passItr);
-				this->SetShaderConstants();
-				m_modelManager.SetShaderInputsForMaterialIndex(matIndex, m_shader.GetRawPtr());
+				this->SetShaderConstants(modelManager);
+				modelManager.SetShaderInputsForMaterialIndex(matIndex, m_shader.GetRawPtr());
 				m_shader.ApplyPass();
-				m_device->DrawIndexedPrimitive(D3DPT_TRIANGLELIST, 0, 0, numVertices, startIndex, primitiveCount);
+				m_device->DrawIndexedPrimitive(D3DPT_TRIANGLELIST, baseVertex, minVertexIndex, numVertices, startIndex, primitiveCount);
 				m_shader.EndPass();
 			}
 			m_shader.EndTechnique();
 		}
     }
 
-	void D3D9Renderer::SetShaderConstants()
+	void D3D9Renderer::SetShaderConstants(const ModelManager& modelManager)
 	{
 		m_shader.GetRawPtr()->SetMatrix("g_WorldMat", &m_worldMat);
 		m_shader.GetRawPtr()->SetMatrix("g_worldViewProjMatrix", &m_worldViewProjMat);
+		const D3DXMATRIX viewProjMat = m_viewMat * m_projMat;
+		m_shader.GetRawPtr()->SetMatrix("g_viewProjMatrix", &viewProjMat);
 		m_shader.GetRawPtr()->SetVector("g_viewDirection", &D3DXVECTOR4(m_camera.GetCamPosition(), 1.0f));
+
+		const auto& quantization = modelManager.GetVertexQuantization();
+		m_shader.GetRawPtr()->SetVector("g_positionScale", &D3DXVECTOR4(quantization.scale, 0.0f));
+		m_shader.GetRawPtr()->SetVector("g_positionOffset", &D3DXVECTOR4(quantization.offset, 1.0f));
 	}
 
     void D3D9Renderer::OnDeviceLost()
     {
+        m_clusterCuller.ReleaseDeviceResources(); //default pool: has to go before the device can be reset
+        m_instanceBuffer.ReleaseDeviceResources();
         Sleep(200);
     }
 
@@ -288,16 +872,404 @@ namespace renderer
 
     void D3D9Renderer::AddModels()
     {
-		std::string filename = "data/Content/Sponza.fbx";
-		m_modelManager.AddModelToWorld(m_device->GetRawDevicePtr(), filename);
+		AddModel("data/Content/Sponza.fbx");
+    }
+
+    ModelHandle D3D9Renderer::AddModel(const std::string& filePath, const D3DXMATRIX* world)
+    {
+        for (uint32_t itr = 0; itr < m_models.size(); ++itr)
+        {
+            if (m_models[itr] != nullptr && m_models[itr]->manager.GetModelPath() == filePath)
+            {
+                m_models[itr]->manager.AddModelToWorld(m_device->GetRawDevicePtr(), filePath, ImportProfile::Production, world);
+                return itr;
+            }
+        }
+
+        auto model = std::make_unique<SceneModel>(m_geometryPool);
+        ConfigureModel(*model);
+        model->manager.AddModelToWorld(m_device->GetRawDevicePtr(), filePath, ImportProfile::Production, world);
+        if (HOT_RELOAD_MODELS && ::GetFileAttributesA(filePath.c_str()) != INVALID_FILE_ATTRIBUTES) //a pack-only install has nothing to watch
+            model->fileWatchIndex = m_fileWatcher.AddFileForWatch(filePath);
+
+        //a removed model's slot is taken first, so the list does not grow with every unload and load
+        const auto slot = std::find(m_models.begin(), m_models.end(), nullptr);
+        if (slot != m_models.end())
+        {
+            *slot = std::move(model);
+            return static_cast<ModelHandle>(slot - m_models.begin());
+        }
+        m_models.push_back(std::move(model));
+        return static_cast<ModelHandle>(m_models.size() - 1);
+    }
+
+    void D3D9Renderer::ConfigureModel(SceneModel& model) const
+    {
+        model.streamer.SetBudgets(STREAMING_UPLOAD_BUDGET_BYTES, STREAMING_RESIDENT_BUDGET_BYTES);
+        model.manager.SetGeometryStreaming(STREAM_SCENE_GEOMETRY);
+        model.manager.SetClusterCulling(CULL_MESH_CLUSTERS);
+        //a driver can still reject the declaration the caps allow; then the full format is drawn instead
+        const bool hasCompactDecl = m_vertexDeclarations.compactVertexDecl != nullptr;
+        model.manager.SetVertexFormat(SupportsCompactVertices() && hasCompactDecl ? SCENE_VERTEX_FORMAT : VertexFormat::Full);
+        model.manager.SetResidencyPolicy(SCENE_RESIDENCY_POLICY);
+        model.manager.SetNonPow2Mipmaps(SupportsNonPow2Mipmaps());
+        model.manager.SetMeshHashing(HOT_RELOAD_MODELS);
+    }
+
+    void D3D9Renderer::RemoveModel(ModelHandle handle)
+    {
+        if (handle >= m_models.size() || m_models[handle] == nullptr)
+            return;
+        auto& model = *m_models[handle];
+        if (model.fileWatchIndex != NoFileWatch)
+            m_fileWatcher.RemoveFileFromWatch(model.fileWatchIndex);
+        if (model.reload != nullptr)
+            ReleaseModelGeometry(*model.reload);
+        ReleaseModelGeometry(model);
+        //destroying a model waits for its import; one still running is parked until UpdateModelStreaming sees it end
+        if (IsImportRunning(model))
+            m_retiredModels.push_back(std::move(m_models[handle]));
+        m_models[handle].reset();
+    }
+
+    void D3D9Renderer::ReleaseModelGeometry(SceneModel& model)
+    {
+        model.streamer.ReleaseAll();
+        m_geometryPool.Free(model.vertices);
+        m_geometryPool.Free(model.indices16);
+        m_geometryPool.Free(model.indices32);
+        for (const auto& staged : model.stagedRanges)
+        {
+            m_geometryPool.Free(staged.vertices);
+            m_geometryPool.Free(staged.indices);
+        }
+        model.stagedRanges.clear();
+        model.vertices = NoGeometry;
+        model.indices16 = NoGeometry;
+        model.indices32 = NoGeometry;
+    }
+
+    bool D3D9Renderer::SetupStaticBuffers(SceneModel& model)
+    {
+        //empty ranges; UploadPendingBatches fills them one batch range at a time
+        const auto vertexCount = static_cast<uint32_t>(model.manager.GetVBufferCount());
+        const auto index16Count = static_cast<uint32_t>(model.manager.GetIndex16Data().size());
+        const auto index32Count = static_cast<uint32_t>(model.manager.GetIndex32Data().size());
+        model.vertices = m_geometryPool.AllocateVertices(m_device->GetRawDevicePtr(), model.manager.GetVertexStride(), vertexCount);
+        if (index16Count > 0)
+            model.indices16 = m_geometryPool.AllocateIndices(m_device->GetRawDevicePtr(), false, index16Count);
+        if (index32Count > 0)
+            model.indices32 = m_geometryPool.AllocateIndices(m_device->GetRawDevicePtr(), true, index32Count);
+        model.nextBatchToUpload = 0;
+
+        //all or nothing, so a draw never finds one of its ranges missing
+        if (model.vertices == NoGeometry || (index16Count > 0 && model.indices16 == NoGeometry) || (index32Count > 0 && model.indices32 == NoGeometry))
+        {
+            ReleaseModelGeometry(model);
+            return false;
+        }
+        return true;
+    }
+
+    void D3D9Renderer::UpdateModelStreaming()
+    {
+        //holes left by evicted chunks and removed models are closed before this frame allocates or draws
+        m_geometryPool.Compact();
+        m_retiredModels.erase(std::remove_if(m_retiredModels.begin(), m_retiredModels.end(), [](const std::unique_ptr<SceneModel>& model) { return !IsImportRunning(*model); }),
+            m_retiredModels.end());
+
+        Stopwatch frameTimer;
+        for (auto& model : m_models)
+        {
+            if (model == nullptr)
+                continue;
+            UpdateModelStreaming(*model, frameTimer);
+            if (HOT_RELOAD_MODELS)
+                UpdateModelReload(model, frameTimer);
+        }
+    }
+
+    void D3D9Renderer::StartModelReload(SceneModel& model)
+    {
+        model.isReloadRequested = false;
+        model.reload = std::make_unique<SceneModel>(m_geometryPool);
+        auto& reload = *model.reload;
+        ConfigureModel(reload);
+        reload.manager.SetTextureRevalidation(true); //the cache trusts known paths; an edited texture keeps its path
+        reload.manager.SetAssetSource(AssetSource::Loose); //the pack still holds the file as it was
+        const std::string filePath = model.manager.GetModelPath();
+        for (const auto& placement : model.manager.GetPlacements())
+            reload.manager.AddModelToWorld(m_device->GetRawDevicePtr(), filePath, ImportProfile::Production, &placement);
+        Logger::GetInstance().LogInfo(("[HotReload] " + filePath + " changed, re-importing").c_str());
+    }
+
+    void D3D9Renderer::UpdateModelReload(std::unique_ptr<SceneModel>& slot, const Stopwatch& frameTimer)
+    {
+        auto& model = *slot;
+        if (model.fileWatchIndex == NoFileWatch)
+            return;
+        //an exporter writes the file in several goes; the import starts once it has been left alone for a while
+        if (m_fileWatcher.IsFileModified(model.fileWatchIndex))
+        {
+            model.isReloadRequested = true;
+            model.reloadTimer.Restart();
+        }
+        if (model.reload == nullptr)
+        {
+            //a model whose import failed is retried too: fixing the file is the usual reason it changed
+            const ModelLoadState liveState = model.manager.GetLoadState();
+            if (model.isReloadRequested && model.reloadTimer.GetElapsedMs() >= HOT_RELOAD_SETTLE_MS && (liveState == ModelLoadState::Resident || liveState == ModelLoadState::Failed))
+                StartModelReload(model);
+            return;
+        }
+
+        //the live model keeps drawing until the reload is resident; nothing of the reload is drawn before
+        auto& reload = *model.reload;
+        auto& reloadManager = reload.manager;
+        if (reloadManager.GetLoadState() == ModelLoadState::Importing)
+        {
+            reloadManager.Update(FRAME_UPLOAD_BUDGET_MS);
+            if (reloadManager.GetLoadState() == ModelLoadState::Importing)
+                return;
+            if (reloadManager.GetLoadState() == ModelLoadState::Failed)
+            {
+                DropModelReload(model, "the file did not import");
+                return;
+            }
+            //when every range lines up with the live model's, only the changed ones are staged and written over it at the swap
+            if (!reloadManager.IsGeometryStreaming() && model.vertices != NoGeometry && IsSameGeometryLayout(model.manager, reloadManager))
+                reload.patchedModel = &model.manager;
+            return;
+        }
+
+        if (reloadManager.IsGeometryStreaming())
+        {
+            //the unchanged chunks move over in the swap; the changed ones stream in afterwards, nearest first
+            if (reloadManager.GetLoadState() != ModelLoadState::Resident)
+                reloadManager.Update(FRAME_UPLOAD_BUDGET_MS);
+            if (reloadManager.GetLoadState() != ModelLoadState::Resident)
+                return;
+            reload.keptRanges = reload.streamer.AdoptUnchangedChunks(model.streamer, model.manager, reloadManager);
+        }
+        else
+        {
+            UpdateModelStreaming(reload, frameTimer);
+            if (reloadManager.GetLoadState() != ModelLoadState::Resident)
+                return;
+            if (reload.isStagingFailed)
+            {
+                DropModelReload(model, "the geometry pool had no room to stage the changed ranges");
+                return;
+            }
+        }
+        FinishModelReload(slot);
+    }
+
+    void D3D9Renderer::FinishModelReload(std::unique_ptr<SceneModel>& slot)
+    {
+        Stopwatch swapTimer;
+        auto& model = *slot;
+        auto reload = std::move(model.reload);
+        if (reload->patchedModel != nullptr)
+        {
+            //the live ranges change in the frame the reload's batch table replaces the old one, before either is drawn,
+            //so no frame mixes old and new sub-batches
+            const auto& subBatchList = reload->manager.GetSubBatchList();
+            for (const auto& staged : reload->stagedRanges)
+            {
+                const auto& subBatch = subBatchList[staged.subBatchIndex];
+                if (staged.vertices != NoGeometry)
+                    m_geometryPool.Copy(staged.vertices, model.vertices, subBatch.baseVertex);
+                if (staged.indices != NoGeometry)
+                    m_geometryPool.Copy(staged.indices, subBatch.isIndex32 ? model.indices32 : model.indices16, subBatch.indexStart);
+                m_geometryPool.Free(staged.vertices);
+                m_geometryPool.Free(staged.indices);
+            }
+            reload->stagedRanges.clear();
+            //the ranges belong to the reload now
+            reload->vertices = model.vertices;
+            reload->indices16 = model.indices16;
+            reload->indices32 = model.indices32;
+            model.vertices = NoGeometry;
+            model.indices16 = NoGeometry;
+            model.indices32 = NoGeometry;
+            reload->patchedModel = nullptr;
+        }
+        ReleaseModelGeometry(model);
+
+        //placements added while the reload was importing
+        const auto& placements = model.manager.GetPlacements();
+        for (size_t itr = reload->manager.GetPlacements().size(); itr < placements.size(); ++itr)
+            reload->manager.AddModelToWorld(m_device->GetRawDevicePtr(), model.manager.GetModelPath(), ImportProfile::Production, &placements[itr]);
+
+        //the levels drawn last frame only carry over to tables of the same shape, clamped to each entry's new level count;
+        //otherwise every entry starts again at LOD0
+        auto carryLods = [](std::vector<uint32_t>& lods, std::vector<uint32_t>& previousLods, const auto& table)
+        {
+            lods.clear();
+            if (previousLods.size() != table.size())
+                return;
+            lods = std::move(previousLods);
+            for (size_t itr = 0; itr < table.size(); ++itr)
+                lods[itr] = (std::min)(lods[itr], table[itr].lodCount - 1);
+        };
+        carryLods(reload->batchLods, model.batchLods, reload->manager.GetBatchList());
+        carryLods(reload->chunkLods, model.chunkLods, reload->manager.GetChunkList());
+        carryLods(reload->groupLods, model.groupLods, reload->manager.GetInstanceGroups());
+
+        std::ostringstream os;
+        os << std::fixed << std::setprecision(1);
+        os << "[HotReload] " << model.manager.GetModelPath() << " swapped in, " << reload->reloadTimer.GetElapsedMs() << " ms after the re-import started, swap "
+            << swapTimer.GetElapsedMs() << " ms | ";
+        if (reload->manager.IsGeometryStreaming())
+        {
+            const auto chunkCount = static_cast<uint32_t>(reload->manager.GetChunkList().size());
+            os << reload->keptRanges << " of " << chunkCount << " chunks kept, " << chunkCount - reload->keptRanges << " to stream";
+        }
+        else
+            os << reload->uploadedRanges << " ranges uploaded, " << reload->keptRanges << " unchanged" << (reload->uploadedRanges + reload->keptRanges > 0 && reload->keptRanges > 0 ? " (patched in place)" : "");
+        Logger::GetInstance().LogInfo(os.str().c_str());
+
+        reload->fileWatchIndex = model.fileWatchIndex;
+        reload->isReloadRequested = model.isReloadRequested; //written again while importing: goes round once more
+        reload->reloadTimer = model.reloadTimer;
+        slot = std::move(reload); //the old model and its textures go; the cache keeps whatever the reload shares
+    }
+
+    void D3D9Renderer::DropModelReload(SceneModel& model, const char* reason)
+    {
+        Logger::GetInstance().LogInfo(("[HotReload] " + model.manager.GetModelPath() + " failed: " + reason + ", keeping the live model").c_str());
+        ReleaseModelGeometry(*model.reload);
+        model.reload.reset();
+    }
+
+    void D3D9Renderer::UpdateModelStreaming(SceneModel& model, const Stopwatch& frameTimer)
+    {
+        auto& modelManager = model.manager;
+        if (modelManager.IsGeometryStreaming())
+        {
+            if (modelManager.GetLoadState() != ModelLoadState::Resident)
+                modelManager.Update(FRAME_UPLOAD_BUDGET_MS);
+            //textures keep finalizing in parallel; chunks draw with placeholders until theirs arrive
+            if (modelManager.HasGeometry())
+                model.streamer.Update(m_device->GetRawDevicePtr(), modelManager, BuildStreamingView(modelManager.GetPlacements().front()));
+            return;
+        }
+
+        if (modelManager.GetLoadState() == ModelLoadState::Resident || modelManager.GetLoadState() == ModelLoadState::Failed)
+            return;
+
+        modelManager.Update(FRAME_UPLOAD_BUDGET_MS);
+        if (modelManager.GetLoadState() != ModelLoadState::Uploading)
+            return;
+
+        //a patching reload takes over the live model's ranges at the swap; until then it only stages what changed
+        if (model.patchedModel == nullptr && model.vertices == NoGeometry && !SetupStaticBuffers(model))
+            return; //the pool could not get a page; the failure is in its report and the next frame tries again
+
+        UploadPendingBatches(model, frameTimer);
+    }
+
+    void D3D9Renderer::UploadPendingBatches(SceneModel& model, const Stopwatch& frameTimer)
+    {
+        auto& modelManager = model.manager;
+        const auto& batchList = modelManager.GetBatchList();
+        const auto& groupList = modelManager.GetInstanceGroups();
+
+        //batches first, then the instance groups; at least one per frame so a slow texture frame cannot starve the geometry
+        while (model.nextBatchToUpload < batchList.size() + groupList.size())
+        {
+            Stopwatch uploadTimer;
+            if (model.nextBatchToUpload < batchList.size())
+            {
+                const auto& batch = batchList[model.nextBatchToUpload];
+                for (uint32_t level = 0; level < batch.lodCount; ++level)
+                {
+                    for (uint32_t subItr = 0; subItr < batch.subBatchCount[level]; ++subItr)
+                        UploadSubBatch(model, batch.subBatchStart[level] + subItr, level == 0);
+                }
+                modelManager.MarkBatchResident(model.nextBatchToUpload, uploadTimer.GetElapsedMs());
+            }
+            else
+            {
+                const auto groupIndex = static_cast<uint32_t>(model.nextBatchToUpload - batchList.size());
+                const auto& group = groupList[groupIndex];
+                for (uint32_t level = 0; level < group.lodCount; ++level)
+                    UploadSubBatch(model, group.subBatchStart + level, level == 0);
+                modelManager.MarkInstanceGroupResident(groupIndex, uploadTimer.GetElapsedMs());
+            }
+            ++model.nextBatchToUpload;
+
+            if (frameTimer.GetElapsedMs() >= FRAME_UPLOAD_BUDGET_MS)
+                break;
+        }
+    }
+
+    void D3D9Renderer::UploadSubBatch(SceneModel& model, uint32_t subBatchIndex, bool withVertices)
+    {
+        const auto& modelManager = model.manager;
+        const auto& subBatch = modelManager.GetSubBatchList()[subBatchIndex];
+        if (subBatch.repeatOf != NoSubBatch)
+            return; //its indices went up with the sub-batch it repeats
+        //a reload patching the live ranges leaves what they have already
+        if (model.patchedModel != nullptr && subBatch.contentHash != 0 && subBatch.contentHash == model.patchedModel->GetSubBatchList()[subBatchIndex].contentHash)
+        {
+            ++model.keptRanges;
+            return;
+        }
+        ++model.uploadedRanges;
+
+        //every level of a sub-batch shares LOD0's vertices, so they go up once; duplicates are not in the device range
+        const bool hasVertices = withVertices && subBatch.vertexCount > 0;
+        const uint8_t* vertices = modelManager.GetVertexImageData() + modelManager.GetVertexStride() * subBatch.sourceVertex;
+        const UINT indexCount = subBatch.primitiveCount * 3;
+        const void* indices = subBatch.isIndex32 ? static_cast<const void*>(modelManager.GetIndex32Data().data() + subBatch.indexStart) :
+            static_cast<const void*>(modelManager.GetIndex16Data().data() + subBatch.indexStart);
+
+        if (model.patchedModel != nullptr)
+        {
+            //the live model still draws its ranges; the new contents wait in ranges of their own
+            IDirect3DDevice9* device = m_device->GetRawDevicePtr();
+            StagedRange staged = { subBatchIndex, NoGeometry, NoGeometry };
+            if (hasVertices)
+                staged.vertices = m_geometryPool.AllocateVertices(device, modelManager.GetVertexStride(), subBatch.vertexCount);
+            if (indexCount > 0)
+                staged.indices = m_geometryPool.AllocateIndices(device, subBatch.isIndex32, indexCount);
+            if ((hasVertices && staged.vertices == NoGeometry) || (indexCount > 0 && staged.indices == NoGeometry))
+            {
+                m_geometryPool.Free(staged.vertices);
+                m_geometryPool.Free(staged.indices);
+                model.isStagingFailed = true;
+                return;
+            }
+            if (hasVertices)
+                m_geometryPool.Write(staged.vertices, 0, subBatch.vertexCount, vertices);
+            if (indexCount > 0)
+                m_geometryPool.Write(staged.indices, 0, indexCount, indices);
+            model.stagedRanges.push_back(staged);
+            return;
+        }
+
+        if (hasVertices)
+            m_geometryPool.Write(model.vertices, subBatch.baseVertex, subBatch.vertexCount, vertices);
+        if (indexCount > 0)
+            m_geometryPool.Write(subBatch.isIndex32 ? model.indices32 : model.indices16, subBatch.indexStart, indexCount, indices);
     }
 
-    void D3D9Renderer::SetupStaticBuffers()
+    StreamingView D3D9Renderer::BuildStreamingView(const D3DXMATRIX& world) const
     {
-        ComResult(m_device->CreateVertexBuffer((sizeof(PositionVertex) * m_modelManager.GetVBufferCount()), NULL, NULL, D3DPOOL_MANAGED, m_vBuffer, nullptr));
-        ComResult(m_device->CreateIndexBuffer(m_modelManager.GetIBufferCount() * sizeof(uint32_t), NULL, D3DFMT_INDEX32, D3DPOOL_MANAGED, m_iBuffer, nullptr));
+        //the view matrix is left handed: its third column is the camera's forward axis in world space
+        const D3DXVECTOR3 position = m_camera.GetCamPosition();
+        const D3DXVECTOR3 forward(m_viewMat(0, 2), m_viewMat(1, 2), m_viewMat(2, 2));
 
-        m_vBuffer.AddDataToBuffer(m_modelManager.GetVertexBufferData().data(), NULL, sizeof(PositionVertex) * m_modelManager.GetVBufferCount());
-        m_iBuffer.AddDataToBuffer(m_modelManager.GetIndexBufferData().data(), NULL, sizeof(uint32_t) * m_modelManager.GetIBufferCount());
+        //bounds and LOD errors stay in model space; moving the camera in is cheaper than moving every bound out
+        D3DXMATRIX worldInverse;
+        D3DXMatrixInverse(&worldInverse, nullptr, &world);
+        StreamingView view;
+        D3DXVec3TransformCoord(&view.position, &position, &worldInverse);
+        D3DXVec3TransformNormal(&view.forward, &forward, &worldInverse);
+        D3DXVec3Normalize(&view.forward, &view.forward);
+        view.pixelsPerUnitAtUnitDistance = m_projMat(1, 1) * static_cast<float>(SCREEN_HEIGHT) * 0.5f;
+        return view;
     }
 }
\ No newline at end of file
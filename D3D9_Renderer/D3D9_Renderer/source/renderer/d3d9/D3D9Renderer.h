@@ -7,23 +7,127 @@
 #include <d3d9.h>
 #include <memory>
 #include <vector>
+#include <array>
 
 #include "../GfxRendererBase.h"
 #include "D3D9Device.h"
-#include "StaticBuffer.hpp"
+#include "GeometryPool.h"
 #include "../Model.h"
 #include "VertexDefs.h"
+#include "InstanceBuffer.h"
 #include "../Camera.h"
 #include "../../enginecore/ModelManager.h"
 #include"../../enginecore/Batch.h"
 #include"../../enginecore/FileWatcher.h"
+#include"../../enginecore/SceneStreamer.h"
+#include"../../enginecore/ClusterCuller.h"
 
 constexpr int16_t SHADER_VERSION = 3;
 constexpr auto SCREEN_HEIGHT = 720;
 constexpr auto SCREEN_WIDTH = 1280;
+constexpr double FRAME_UPLOAD_BUDGET_MS = 4.0; //render-thread time a frame may spend finalizing streamed-in models
+constexpr bool STREAM_SCENE_GEOMETRY = false;  //opt-in: upload mesh chunks by camera priority instead of the whole model
+constexpr size_t STREAMING_UPLOAD_BUDGET_BYTES = 4 * 1024 * 1024;    //geometry uploaded per frame
+constexpr size_t STREAMING_RESIDENT_BUDGET_BYTES = 64 * 1024 * 1024; //streamed geometry kept in device buffers
+constexpr bool SELECT_MESH_LODS = true;         //draw the coarsest level whose error stays under a pixel
+constexpr bool CULL_MESH_CLUSTERS = false;      //opt-in: reject LOD0 clusters outside the frustum or facing away on the CPU
+constexpr renderer::VertexFormat SCENE_VERTEX_FORMAT = renderer::VertexFormat::Compact; //falls back to Full without the declaration types
+constexpr renderer::ResidencyPolicy SCENE_RESIDENCY_POLICY = renderer::ResidencyPolicy::ReleaseAfterUpload; //free the import data once resident
+constexpr uint32_t LOD_REPORT_INTERVAL_FRAMES = 600;
+constexpr bool HOT_RELOAD_MODELS = false;       //opt-in, dev builds: re-import a model file when it changes on disk and swap it in once resident
+constexpr double HOT_RELOAD_SETTLE_MS = 500.0;  //quiet time after the last write, so an export in progress is not read half done
+constexpr auto ASSET_PACK_PATH = "data.pack";   //built by the AssetPacker; paths it does not hold are read loose
 
 namespace renderer
 {
+    //>One draw call of the frame, collected first so the cluster culler's index buffers are unlocked before any draw
+    struct FrameDraw
+    {
+        IDirect3DVertexBuffer9* vertexBuffer;
+        IDirect3DIndexBuffer9* indexBuffer;
+        INT baseVertex; //added to every index, so 16-bit indices can address anywhere in the vertex buffer
+        UINT minVertexIndex;
+        UINT numVertices;
+        UINT indexStart;
+        UINT primitiveCount;
+        UINT materialIndex;
+        UINT instanceStart; //first InstanceVertex of the frame's instance buffer
+        UINT instanceCount; //0 for a plain draw of the model at its first placement
+        UINT transformIndex; //scene node whose move since import the draw applies, NoTransform when the instances carry it
+        UINT modelIndex;     //entry of the model list whose materials, vertex format and placement the draw uses
+    };
+
+    //>Index into the renderer's model list; stays valid until RemoveModel
+    using ModelHandle = uint32_t;
+    constexpr size_t NoFileWatch = SIZE_MAX; //hot reload is off, or only the pack holds the model: nothing on disk to watch
+
+    //>A changed sub-batch of a patching reload, held in ranges of its own until the swap copies it over the live ones
+    struct StagedRange
+    {
+        uint32_t subBatchIndex;
+        GeometryHandle vertices; //NoGeometry past LOD0, whose levels share its vertices
+        GeometryHandle indices;
+    };
+
+    //>One loaded model file and its ranges in the geometry pool; every placement of the file shares them
+    struct SceneModel
+    {
+        explicit SceneModel(GeometryPool& geometryPool)
+            :manager(),
+            streamer(geometryPool),
+            vertices(NoGeometry),
+            indices16(NoGeometry),
+            indices32(NoGeometry),
+            nextBatchToUpload(0),
+            batchLods(),
+            chunkLods(),
+            groupLods(),
+            fileWatchIndex(NoFileWatch),
+            isReloadRequested(false),
+            reloadTimer(),
+            reload(),
+            patchedModel(nullptr),
+            stagedRanges(),
+            isStagingFailed(false),
+            uploadedRanges(0),
+            keptRanges(0)
+        {}
+
+        ModelManager manager;
+        SceneStreamer streamer;   //streamed models only: per chunk ranges instead of the three below
+        GeometryHandle vertices;
+        GeometryHandle indices16; //16-bit sub-batches
+        GeometryHandle indices32; //sub-batches too large for 16-bit indices, usually none
+        uint32_t nextBatchToUpload;
+        std::vector<uint32_t> batchLods;  //level drawn last frame, per batch
+        std::vector<uint32_t> chunkLods;  //level drawn last frame, per streamed chunk
+        std::vector<uint32_t> groupLods;  //level drawn last frame, per instance group
+
+        size_t fileWatchIndex;
+        bool isReloadRequested;
+        Stopwatch reloadTimer;              //since the last write to the file; on a reload, since it started
+        std::unique_ptr<SceneModel> reload; //re-import of the file, not drawn until it replaces this entry
+        const ModelManager* patchedModel;   //on a reload with the same layout: the live model whose ranges it takes over at the swap
+        std::vector<StagedRange> stagedRanges; //patching reload: what it writes over those ranges, all in the frame of the swap
+        bool isStagingFailed;               //the pool had no room to stage a changed range
+        uint32_t uploadedRanges;            //sub-batches written to the pool
+        uint32_t keptRanges;                //sub-batches or chunks a reload found unchanged
+    };
+
+    //>Triangles submitted this frame against what LOD0 everywhere would have cost
+    struct LodFrameStats
+    {
+        LodFrameStats()
+            :fullTriangles(0),
+            drawnTriangles(0),
+            drawsPerLod()
+        {}
+
+        uint64_t fullTriangles;
+        uint64_t drawnTriangles;
+        std::array<uint32_t, MaxMeshLods> drawsPerLod;
+    };
+
 	//>Singleton Class
 	class D3D9Renderer :
 		public GfxRendererBase
@@ -52,19 +156,51 @@ namespace renderer
         [[nodiscard]] DWORD GetSupportedFeaturesBehavioralFlags() const;
 		[[nodiscard]] HRESULT CheckMultiSampleSupport(const D3DMULTISAMPLE_TYPE type, DWORD* quality, const bool isWindowed) const;
 		[[nodiscard]] bool CheckShaderVersionSupport(int16_t version) const;
+		[[nodiscard]] bool SupportsNonPow2Mipmaps() const;
+		[[nodiscard]] bool SupportsCompactVertices() const;
 		
         [[nodiscard]] HRESULT CreateD3DDevice(D3DPRESENT_PARAMETERS * d3dpp);
         
         void AddModels();
+        //>Starts importing the file, or places an already loaded one again at world; both share one entry
+        ModelHandle AddModel(const std::string& filePath, const D3DXMATRIX* world = nullptr);
+        //>Returns the model's geometry ranges to the pool; every placement of it goes
+        void RemoveModel(ModelHandle handle);
 
 	private:
         void SetupDeviceConfiguration();
         void SetupVertexDeclaration();
 		void BuildMatrices();
 		void UpdateMatrices();
-		void SetupStaticBuffers();
-		void RenderBatch(UINT numVertices, UINT startIndex, UINT primitiveCount, UINT matIndex);
-		void SetShaderConstants();
+		//>Takes the model's vertex and index ranges from the pool; false, with nothing held, when a page could not be created
+		[[nodiscard]] bool SetupStaticBuffers(SceneModel& model);
+		void ReleaseModelGeometry(SceneModel& model);
+		void ConfigureModel(SceneModel& model) const;
+		void StartModelReload(SceneModel& model);
+		void UpdateModelReload(std::unique_ptr<SceneModel>& slot, const Stopwatch& frameTimer);
+		void FinishModelReload(std::unique_ptr<SceneModel>& slot);
+		//>Throws the reload away and keeps drawing the live model, which a later write to the file retries
+		void DropModelReload(SceneModel& model, const char* reason);
+		void UpdateModelStreaming();
+		void UpdateModelStreaming(SceneModel& model, const Stopwatch& frameTimer);
+		void UploadPendingBatches(SceneModel& model, const Stopwatch& frameTimer);
+		void AppendBatchDraws(uint32_t modelIndex, bool isCulling);
+		void AppendStreamedChunks(uint32_t modelIndex, bool isCulling);
+		void AppendInstancedDraws(uint32_t modelIndex);
+		[[nodiscard]] uint32_t AppendVisibleInstances(const ModelManager& modelManager, const D3DXVECTOR3* offsets, const uint32_t* transformIndices, uint32_t offsetCount, uint32_t firstPlacement, const std::array<LodRange, MaxMeshLods>& lods,
+			uint32_t lodCount, const D3DXVECTOR3& center, float radius, const ClusterView& worldView, const StreamingView& worldLodView, uint32_t& inOutLod);
+		//>Queues draw, or one copy of it per node span once a node of the sub-batch has moved
+		void AppendSubBatchDraw(const FrameDraw& draw, const ModelManager& modelManager, const SubBatchDesc& subBatch);
+		void UploadSubBatch(SceneModel& model, uint32_t subBatchIndex, bool withVertices);
+		void CountLodDraw(const std::array<LodRange, MaxMeshLods>& lods, uint32_t lod, uint32_t instanceCount);
+		[[nodiscard]] uint32_t SelectDrawLod(std::vector<uint32_t>& drawLods, uint32_t itr, const std::array<LodRange, MaxMeshLods>& lods, uint32_t lodCount,
+			const D3DXVECTOR3& center, float radius, const StreamingView& view);
+		void SubmitFrameDraws();
+		void ReportGeometryStats();
+		//>Camera in the model space of the given world matrix, where the bounds and LOD errors are
+		[[nodiscard]] StreamingView BuildStreamingView(const D3DXMATRIX& world) const;
+		void RenderBatch(ModelManager& modelManager, bool isInstanced, INT baseVertex, UINT minVertexIndex, UINT numVertices, UINT startIndex, UINT primitiveCount, UINT matIndex);
+		void SetShaderConstants(const ModelManager& modelManager);
 
 		int32_t m_vBufferVertexCount;
 		int32_t m_iBufferIndexCount;
@@ -74,9 +210,6 @@ namespace renderer
 		IDirect3D9* m_d3d9;
 		Shader m_shader;
 		
-		StaticBuffer<IDirect3DVertexBuffer9> m_vBuffer;
-		StaticBuffer<IDirect3DIndexBuffer9> m_iBuffer;
-
         VertexDeclContainer m_vertexDeclarations;
 		Camera m_camera;
 
@@ -87,7 +220,15 @@ namespace renderer
 
 		std::unique_ptr<D3D9Device> m_device;
 		HWND m_hWindow;
-        ModelManager m_modelManager;
+        GeometryPool m_geometryPool; //ahead of m_models: their streamers return ranges to it when destroyed
+        std::vector<std::unique_ptr<SceneModel>> m_models; //null where a model was removed, so handles stay stable
+        std::vector<std::unique_ptr<SceneModel>> m_retiredModels; //removed while an import was running; destroyed once it ends
+        ClusterCuller m_clusterCuller;
+        std::vector<FrameDraw> m_frameDraws;
+        std::vector<InstanceVertex> m_frameInstances;
+        InstanceBuffer m_instanceBuffer;
+        LodFrameStats m_lodStats;
+        uint32_t m_lodFrame;
         FileWatcher m_fileWatcher;
         size_t m_shaderFileWatchIndex;
 	};
@@ -0,0 +1,283 @@
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+
+#include "GeometryPool.h"
+#include "../../utils/ComHelpers.h"
+#include "../../utils/Logger.h"
+#include "../../utils/MemoryStats.h"
+#include "../../utils/Time.h"
+
+namespace renderer
+{
+    GeometryPool::GeometryPool()
+        :m_pages(),
+        m_allocations(),
+        m_freeHandles(),
+        m_failedAllocations(0),
+        m_compactions(0),
+        m_compactionMovedBytes(0),
+        m_compactionMs(0.0)
+    {
+    }
+
+    GeometryPool::~GeometryPool()
+    {
+        ReleaseAll();
+    }
+
+    GeometryHandle GeometryPool::AllocateVertices(IDirect3DDevice9* device, uint32_t vertexStride, uint32_t vertexCount)
+    {
+        return Allocate(device, false, vertexStride, vertexCount);
+    }
+
+    GeometryHandle GeometryPool::AllocateIndices(IDirect3DDevice9* device, bool isIndex32, uint32_t indexCount)
+    {
+        return Allocate(device, true, isIndex32 ? sizeof(uint32_t) : sizeof(uint16_t), indexCount);
+    }
+
+    GeometryHandle GeometryPool::Allocate(IDirect3DDevice9* device, bool isIndex, uint32_t elementSize, uint32_t count)
+    {
+        assert(count > 0);
+        auto isMatch = [isIndex, elementSize](const Page& page) { return (page.indexBuffer != nullptr) == isIndex && page.elementSize == elementSize; };
+
+        //an existing page first, then one whose holes add up to enough once compacted, then a new page
+        uint32_t pageIndex = 0;
+        uint32_t offset = RangeAllocator::InvalidOffset;
+        for (; pageIndex < m_pages.size() && offset == RangeAllocator::InvalidOffset; ++pageIndex)
+        {
+            if (isMatch(m_pages[pageIndex]))
+                offset = m_pages[pageIndex].allocator.Allocate(count);
+        }
+        for (uint32_t itr = 0; itr < m_pages.size() && offset == RangeAllocator::InvalidOffset; ++itr)
+        {
+            if (!isMatch(m_pages[itr]) || m_pages[itr].allocator.GetFreeCount() < count)
+                continue;
+            CompactPage(itr);
+            offset = m_pages[itr].allocator.Allocate(count);
+            pageIndex = itr + 1;
+        }
+        if (offset == RangeAllocator::InvalidOffset)
+        {
+            const uint32_t pageBytes = isIndex ? GeometryPoolIndexPageBytes : GeometryPoolVertexPageBytes;
+            if (!CreatePage(device, isIndex, elementSize, (std::max)(pageBytes / elementSize, count)))
+            {
+                ++m_failedAllocations;
+                return NoGeometry;
+            }
+            offset = m_pages.back().allocator.Allocate(count);
+            pageIndex = static_cast<uint32_t>(m_pages.size());
+        }
+        --pageIndex; //the loops leave it one past the page that served the request
+
+        GeometryHandle handle;
+        if (!m_freeHandles.empty())
+        {
+            handle = m_freeHandles.back();
+            m_freeHandles.pop_back();
+        }
+        else
+        {
+            handle = static_cast<GeometryHandle>(m_allocations.size());
+            m_allocations.emplace_back();
+        }
+        m_allocations[handle] = { pageIndex, offset, count, true };
+        return handle;
+    }
+
+    bool GeometryPool::CreatePage(IDirect3DDevice9* device, bool isIndex, uint32_t elementSize, uint32_t capacity)
+    {
+        //not write-only: compaction reads the moved ranges back out of the runtime's copy
+        Page page = { nullptr, nullptr, elementSize, RangeAllocator(capacity) };
+        const UINT bytes = capacity * elementSize;
+        const HRESULT result = isIndex
+            ? device->CreateIndexBuffer(bytes, NULL, elementSize == sizeof(uint32_t) ? D3DFMT_INDEX32 : D3DFMT_INDEX16, D3DPOOL_MANAGED, &page.indexBuffer, nullptr)
+            : device->CreateVertexBuffer(bytes, NULL, NULL, D3DPOOL_MANAGED, &page.vertexBuffer, nullptr);
+        if (FAILED(result))
+            return false;
+        m_pages.push_back(page);
+        return true;
+    }
+
+    void GeometryPool::Free(GeometryHandle handle)
+    {
+        if (handle == NoGeometry)
+            return;
+        auto& allocation = m_allocations[handle];
+        assert(allocation.isLive);
+        m_pages[allocation.page].allocator.Free(allocation.start, allocation.count);
+        allocation.isLive = false;
+        m_freeHandles.push_back(handle);
+    }
+
+    GeometryRange GeometryPool::GetRange(GeometryHandle handle) const
+    {
+        const auto& allocation = m_allocations[handle];
+        assert(allocation.isLive);
+        const auto& page = m_pages[allocation.page];
+        return { page.vertexBuffer, page.indexBuffer, allocation.start, allocation.count };
+    }
+
+    bool GeometryPool::Write(GeometryHandle handle, uint32_t firstElement, uint32_t count, const void* data)
+    {
+        const auto& allocation = m_allocations[handle];
+        assert(allocation.isLive && firstElement + count <= allocation.count);
+        const auto& page = m_pages[allocation.page];
+        void* bufferData = LockPage(page, allocation.start + firstElement, count);
+        if (bufferData == nullptr)
+            return false;
+        memcpy(bufferData, data, static_cast<size_t>(count) * page.elementSize);
+        UnlockPage(page);
+        return true;
+    }
+
+    bool GeometryPool::Copy(GeometryHandle source, GeometryHandle destination, uint32_t firstElement)
+    {
+        const auto& allocation = m_allocations[source];
+        assert(allocation.isLive);
+        const auto& page = m_pages[allocation.page];
+        //both may sit on one page, whose buffer is only locked once at a time: the source goes through system memory
+        const auto* sourceData = static_cast<const uint8_t*>(LockPage(page, allocation.start, allocation.count));
+        if (sourceData == nullptr)
+            return false;
+        const std::vector<uint8_t> elements(sourceData, sourceData + static_cast<size_t>(allocation.count) * page.elementSize);
+        UnlockPage(page);
+        return Write(destination, firstElement, allocation.count, elements.data());
+    }
+
+    void* GeometryPool::Lock(GeometryHandle handle)
+    {
+        const auto& allocation = m_allocations[handle];
+        assert(allocation.isLive);
+        return LockPage(m_pages[allocation.page], allocation.start, allocation.count);
+    }
+
+    void GeometryPool::Unlock(GeometryHandle handle)
+    {
+        UnlockPage(m_pages[m_allocations[handle].page]);
+    }
+
+    void* GeometryPool::LockPage(const Page& page, uint32_t start, uint32_t count) const
+    {
+        //a managed buffer locks the runtime's system memory copy; the dirty range is uploaded before the next draw using it
+        void* bufferData = nullptr;
+        const UINT offset = start * page.elementSize;
+        const UINT bytes = count * page.elementSize;
+        const HRESULT result = page.indexBuffer != nullptr ? page.indexBuffer->Lock(offset, bytes, &bufferData, NULL) : page.vertexBuffer->Lock(offset, bytes, &bufferData, NULL);
+        return SUCCEEDED(result) ? bufferData : nullptr;
+    }
+
+    void GeometryPool::UnlockPage(const Page& page) const
+    {
+        if (page.indexBuffer != nullptr)
+            page.indexBuffer->Unlock();
+        else
+            page.vertexBuffer->Unlock();
+    }
+
+    void GeometryPool::Compact()
+    {
+        for (uint32_t itr = 0; itr < m_pages.size(); ++itr)
+        {
+            if (m_pages[itr].allocator.GetFragmentation() > GeometryPoolCompactFragmentation)
+                CompactPage(itr);
+        }
+    }
+
+    void GeometryPool::CompactPage(uint32_t pageIndex)
+    {
+        Stopwatch stopwatch;
+        auto& page = m_pages[pageIndex];
+        std::vector<GeometryHandle> live;
+        for (GeometryHandle handle = 0; handle < m_allocations.size(); ++handle)
+        {
+            if (m_allocations[handle].isLive && m_allocations[handle].page == pageIndex)
+                live.push_back(handle);
+        }
+        std::sort(live.begin(), live.end(), [this](GeometryHandle lhs, GeometryHandle rhs) { return m_allocations[lhs].start < m_allocations[rhs].start; });
+
+        //ranges already packed at the bottom stay put; only the span from the first gap to the last live element is
+        //locked, which keeps the dirty region the runtime re-uploads to what actually moves
+        uint32_t cursor = 0;
+        size_t firstMoved = 0;
+        for (; firstMoved < live.size() && m_allocations[live[firstMoved]].start == cursor; ++firstMoved)
+            cursor += m_allocations[live[firstMoved]].count;
+        if (firstMoved < live.size())
+        {
+            const auto& lastAllocation = m_allocations[live.back()];
+            const uint32_t lockStart = cursor;
+            //in start order every range only ever moves down, so memmove over the one mapping is safe
+            uint8_t* lockData = static_cast<uint8_t*>(LockPage(page, lockStart, lastAllocation.start + lastAllocation.count - lockStart));
+            if (lockData == nullptr)
+                return;
+            for (size_t itr = firstMoved; itr < live.size(); ++itr)
+            {
+                auto& allocation = m_allocations[live[itr]];
+                if (allocation.start != cursor)
+                {
+                    memmove(lockData + static_cast<size_t>(cursor - lockStart) * page.elementSize, lockData + static_cast<size_t>(allocation.start - lockStart) * page.elementSize,
+                        static_cast<size_t>(allocation.count) * page.elementSize);
+                    m_compactionMovedBytes += static_cast<size_t>(allocation.count) * page.elementSize;
+                    allocation.start = cursor;
+                }
+                cursor += allocation.count;
+            }
+            UnlockPage(page);
+        }
+
+        page.allocator.ResetCompacted(cursor);
+        ++m_compactions;
+        m_compactionMs += stopwatch.GetElapsedMs();
+    }
+
+    void GeometryPool::ReleaseAll()
+    {
+        for (auto& page : m_pages)
+        {
+            ComSafeRelease(page.vertexBuffer);
+            ComSafeRelease(page.indexBuffer);
+            page.vertexBuffer = nullptr;
+            page.indexBuffer = nullptr;
+        }
+        m_pages.clear();
+        m_allocations.clear();
+        m_freeHandles.clear();
+    }
+
+    GeometryPoolStats GeometryPool::GetStats() const
+    {
+        GeometryPoolStats stats;
+        stats.pages = static_cast<uint32_t>(m_pages.size());
+        for (const auto& page : m_pages)
+        {
+            stats.pageBytes += static_cast<size_t>(page.allocator.GetCapacity()) * page.elementSize;
+            stats.usedBytes += static_cast<size_t>(page.allocator.GetCapacity() - page.allocator.GetFreeCount()) * page.elementSize;
+        }
+        stats.liveAllocations = static_cast<uint32_t>(m_allocations.size() - m_freeHandles.size());
+        stats.failedAllocations = m_failedAllocations;
+        stats.compactions = m_compactions;
+        stats.compactionMovedBytes = m_compactionMovedBytes;
+        stats.compactionMs = m_compactionMs;
+        return stats;
+    }
+
+    void GeometryPool::LogReport() const
+    {
+        const auto stats = GetStats();
+        std::ostringstream os;
+        os << std::fixed << std::setprecision(2);
+        os << "[GeometryPool] " << stats.pages << " pages, " << BytesToMB(stats.usedBytes) << " / " << BytesToMB(stats.pageBytes) << " MB in ";
+        os << stats.liveAllocations << " ranges | compactions: " << stats.compactions << " (" << BytesToMB(stats.compactionMovedBytes) << " MB moved in ";
+        os << stats.compactionMs << " ms) | failed allocations: " << stats.failedAllocations;
+        for (uint32_t itr = 0; itr < m_pages.size(); ++itr)
+        {
+            const auto& page = m_pages[itr];
+            os << "\n    page " << itr << (page.indexBuffer != nullptr ? " index" : " vertex") << page.elementSize * 8 << ": ";
+            os << BytesToMB(static_cast<size_t>(page.allocator.GetCapacity() - page.allocator.GetFreeCount()) * page.elementSize) << " MB used, ";
+            os << page.allocator.GetFreeRangeCount() << " holes, fragmentation " << page.allocator.GetFragmentation();
+        }
+        Logger::GetInstance().LogInfo(os.str().c_str());
+    }
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <d3d9.h>
+#include <cstdint>
+#include <vector>
+
+#include "../../utils/RangeAllocator.h"
+
+namespace renderer
+{
+    using GeometryHandle = uint32_t;
+    constexpr GeometryHandle NoGeometry = UINT32_MAX;
+
+    constexpr uint32_t GeometryPoolVertexPageBytes = 32 * 1024 * 1024; //a single larger request gets a page of its own
+    constexpr uint32_t GeometryPoolIndexPageBytes = 16 * 1024 * 1024;
+    constexpr float GeometryPoolCompactFragmentation = 0.5f; //pages with more of their free space scattered than this are compacted
+
+    //>Where an allocation lives right now. Compaction moves allocations, so look it up again every frame instead of keeping it.
+    struct GeometryRange
+    {
+        IDirect3DVertexBuffer9* vertexBuffer; //vertex allocations
+        IDirect3DIndexBuffer9* indexBuffer;   //index allocations
+        uint32_t start; //elements: the base vertex or the first index of the allocation
+        uint32_t count;
+    };
+
+    //>Counters for the pool report, pages and ranges as they are now, compactions since the pool was created
+    struct GeometryPoolStats
+    {
+        GeometryPoolStats()
+            :pages(0),
+            pageBytes(0),
+            usedBytes(0),
+            liveAllocations(0),
+            failedAllocations(0),
+            compactions(0),
+            compactionMovedBytes(0),
+            compactionMs(0.0)
+        {}
+
+        uint32_t pages;
+        size_t pageBytes;
+        size_t usedBytes;
+        uint32_t liveAllocations;
+        uint32_t failedAllocations; //the device was out of memory for a new page
+        uint32_t compactions;       //pages compacted
+        size_t compactionMovedBytes;
+        double compactionMs;
+    };
+
+    //>A few large managed vertex and index buffers shared by every model. Vertex pages are per stride and index pages per
+    //>width, so an allocation's start is directly the BaseVertexIndex or StartIndex of its draws. Managed buffers keep
+    //>their contents across a device reset; nothing has to be re-uploaded.
+    class GeometryPool
+    {
+    public:
+        GeometryPool();
+        ~GeometryPool();
+
+        GeometryPool(const GeometryPool&) = delete;
+        GeometryPool& operator=(const GeometryPool&) = delete;
+
+        //>NoGeometry when no page can hold the range and the device cannot create another
+        [[nodiscard]] GeometryHandle AllocateVertices(IDirect3DDevice9* device, uint32_t vertexStride, uint32_t vertexCount);
+        [[nodiscard]] GeometryHandle AllocateIndices(IDirect3DDevice9* device, bool isIndex32, uint32_t indexCount);
+        //>Returns the range to its page; a handle of NoGeometry is ignored
+        void Free(GeometryHandle handle);
+
+        [[nodiscard]] GeometryRange GetRange(GeometryHandle handle) const;
+        //>Copies count elements to firstElement of the allocation
+        bool Write(GeometryHandle handle, uint32_t firstElement, uint32_t count, const void* data);
+        //>Copies all of source to firstElement of destination, an allocation of the same element size
+        bool Copy(GeometryHandle source, GeometryHandle destination, uint32_t firstElement);
+        //>Maps the whole allocation for writing; Unlock before the next Compact
+        [[nodiscard]] void* Lock(GeometryHandle handle);
+        void Unlock(GeometryHandle handle);
+
+        //>Slides the live ranges of every page past GeometryPoolCompactFragmentation down to close its holes. Call between
+        //>frames: the draws of the frame being built read the moved starts through GetRange.
+        void Compact();
+        void ReleaseAll();
+
+        [[nodiscard]] GeometryPoolStats GetStats() const;
+        void LogReport() const;
+
+    private:
+        struct Page
+        {
+            IDirect3DVertexBuffer9* vertexBuffer;
+            IDirect3DIndexBuffer9* indexBuffer;
+            uint32_t elementSize; //vertex stride or index width
+            RangeAllocator allocator;
+        };
+
+        struct Allocation
+        {
+            uint32_t page;
+            uint32_t start;
+            uint32_t count;
+            bool isLive;
+        };
+
+        [[nodiscard]] GeometryHandle Allocate(IDirect3DDevice9* device, bool isIndex, uint32_t elementSize, uint32_t count);
+        [[nodiscard]] bool CreatePage(IDirect3DDevice9* device, bool isIndex, uint32_t elementSize, uint32_t capacity);
+        [[nodiscard]] void* LockPage(const Page& page, uint32_t start, uint32_t count) const;
+        void UnlockPage(const Page& page) const;
+        void CompactPage(uint32_t pageIndex);
+
+        std::vector<Page> m_pages;
+        std::vector<Allocation> m_allocations;
+        std::vector<GeometryHandle> m_freeHandles; //slots of freed allocations, reused before m_allocations grows
+        uint32_t m_failedAllocations;
+        uint32_t m_compactions;
+        size_t m_compactionMovedBytes;
+        double m_compactionMs;
+    };
+}
@@ -0,0 +1,56 @@
+#include <cstring>
+#include <algorithm>
+
+#include "InstanceBuffer.h"
+#include "../../utils/ComHelpers.h"
+
+namespace renderer
+{
+    InstanceBuffer::InstanceBuffer()
+        :m_buffer(nullptr),
+        m_capacity(0)
+    {
+    }
+
+    InstanceBuffer::~InstanceBuffer()
+    {
+        ReleaseDeviceResources();
+    }
+
+    bool InstanceBuffer::Upload(IDirect3DDevice9* device, const InstanceVertex* instances, uint32_t instanceCount)
+    {
+        if (instanceCount == 0)
+            return true;
+
+        if (m_buffer == nullptr || m_capacity < instanceCount)
+        {
+            //doubling keeps a camera that gradually sees more copies from recreating the buffer every frame
+            uint32_t capacity = (std::max)(m_capacity, 256u);
+            while (capacity < instanceCount)
+                capacity *= 2;
+
+            ReleaseDeviceResources();
+            if (FAILED(device->CreateVertexBuffer(capacity * sizeof(InstanceVertex), D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY, 0, D3DPOOL_DEFAULT, &m_buffer, nullptr)))
+            {
+                m_buffer = nullptr;
+                return false;
+            }
+            m_capacity = capacity;
+        }
+
+        //DISCARD hands out fresh memory, so last frame's draws never stall the lock
+        void* bufferData = nullptr;
+        if (FAILED(m_buffer->Lock(0, instanceCount * sizeof(InstanceVertex), &bufferData, D3DLOCK_DISCARD)))
+            return false;
+        memcpy(bufferData, instances, instanceCount * sizeof(InstanceVertex));
+        m_buffer->Unlock();
+        return true;
+    }
+
+    void InstanceBuffer::ReleaseDeviceResources()
+    {
+        ComSafeRelease(m_buffer);
+        m_buffer = nullptr;
+        m_capacity = 0;
+    }
+}
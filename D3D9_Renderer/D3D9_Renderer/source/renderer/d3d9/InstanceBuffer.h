@@ -0,0 +1,31 @@
+#pragma once
+
+#include <d3d9.h>
+#include <cstdint>
+
+#include "VertexDefs.h"
+
+namespace renderer
+{
+    //>Dynamic vertex buffer holding the InstanceVertex stream of one frame, rewritten with DISCARD every frame
+    class InstanceBuffer
+    {
+    public:
+        InstanceBuffer();
+        ~InstanceBuffer();
+
+        InstanceBuffer(const InstanceBuffer&) = delete;
+        InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+
+        //>Grows the buffer if needed and copies the frame's instances in. False when the buffer is unavailable.
+        [[nodiscard]] bool Upload(IDirect3DDevice9* device, const InstanceVertex* instances, uint32_t instanceCount);
+        //>The buffer lives in the default pool: release on device lost, it is recreated by the next Upload
+        void ReleaseDeviceResources();
+
+        inline IDirect3DVertexBuffer9* GetVertexBuffer() const { return m_buffer; }
+
+    private:
+        IDirect3DVertexBuffer9* m_buffer;
+        uint32_t m_capacity; //instances
+    };
+}
@@ -26,10 +26,10 @@ namespace renderer
 
         inline constexpr auto GetBufferDesc() const { return m_bufferDesc.GetBufferDesc(); }
 
-		void AddDataToBuffer(void* data, DWORD lockFlags, UINT dataSize)
+		void AddDataToBuffer(const void* data, DWORD lockFlags, UINT dataSize, UINT offsetInBytes = FullBufferLock)
 		{
             void* bufferData;
-            Lock(FullBufferLock, dataSize, &bufferData, lockFlags);
+            Lock(offsetInBytes, dataSize, &bufferData, lockFlags);
             memcpy(bufferData, data, dataSize);
             Unlock();
 		}
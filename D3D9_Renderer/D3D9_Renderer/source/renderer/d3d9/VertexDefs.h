@@ -1,12 +1,23 @@
 #pragma once
 
 #include <d3d9.h>
+#include <cstdint>
 
 namespace renderer
 {
+    //>Layout a model's vertex buffer is uploaded in; the CPU images are always PositionVertex
+    enum class VertexFormat
+    {
+        Full,    //PositionVertex, 56 bytes
+        Compact  //CompactVertex, 20 bytes
+    };
+
     struct VertexDeclContainer
     {
         IDirect3DVertexDeclaration9* positionVertexDecl = nullptr;
+        IDirect3DVertexDeclaration9* compactVertexDecl = nullptr; //null when the device lacks SHORT4N/SHORT2N/UBYTE4N/FLOAT16_2
+        IDirect3DVertexDeclaration9* positionInstancedDecl = nullptr; //positionVertexDecl plus an InstanceVertex stream 1
+        IDirect3DVertexDeclaration9* compactInstancedDecl = nullptr;
     };
 
     struct PositionVertex
@@ -47,4 +58,21 @@ namespace renderer
         float m_tangx, m_tangy, m_tangz; //Tangents
         float m_biTangx, m_biTangy, m_biTangz; //Bi-Tangents
     };
-}
\ No newline at end of file
+
+    //>Quantized PositionVertex, decoded by RenderCompactVS (see VertexCompression.h for the encoding)
+    struct CompactVertex
+    {
+        int16_t position[4]; //SHORT4N inside the model's bounds: position = value * scale + offset; w unused
+        int16_t normal[2];   //SHORT2N octahedral
+        uint8_t tangent[4];  //UBYTE4N xyz * 0.5 + 0.5, w: bitangent sign (0 negative, 255 positive)
+        uint16_t uv[2];      //FLOAT16_2
+    };
+    static_assert(sizeof(CompactVertex) == 20, "CompactVertex has to match its vertex declaration");
+
+    //>Stream 1 of instanced draws: the affine world matrix as three columns, read as TEXCOORD1-3 by RenderInstancedVS
+    struct InstanceVertex
+    {
+        float worldColumns[3][4];
+    };
+    static_assert(sizeof(InstanceVertex) == 48, "InstanceVertex has to match its vertex declaration");
+}
@@ -1,6 +1,11 @@
 //Matrices
 uniform extern float4x4 g_worldViewProjMatrix;
 uniform extern float4x4 g_WorldMat;
+uniform extern float4x4 g_viewProjMatrix; //instanced draws: the world matrix comes from stream 1
+
+//Compact vertices: SHORT4N positions inside the model's bounds
+uniform extern float4 g_positionScale;
+uniform extern float4 g_positionOffset;
 
 //Directional Light
 uniform extern float4 g_dirLightDir;
@@ -20,6 +25,7 @@ uniform extern texture g_DiffuseTex;
 uniform extern texture g_NormalTex;
 uniform extern texture g_SpecularTex;
 uniform extern texture g_OpacityTex;
+uniform extern bool g_normalMapXY; //cooked BC3 normal map: X in alpha, Y in green, Z rebuilt
 
 sampler DiffuseSampler = sampler_state
 {
@@ -91,6 +97,65 @@ VS_OUTPUT RenderVS(float3 pos : POSITION0,
 	return vsoutput;
 }
 
+//Octahedral normal folded on z, see VertexCompression.cpp
+float3 DecodeOctahedral(float2 encoded)
+{
+	float3 normal = float3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+	float fold = saturate(-normal.z);
+	normal.xy += (normal.xy >= 0.0f) ? -fold : fold;
+	return normalize(normal);
+}
+
+VS_OUTPUT RenderCompactVS(float4 pos : POSITION0,
+	float2 octNormal : NORMAL0,
+	float4 tangentSign : TANGENT0,
+	float2 uv : TEXCOORD0)
+{
+	float3 position = pos.xyz * g_positionScale.xyz + g_positionOffset.xyz;
+	float3 norm = DecodeOctahedral(octNormal);
+	float3 tangent = tangentSign.xyz * 2.0f - 1.0f;
+	float3 biTangent = cross(norm, tangent) * (tangentSign.w * 2.0f - 1.0f);
+	return RenderVS(position, norm, uv, tangent, biTangent);
+}
+
+//World matrix columns of one copy, see InstanceVertex
+VS_OUTPUT RenderInstancedVS(float3 pos : POSITION0,
+	float3 norm : NORMAL0,
+	float2 uv : TEXCOORD0,
+	float3 tangent : TANGENT0,
+	float3 biTangent : BINORMAL0,
+	float4 world0 : TEXCOORD1,
+	float4 world1 : TEXCOORD2,
+	float4 world2 : TEXCOORD3)
+{
+	//g_WorldMat holds the draw's scene node move (identity when the copies carry their own), then the copy's matrix
+	float4x3 world = transpose(float3x4(world0, world1, world2));
+	VS_OUTPUT vsoutput = (VS_OUTPUT)0;
+	float3 nodePos = mul(float4(pos, 1.0f), g_WorldMat).xyz;
+	vsoutput.worldPos = mul(float4(nodePos, 1.0f), world);
+	vsoutput.position = mul(float4(vsoutput.worldPos, 1.0f), g_viewProjMatrix);
+	vsoutput.normal = normalize(mul(mul(norm, (float3x3)g_WorldMat), (float3x3)world));
+	vsoutput.uv = uv;
+	vsoutput.tangent = normalize(mul(mul(tangent, (float3x3)g_WorldMat), (float3x3)world));
+	vsoutput.biTangent = normalize(mul(mul(biTangent, (float3x3)g_WorldMat), (float3x3)world));
+	return vsoutput;
+}
+
+VS_OUTPUT RenderCompactInstancedVS(float4 pos : POSITION0,
+	float2 octNormal : NORMAL0,
+	float4 tangentSign : TANGENT0,
+	float2 uv : TEXCOORD0,
+	float4 world0 : TEXCOORD1,
+	float4 world1 : TEXCOORD2,
+	float4 world2 : TEXCOORD3)
+{
+	float3 position = pos.xyz * g_positionScale.xyz + g_positionOffset.xyz;
+	float3 norm = DecodeOctahedral(octNormal);
+	float3 tangent = tangentSign.xyz * 2.0f - 1.0f;
+	float3 biTangent = cross(norm, tangent) * (tangentSign.w * 2.0f - 1.0f);
+	return RenderInstancedVS(position, norm, uv, tangent, biTangent, world0, world1, world2);
+}
+
 struct PS_OUTPUT
 {
 	float4 color : COLOR0;
@@ -100,7 +165,13 @@ PS_OUTPUT RenderPS(in VS_OUTPUT psInput)
 {
 	PS_OUTPUT psoutput = (PS_OUTPUT)0;
 
-	float3 bumpTex = 2.0f * tex2D(NormalSampler, psInput.uv) - 1.0f; //from 0 to 1 to -1 to 1
+	float4 normalSample = tex2D(NormalSampler, psInput.uv);
+	float3 bumpTex = 2.0f * normalSample.rgb - 1.0f; //from 0 to 1 to -1 to 1
+	if (g_normalMapXY)
+	{
+		bumpTex.xy = 2.0f * normalSample.ag - 1.0f;
+		bumpTex.z = sqrt(saturate(1.0f - dot(bumpTex.xy, bumpTex.xy)));
+	}
 	float3 bumpedNormal = normalize(((bumpTex.x * psInput.tangent) + (bumpTex.y * psInput.biTangent) + (bumpTex.z * psInput.normal)));
 
 	float4 texColorDiff = tex2D(DiffuseSampler, psInput.uv);
@@ -142,5 +213,47 @@ technique Tex
 		VertexShader = compile vs_3_0 RenderVS();
 		PixelShader = compile ps_3_0 RenderPS();
 
+	}
+};
+
+technique TexCompact
+{
+	pass P0
+	{
+		ShadeMode = PHONG;
+		FillMode = SOLID;
+		CullMode = CCW;
+
+		VertexShader = compile vs_3_0 RenderCompactVS();
+		PixelShader = compile ps_3_0 RenderPS();
+
+	}
+};
+
+technique TexInstanced
+{
+	pass P0
+	{
+		ShadeMode = PHONG;
+		FillMode = SOLID;
+		CullMode = CCW;
+
+		VertexShader = compile vs_3_0 RenderInstancedVS();
+		PixelShader = compile ps_3_0 RenderPS();
+
+	}
+};
+
+technique TexCompactInstanced
+{
+	pass P0
+	{
+		ShadeMode = PHONG;
+		FillMode = SOLID;
+		CullMode = CCW;
+
+		VertexShader = compile vs_3_0 RenderCompactInstancedVS();
+		PixelShader = compile ps_3_0 RenderPS();
+
 	}
 };
\ No newline at end of file
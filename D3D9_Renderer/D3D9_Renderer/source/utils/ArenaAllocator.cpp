@@ -0,0 +1,65 @@
+#include <algorithm>
+#include <cassert>
+#include <new>
+
+#include "ArenaAllocator.h"
+
+namespace renderer
+{
+    LinearArena::LinearArena()
+        :m_mutex(),
+        m_blocks(),
+        m_usedBytes(0),
+        m_reservedBytes(0),
+        m_highWaterBytes(0),
+        m_peakBlockCount(0)
+    {
+    }
+
+    LinearArena::~LinearArena()
+    {
+        Release();
+    }
+
+    void* LinearArena::Allocate(size_t size, size_t alignment)
+    {
+        assert(alignment > 0 && (alignment & (alignment - 1)) == 0 && alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        //block data comes from operator new, so it is aligned for any fundamental type; only the offset needs padding
+        if (!m_blocks.empty())
+        {
+            Block& block = m_blocks.back();
+            const size_t offset = (block.used + alignment - 1) & ~(alignment - 1);
+            if (offset + size <= block.size)
+            {
+                m_usedBytes += offset + size - block.used;
+                block.used = offset + size;
+                m_highWaterBytes = (std::max)(m_highWaterBytes, m_usedBytes);
+                return block.data + offset;
+            }
+        }
+
+        //the tail of the previous block is abandoned; with 1 MB blocks and mostly small requests that is little
+        Block block;
+        block.size = (std::max)(size, ArenaBlockSize);
+        block.data = static_cast<uint8_t*>(::operator new(block.size));
+        block.used = size;
+        m_blocks.push_back(block);
+        m_reservedBytes += block.size;
+        m_usedBytes += size;
+        m_highWaterBytes = (std::max)(m_highWaterBytes, m_usedBytes);
+        m_peakBlockCount = (std::max)(m_peakBlockCount, static_cast<uint32_t>(m_blocks.size()));
+        return block.data;
+    }
+
+    void LinearArena::Release()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& block : m_blocks)
+            ::operator delete(block.data);
+        m_blocks = std::vector<Block>();
+        m_usedBytes = 0;
+        m_reservedBytes = 0;
+    }
+}
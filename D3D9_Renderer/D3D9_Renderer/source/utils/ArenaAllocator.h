@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace renderer
+{
+    constexpr size_t ArenaBlockSize = 1024 * 1024; //larger requests get a block of their own
+
+    //>Bump allocator for data that lives exactly as long as one import. Nothing is freed individually; Release
+    //>drops every block at once. Allocate is thread safe so ParallelFor bodies can use it.
+    class LinearArena
+    {
+    public:
+        LinearArena();
+        ~LinearArena();
+
+        LinearArena(const LinearArena&) = delete;
+        LinearArena& operator=(const LinearArena&) = delete;
+
+        [[nodiscard]] void* Allocate(size_t size, size_t alignment);
+        //>Frees every block. The high-water mark survives so the load report can read it afterwards.
+        void Release();
+
+        inline size_t GetUsedBytes() const { return m_usedBytes; }
+        inline size_t GetReservedBytes() const { return m_reservedBytes; }
+        inline size_t GetHighWaterBytes() const { return m_highWaterBytes; }
+        inline uint32_t GetPeakBlockCount() const { return m_peakBlockCount; }
+
+    private:
+        struct Block
+        {
+            uint8_t* data;
+            size_t size;
+            size_t used;
+        };
+
+        std::mutex m_mutex;
+        std::vector<Block> m_blocks; //the last one is bumped; earlier ones are full
+        size_t m_usedBytes;     //bytes handed out, alignment padding included
+        size_t m_reservedBytes; //sum of the block sizes
+        size_t m_highWaterBytes;
+        uint32_t m_peakBlockCount;
+    };
+
+    //>STL allocator over a LinearArena; deallocate is a no-op, the arena's Release frees everything
+    template<typename T>
+    class ArenaAllocator
+    {
+    public:
+        using value_type = T;
+
+        ArenaAllocator(LinearArena& arena) noexcept
+            :m_arena(&arena)
+        {}
+        template<typename U>
+        ArenaAllocator(const ArenaAllocator<U>& other) noexcept
+            :m_arena(other.GetArena())
+        {}
+
+        [[nodiscard]] T* allocate(size_t count)
+        {
+            return static_cast<T*>(m_arena->Allocate(count * sizeof(T), alignof(T)));
+        }
+        void deallocate(T*, size_t) noexcept {}
+
+        inline LinearArena* GetArena() const { return m_arena; }
+
+    private:
+        LinearArena* m_arena;
+    };
+
+    template<typename T, typename U>
+    inline bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.GetArena() == b.GetArena(); }
+    template<typename T, typename U>
+    inline bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.GetArena() != b.GetArena(); }
+
+    //>Import scratch: construct with the arena, e.g. ArenaVector<uint32_t> order(count, arena). Reserve up front where
+    //>the size is known, since every regrowth leaves the old storage behind until Release.
+    template<typename T>
+    using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+}
@@ -0,0 +1,69 @@
+#include "AssetFile.h"
+#include "AssetPack.h"
+#include "Hash.h"
+
+namespace renderer
+{
+    AssetFile::AssetFile()
+        :m_file(),
+        m_inflated(),
+        m_data(nullptr),
+        m_size(0),
+        m_isPacked(false)
+    {
+    }
+
+    AssetFile::~AssetFile()
+    {
+        Close();
+    }
+
+    bool AssetFile::Open(const std::string& filePath, AssetSource source, MappedFile::AccessPattern accessPattern)
+    {
+        Close();
+
+        auto& assetPack = AssetPack::GetInstance();
+        const auto entry = source == AssetSource::Any ? assetPack.Find(filePath) : nullptr;
+        if (entry != nullptr && entry->size > 0) //refused like MappedFile refuses empty files
+        {
+            if (entry->chunkCount == 0)
+                m_data = assetPack.GetStoredData(*entry);
+            else if (assetPack.Inflate(*entry, m_inflated))
+                m_data = m_inflated.data();
+            else
+                return false;
+            m_size = entry->size;
+            m_isPacked = true;
+            assetPack.RecordPackedRead(entry->storedSize);
+            return true;
+        }
+
+        if (!m_file.Open(filePath, accessPattern))
+            return false;
+        m_data = m_file.GetData();
+        m_size = m_file.GetSize();
+        assetPack.RecordLooseRead(m_size);
+        return true;
+    }
+
+    void AssetFile::Close()
+    {
+        m_file.Close();
+        m_inflated = std::vector<uint8_t>();
+        m_data = nullptr;
+        m_size = 0;
+        m_isPacked = false;
+    }
+
+    uint64_t AssetFile::HashContents(const std::string& filePath, AssetSource source)
+    {
+        uint64_t contentHash = 0;
+        if (source == AssetSource::Any && AssetPack::GetInstance().FindContentHash(filePath, contentHash))
+            return contentHash;
+
+        AssetFile file;
+        if (!file.Open(filePath, source))
+            return 0;
+        return HashBytes(file.GetData(), file.GetSize());
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+namespace renderer
+{
+    //>Where AssetFile may look for a path
+    enum class AssetSource
+    {
+        Any,  //the mounted pack first, then the loose file
+        Loose //the file on disk only: what a hot reload has to see
+    };
+
+    //>Read-only bytes of an asset: a view into the mounted AssetPack, the pack entry inflated into memory, or the loose file
+    //>mapped. Stays valid until Close or the AssetFile goes away.
+    class AssetFile
+    {
+    public:
+        AssetFile();
+        ~AssetFile();
+
+        AssetFile(const AssetFile&) = delete;
+        AssetFile& operator=(const AssetFile&) = delete;
+
+        [[nodiscard]] bool Open(const std::string& filePath, AssetSource source = AssetSource::Any,
+            MappedFile::AccessPattern accessPattern = MappedFile::AccessPattern::Sequential);
+        void Close();
+
+        //>Content hash of a file as the caches key it, from the pack directory when it holds the file, else by reading it
+        [[nodiscard]] static uint64_t HashContents(const std::string& filePath, AssetSource source = AssetSource::Any);
+
+        inline bool IsOpen() const { return m_data != nullptr; }
+        inline bool IsPacked() const { return m_isPacked; }
+        //>The bytes are a file mapping (loose or a stored pack entry) rather than an inflated copy
+        inline bool IsMapped() const { return m_data != nullptr && m_inflated.empty(); }
+        inline const uint8_t* GetData() const { return m_data; }
+        inline size_t GetSize() const { return m_size; }
+
+    private:
+        MappedFile m_file;
+        std::vector<uint8_t> m_inflated;
+        const uint8_t* m_data;
+        size_t m_size;
+        bool m_isPacked;
+    };
+}
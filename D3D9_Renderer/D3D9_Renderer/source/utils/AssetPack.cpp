@@ -0,0 +1,371 @@
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+#include "AssetPack.h"
+#include "Hash.h"
+#include "Lz4Block.h"
+#include "Logger.h"
+#include "MemoryStats.h"
+#include "ThreadPool.h"
+#include "Time.h"
+
+namespace renderer
+{
+    namespace
+    {
+        inline uint64_t AlignOffset(uint64_t offset, uint64_t alignment)
+        {
+            return (offset + alignment - 1) & ~(alignment - 1);
+        }
+
+        void WritePadding(std::ofstream& stream, uint64_t alignedOffset)
+        {
+            static const char zeros[AssetPackEntryAlignment] = {};
+            const auto current = static_cast<uint64_t>(stream.tellp());
+            stream.write(zeros, static_cast<std::streamsize>(alignedOffset - current));
+        }
+
+        inline uint32_t GetChunkSize(const AssetPackEntry& entry, uint32_t chunk)
+        {
+            return (std::min)(AssetPackChunkBytes, entry.size - chunk * AssetPackChunkBytes);
+        }
+    }
+
+    AssetPack::AssetPack()
+        :m_file(),
+        m_directory(),
+        m_entries(nullptr),
+        m_chunks(nullptr),
+        m_names(nullptr),
+        m_entryCount(0),
+        m_packedOpens(0),
+        m_looseOpens(0),
+        m_hashLookups(0),
+        m_packedBytesRead(0),
+        m_inflatedBytes(0),
+        m_looseBytesRead(0),
+        m_inflateMicroseconds(0)
+    {
+    }
+
+    AssetPack::~AssetPack()
+    {
+        Unmount();
+    }
+
+    std::string AssetPack::NormalizePath(const std::string& path)
+    {
+        std::string lowered(path);
+        std::transform(lowered.begin(), lowered.end(), lowered.begin(), [](char c)
+            {
+                return c == '\\' ? '/' : static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            });
+
+        std::vector<std::string> parts;
+        std::istringstream stream(lowered);
+        std::string part;
+        while (std::getline(stream, part, '/'))
+        {
+            if (part.empty() || part == ".")
+                continue;
+            if (part == ".." && !parts.empty() && parts.back() != "..")
+                parts.pop_back();
+            else
+                parts.emplace_back(part);
+        }
+
+        std::string normalized;
+        for (size_t itr = 0; itr < parts.size(); ++itr)
+        {
+            if (itr > 0)
+                normalized += '/';
+            normalized += parts[itr];
+        }
+        return normalized;
+    }
+
+    bool AssetPack::Mount(const std::string& packPath)
+    {
+        Unmount();
+
+        //lookups jump around the pack; Prefetch supplies the read-ahead for what is about to be read
+        if (!m_file.Open(packPath, MappedFile::AccessPattern::Random))
+            return false;
+
+        const auto header = reinterpret_cast<const AssetPackHeader*>(m_file.GetData());
+        if (m_file.GetSize() < sizeof(AssetPackHeader) || header->magic != AssetPackMagic || header->version != AssetPackVersion
+            || header->directoryOffset + header->directoryStoredSize > m_file.GetSize()
+            || static_cast<uint64_t>(header->entryCount) * sizeof(AssetPackEntry) + static_cast<uint64_t>(header->chunkCount) * sizeof(AssetPackChunk) + header->namesSize != header->directorySize)
+        {
+            Unmount();
+            return false;
+        }
+
+        m_directory.resize(header->directorySize);
+        if (!Lz4Decompress(m_file.GetData() + header->directoryOffset, header->directoryStoredSize, m_directory.data(), m_directory.size()))
+        {
+            Unmount();
+            return false;
+        }
+        m_entries = reinterpret_cast<const AssetPackEntry*>(m_directory.data());
+        m_chunks = reinterpret_cast<const AssetPackChunk*>(m_directory.data() + header->entryCount * sizeof(AssetPackEntry));
+        m_names = reinterpret_cast<const char*>(m_directory.data() + header->entryCount * sizeof(AssetPackEntry) + header->chunkCount * sizeof(AssetPackChunk));
+
+        //a truncated or hand-edited pack must not send a read past the mapping
+        for (uint32_t itr = 0; itr < header->entryCount; ++itr)
+        {
+            const auto& entry = m_entries[itr];
+            const bool valid = entry.dataOffset + entry.storedSize <= header->directoryOffset
+                && static_cast<uint64_t>(entry.nameOffset) + entry.nameLength <= header->namesSize
+                && static_cast<uint64_t>(entry.firstChunk) + entry.chunkCount <= header->chunkCount
+                && (entry.chunkCount != 0 || entry.storedSize == entry.size)
+                && (entry.chunkCount == 0 || entry.chunkCount == (entry.size + AssetPackChunkBytes - 1) / AssetPackChunkBytes);
+            if (!valid)
+            {
+                Unmount();
+                return false;
+            }
+        }
+        m_entryCount = header->entryCount;
+
+        std::ostringstream os;
+        os << std::fixed << std::setprecision(2);
+        os << "[AssetPack] mounted " << packPath << ": " << m_entryCount << " files, " << BytesToMB(m_file.GetSize()) << " MB";
+        Logger::GetInstance().LogInfo(os.str().c_str());
+        return true;
+    }
+
+    void AssetPack::Unmount()
+    {
+        m_entries = nullptr;
+        m_chunks = nullptr;
+        m_names = nullptr;
+        m_entryCount = 0;
+        m_directory = std::vector<uint8_t>();
+        m_file.Close();
+    }
+
+    const AssetPackEntry* AssetPack::Find(const std::string& filePath) const
+    {
+        if (m_entryCount == 0)
+            return nullptr;
+
+        const std::string name = NormalizePath(filePath);
+        const uint64_t pathHash = HashBytes(name.data(), name.size());
+        const auto entriesEnd = m_entries + m_entryCount;
+        auto entry = std::lower_bound(m_entries, entriesEnd, pathHash, [](const AssetPackEntry& lhs, uint64_t rhs) { return lhs.pathHash < rhs; });
+        for (; entry != entriesEnd && entry->pathHash == pathHash; ++entry)
+        {
+            if (entry->nameLength == name.size() && memcmp(m_names + entry->nameOffset, name.data(), name.size()) == 0)
+                return entry;
+        }
+        return nullptr;
+    }
+
+    bool AssetPack::FindContentHash(const std::string& filePath, uint64_t& outHash) const
+    {
+        const auto entry = Find(filePath);
+        if (entry == nullptr)
+            return false;
+        outHash = entry->contentHash;
+        ++m_hashLookups;
+        return true;
+    }
+
+    const uint8_t* AssetPack::GetStoredData(const AssetPackEntry& entry) const
+    {
+        return m_file.GetData() + entry.dataOffset;
+    }
+
+    bool AssetPack::Inflate(const AssetPackEntry& entry, std::vector<uint8_t>& outData)
+    {
+        Stopwatch stopwatch;
+        outData.resize(entry.size);
+        const uint8_t* storedData = GetStoredData(entry);
+        std::atomic<bool> isValid(true);
+        auto inflateChunk = [this, &entry, &outData, storedData, &isValid](uint32_t chunk)
+        {
+            const auto& record = m_chunks[entry.firstChunk + chunk];
+            const uint32_t chunkSize = GetChunkSize(entry, chunk);
+            uint8_t* destination = outData.data() + static_cast<size_t>(chunk) * AssetPackChunkBytes;
+            if (static_cast<uint64_t>(record.storedOffset) + record.storedSize > entry.storedSize)
+                isValid = false;
+            else if (record.storedSize == chunkSize)
+                memcpy(destination, storedData + record.storedOffset, chunkSize);
+            else if (!Lz4Decompress(storedData + record.storedOffset, record.storedSize, destination, chunkSize))
+                isValid = false;
+        };
+
+        //one chunk is not worth waking the workers for; most textures are one or two
+        if (entry.chunkCount == 1)
+            inflateChunk(0);
+        else
+            ThreadPool::GetInstance().ParallelFor(entry.chunkCount, inflateChunk);
+
+        m_inflatedBytes += entry.size;
+        m_inflateMicroseconds += static_cast<uint64_t>(stopwatch.GetElapsedMs() * 1000.0);
+        if (!isValid)
+            outData.clear();
+        return isValid;
+    }
+
+    void AssetPack::Prefetch(const std::vector<std::string>& filePaths) const
+    {
+        std::vector<WIN32_MEMORY_RANGE_ENTRY> ranges;
+        for (const auto& filePath : filePaths)
+        {
+            const auto entry = Find(filePath);
+            if (entry != nullptr && entry->storedSize > 0)
+                ranges.push_back({ const_cast<uint8_t*>(GetStoredData(*entry)), entry->storedSize });
+        }
+        //only a hint: the reads still fault the pages in if the OS declines
+        if (!ranges.empty())
+            ::PrefetchVirtualMemory(::GetCurrentProcess(), ranges.size(), ranges.data(), 0);
+    }
+
+    AssetPackSource AssetPack::CompressEntry(const std::string& filePath, const uint8_t* data, size_t size, bool isCompressible)
+    {
+        AssetPackSource source;
+        source.name = NormalizePath(filePath);
+        source.contentHash = HashBytes(data, size);
+        source.size = static_cast<uint32_t>(size);
+
+        //a chunk that does not shrink is kept as is; the reader tells them apart by the stored size
+        for (size_t offset = 0; isCompressible && offset < size; offset += AssetPackChunkBytes)
+        {
+            const size_t chunkSize = (std::min)(static_cast<size_t>(AssetPackChunkBytes), size - offset);
+            AssetPackChunk chunk = { static_cast<uint32_t>(source.storedData.size()), 0 };
+            chunk.storedSize = static_cast<uint32_t>(Lz4Compress(data + offset, chunkSize, source.storedData));
+            if (chunk.storedSize >= chunkSize)
+            {
+                source.storedData.resize(chunk.storedOffset);
+                source.storedData.insert(source.storedData.end(), data + offset, data + offset + chunkSize);
+                chunk.storedSize = static_cast<uint32_t>(chunkSize);
+            }
+            source.chunks.push_back(chunk);
+        }
+
+        //PNGs and the like are compressed already: storing them saves the inflate and serves them in place
+        if (!isCompressible || source.storedData.size() > static_cast<size_t>(size * (1.0f - AssetPackMinSaving)))
+        {
+            source.storedData.assign(data, data + size);
+            source.chunks.clear();
+        }
+        return source;
+    }
+
+    bool AssetPack::Write(const std::string& packPath, const std::vector<AssetPackSource>& sources)
+    {
+        std::vector<uint64_t> pathHashes(sources.size());
+        std::vector<uint32_t> order(sources.size());
+        for (uint32_t itr = 0; itr < sources.size(); ++itr)
+        {
+            pathHashes[itr] = HashBytes(sources[itr].name.data(), sources[itr].name.size());
+            order[itr] = itr;
+        }
+        std::sort(order.begin(), order.end(), [&pathHashes, &sources](uint32_t lhs, uint32_t rhs)
+            {
+                return pathHashes[lhs] != pathHashes[rhs] ? pathHashes[lhs] < pathHashes[rhs] : sources[lhs].name < sources[rhs].name;
+            });
+
+        std::vector<AssetPackEntry> entries;
+        std::vector<AssetPackChunk> chunks;
+        std::string names;
+        entries.reserve(sources.size());
+
+        //write to a temporary and swap it in so a crash mid-write never leaves a valid-looking pack behind
+        const std::string tempPath = packPath + ".tmp";
+        AssetPackHeader header = {};
+        {
+            std::ofstream stream(tempPath, std::ios::binary | std::ios::trunc);
+            if (!stream)
+                return false;
+
+            stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            for (const auto index : order)
+            {
+                const auto& source = sources[index];
+                AssetPackEntry entry = {};
+                entry.pathHash = pathHashes[index];
+                entry.contentHash = source.contentHash;
+                entry.dataOffset = AlignOffset(static_cast<uint64_t>(stream.tellp()), AssetPackEntryAlignment);
+                entry.size = source.size;
+                entry.storedSize = static_cast<uint32_t>(source.storedData.size());
+                entry.firstChunk = static_cast<uint32_t>(chunks.size());
+                entry.chunkCount = static_cast<uint32_t>(source.chunks.size());
+                entry.nameOffset = static_cast<uint32_t>(names.size());
+                entry.nameLength = static_cast<uint32_t>(source.name.size());
+                entries.push_back(entry);
+                chunks.insert(chunks.end(), source.chunks.begin(), source.chunks.end());
+                names += source.name;
+
+                WritePadding(stream, entry.dataOffset);
+                stream.write(reinterpret_cast<const char*>(source.storedData.data()), static_cast<std::streamsize>(source.storedData.size()));
+            }
+
+            std::vector<uint8_t> directory;
+            directory.insert(directory.end(), reinterpret_cast<const uint8_t*>(entries.data()), reinterpret_cast<const uint8_t*>(entries.data() + entries.size()));
+            directory.insert(directory.end(), reinterpret_cast<const uint8_t*>(chunks.data()), reinterpret_cast<const uint8_t*>(chunks.data() + chunks.size()));
+            directory.insert(directory.end(), names.begin(), names.end());
+            std::vector<uint8_t> storedDirectory;
+            Lz4Compress(directory.data(), directory.size(), storedDirectory);
+
+            header.magic = AssetPackMagic;
+            header.version = AssetPackVersion;
+            header.entryCount = static_cast<uint32_t>(entries.size());
+            header.chunkCount = static_cast<uint32_t>(chunks.size());
+            header.directoryOffset = static_cast<uint64_t>(stream.tellp());
+            header.directoryStoredSize = static_cast<uint32_t>(storedDirectory.size());
+            header.directorySize = static_cast<uint32_t>(directory.size());
+            header.namesSize = static_cast<uint32_t>(names.size());
+            stream.write(reinterpret_cast<const char*>(storedDirectory.data()), static_cast<std::streamsize>(storedDirectory.size()));
+
+            stream.seekp(0);
+            stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            if (!stream)
+                return false;
+        }
+
+        return ::MoveFileExA(tempPath.c_str(), packPath.c_str(), MOVEFILE_REPLACE_EXISTING) != FALSE;
+    }
+
+    void AssetPack::RecordLooseRead(size_t bytes)
+    {
+        ++m_looseOpens;
+        m_looseBytesRead += bytes;
+    }
+
+    void AssetPack::RecordPackedRead(size_t bytes)
+    {
+        ++m_packedOpens;
+        m_packedBytesRead += bytes;
+    }
+
+    AssetIoStats AssetPack::GetStats() const
+    {
+        AssetIoStats stats;
+        stats.packedOpens = m_packedOpens;
+        stats.looseOpens = m_looseOpens;
+        stats.hashLookups = m_hashLookups;
+        stats.packedBytesRead = m_packedBytesRead;
+        stats.inflatedBytes = m_inflatedBytes;
+        stats.looseBytesRead = m_looseBytesRead;
+        stats.inflateMs = static_cast<double>(m_inflateMicroseconds.load()) / 1000.0;
+        return stats;
+    }
+
+    void AssetPack::LogReport() const
+    {
+        const auto stats = GetStats();
+        std::ostringstream os;
+        os << std::fixed << std::setprecision(2);
+        os << "[AssetIO] " << (IsMounted() ? "pack mounted" : "no pack") << " | packed: " << stats.packedOpens << " files, ";
+        os << BytesToMB(stats.packedBytesRead) << " MB read, " << BytesToMB(stats.inflatedBytes) << " MB inflated in " << stats.inflateMs << " ms | ";
+        os << "loose: " << stats.looseOpens << " files, " << BytesToMB(stats.looseBytesRead) << " MB | hashes from the directory: " << stats.hashLookups;
+        Logger::GetInstance().LogInfo(os.str().c_str());
+    }
+}
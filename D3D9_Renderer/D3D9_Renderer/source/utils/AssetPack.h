@@ -0,0 +1,138 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+namespace renderer
+{
+    constexpr uint32_t AssetPackMagic = 0x4B435041;  //'APCK'
+    constexpr uint32_t AssetPackVersion = 1;
+    constexpr uint32_t AssetPackChunkBytes = 256 * 1024;  //uncompressed bytes per chunk; the chunks of one entry inflate in parallel
+    constexpr uint64_t AssetPackEntryAlignment = 4096;    //every entry starts on a page, so a stored entry is a page-aligned view
+    constexpr float AssetPackMinSaving = 0.1f;            //an entry is stored as is unless compression saves at least this much
+
+    //>On-disk layout: header, the entries' data, then the directory (entry table, chunk table, name blob) as one LZ4 block
+    struct AssetPackHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t entryCount;
+        uint32_t chunkCount;
+        uint64_t directoryOffset;
+        uint32_t directoryStoredSize;
+        uint32_t directorySize;
+        uint32_t namesSize;
+        uint32_t reserved[3];
+    };
+
+    //>Entries are sorted by pathHash for a binary search; the name tells colliding paths apart
+    struct AssetPackEntry
+    {
+        uint64_t pathHash;    //HashBytes of the normalized path
+        uint64_t contentHash; //HashBytes of the uncompressed file, the key the model and texture caches use
+        uint64_t dataOffset;  //relative to the start of the pack
+        uint32_t size;        //uncompressed
+        uint32_t storedSize;
+        uint32_t firstChunk;
+        uint32_t chunkCount;  //0 for an entry stored uncompressed
+        uint32_t nameOffset;  //into the name blob
+        uint32_t nameLength;
+    };
+
+    //>Chunk i of an entry holds AssetPackChunkBytes uncompressed bytes, the last one the rest
+    struct AssetPackChunk
+    {
+        uint32_t storedOffset; //relative to the entry's dataOffset
+        uint32_t storedSize;   //equal to the uncompressed size when the chunk did not compress
+    };
+
+    //>One file on its way into a pack, built by AssetPack::CompressEntry
+    struct AssetPackSource
+    {
+        std::string name; //normalized path
+        uint64_t contentHash;
+        uint32_t size;
+        std::vector<uint8_t> storedData;
+        std::vector<AssetPackChunk> chunks; //empty when stored uncompressed
+    };
+
+    //>I/O counters since startup, packed and loose reads alike
+    struct AssetIoStats
+    {
+        uint32_t packedOpens;
+        uint32_t looseOpens;
+        uint32_t hashLookups;   //content hashes answered from the directory without reading the file
+        size_t packedBytesRead; //stored bytes read from the pack mapping
+        size_t inflatedBytes;
+        size_t looseBytesRead;
+        double inflateMs;
+    };
+
+    //>Read-only archive of the data directory, mapped whole. Mount it once at startup; AssetFile then serves every path it
+    //>holds from the mapping and falls back to the loose file for the rest.
+    class AssetPack
+    {
+    public:
+        AssetPack();
+        ~AssetPack();
+
+        AssetPack(const AssetPack&) = delete;
+        AssetPack& operator=(const AssetPack&) = delete;
+
+        inline static AssetPack& GetInstance()
+        {
+            static AssetPack instance;
+            return instance;
+        }
+
+        //>Lower case, forward slashes, "." and ".." folded; the form every entry is stored and looked up under
+        static std::string NormalizePath(const std::string& path);
+
+        //>Maps the pack and inflates its directory. False (and nothing mounted) when it is missing or malformed.
+        [[nodiscard]] bool Mount(const std::string& packPath);
+        void Unmount();
+        inline bool IsMounted() const { return m_file.IsOpen(); }
+
+        //>nullptr when the pack does not hold the path
+        [[nodiscard]] const AssetPackEntry* Find(const std::string& filePath) const;
+        //>The content hash of a packed file without reading any of it
+        [[nodiscard]] bool FindContentHash(const std::string& filePath, uint64_t& outHash) const;
+        //>A stored entry is served straight from the mapping; the caller reads it in place
+        [[nodiscard]] const uint8_t* GetStoredData(const AssetPackEntry& entry) const;
+        //>Inflates a compressed entry into outData, its chunks spread over the thread pool
+        [[nodiscard]] bool Inflate(const AssetPackEntry& entry, std::vector<uint8_t>& outData);
+        //>Asks the OS to start reading the entries' pages in the background; a miss on any path is ignored
+        void Prefetch(const std::vector<std::string>& filePaths) const;
+
+        //>Splits data into chunks and compresses each; the entry is stored as is when that does not pay or isCompressible is
+        //>false, for files read in place from the mapping for as long as they are in use
+        static AssetPackSource CompressEntry(const std::string& filePath, const uint8_t* data, size_t size, bool isCompressible = true);
+        //>Sorts the sources by path hash and writes the pack through a temporary file
+        [[nodiscard]] static bool Write(const std::string& packPath, const std::vector<AssetPackSource>& sources);
+
+        void RecordLooseRead(size_t bytes);
+        void RecordPackedRead(size_t bytes);
+        [[nodiscard]] AssetIoStats GetStats() const;
+        void LogReport() const;
+
+    private:
+        MappedFile m_file;
+        std::vector<uint8_t> m_directory; //inflated entry table, chunk table and names
+        const AssetPackEntry* m_entries;
+        const AssetPackChunk* m_chunks;
+        const char* m_names;
+        uint32_t m_entryCount;
+
+        std::atomic<uint32_t> m_packedOpens;
+        std::atomic<uint32_t> m_looseOpens;
+        mutable std::atomic<uint32_t> m_hashLookups;
+        std::atomic<size_t> m_packedBytesRead;
+        std::atomic<size_t> m_inflatedBytes;
+        std::atomic<size_t> m_looseBytesRead;
+        std::atomic<uint64_t> m_inflateMicroseconds;
+    };
+}
@@ -0,0 +1,19 @@
+#include <fstream>
+
+#include "FileIO.h"
+
+namespace renderer
+{
+    bool ReadWholeFile(const std::string& filePath, std::vector<uint8_t>& outData)
+    {
+        outData.clear();
+        std::ifstream file(filePath, std::ios::binary | std::ios::ate);
+        if (!file)
+            return false;
+
+        outData.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(outData.data()), static_cast<std::streamsize>(outData.size()));
+        return static_cast<bool>(file);
+    }
+}
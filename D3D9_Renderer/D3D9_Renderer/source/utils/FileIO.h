@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace renderer
+{
+    //>Reads the whole file into outData. False (and outData empty) if it cannot be opened.
+    [[nodiscard]] bool ReadWholeFile(const std::string& filePath, std::vector<uint8_t>& outData);
+}
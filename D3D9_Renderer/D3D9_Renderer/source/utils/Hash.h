@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace renderer
+{
+    constexpr uint64_t HashSeed = 14695981039346656037ull;
+
+    //>FNV-1a, 64 bit. Chain calls by passing the previous result as the seed.
+    inline uint64_t HashBytes(const void* data, size_t size, uint64_t seed = HashSeed)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        uint64_t hash = seed;
+        for (size_t itr = 0; itr < size; ++itr)
+        {
+            hash ^= bytes[itr];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+}
@@ -0,0 +1,158 @@
+#include <cstring>
+
+#include "Lz4Block.h"
+
+namespace renderer
+{
+    namespace
+    {
+        constexpr size_t MinMatch = 4;
+        constexpr size_t LastLiterals = 5;   //the format ends every block with at least this many literals
+        constexpr size_t MatchFindLimit = 12; //and starts no match closer to the end than this
+        constexpr size_t MaxOffset = 65535;
+        constexpr uint32_t HashLog = 14;
+
+        inline uint32_t Read32(const uint8_t* data)
+        {
+            uint32_t value;
+            memcpy(&value, data, sizeof(value));
+            return value;
+        }
+
+        inline uint32_t HashSequence(uint32_t sequence)
+        {
+            return (sequence * 2654435761u) >> (32 - HashLog);
+        }
+
+        void WriteLength(std::vector<uint8_t>& outData, size_t length)
+        {
+            for (; length >= 255; length -= 255)
+                outData.push_back(255);
+            outData.push_back(static_cast<uint8_t>(length));
+        }
+
+        void WriteSequence(std::vector<uint8_t>& outData, const uint8_t* literals, size_t literalCount, size_t offset, size_t matchLength)
+        {
+            const size_t matchCode = matchLength - MinMatch;
+            const uint8_t literalToken = static_cast<uint8_t>(literalCount < 15 ? literalCount : 15);
+            const uint8_t matchToken = static_cast<uint8_t>(matchCode < 15 ? matchCode : 15);
+            outData.push_back(static_cast<uint8_t>((literalToken << 4) | matchToken));
+            if (literalCount >= 15)
+                WriteLength(outData, literalCount - 15);
+            outData.insert(outData.end(), literals, literals + literalCount);
+
+            outData.push_back(static_cast<uint8_t>(offset & 0xFF));
+            outData.push_back(static_cast<uint8_t>(offset >> 8));
+            if (matchCode >= 15)
+                WriteLength(outData, matchCode - 15);
+        }
+
+        bool ReadLength(const uint8_t*& input, const uint8_t* inputEnd, size_t& length)
+        {
+            uint8_t value;
+            do
+            {
+                if (input >= inputEnd)
+                    return false;
+                value = *input++;
+                length += value;
+            } while (value == 255);
+            return true;
+        }
+    }
+
+    size_t Lz4Compress(const uint8_t* source, size_t sourceSize, std::vector<uint8_t>& outData)
+    {
+        const size_t startSize = outData.size();
+        outData.reserve(startSize + Lz4CompressBound(sourceSize));
+
+        size_t anchor = 0;
+        if (sourceSize > MatchFindLimit)
+        {
+            //positions + 1, so a zeroed table means no candidate
+            std::vector<uint32_t> table(size_t(1) << HashLog, 0);
+            const size_t matchLimit = sourceSize - LastLiterals;
+            size_t position = 0;
+            while (position < sourceSize - MatchFindLimit)
+            {
+                const uint32_t sequence = Read32(source + position);
+                const uint32_t hash = HashSequence(sequence);
+                const size_t candidate = table[hash];
+                table[hash] = static_cast<uint32_t>(position + 1);
+                if (candidate == 0 || position - (candidate - 1) > MaxOffset || Read32(source + candidate - 1) != sequence)
+                {
+                    ++position;
+                    continue;
+                }
+
+                const size_t reference = candidate - 1;
+                size_t matchLength = MinMatch;
+                while (position + matchLength < matchLimit && source[reference + matchLength] == source[position + matchLength])
+                    ++matchLength;
+
+                WriteSequence(outData, source + anchor, position - anchor, position - reference, matchLength);
+                position += matchLength;
+                anchor = position;
+            }
+        }
+
+        //the trailing literals carry a token without an offset
+        const size_t literalCount = sourceSize - anchor;
+        outData.push_back(static_cast<uint8_t>((literalCount < 15 ? literalCount : 15) << 4));
+        if (literalCount >= 15)
+            WriteLength(outData, literalCount - 15);
+        outData.insert(outData.end(), source + anchor, source + sourceSize);
+        return outData.size() - startSize;
+    }
+
+    bool Lz4Decompress(const uint8_t* source, size_t sourceSize, uint8_t* destination, size_t destinationSize)
+    {
+        const uint8_t* input = source;
+        const uint8_t* const inputEnd = source + sourceSize;
+        uint8_t* output = destination;
+        uint8_t* const outputEnd = destination + destinationSize;
+
+        while (input < inputEnd)
+        {
+            const uint8_t token = *input++;
+            size_t literalCount = token >> 4;
+            if (literalCount == 15 && !ReadLength(input, inputEnd, literalCount))
+                return false;
+            if (literalCount > static_cast<size_t>(inputEnd - input) || literalCount > static_cast<size_t>(outputEnd - output))
+                return false;
+            memcpy(output, input, literalCount);
+            input += literalCount;
+            output += literalCount;
+            if (input == inputEnd)
+                break; //the last sequence has no match
+
+            if (inputEnd - input < 2)
+                return false;
+            const size_t offset = static_cast<size_t>(input[0]) | (static_cast<size_t>(input[1]) << 8);
+            input += 2;
+            if (offset == 0 || offset > static_cast<size_t>(output - destination))
+                return false;
+
+            size_t matchLength = token & 0x0F;
+            if (matchLength == 15 && !ReadLength(input, inputEnd, matchLength))
+                return false;
+            matchLength += MinMatch;
+            if (matchLength > static_cast<size_t>(outputEnd - output))
+                return false;
+
+            //an offset shorter than the match repeats the bytes just written, so it copies forward one at a time
+            const uint8_t* match = output - offset;
+            if (offset >= matchLength)
+            {
+                memcpy(output, match, matchLength);
+                output += matchLength;
+            }
+            else
+            {
+                for (size_t itr = 0; itr < matchLength; ++itr)
+                    *output++ = *match++;
+            }
+        }
+        return output == outputEnd;
+    }
+}
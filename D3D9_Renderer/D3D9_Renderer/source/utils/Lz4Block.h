@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace renderer
+{
+    //>Worst case compressed size of size bytes: incompressible input grows by its literal run lengths
+    inline size_t Lz4CompressBound(size_t size) { return size + size / 255 + 16; }
+
+    //>Greedy LZ4 block format compressor (no frame header). Appends to outData and returns the compressed size.
+    size_t Lz4Compress(const uint8_t* source, size_t sourceSize, std::vector<uint8_t>& outData);
+    //>Inflates a whole block into exactly destinationSize bytes. False on a malformed block or a size mismatch.
+    [[nodiscard]] bool Lz4Decompress(const uint8_t* source, size_t sourceSize, uint8_t* destination, size_t destinationSize);
+}
@@ -0,0 +1,73 @@
+#include "MappedFile.h"
+
+namespace renderer
+{
+    MappedFile::MappedFile()
+        :m_file(INVALID_HANDLE_VALUE),
+        m_mapping(nullptr),
+        m_view(nullptr),
+        m_size(0)
+    {
+    }
+
+    MappedFile::~MappedFile()
+    {
+        Close();
+    }
+
+    bool MappedFile::Open(const std::string& filePath, AccessPattern accessPattern)
+    {
+        Close();
+
+        //the hint lets the cache manager read ahead aggressively for front-to-back parsing
+        const DWORD accessFlags = (accessPattern == AccessPattern::Sequential) ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS;
+
+        m_file = ::CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | accessFlags, nullptr);
+        if (m_file == INVALID_HANDLE_VALUE)
+            return false;
+
+        LARGE_INTEGER fileSize;
+        if (!::GetFileSizeEx(m_file, &fileSize) || fileSize.QuadPart == 0) //empty files cannot be mapped
+        {
+            Close();
+            return false;
+        }
+        m_size = static_cast<size_t>(fileSize.QuadPart);
+
+        m_mapping = ::CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_mapping == nullptr)
+        {
+            Close();
+            return false;
+        }
+
+        m_view = ::MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+        if (m_view == nullptr)
+        {
+            Close();
+            return false;
+        }
+
+        return true;
+    }
+
+    void MappedFile::Close()
+    {
+        if (m_view)
+        {
+            ::UnmapViewOfFile(m_view);
+            m_view = nullptr;
+        }
+        if (m_mapping)
+        {
+            ::CloseHandle(m_mapping);
+            m_mapping = nullptr;
+        }
+        if (m_file != INVALID_HANDLE_VALUE)
+        {
+            ::CloseHandle(m_file);
+            m_file = INVALID_HANDLE_VALUE;
+        }
+        m_size = 0;
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <windows.h>
+#include <cstdint>
+#include <string>
+
+namespace renderer
+{
+    //>Read-only view of a whole file mapped into the address space
+    class MappedFile
+    {
+    public:
+        enum class AccessPattern
+        {
+            Sequential,
+            Random
+        };
+
+        MappedFile();
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        [[nodiscard]] bool Open(const std::string& filePath, AccessPattern accessPattern = AccessPattern::Sequential);
+        void Close();
+
+        inline bool IsOpen() const { return m_view != nullptr; }
+        inline const uint8_t* GetData() const { return static_cast<const uint8_t*>(m_view); }
+        inline size_t GetSize() const { return m_size; }
+
+    private:
+        HANDLE m_file;
+        HANDLE m_mapping;
+        const void* m_view;
+        size_t m_size;
+    };
+}
@@ -0,0 +1,30 @@
+#pragma comment (lib, "psapi.lib")
+
+#include <windows.h>
+#include <psapi.h>
+
+#include "MemoryStats.h"
+
+namespace renderer
+{
+    namespace
+    {
+        PROCESS_MEMORY_COUNTERS QueryProcessMemory()
+        {
+            PROCESS_MEMORY_COUNTERS counters = {};
+            counters.cb = sizeof(counters);
+            ::GetProcessMemoryInfo(::GetCurrentProcess(), &counters, sizeof(counters));
+            return counters;
+        }
+    }
+
+    size_t GetPeakWorkingSetBytes()
+    {
+        return QueryProcessMemory().PeakWorkingSetSize;
+    }
+
+    size_t GetWorkingSetBytes()
+    {
+        return QueryProcessMemory().WorkingSetSize;
+    }
+}
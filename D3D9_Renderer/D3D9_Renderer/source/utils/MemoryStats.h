@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstddef>
+
+namespace renderer
+{
+    [[nodiscard]] size_t GetPeakWorkingSetBytes();
+    [[nodiscard]] size_t GetWorkingSetBytes();
+
+    inline double BytesToMB(size_t bytes) { return static_cast<double>(bytes) / (1024.0 * 1024.0); }
+}
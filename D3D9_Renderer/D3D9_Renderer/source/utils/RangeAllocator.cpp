@@ -0,0 +1,103 @@
+#include <cassert>
+#include <iterator>
+
+#include "RangeAllocator.h"
+
+namespace renderer
+{
+    RangeAllocator::RangeAllocator(uint32_t capacity)
+        :m_freeRanges(),
+        m_capacity(0),
+        m_freeCount(0)
+    {
+        Reset(capacity);
+    }
+
+    void RangeAllocator::Reset(uint32_t capacity)
+    {
+        m_freeRanges.clear();
+        m_capacity = capacity;
+        m_freeCount = capacity;
+        if (capacity > 0)
+            m_freeRanges.emplace(0, capacity);
+    }
+
+    void RangeAllocator::ResetCompacted(uint32_t usedCount)
+    {
+        assert(usedCount <= m_capacity);
+        m_freeRanges.clear();
+        m_freeCount = m_capacity - usedCount;
+        if (m_freeCount > 0)
+            m_freeRanges.emplace(usedCount, m_freeCount);
+    }
+
+    uint32_t RangeAllocator::Allocate(uint32_t count)
+    {
+        assert(count > 0);
+        if (count > m_freeCount)
+            return InvalidOffset;
+
+        //a linear scan: a page holds a few hundred ranges at most, and an exact fit ends it early
+        auto best = m_freeRanges.end();
+        for (auto itr = m_freeRanges.begin(); itr != m_freeRanges.end(); ++itr)
+        {
+            if (itr->second < count || (best != m_freeRanges.end() && itr->second >= best->second))
+                continue;
+            best = itr;
+            if (itr->second == count)
+                break;
+        }
+        if (best == m_freeRanges.end())
+            return InvalidOffset;
+
+        const uint32_t offset = best->first;
+        const uint32_t remaining = best->second - count;
+        m_freeRanges.erase(best);
+        if (remaining > 0)
+            m_freeRanges.emplace(offset + count, remaining);
+        m_freeCount -= count;
+        return offset;
+    }
+
+    void RangeAllocator::Free(uint32_t offset, uint32_t count)
+    {
+        assert(count > 0 && offset + count <= m_capacity);
+        auto next = m_freeRanges.lower_bound(offset);
+        assert(next == m_freeRanges.end() || next->first >= offset + count);
+
+        uint32_t start = offset;
+        uint32_t end = offset + count;
+        if (next != m_freeRanges.begin())
+        {
+            auto previous = std::prev(next);
+            assert(previous->first + previous->second <= offset);
+            if (previous->first + previous->second == offset)
+            {
+                start = previous->first;
+                m_freeRanges.erase(previous);
+            }
+        }
+        if (next != m_freeRanges.end() && next->first == end)
+        {
+            end += next->second;
+            m_freeRanges.erase(next);
+        }
+        m_freeRanges.emplace(start, end - start);
+        m_freeCount += count;
+    }
+
+    uint32_t RangeAllocator::GetLargestFreeRange() const
+    {
+        uint32_t largest = 0;
+        for (const auto& range : m_freeRanges)
+            largest = range.second > largest ? range.second : largest;
+        return largest;
+    }
+
+    float RangeAllocator::GetFragmentation() const
+    {
+        if (m_freeCount == 0)
+            return 0.0f;
+        return 1.0f - static_cast<float>(GetLargestFreeRange()) / static_cast<float>(m_freeCount);
+    }
+}
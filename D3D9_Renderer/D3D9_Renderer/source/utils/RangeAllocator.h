@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+
+namespace renderer
+{
+    //>Free-list sub-allocator over [0, capacity) elements. Best fit keeps large holes for large requests; freeing
+    //>coalesces with both neighbours, so the list only ever holds ranges separated by live allocations.
+    class RangeAllocator
+    {
+    public:
+        static constexpr uint32_t InvalidOffset = UINT32_MAX;
+
+        explicit RangeAllocator(uint32_t capacity = 0);
+
+        //>Everything free again
+        void Reset(uint32_t capacity);
+        //>[0, usedCount) allocated as one block, the rest free: what a compacted page looks like
+        void ResetCompacted(uint32_t usedCount);
+
+        [[nodiscard]] uint32_t Allocate(uint32_t count);
+        void Free(uint32_t offset, uint32_t count);
+
+        inline uint32_t GetCapacity() const { return m_capacity; }
+        inline uint32_t GetFreeCount() const { return m_freeCount; }
+        inline uint32_t GetFreeRangeCount() const { return static_cast<uint32_t>(m_freeRanges.size()); }
+        [[nodiscard]] uint32_t GetLargestFreeRange() const;
+        //>Share of the free elements outside the largest free range: 0 when the free space is one hole
+        [[nodiscard]] float GetFragmentation() const;
+
+    private:
+        std::map<uint32_t, uint32_t> m_freeRanges; //offset -> count, ordered so neighbours are one step away
+        uint32_t m_capacity;
+        uint32_t m_freeCount;
+    };
+}
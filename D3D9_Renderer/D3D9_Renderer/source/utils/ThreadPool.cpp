@@ -0,0 +1,105 @@
+#include <windows.h>
+#include <algorithm>
+#include <atomic>
+
+#include "ThreadPool.h"
+
+namespace renderer
+{
+    ThreadPool::ThreadPool(uint32_t numThreads)
+        :m_workers(),
+        m_jobs(),
+        m_mutex(),
+        m_condition(),
+        m_shutdown(false)
+    {
+        if (numThreads == 0)
+        {
+            const uint32_t hardwareThreads = std::thread::hardware_concurrency();
+            numThreads = std::max(1u, hardwareThreads > 1 ? hardwareThreads - 1 : 1u);
+        }
+
+        m_workers.reserve(numThreads);
+        for (uint32_t itr = 0; itr < numThreads; ++itr)
+            m_workers.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_shutdown = true;
+        }
+        m_condition.notify_all();
+
+        for (auto& worker : m_workers)
+            worker.join();
+    }
+
+    void ThreadPool::ParallelFor(uint32_t count, const std::function<void(uint32_t)>& func)
+    {
+        if (count == 0)
+            return;
+
+        struct ParallelForState
+        {
+            std::atomic<uint32_t> nextIndex{ 0 };
+            std::atomic<uint32_t> doneCount{ 0 };
+            std::mutex mutex;
+            std::condition_variable finished;
+        };
+        auto state = std::make_shared<ParallelForState>();
+
+        //helpers that start after every index is claimed exit without touching func,
+        //so it is safe for them to outlive this call
+        auto runItems = [state, count, &func]()
+        {
+            for (uint32_t index = state->nextIndex.fetch_add(1); index < count; index = state->nextIndex.fetch_add(1))
+            {
+                func(index);
+                if (state->doneCount.fetch_add(1) + 1 == count)
+                {
+                    std::lock_guard<std::mutex> lock(state->mutex);
+                    state->finished.notify_all();
+                }
+            }
+        };
+
+        const uint32_t numHelpers = std::min(GetThreadCount(), count - 1);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (uint32_t itr = 0; itr < numHelpers; ++itr)
+                m_jobs.emplace(runItems);
+        }
+        m_condition.notify_all();
+
+        runItems();
+
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->finished.wait(lock, [&state, count]() { return state->doneCount.load() == count; });
+    }
+
+    void ThreadPool::WorkerLoop()
+    {
+        //jobs decode through WIC, which needs COM. Only the pool's own threads join the multithreaded apartment;
+        //a caller helping out in ParallelFor keeps whatever apartment it chose (the render thread's D3DX needs STA)
+        const HRESULT comResult = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+        while (true)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_condition.wait(lock, [this]() { return m_shutdown || !m_jobs.empty(); });
+
+                if (m_shutdown && m_jobs.empty())
+                    break;
+
+                job = std::move(m_jobs.front());
+                m_jobs.pop();
+            }
+            job();
+        }
+        if (SUCCEEDED(comResult))
+            CoUninitialize();
+    }
+}
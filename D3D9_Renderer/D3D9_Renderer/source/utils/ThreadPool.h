@@ -0,0 +1,61 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace renderer
+{
+    //>Fixed set of worker threads fed from one FIFO job queue
+    class ThreadPool
+    {
+    public:
+        //numThreads == 0 picks one worker per hardware thread, minus the calling thread
+        explicit ThreadPool(uint32_t numThreads = 0);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        inline static ThreadPool& GetInstance()
+        {
+            static ThreadPool instance;
+            return instance;
+        }
+
+        template<typename Func>
+        std::future<std::invoke_result_t<Func>> Enqueue(Func&& func)
+        {
+            using ResultType = std::invoke_result_t<Func>;
+            auto task = std::make_shared<std::packaged_task<ResultType()>>(std::forward<Func>(func));
+            auto result = task->get_future();
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_jobs.emplace([task]() { (*task)(); });
+            }
+            m_condition.notify_one();
+            return result;
+        }
+
+        //>Runs func(0..count-1) across the workers; the calling thread helps and returns once every index is done
+        void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& func);
+
+        inline uint32_t GetThreadCount() const { return static_cast<uint32_t>(m_workers.size()); }
+
+    private:
+        void WorkerLoop();
+
+        std::vector<std::thread> m_workers;
+        std::queue<std::function<void()>> m_jobs;
+        std::mutex m_mutex;
+        std::condition_variable m_condition;
+        bool m_shutdown;
+    };
+}
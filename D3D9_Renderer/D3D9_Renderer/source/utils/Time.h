@@ -30,4 +30,22 @@ namespace renderer
         int16_t m_numFrames;
         int16_t m_fps;
 	};
+
+    //>Wall-clock interval measurement for load/import profiling
+    class Stopwatch
+    {
+    public:
+        Stopwatch()
+            :m_tStart(std::chrono::high_resolution_clock::now())
+        {}
+
+        inline void Restart() { m_tStart = std::chrono::high_resolution_clock::now(); }
+        inline double GetElapsedMs() const
+        {
+            return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - m_tStart).count();
+        }
+
+    private:
+        std::chrono::high_resolution_clock::time_point m_tStart;
+    };
 }
\ No newline at end of file
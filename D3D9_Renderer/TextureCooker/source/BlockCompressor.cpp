@@ -0,0 +1,218 @@
+#include <emmintrin.h>
+#include <algorithm>
+#include <cstring>
+
+#include "BlockCompressor.h"
+
+namespace cooker
+{
+    namespace
+    {
+        //>Gathers one 4x4 block (16 BGRA pixels, row-major) with edge clamping
+        void ExtractBlock(const uint8_t* bgra, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, uint8_t* block)
+        {
+            for (uint32_t y = 0; y < 4; ++y)
+            {
+                const uint32_t srcY = (std::min)(blockY * 4 + y, height - 1);
+                for (uint32_t x = 0; x < 4; ++x)
+                {
+                    const uint32_t srcX = (std::min)(blockX * 4 + x, width - 1);
+                    memcpy(block + (y * 4 + x) * 4, bgra + (static_cast<size_t>(srcY) * width + srcX) * 4, 4);
+                }
+            }
+        }
+
+        inline uint16_t PackRGB565(uint32_t bgra)
+        {
+            const uint32_t b = bgra & 0xFF;
+            const uint32_t g = (bgra >> 8) & 0xFF;
+            const uint32_t r = (bgra >> 16) & 0xFF;
+            return static_cast<uint16_t>((((r * 31 + 127) / 255) << 11) | (((g * 63 + 127) / 255) << 5) | ((b * 31 + 127) / 255));
+        }
+
+        inline uint32_t UnpackRGB565(uint16_t color)
+        {
+            const uint32_t r5 = (color >> 11) & 0x1F;
+            const uint32_t g6 = (color >> 5) & 0x3F;
+            const uint32_t b5 = color & 0x1F;
+            const uint32_t r = (r5 << 3) | (r5 >> 2);
+            const uint32_t g = (g6 << 2) | (g6 >> 4);
+            const uint32_t b = (b5 << 3) | (b5 >> 2);
+            return (r << 16) | (g << 8) | b;
+        }
+
+        inline uint32_t LerpColor(uint32_t c0, uint32_t c1, uint32_t w0, uint32_t w1)
+        {
+            uint32_t result = 0;
+            for (uint32_t shift = 0; shift < 24; shift += 8)
+            {
+                const uint32_t channel = (((c0 >> shift) & 0xFF) * w0 + ((c1 >> shift) & 0xFF) * w1) / (w0 + w1);
+                result |= channel << shift;
+            }
+            return result;
+        }
+
+        //>Per-pixel L1 distance of 4 BGRA pixels to one colour, alpha ignored: 4 x int32
+        inline __m128i ColorDistance(__m128i pixels, __m128i color)
+        {
+            const __m128i diff = _mm_or_si128(_mm_subs_epu8(pixels, color), _mm_subs_epu8(color, pixels));
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i ones = _mm_set1_epi16(1);
+            //widen to 16 bit and pairwise add: [b+g, r+0] per pixel, then fold the pairs
+            const __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(diff, zero), ones);
+            const __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(diff, zero), ones);
+            const __m128i loSum = _mm_add_epi32(lo, _mm_shuffle_epi32(lo, _MM_SHUFFLE(2, 3, 0, 1)));
+            const __m128i hiSum = _mm_add_epi32(hi, _mm_shuffle_epi32(hi, _MM_SHUFFLE(2, 3, 0, 1)));
+            return _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(loSum), _mm_castsi128_ps(hiSum), _MM_SHUFFLE(2, 0, 2, 0)));
+        }
+
+        //>Bounding box of the 16 pixels: returns min/max BGRA packed in the low dword of each register
+        inline void BlockMinMax(const __m128i* pixels, __m128i& outMin, __m128i& outMax)
+        {
+            __m128i minColor = _mm_min_epu8(_mm_min_epu8(pixels[0], pixels[1]), _mm_min_epu8(pixels[2], pixels[3]));
+            __m128i maxColor = _mm_max_epu8(_mm_max_epu8(pixels[0], pixels[1]), _mm_max_epu8(pixels[2], pixels[3]));
+            minColor = _mm_min_epu8(minColor, _mm_shuffle_epi32(minColor, _MM_SHUFFLE(2, 3, 0, 1)));
+            minColor = _mm_min_epu8(minColor, _mm_shuffle_epi32(minColor, _MM_SHUFFLE(1, 0, 3, 2)));
+            maxColor = _mm_max_epu8(maxColor, _mm_shuffle_epi32(maxColor, _MM_SHUFFLE(2, 3, 0, 1)));
+            maxColor = _mm_max_epu8(maxColor, _mm_shuffle_epi32(maxColor, _MM_SHUFFLE(1, 0, 3, 2)));
+            outMin = minColor;
+            outMax = maxColor;
+        }
+
+        void EncodeColorBlock(const __m128i* pixels, uint32_t minColor, uint32_t maxColor, uint8_t* outBlock)
+        {
+            //inset the box by 1/16 of its extent; pulls the endpoints off outliers and lowers the average error
+            uint32_t insetMin = 0;
+            uint32_t insetMax = 0;
+            for (uint32_t shift = 0; shift < 24; shift += 8)
+            {
+                const uint32_t lo = (minColor >> shift) & 0xFF;
+                const uint32_t hi = (maxColor >> shift) & 0xFF;
+                const uint32_t inset = (hi - lo) >> 4;
+                insetMin |= (lo + inset) << shift;
+                insetMax |= (hi - inset) << shift;
+            }
+
+            const uint16_t color0 = PackRGB565(insetMax);
+            const uint16_t color1 = PackRGB565(insetMin);
+            uint32_t indices = 0;
+
+            //per-channel max >= min, so color0 >= color1 always; only equality drops into the 3-colour mode
+            if (color0 != color1)
+            {
+                const uint32_t palette0 = UnpackRGB565(color0);
+                const uint32_t palette1 = UnpackRGB565(color1);
+                const __m128i colors[4] =
+                {
+                    _mm_set1_epi32(static_cast<int>(palette0)),
+                    _mm_set1_epi32(static_cast<int>(palette1)),
+                    _mm_set1_epi32(static_cast<int>(LerpColor(palette0, palette1, 2, 1))),
+                    _mm_set1_epi32(static_cast<int>(LerpColor(palette0, palette1, 1, 2)))
+                };
+                const __m128i rgbMask = _mm_set1_epi32(0x00FFFFFF);
+
+                for (uint32_t row = 0; row < 4; ++row)
+                {
+                    const __m128i rgb = _mm_and_si128(pixels[row], rgbMask);
+                    __m128i bestDistance = ColorDistance(rgb, colors[0]);
+                    __m128i bestIndex = _mm_setzero_si128();
+                    for (int paletteIndex = 1; paletteIndex < 4; ++paletteIndex)
+                    {
+                        const __m128i distance = ColorDistance(rgb, colors[paletteIndex]);
+                        const __m128i closer = _mm_cmplt_epi32(distance, bestDistance);
+                        bestDistance = _mm_or_si128(_mm_and_si128(closer, distance), _mm_andnot_si128(closer, bestDistance));
+                        bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(paletteIndex)), _mm_andnot_si128(closer, bestIndex));
+                    }
+
+                    alignas(16) uint32_t rowIndices[4];
+                    _mm_store_si128(reinterpret_cast<__m128i*>(rowIndices), bestIndex);
+                    for (uint32_t column = 0; column < 4; ++column)
+                    {
+                        indices |= rowIndices[column] << ((row * 4 + column) * 2);
+                    }
+                }
+            }
+
+            memcpy(outBlock, &color0, 2);
+            memcpy(outBlock + 2, &color1, 2);
+            memcpy(outBlock + 4, &indices, 4);
+        }
+
+        void EncodeAlphaBlock(const uint8_t* block, uint8_t minAlpha, uint8_t maxAlpha, uint8_t* outBlock)
+        {
+            //alpha0 > alpha1 selects the 8-value ramp; no inset so masks keep exact 0 and 255
+            outBlock[0] = maxAlpha;
+            outBlock[1] = minAlpha;
+            uint64_t indices = 0;
+            if (maxAlpha != minAlpha)
+            {
+                const uint32_t range = maxAlpha - minAlpha;
+                for (uint32_t pixel = 0; pixel < 16; ++pixel)
+                {
+                    //t = 0 is alpha1 (index 1), t = 7 is alpha0 (index 0), t = 1..6 are indices 7..2
+                    const uint32_t alpha = block[pixel * 4 + 3];
+                    const uint32_t t = ((alpha - minAlpha) * 7 + range / 2) / range;
+                    const uint64_t index = t == 7 ? 0 : (t == 0 ? 1 : 8 - t);
+                    indices |= index << (pixel * 3);
+                }
+            }
+            for (uint32_t byte = 0; byte < 6; ++byte)
+            {
+                outBlock[2 + byte] = static_cast<uint8_t>(indices >> (byte * 8));
+            }
+        }
+
+        template<bool WithAlpha>
+        void CompressBlocks(const uint8_t* bgra, uint32_t width, uint32_t height, std::vector<uint8_t>& outBlocks)
+        {
+            constexpr uint32_t blockBytes = WithAlpha ? 16 : 8;
+            const uint32_t blocksWide = (width + 3) / 4;
+            const uint32_t blocksHigh = (height + 3) / 4;
+            outBlocks.resize(static_cast<size_t>(blocksWide) * blocksHigh * blockBytes);
+
+            alignas(16) uint8_t block[64];
+            uint8_t* out = outBlocks.data();
+            for (uint32_t blockY = 0; blockY < blocksHigh; ++blockY)
+            {
+                for (uint32_t blockX = 0; blockX < blocksWide; ++blockX)
+                {
+                    ExtractBlock(bgra, width, height, blockX, blockY, block);
+                    const __m128i pixels[4] =
+                    {
+                        _mm_load_si128(reinterpret_cast<const __m128i*>(block)),
+                        _mm_load_si128(reinterpret_cast<const __m128i*>(block + 16)),
+                        _mm_load_si128(reinterpret_cast<const __m128i*>(block + 32)),
+                        _mm_load_si128(reinterpret_cast<const __m128i*>(block + 48))
+                    };
+
+                    __m128i minColor;
+                    __m128i maxColor;
+                    BlockMinMax(pixels, minColor, maxColor);
+                    const auto minPacked = static_cast<uint32_t>(_mm_cvtsi128_si32(minColor));
+                    const auto maxPacked = static_cast<uint32_t>(_mm_cvtsi128_si32(maxColor));
+
+                    if (WithAlpha)
+                    {
+                        EncodeAlphaBlock(block, static_cast<uint8_t>(minPacked >> 24), static_cast<uint8_t>(maxPacked >> 24), out);
+                        EncodeColorBlock(pixels, minPacked, maxPacked, out + 8);
+                    }
+                    else
+                    {
+                        EncodeColorBlock(pixels, minPacked, maxPacked, out);
+                    }
+                    out += blockBytes;
+                }
+            }
+        }
+    }
+
+    void CompressBC1(const uint8_t* bgra, uint32_t width, uint32_t height, std::vector<uint8_t>& outBlocks)
+    {
+        CompressBlocks<false>(bgra, width, height, outBlocks);
+    }
+
+    void CompressBC3(const uint8_t* bgra, uint32_t width, uint32_t height, std::vector<uint8_t>& outBlocks)
+    {
+        CompressBlocks<true>(bgra, width, height, outBlocks);
+    }
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace cooker
+{
+    //>Compresses a tightly packed BGRA8 image into BC1 (DXT1) blocks, block rows top to bottom.
+    //>Sizes that are not a multiple of 4 replicate the last row/column into the partial blocks.
+    void CompressBC1(const uint8_t* bgra, uint32_t width, uint32_t height, std::vector<uint8_t>& outBlocks);
+    //>BC3 (DXT5): interpolated 8-bit alpha block followed by a BC1 colour block
+    void CompressBC3(const uint8_t* bgra, uint32_t width, uint32_t height, std::vector<uint8_t>& outBlocks);
+}
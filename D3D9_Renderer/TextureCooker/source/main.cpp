@@ -0,0 +1,313 @@
+//>Offline texture cooker: PNG -> pre-mipped BC1/BC3 .ctex next to the source file.
+//>Usage: TextureCooker [--force] [--models directory] [directory ...]   (defaults to data/Content and data/DefaultTex, models from data)
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+
+#include "BlockCompressor.h"
+#include "../../D3D9_Renderer/source/utils/AssetPack.h"
+#include "../../D3D9_Renderer/source/renderer/CookedTexture.h"
+#include "../../D3D9_Renderer/source/renderer/TextureDecoder.h"
+#include "../../D3D9_Renderer/source/utils/Hash.h"
+#include "../../D3D9_Renderer/source/utils/MappedFile.h"
+#include "../../D3D9_Renderer/source/utils/ThreadPool.h"
+#include "../../D3D9_Renderer/source/utils/Time.h"
+
+namespace filesystem = std::experimental::filesystem;
+
+namespace
+{
+    enum class TextureKind
+    {
+        Color,
+        Normal,
+        Opacity
+    };
+
+    enum class CookResult
+    {
+        Cooked,
+        UpToDate,
+        Failed
+    };
+
+    struct CookJob
+    {
+        std::string sourcePath;
+        CookResult result;
+        renderer::CookedTextureFormat format;
+        size_t uncompressedBytes; //BGRA8 mip chain, what the runtime decode path keeps in video memory
+        size_t cookedBytes;
+        std::string message;
+    };
+
+    //>Normalized texture path -> the slot every material that uses it binds it to
+    using TextureSlots = std::unordered_map<std::string, TextureKind>;
+
+    std::string ToLower(std::string text)
+    {
+        std::transform(text.begin(), text.end(), text.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+        return text;
+    }
+
+    //>Records the slot of every texture the model's materials reference, resolved the way Model does (model directory + path).
+    //>A texture bound to different slots anywhere is cooked as plain colour, which every slot can sample.
+    void CollectTextureSlots(const std::string& modelPath, TextureSlots& slots)
+    {
+        Assimp::Importer importer;
+        const aiScene* scene = importer.ReadFile(modelPath, 0);
+        if (scene == nullptr)
+        {
+            std::printf("skipping model %s: %s\n", modelPath.c_str(), importer.GetErrorString());
+            return;
+        }
+
+        //the renderer's normal slot reads aiTextureType_HEIGHT; its specular slot reads SHININESS
+        const std::pair<aiTextureType, TextureKind> slotKinds[] =
+        {
+            { aiTextureType_DIFFUSE, TextureKind::Color },
+            { aiTextureType_HEIGHT, TextureKind::Normal },
+            { aiTextureType_SHININESS, TextureKind::Color },
+            { aiTextureType_OPACITY, TextureKind::Opacity }
+        };
+        const std::string fileDir = modelPath.substr(0, modelPath.find_last_of("/") + 1);
+        for (uint32_t matIndex = 0; matIndex < scene->mNumMaterials; ++matIndex)
+        {
+            const aiMaterial* material = scene->mMaterials[matIndex];
+            for (const auto& slotKind : slotKinds)
+            {
+                aiString path;
+                if (material->GetTextureCount(slotKind.first) == 0 || material->GetTexture(slotKind.first, 0, &path) != aiReturn_SUCCESS)
+                    continue;
+
+                auto inserted = slots.emplace(renderer::AssetPack::NormalizePath(fileDir + path.C_Str()), slotKind.second);
+                if (!inserted.second && inserted.first->second != slotKind.second)
+                    inserted.first->second = TextureKind::Color;
+            }
+        }
+    }
+
+    //>Textures no scanned material references are cooked as colour: only a known normal slot may get the swizzled layout
+    TextureKind ClassifyTexture(const TextureSlots& slots, const std::string& sourcePath)
+    {
+        auto found = slots.find(renderer::AssetPack::NormalizePath(sourcePath));
+        return found != slots.end() ? found->second : TextureKind::Color;
+    }
+
+    bool HasAlpha(const renderer::StagingImage& image)
+    {
+        const auto& pixels = image.mips.front().pixels;
+        for (size_t itr = 3; itr < pixels.size(); itr += 4)
+        {
+            if (pixels[itr] != 255)
+                return true;
+        }
+        return false;
+    }
+
+    //>BC3 normal layout: X moves to alpha (its own 8-bit ramp), Y stays in green (6 bits), red/blue are cleared
+    void SwizzleNormalMap(renderer::StagingImage& image)
+    {
+        for (auto& mip : image.mips)
+        {
+            for (size_t itr = 0; itr < mip.pixels.size(); itr += 4)
+            {
+                uint8_t* pixel = &mip.pixels[itr];
+                const uint8_t x = pixel[2];
+                pixel[0] = 0;
+                pixel[2] = 0;
+                pixel[3] = x;
+            }
+        }
+    }
+
+    void CookTexture(CookJob& job, const TextureSlots& slots, bool force)
+    {
+        renderer::MappedFile source;
+        if (!source.Open(job.sourcePath))
+        {
+            job.result = CookResult::Failed;
+            job.message = "cannot open";
+            return;
+        }
+
+        const uint64_t sourceHash = renderer::HashBytes(source.GetData(), source.GetSize());
+        const std::string cookedPath = renderer::CookedTexture::GetCookedPath(job.sourcePath);
+        if (!force)
+        {
+            renderer::CookedTexture existing;
+            if (existing.Open(cookedPath, sourceHash))
+            {
+                job.result = CookResult::UpToDate;
+                job.format = existing.GetFormat();
+                return;
+            }
+        }
+
+        renderer::StagingImage image;
+        if (!renderer::DecodeImage(source.GetData(), source.GetSize(), image))
+        {
+            job.result = CookResult::Failed;
+            job.message = "decode failed";
+            return;
+        }
+
+        const uint32_t width = image.mips.front().width;
+        const uint32_t height = image.mips.front().height;
+        if (width % 4 != 0 || height % 4 != 0)
+        {
+            //D3D9 wants block-compressed top levels in whole blocks; the runtime keeps decoding this one
+            job.result = CookResult::Failed;
+            job.message = "size is not a multiple of 4";
+            return;
+        }
+
+        renderer::BuildMipChain(image);
+        job.uncompressedBytes = image.GetSizeInBytes();
+
+        uint32_t flags = renderer::CookedTextureFlagNone;
+        switch (ClassifyTexture(slots, job.sourcePath))
+        {
+        case TextureKind::Normal:
+            job.format = renderer::CookedTextureFormat::BC3;
+            flags |= renderer::CookedTextureFlagNormalXY;
+            SwizzleNormalMap(image);
+            break;
+        case TextureKind::Opacity:
+            job.format = renderer::CookedTextureFormat::BC1; //the shader only tests .r against 0.5
+            break;
+        default:
+            job.format = HasAlpha(image) ? renderer::CookedTextureFormat::BC3 : renderer::CookedTextureFormat::BC1;
+            break;
+        }
+
+        const size_t mipCount = (std::min)(image.mips.size(), static_cast<size_t>(renderer::CookedTextureMaxMips));
+        std::vector<std::vector<uint8_t>> levels(mipCount);
+        for (size_t level = 0; level < mipCount; ++level)
+        {
+            const auto& mip = image.mips[level];
+            if (job.format == renderer::CookedTextureFormat::BC1)
+                cooker::CompressBC1(mip.pixels.data(), mip.width, mip.height, levels[level]);
+            else
+                cooker::CompressBC3(mip.pixels.data(), mip.width, mip.height, levels[level]);
+            job.cookedBytes += levels[level].size();
+        }
+
+        if (!renderer::CookedTexture::Write(cookedPath, sourceHash, job.format, flags, width, height, levels))
+        {
+            job.result = CookResult::Failed;
+            job.message = "cannot write " + cookedPath;
+            return;
+        }
+        job.result = CookResult::Cooked;
+    }
+
+    inline double ToMB(size_t bytes) { return static_cast<double>(bytes) / (1024.0 * 1024.0); }
+}
+
+int main(int argc, char** argv)
+{
+    //the main thread decodes alongside the workers in ParallelFor, and WIC needs COM on every decoding thread
+    const HRESULT comResult = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+    bool force = false;
+    std::vector<std::string> directories;
+    std::vector<std::string> modelDirectories;
+    for (int itr = 1; itr < argc; ++itr)
+    {
+        const std::string arg = argv[itr];
+        if (arg == "--force")
+            force = true;
+        else if (arg == "--models" && itr + 1 < argc)
+            modelDirectories.emplace_back(argv[++itr]);
+        else
+            directories.emplace_back(arg);
+    }
+    if (directories.empty())
+        directories = { "data/Content", "data/DefaultTex" };
+    if (modelDirectories.empty())
+        modelDirectories = { "data" };
+
+    //the format follows the material slot a texture is bound to, so the models are read first
+    TextureSlots slots;
+    for (const auto& directory : modelDirectories)
+    {
+        std::error_code error;
+        Assimp::Importer extensionCheck;
+        for (const auto& entry : filesystem::directory_iterator(directory, error))
+        {
+            if (filesystem::is_regular_file(entry.status()) && extensionCheck.IsExtensionSupported(entry.path().extension().string()))
+                CollectTextureSlots(entry.path().generic_string(), slots);
+        }
+        if (error)
+            std::printf("skipping models in %s: %s\n", directory.c_str(), error.message().c_str());
+    }
+
+    std::vector<CookJob> jobs;
+    for (const auto& directory : directories)
+    {
+        std::error_code error;
+        for (const auto& entry : filesystem::directory_iterator(directory, error))
+        {
+            if (ToLower(entry.path().extension().string()) != ".png")
+                continue;
+
+            CookJob job = {};
+            job.sourcePath = entry.path().generic_string();
+            jobs.emplace_back(job);
+        }
+        if (error)
+            std::printf("skipping %s: %s\n", directory.c_str(), error.message().c_str());
+    }
+
+    renderer::Stopwatch stopwatch;
+    auto& threadPool = renderer::ThreadPool::GetInstance();
+    threadPool.ParallelFor(static_cast<uint32_t>(jobs.size()), [&jobs, &slots, force](uint32_t itr)
+        {
+            CookTexture(jobs[itr], slots, force);
+        });
+    const double wallMs = stopwatch.GetElapsedMs();
+
+    uint32_t cooked = 0;
+    uint32_t upToDate = 0;
+    uint32_t failed = 0;
+    size_t uncompressedBytes = 0;
+    size_t cookedBytes = 0;
+    for (const auto& job : jobs)
+    {
+        switch (job.result)
+        {
+        case CookResult::Cooked:
+            ++cooked;
+            uncompressedBytes += job.uncompressedBytes;
+            cookedBytes += job.cookedBytes;
+            std::printf("cooked   %-48s %s %8.2f MB -> %6.2f MB\n", job.sourcePath.c_str(), job.format == renderer::CookedTextureFormat::BC1 ? "BC1" : "BC3",
+                ToMB(job.uncompressedBytes), ToMB(job.cookedBytes));
+            break;
+        case CookResult::UpToDate:
+            ++upToDate;
+            break;
+        default:
+            ++failed;
+            std::printf("failed   %-48s %s\n", job.sourcePath.c_str(), job.message.c_str());
+            break;
+        }
+    }
+
+    std::printf("\n%u cooked, %u up to date, %u failed in %.2f ms on %u threads\n", cooked, upToDate, failed, wallMs, threadPool.GetThreadCount() + 1);
+    if (cookedBytes > 0)
+        std::printf("texture memory: %.2f MB -> %.2f MB (%.2fx smaller)\n", ToMB(uncompressedBytes), ToMB(cookedBytes), static_cast<double>(uncompressedBytes) / cookedBytes);
+
+    if (SUCCEEDED(comResult))
+        CoUninitialize();
+    return failed == 0 ? 0 : 1;
+}